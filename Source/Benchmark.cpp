@@ -0,0 +1,417 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ============
+// scripted camera path, frame time statistics and baseline comparison
+//
+// NOTE: the camera follows a closed Catmull-Rom spline through a handful of
+// viewpoints around the desk, and both the path and the candle animation
+// are driven by the frame index rather than the wall clock, so every run
+// draws exactly the same frames. The results file is written by this class
+// in a fixed layout, and ReadResults() only needs to understand that.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmark.h"
+#include "Logger.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// a viewpoint on the path
+	struct CAMERA_KEY
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	// around the table and back, passing close to the candle and the
+	// book - the first key follows the last
+	const CAMERA_KEY CAMERA_PATH[] =
+	{
+		{ glm::vec3(0.0f, 9.0f, 18.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(13.0f, 6.0f, 11.0f), glm::vec3(0.0f, 1.5f, 0.0f) },
+		{ glm::vec3(4.0f, 3.5f, 4.0f), glm::vec3(0.0f, 2.0f, 0.0f) },
+		{ glm::vec3(14.0f, 4.0f, -6.0f), glm::vec3(0.0f, 1.0f, -1.0f) },
+		{ glm::vec3(0.0f, 12.0f, -14.0f), glm::vec3(0.0f, 0.0f, 0.0f) },
+		{ glm::vec3(-14.0f, 5.0f, -4.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-5.0f, 2.5f, 5.0f), glm::vec3(-1.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-12.0f, 8.0f, 12.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+	};
+	const int CAMERA_KEY_COUNT = (int)(sizeof(CAMERA_PATH) / sizeof(CAMERA_PATH[0]));
+	// seconds between two keys
+	const float SECONDS_PER_KEY = 3.0f;
+
+	const float FIELD_OF_VIEW = 45.0f;
+
+	/***********************************************************
+	 *  CatmullRom()
+	 ***********************************************************/
+	glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+		return(0.5f * ((2.0f * p1) +
+			(p2 - p0) * t +
+			(2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+			(3.0f * p1 - p0 - 3.0f * p2 + p3) * t3));
+	}
+
+	/***********************************************************
+	 *  GetTimings()
+	 *
+	 *  Return the average and the nearest-rank percentiles of
+	 *  the samples.
+	 ***********************************************************/
+	BENCHMARK_TIMINGS GetTimings(std::vector<double> samples)
+	{
+		BENCHMARK_TIMINGS timings;
+		if (samples.empty())
+		{
+			return(timings);
+		}
+
+		std::sort(samples.begin(), samples.end());
+		double total = 0.0;
+		for (double sample : samples)
+		{
+			total += sample;
+		}
+
+		auto percentile = [&samples](double percent)
+		{
+			size_t rank = (size_t)std::ceil(percent / 100.0 * samples.size());
+			return(samples[std::min(std::max(rank, (size_t)1), samples.size()) - 1]);
+		};
+		timings.average = total / samples.size();
+		timings.p50 = percentile(50.0);
+		timings.p95 = percentile(95.0);
+		timings.p99 = percentile(99.0);
+		timings.maximum = samples.back();
+		return(timings);
+	}
+
+	/***********************************************************
+	 *  WriteTimings()
+	 ***********************************************************/
+	void WriteTimings(std::ofstream& file, const char* pName, const BENCHMARK_TIMINGS& timings)
+	{
+		char text[256];
+		snprintf(text, sizeof(text),
+			"  \"%s\": { \"average\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+			pName, timings.average, timings.p50, timings.p95, timings.p99, timings.maximum);
+		file << text;
+	}
+
+	/***********************************************************
+	 *  FindNumber()
+	 *
+	 *  Find "key": number in the text between two positions.
+	 ***********************************************************/
+	bool FindNumber(const std::string& text, size_t begin, size_t end, const char* pKey, double& value)
+	{
+		std::string quotedKey = std::string("\"") + pKey + "\"";
+		size_t keyPosition = text.find(quotedKey, begin);
+		if ((keyPosition == std::string::npos) || (keyPosition >= end))
+		{
+			return(false);
+		}
+		size_t colon = text.find(':', keyPosition + quotedKey.size());
+		if ((colon == std::string::npos) || (colon >= end))
+		{
+			return(false);
+		}
+		char* pEnd = NULL;
+		value = strtod(text.c_str() + colon + 1, &pEnd);
+		return(pEnd != text.c_str() + colon + 1);
+	}
+
+	/***********************************************************
+	 *  FindTimings()
+	 *
+	 *  Read the timings object with the given name.
+	 ***********************************************************/
+	bool FindTimings(const std::string& text, const char* pName, BENCHMARK_TIMINGS& timings)
+	{
+		size_t nameStart = text.find(std::string("\"") + pName + "\"");
+		if (nameStart == std::string::npos)
+		{
+			return(false);
+		}
+		size_t objectStart = text.find('{', nameStart);
+		size_t objectEnd = text.find('}', nameStart);
+		if ((objectStart == std::string::npos) || (objectEnd == std::string::npos))
+		{
+			return(false);
+		}
+
+		return(FindNumber(text, objectStart, objectEnd, "average", timings.average) &&
+			FindNumber(text, objectStart, objectEnd, "p50", timings.p50) &&
+			FindNumber(text, objectStart, objectEnd, "p95", timings.p95) &&
+			FindNumber(text, objectStart, objectEnd, "p99", timings.p99) &&
+			FindNumber(text, objectStart, objectEnd, "max", timings.maximum));
+	}
+
+	/***********************************************************
+	 *  CompareTiming()
+	 *
+	 *  Log one timing next to its baseline. Returns false when
+	 *  it regressed by more than the threshold. Timings missing
+	 *  from either run are skipped.
+	 ***********************************************************/
+	bool CompareTiming(const char* pName, double value, double baseline, double thresholdPercent)
+	{
+		if ((baseline <= 0.0) || (value <= 0.0))
+		{
+			return(true);
+		}
+
+		double changePercent = 100.0 * (value - baseline) / baseline;
+		bool bRegressed = changePercent > thresholdPercent;
+		if (bRegressed)
+		{
+			LOG_ERROR("%-20s %10.3f ms  baseline %10.3f ms  %+7.1f%%  REGRESSION", pName, value, baseline, changePercent);
+		}
+		else
+		{
+			LOG_INFO("%-20s %10.3f ms  baseline %10.3f ms  %+7.1f%%", pName, value, baseline, changePercent);
+		}
+		return(!bRegressed);
+	}
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Benchmark::Benchmark(int frameCount)
+{
+	m_frameCount = std::max(1, frameCount);
+	m_frameMilliseconds.reserve(m_frameCount);
+	m_cpuMilliseconds.reserve(m_frameCount);
+	m_gpuMilliseconds.reserve(m_frameCount);
+}
+
+/***********************************************************
+ *  GetFrameSeconds()
+ ***********************************************************/
+float Benchmark::GetFrameSeconds(int frame)
+{
+	return((float)frame / (float)FRAMES_PER_SECOND);
+}
+
+/***********************************************************
+ *  BuildFrameState()
+ *
+ *  This method places the camera on the path at the frame's
+ *  simulated time.
+ ***********************************************************/
+void Benchmark::BuildFrameState(int frame, int width, int height, FRAME_STATE& frameState) const
+{
+	float pathPosition = std::fmod(GetFrameSeconds(frame) / SECONDS_PER_KEY, (float)CAMERA_KEY_COUNT);
+	int key = (int)pathPosition;
+	float t = pathPosition - (float)key;
+
+	const CAMERA_KEY& key0 = CAMERA_PATH[(key + CAMERA_KEY_COUNT - 1) % CAMERA_KEY_COUNT];
+	const CAMERA_KEY& key1 = CAMERA_PATH[key % CAMERA_KEY_COUNT];
+	const CAMERA_KEY& key2 = CAMERA_PATH[(key + 1) % CAMERA_KEY_COUNT];
+	const CAMERA_KEY& key3 = CAMERA_PATH[(key + 2) % CAMERA_KEY_COUNT];
+	glm::vec3 position = CatmullRom(key0.position, key1.position, key2.position, key3.position, t);
+	glm::vec3 target = CatmullRom(key0.target, key1.target, key2.target, key3.target, t);
+
+	glm::vec3 front = glm::normalize(target - position);
+	frameState.frameNumber = (uint64_t)frame;
+	frameState.deltaTime = 1.0f / (float)FRAMES_PER_SECOND;
+	frameState.framebufferWidth = width;
+	frameState.framebufferHeight = height;
+	frameState.view = glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f));
+	frameState.projection = glm::perspective(
+		glm::radians(FIELD_OF_VIEW),
+		(float)width / (float)std::max(height, 1),
+		0.1f, 100.0f);
+	frameState.viewPosition = position;
+	frameState.bOrthographicProjection = false;
+	frameState.fieldOfView = FIELD_OF_VIEW;
+	frameState.cameraYaw = glm::degrees(std::atan2(front.z, front.x));
+	frameState.cameraPitch = glm::degrees(std::asin(glm::clamp(front.y, -1.0f, 1.0f)));
+}
+
+/***********************************************************
+ *  AddFrame()
+ ***********************************************************/
+void Benchmark::AddFrame(int frame, double frameMilliseconds, double cpuMilliseconds, double gpuMilliseconds)
+{
+	if (frame < WARMUP_FRAMES)
+	{
+		return;
+	}
+
+	m_frameMilliseconds.push_back(frameMilliseconds);
+	m_cpuMilliseconds.push_back(cpuMilliseconds);
+	m_gpuMilliseconds.push_back(gpuMilliseconds);
+}
+
+/***********************************************************
+ *  GetResults()
+ ***********************************************************/
+BENCHMARK_RESULTS Benchmark::GetResults(double startupMilliseconds, int width, int height) const
+{
+	BENCHMARK_RESULTS results;
+	results.frameCount = (int)m_frameMilliseconds.size();
+	results.warmupFrames = WARMUP_FRAMES;
+	results.width = width;
+	results.height = height;
+	results.startupMilliseconds = startupMilliseconds;
+	results.frame = GetTimings(m_frameMilliseconds);
+	results.cpu = GetTimings(m_cpuMilliseconds);
+	results.gpu = GetTimings(m_gpuMilliseconds);
+	return(results);
+}
+
+/***********************************************************
+ *  PrintResults()
+ ***********************************************************/
+void Benchmark::PrintResults(const BENCHMARK_RESULTS& results)
+{
+	LOG_INFO("Benchmark: %d frames at %dx%d after %d warm-up frames, startup %.1f ms",
+		results.frameCount,
+		results.width,
+		results.height,
+		results.warmupFrames,
+		results.startupMilliseconds);
+	LOG_INFO("%-8s %10s %10s %10s %10s %10s", "ms", "average", "p50", "p95", "p99", "max");
+
+	const char* names[] = { "frame", "cpu", "gpu" };
+	const BENCHMARK_TIMINGS* timings[] = { &results.frame, &results.cpu, &results.gpu };
+	for (int i = 0; i < 3; i++)
+	{
+		LOG_INFO("%-8s %10.3f %10.3f %10.3f %10.3f %10.3f",
+			names[i],
+			timings[i]->average,
+			timings[i]->p50,
+			timings[i]->p95,
+			timings[i]->p99,
+			timings[i]->maximum);
+	}
+	LOG_INFO("%llu draws and %llu triangles per frame",
+		(unsigned long long)results.drawCalls,
+		(unsigned long long)results.triangles);
+}
+
+/***********************************************************
+ *  WriteResults()
+ ***********************************************************/
+bool Benchmark::WriteResults(const std::string& filename, const BENCHMARK_RESULTS& results)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		LOG_ERROR("Could not write benchmark results %s", filename.c_str());
+		return(false);
+	}
+
+	char text[256];
+	snprintf(text, sizeof(text),
+		"{\n  \"frames\": %d,\n  \"warmupFrames\": %d,\n  \"width\": %d,\n  \"height\": %d,\n  \"startupMilliseconds\": %.3f,\n  \"drawCalls\": %llu,\n  \"triangles\": %llu,\n",
+		results.frameCount,
+		results.warmupFrames,
+		results.width,
+		results.height,
+		results.startupMilliseconds,
+		(unsigned long long)results.drawCalls,
+		(unsigned long long)results.triangles);
+	file << text;
+	WriteTimings(file, "frameMilliseconds", results.frame);
+	file << ",\n";
+	WriteTimings(file, "cpuMilliseconds", results.cpu);
+	file << ",\n";
+	WriteTimings(file, "gpuMilliseconds", results.gpu);
+	file << "\n}\n";
+	return(file.good());
+}
+
+/***********************************************************
+ *  ReadResults()
+ ***********************************************************/
+bool Benchmark::ReadResults(const std::string& filename, BENCHMARK_RESULTS& results)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		LOG_ERROR("Could not read benchmark baseline %s", filename.c_str());
+		return(false);
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::string text = contents.str();
+
+	double frames = 0.0;
+	double width = 0.0;
+	double height = 0.0;
+	double drawCalls = 0.0;
+	double triangles = 0.0;
+	if (!FindNumber(text, 0, text.size(), "frames", frames) ||
+		!FindNumber(text, 0, text.size(), "width", width) ||
+		!FindNumber(text, 0, text.size(), "height", height) ||
+		!FindNumber(text, 0, text.size(), "startupMilliseconds", results.startupMilliseconds) ||
+		!FindTimings(text, "frameMilliseconds", results.frame) ||
+		!FindTimings(text, "cpuMilliseconds", results.cpu) ||
+		!FindTimings(text, "gpuMilliseconds", results.gpu))
+	{
+		LOG_ERROR("%s is not a benchmark results file", filename.c_str());
+		return(false);
+	}
+	FindNumber(text, 0, text.size(), "drawCalls", drawCalls);
+	FindNumber(text, 0, text.size(), "triangles", triangles);
+
+	results.frameCount = (int)frames;
+	results.width = (int)width;
+	results.height = (int)height;
+	results.drawCalls = (uint64_t)drawCalls;
+	results.triangles = (uint64_t)triangles;
+	return(true);
+}
+
+/***********************************************************
+ *  CompareWithBaseline()
+ ***********************************************************/
+bool Benchmark::CompareWithBaseline(
+	const BENCHMARK_RESULTS& results,
+	const BENCHMARK_RESULTS& baseline,
+	double thresholdPercent)
+{
+	if ((results.width != baseline.width) || (results.height != baseline.height))
+	{
+		LOG_WARNING("The baseline was measured at %dx%d, this run at %dx%d",
+			baseline.width, baseline.height, results.width, results.height);
+	}
+	if ((results.drawCalls != baseline.drawCalls) || (results.triangles != baseline.triangles))
+	{
+		LOG_WARNING("The scene changed since the baseline: %llu draws and %llu triangles, was %llu and %llu",
+			(unsigned long long)results.drawCalls,
+			(unsigned long long)results.triangles,
+			(unsigned long long)baseline.drawCalls,
+			(unsigned long long)baseline.triangles);
+	}
+
+	LOG_INFO("Comparing with the baseline, regression threshold %.1f%%", thresholdPercent);
+	bool bPassed = true;
+	bPassed &= CompareTiming("startup", results.startupMilliseconds, baseline.startupMilliseconds, thresholdPercent);
+	bPassed &= CompareTiming("frame average", results.frame.average, baseline.frame.average, thresholdPercent);
+	bPassed &= CompareTiming("frame p95", results.frame.p95, baseline.frame.p95, thresholdPercent);
+	bPassed &= CompareTiming("frame p99", results.frame.p99, baseline.frame.p99, thresholdPercent);
+	bPassed &= CompareTiming("cpu average", results.cpu.average, baseline.cpu.average, thresholdPercent);
+	bPassed &= CompareTiming("cpu p95", results.cpu.p95, baseline.cpu.p95, thresholdPercent);
+	bPassed &= CompareTiming("gpu average", results.gpu.average, baseline.gpu.average, thresholdPercent);
+	bPassed &= CompareTiming("gpu p95", results.gpu.p95, baseline.gpu.p95, thresholdPercent);
+	return(bPassed);
+}
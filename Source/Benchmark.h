@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ============
+// deterministic fly-through of the desk scene - a scripted camera path on a
+// fixed simulated clock - with frame time percentiles, JSON results and a
+// comparison against a stored baseline
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameState.h"
+
+#include <string>
+#include <vector>
+
+// distribution of one timing over the measured frames, in milliseconds
+struct BENCHMARK_TIMINGS
+{
+	double average = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double maximum = 0.0;
+};
+
+// everything a benchmark run reports
+struct BENCHMARK_RESULTS
+{
+	int frameCount = 0;
+	int warmupFrames = 0;
+	int width = 0;
+	int height = 0;
+	// from launch until the scene was ready to draw
+	double startupMilliseconds = 0.0;
+	// time between frame starts, CPU time spent submitting the frame, and
+	// GPU time of the frame's commands
+	BENCHMARK_TIMINGS frame;
+	BENCHMARK_TIMINGS cpu;
+	BENCHMARK_TIMINGS gpu;
+	// work per frame, so a changed scene is told apart from a slower one
+	uint64_t drawCalls = 0;
+	uint64_t triangles = 0;
+};
+
+class Benchmark
+{
+public:
+	// constructor - the run measures the given number of frames after a
+	// short warm-up
+	Benchmark(int frameCount);
+
+	// frames drawn in all, warm-up included
+	int GetTotalFrames() const { return(WARMUP_FRAMES + m_frameCount); }
+
+	// fill in the camera and animation of the given frame - the same
+	// frame index always gives the same snapshot
+	void BuildFrameState(int frame, int width, int height, FRAME_STATE& frameState) const;
+	// the animation clock of the given frame, in seconds
+	static float GetFrameSeconds(int frame);
+
+	// record the timings of the next frame - warm-up frames are dropped
+	void AddFrame(int frame, double frameMilliseconds, double cpuMilliseconds, double gpuMilliseconds);
+
+	// work out the distributions of the measured frames
+	BENCHMARK_RESULTS GetResults(double startupMilliseconds, int width, int height) const;
+
+	// log the results, and write them to or read them from a JSON file
+	static void PrintResults(const BENCHMARK_RESULTS& results);
+	static bool WriteResults(const std::string& filename, const BENCHMARK_RESULTS& results);
+	static bool ReadResults(const std::string& filename, BENCHMARK_RESULTS& results);
+
+	// log how each timing compares with the baseline. Returns false when
+	// any of them is slower by more than the threshold, in percent.
+	static bool CompareWithBaseline(
+		const BENCHMARK_RESULTS& results,
+		const BENCHMARK_RESULTS& baseline,
+		double thresholdPercent);
+
+	// rate of the simulated clock, and frames drawn before measuring so
+	// that caches and driver state have settled
+	static const int FRAMES_PER_SECOND = 60;
+	static const int WARMUP_FRAMES = 30;
+
+private:
+	int m_frameCount;
+	std::vector<double> m_frameMilliseconds;
+	std::vector<double> m_cpuMilliseconds;
+	std::vector<double> m_gpuMilliseconds;
+};
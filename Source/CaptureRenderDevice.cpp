@@ -0,0 +1,267 @@
+///////////////////////////////////////////////////////////////////////////////
+// capturerenderdevice.cpp
+// ============
+// the recording render device
+//
+// NOTE: a capture file is a header, the resource records and one frame. The
+// header holds the magic, the version and the sizes of the frame and draw
+// constants, which are stored as they sit in memory - a capture only replays
+// in a build with the same layout. Each resource record is its type, the
+// handle the wrapped device returned and the arguments it was created with,
+// including the buffer bytes and texture pixels. The frame is its size and
+// constants, then each command list as a byte count and its command stream.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CaptureRenderDevice.h"
+#include "Logger.h"
+
+#include <fstream>
+
+namespace
+{
+	/***********************************************************
+	 *  Append()
+	 ***********************************************************/
+	template <typename T>
+	void Append(std::vector<unsigned char>& buffer, const T& value)
+	{
+		const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(&value);
+		buffer.insert(buffer.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	/***********************************************************
+	 *  AppendBytes()
+	 ***********************************************************/
+	void AppendBytes(std::vector<unsigned char>& buffer, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+		buffer.insert(buffer.end(), pBytes, pBytes + size);
+	}
+}
+
+/***********************************************************
+ *  CaptureCommandList
+ *
+ *  Encodes each call into its own stream before passing it
+ *  on, so lists recorded on different threads never share
+ *  a buffer.
+ ***********************************************************/
+class CaptureCommandList : public RenderCommandList
+{
+public:
+	void Begin(RenderCommandList* pCommandList)
+	{
+		m_pCommandList = pCommandList;
+		m_stream.clear();
+	}
+
+	virtual void BindPipeline(PIPELINE_HANDLE pipeline)
+	{
+		Append(m_stream, (unsigned char)CAPTURE_BIND_PIPELINE);
+		Append(m_stream, (int32_t)pipeline);
+		m_pCommandList->BindPipeline(pipeline);
+	}
+
+	virtual void BindTexture(TEXTURE_HANDLE texture)
+	{
+		Append(m_stream, (unsigned char)CAPTURE_BIND_TEXTURE);
+		Append(m_stream, (int32_t)texture);
+		m_pCommandList->BindTexture(texture);
+	}
+
+	virtual void BindMesh(BUFFER_HANDLE vertexBuffer, BUFFER_HANDLE indexBuffer)
+	{
+		Append(m_stream, (unsigned char)CAPTURE_BIND_MESH);
+		Append(m_stream, (int32_t)vertexBuffer);
+		Append(m_stream, (int32_t)indexBuffer);
+		m_pCommandList->BindMesh(vertexBuffer, indexBuffer);
+	}
+
+	virtual void SetDrawConstants(const DRAW_CONSTANTS& constants)
+	{
+		Append(m_stream, (unsigned char)CAPTURE_SET_DRAW_CONSTANTS);
+		Append(m_stream, constants);
+		m_pCommandList->SetDrawConstants(constants);
+	}
+
+	virtual void DrawIndexed(uint32_t indexCount)
+	{
+		Append(m_stream, (unsigned char)CAPTURE_DRAW_INDEXED);
+		Append(m_stream, indexCount);
+		m_pCommandList->DrawIndexed(indexCount);
+	}
+
+	const std::vector<unsigned char>& GetStream() const { return(m_stream); }
+
+private:
+	RenderCommandList* m_pCommandList = NULL;
+	std::vector<unsigned char> m_stream;
+};
+
+/***********************************************************
+ *  CaptureRenderDevice()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CaptureRenderDevice::CaptureRenderDevice(RenderDevice* pDevice)
+{
+	m_pDevice = pDevice;
+	m_resourceCount = 0;
+
+	int listCount = m_pDevice->GetMaxCommandLists();
+	for (int i = 0; i < listCount; i++)
+	{
+		m_commandLists.push_back(new CaptureCommandList());
+	}
+}
+
+/***********************************************************
+ *  ~CaptureRenderDevice()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CaptureRenderDevice::~CaptureRenderDevice()
+{
+	for (CaptureCommandList* pCommandList : m_commandLists)
+	{
+		delete pCommandList;
+	}
+	m_commandLists.clear();
+	m_pDevice = NULL;
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ ***********************************************************/
+BUFFER_HANDLE CaptureRenderDevice::CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size)
+{
+	BUFFER_HANDLE buffer = m_pDevice->CreateBuffer(usage, pData, size);
+
+	Append(m_resources, (unsigned char)CAPTURE_RESOURCE_BUFFER);
+	Append(m_resources, (int32_t)buffer);
+	Append(m_resources, (unsigned char)usage);
+	Append(m_resources, (uint64_t)size);
+	AppendBytes(m_resources, pData, size);
+	m_resourceCount++;
+	return(buffer);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ ***********************************************************/
+TEXTURE_HANDLE CaptureRenderDevice::CreateTexture(const TEXTURE_DESC& desc)
+{
+	TEXTURE_HANDLE texture = m_pDevice->CreateTexture(desc);
+
+	Append(m_resources, (unsigned char)CAPTURE_RESOURCE_TEXTURE);
+	Append(m_resources, (int32_t)texture);
+	Append(m_resources, (int32_t)desc.width);
+	Append(m_resources, (int32_t)desc.height);
+	Append(m_resources, (unsigned char)desc.bMipmaps);
+	Append(m_resources, (unsigned char)(NULL != desc.pPixels));
+	if (NULL != desc.pPixels)
+	{
+		AppendBytes(m_resources, desc.pPixels, (size_t)desc.width * desc.height * 4);
+	}
+	m_resourceCount++;
+	return(texture);
+}
+
+/***********************************************************
+ *  CreatePipeline()
+ ***********************************************************/
+PIPELINE_HANDLE CaptureRenderDevice::CreatePipeline(const PIPELINE_DESC& desc)
+{
+	PIPELINE_HANDLE pipeline = m_pDevice->CreatePipeline(desc);
+
+	Append(m_resources, (unsigned char)CAPTURE_RESOURCE_PIPELINE);
+	Append(m_resources, (int32_t)pipeline);
+	Append(m_resources, (unsigned char)desc.bBlend);
+	Append(m_resources, (unsigned char)desc.bDepthWrite);
+	m_resourceCount++;
+	return(pipeline);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ ***********************************************************/
+bool CaptureRenderDevice::BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants)
+{
+	m_frameHeader.clear();
+	Append(m_frameHeader, (int32_t)width);
+	Append(m_frameHeader, (int32_t)height);
+	Append(m_frameHeader, frameConstants);
+	return(m_pDevice->BeginFrame(width, height, frameConstants));
+}
+
+/***********************************************************
+ *  BeginCommandList()
+ ***********************************************************/
+RenderCommandList* CaptureRenderDevice::BeginCommandList(int listIndex)
+{
+	m_commandLists[listIndex]->Begin(m_pDevice->BeginCommandList(listIndex));
+	return(m_commandLists[listIndex]);
+}
+
+/***********************************************************
+ *  EndCommandList()
+ ***********************************************************/
+void CaptureRenderDevice::EndCommandList(int listIndex)
+{
+	m_pDevice->EndCommandList(listIndex);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method keeps the finished frame, replacing the one
+ *  before it, once every list has been recorded.
+ ***********************************************************/
+void CaptureRenderDevice::EndFrame(int listCount)
+{
+	m_lastFrame = m_frameHeader;
+	Append(m_lastFrame, (uint32_t)listCount);
+	for (int i = 0; i < listCount; i++)
+	{
+		const std::vector<unsigned char>& stream = m_commandLists[i]->GetStream();
+		Append(m_lastFrame, (uint64_t)stream.size());
+		AppendBytes(m_lastFrame, stream.data(), stream.size());
+	}
+
+	m_pDevice->EndFrame(listCount);
+}
+
+/***********************************************************
+ *  WriteCapture()
+ ***********************************************************/
+bool CaptureRenderDevice::WriteCapture(const std::string& filename) const
+{
+	if (m_lastFrame.empty())
+	{
+		LOG_ERROR("No frame was rendered to capture into %s", filename.c_str());
+		return(false);
+	}
+
+	std::vector<unsigned char> header;
+	AppendBytes(header, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC));
+	Append(header, CAPTURE_FILE_VERSION);
+	Append(header, (uint32_t)sizeof(FRAME_CONSTANTS));
+	Append(header, (uint32_t)sizeof(DRAW_CONSTANTS));
+	Append(header, m_resourceCount);
+
+	std::ofstream file(filename, std::ios::binary);
+	file.write((const char*)header.data(), header.size());
+	file.write((const char*)m_resources.data(), m_resources.size());
+	file.write((const char*)m_lastFrame.data(), m_lastFrame.size());
+	if (!file)
+	{
+		LOG_ERROR("Could not write capture %s", filename.c_str());
+		return(false);
+	}
+
+	LOG_INFO("Captured %u resources and a %llu byte frame to %s",
+		m_resourceCount,
+		(unsigned long long)m_lastFrame.size(),
+		filename.c_str());
+	return(true);
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// capturerenderdevice.h
+// ============
+// a render device that records everything sent through it - the resources
+// with their contents, and the command lists of the last frame - while
+// passing each call on to the device it wraps, so the stream can be saved
+// and replayed without the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderDevice.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// identifies a capture file, and the layout version it was written with
+const char CAPTURE_FILE_MAGIC[4] = { 'R', 'D', 'C', 'P' };
+const uint32_t CAPTURE_FILE_VERSION = 1;
+
+// kinds of resource records
+enum CAPTURE_RESOURCE_TYPE
+{
+	CAPTURE_RESOURCE_BUFFER,
+	CAPTURE_RESOURCE_TEXTURE,
+	CAPTURE_RESOURCE_PIPELINE
+};
+
+// command list calls, one byte each in the stream, followed by the
+// arguments
+enum CAPTURE_COMMAND_TYPE
+{
+	CAPTURE_BIND_PIPELINE,
+	CAPTURE_BIND_TEXTURE,
+	CAPTURE_BIND_MESH,
+	CAPTURE_SET_DRAW_CONSTANTS,
+	CAPTURE_DRAW_INDEXED
+};
+
+class CaptureCommandList;
+
+class CaptureRenderDevice : public RenderDevice
+{
+public:
+	// constructor - the wrapped device must outlive this one
+	CaptureRenderDevice(RenderDevice* pDevice);
+	// destructor
+	virtual ~CaptureRenderDevice();
+
+	virtual const char* GetName() const { return(m_pDevice->GetName()); }
+
+	virtual BUFFER_HANDLE CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size);
+	virtual TEXTURE_HANDLE CreateTexture(const TEXTURE_DESC& desc);
+	virtual PIPELINE_HANDLE CreatePipeline(const PIPELINE_DESC& desc);
+
+	virtual int GetMaxCommandLists() const { return(m_pDevice->GetMaxCommandLists()); }
+
+	virtual bool BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants);
+	virtual RenderCommandList* BeginCommandList(int listIndex);
+	virtual void EndCommandList(int listIndex);
+	virtual void EndFrame(int listCount);
+
+	virtual void ReadPixels(std::vector<unsigned char>& pixels) { m_pDevice->ReadPixels(pixels); }
+
+	// write the resources and the last frame's command lists to a file
+	bool WriteCapture(const std::string& filename) const;
+
+private:
+	RenderDevice* m_pDevice;
+	std::vector<CaptureCommandList*> m_commandLists;
+
+	// resource records, in creation order
+	std::vector<unsigned char> m_resources;
+	uint32_t m_resourceCount;
+	// the frame being recorded, and the last one finished
+	std::vector<unsigned char> m_frameHeader;
+	std::vector<unsigned char> m_lastFrame;
+};
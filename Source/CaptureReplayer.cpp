@@ -0,0 +1,387 @@
+///////////////////////////////////////////////////////////////////////////////
+// capturereplayer.cpp
+// ============
+// the capture file reader and frame replayer
+//
+// NOTE: everything is decoded when the file is loaded and the handles are
+// patched once the resources exist, so a replayed frame is only the calls
+// to the device. A device that takes fewer command lists than were captured
+// gets the extra lists appended to its last one, in their original order.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CaptureReplayer.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+namespace
+{
+	/***********************************************************
+	 *  Extract()
+	 *
+	 *  Reads the next value, or returns false at the end of the
+	 *  data.
+	 ***********************************************************/
+	template <typename T>
+	bool Extract(const std::vector<unsigned char>& data, size_t& offset, T& value)
+	{
+		if (offset + sizeof(T) > data.size())
+		{
+			return(false);
+		}
+		memcpy(&value, data.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ExtractBytes()
+	 ***********************************************************/
+	bool ExtractBytes(const std::vector<unsigned char>& data, size_t& offset, size_t size, std::vector<unsigned char>& bytes)
+	{
+		if ((size > data.size()) || (offset > data.size() - size))
+		{
+			return(false);
+		}
+		bytes.assign(data.begin() + offset, data.begin() + offset + size);
+		offset += size;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  RemapHandle()
+	 ***********************************************************/
+	int32_t RemapHandle(const std::map<int32_t, int32_t>& handles, int32_t handle)
+	{
+		std::map<int32_t, int32_t>::const_iterator found = handles.find(handle);
+		if (found == handles.end())
+		{
+			return(INVALID_DEVICE_HANDLE);
+		}
+		return(found->second);
+	}
+}
+
+/***********************************************************
+ *  CaptureReplayer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CaptureReplayer::CaptureReplayer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_drawCount = 0;
+}
+
+/***********************************************************
+ *  GetCommandCount()
+ ***********************************************************/
+size_t CaptureReplayer::GetCommandCount() const
+{
+	size_t commandCount = 0;
+	for (const std::vector<REPLAY_COMMAND>& commands : m_commandLists)
+	{
+		commandCount += commands.size();
+	}
+	return(commandCount);
+}
+
+/***********************************************************
+ *  Load()
+ ***********************************************************/
+bool CaptureReplayer::Load(const std::string& filename)
+{
+	m_resources.clear();
+	m_commandLists.clear();
+	m_drawConstants.clear();
+	m_drawCount = 0;
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		LOG_ERROR("Could not read capture %s", filename.c_str());
+		return(false);
+	}
+	std::vector<unsigned char> data(
+		(std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	size_t offset = sizeof(CAPTURE_FILE_MAGIC);
+	uint32_t version = 0;
+	uint32_t frameConstantsSize = 0;
+	uint32_t drawConstantsSize = 0;
+	uint32_t resourceCount = 0;
+	if ((data.size() < sizeof(CAPTURE_FILE_MAGIC)) ||
+		(memcmp(data.data(), CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC)) != 0) ||
+		!Extract(data, offset, version) ||
+		(version != CAPTURE_FILE_VERSION) ||
+		!Extract(data, offset, frameConstantsSize) ||
+		!Extract(data, offset, drawConstantsSize) ||
+		!Extract(data, offset, resourceCount))
+	{
+		LOG_ERROR("%s is not a capture", filename.c_str());
+		return(false);
+	}
+	if ((frameConstantsSize != sizeof(FRAME_CONSTANTS)) || (drawConstantsSize != sizeof(DRAW_CONSTANTS)))
+	{
+		LOG_ERROR("%s was captured by a build with a different constants layout", filename.c_str());
+		return(false);
+	}
+
+	bool bValid = true;
+	for (uint32_t i = 0; (i < resourceCount) && bValid; i++)
+	{
+		CAPTURE_RESOURCE resource;
+		unsigned char type = 0;
+		bValid = Extract(data, offset, type) && Extract(data, offset, resource.handle);
+		resource.type = (CAPTURE_RESOURCE_TYPE)type;
+		if (bValid && (resource.type == CAPTURE_RESOURCE_BUFFER))
+		{
+			unsigned char usage = 0;
+			uint64_t size = 0;
+			bValid = Extract(data, offset, usage) &&
+				Extract(data, offset, size) &&
+				ExtractBytes(data, offset, (size_t)size, resource.data);
+			resource.usage = (BUFFER_USAGE)usage;
+		}
+		else if (bValid && (resource.type == CAPTURE_RESOURCE_TEXTURE))
+		{
+			int32_t width = 0;
+			int32_t height = 0;
+			unsigned char bMipmaps = 0;
+			unsigned char bPixels = 0;
+			bValid = Extract(data, offset, width) &&
+				Extract(data, offset, height) &&
+				Extract(data, offset, bMipmaps) &&
+				Extract(data, offset, bPixels) &&
+				(width > 0) && (height > 0);
+			if (bValid && bPixels)
+			{
+				bValid = ExtractBytes(data, offset, (size_t)width * height * 4, resource.data);
+			}
+			resource.textureDesc.width = width;
+			resource.textureDesc.height = height;
+			resource.textureDesc.bMipmaps = (bMipmaps != 0);
+		}
+		else if (bValid && (resource.type == CAPTURE_RESOURCE_PIPELINE))
+		{
+			unsigned char bBlend = 0;
+			unsigned char bDepthWrite = 0;
+			bValid = Extract(data, offset, bBlend) && Extract(data, offset, bDepthWrite);
+			resource.pipelineDesc.bBlend = (bBlend != 0);
+			resource.pipelineDesc.bDepthWrite = (bDepthWrite != 0);
+		}
+		else
+		{
+			bValid = false;
+		}
+		m_resources.push_back(resource);
+	}
+
+	int32_t width = 0;
+	int32_t height = 0;
+	uint32_t listCount = 0;
+	bValid = bValid &&
+		Extract(data, offset, width) &&
+		Extract(data, offset, height) &&
+		Extract(data, offset, m_frameConstants) &&
+		Extract(data, offset, listCount);
+	m_width = width;
+	m_height = height;
+
+	for (uint32_t i = 0; (i < listCount) && bValid; i++)
+	{
+		uint64_t streamSize = 0;
+		bValid = Extract(data, offset, streamSize) && (streamSize <= data.size() - offset);
+		size_t streamEnd = bValid ? offset + (size_t)streamSize : 0;
+
+		std::vector<REPLAY_COMMAND> commands;
+		while (bValid && (offset < streamEnd))
+		{
+			REPLAY_COMMAND command = REPLAY_COMMAND();
+			unsigned char type = 0;
+			Extract(data, offset, type);
+			command.type = (CAPTURE_COMMAND_TYPE)type;
+			switch (command.type)
+			{
+			case CAPTURE_BIND_PIPELINE:
+			case CAPTURE_BIND_TEXTURE:
+				bValid = Extract(data, offset, command.argument0);
+				break;
+
+			case CAPTURE_BIND_MESH:
+				bValid = Extract(data, offset, command.argument0) && Extract(data, offset, command.argument1);
+				break;
+
+			case CAPTURE_SET_DRAW_CONSTANTS:
+			{
+				DRAW_CONSTANTS constants;
+				bValid = Extract(data, offset, constants);
+				command.argument0 = (int32_t)m_drawConstants.size();
+				m_drawConstants.push_back(constants);
+				break;
+			}
+
+			case CAPTURE_DRAW_INDEXED:
+			{
+				uint32_t indexCount = 0;
+				bValid = Extract(data, offset, indexCount);
+				command.argument0 = (int32_t)indexCount;
+				m_drawCount++;
+				break;
+			}
+
+			default:
+				bValid = false;
+				break;
+			}
+			commands.push_back(command);
+		}
+		bValid = bValid && (offset == streamEnd);
+		m_commandLists.push_back(commands);
+	}
+
+	if (!bValid || (m_width <= 0) || (m_height <= 0) || (offset != data.size()))
+	{
+		LOG_ERROR("%s is damaged or truncated", filename.c_str());
+		m_resources.clear();
+		m_commandLists.clear();
+		return(false);
+	}
+
+	LOG_INFO("Loaded capture %s: %d resources, %d command lists, %d draws at %dx%d",
+		filename.c_str(),
+		(int)m_resources.size(),
+		(int)m_commandLists.size(),
+		(int)m_drawCount,
+		m_width,
+		m_height);
+	return(true);
+}
+
+/***********************************************************
+ *  CreateResources()
+ *
+ *  This method creates the resources in their captured
+ *  order, and rewrites the handles in the commands to the
+ *  ones the device returned. The resource contents are
+ *  released once the device holds them.
+ ***********************************************************/
+bool CaptureReplayer::CreateResources(RenderDevice* pDevice)
+{
+	std::map<int32_t, int32_t> buffers;
+	std::map<int32_t, int32_t> textures;
+	std::map<int32_t, int32_t> pipelines;
+
+	for (CAPTURE_RESOURCE& resource : m_resources)
+	{
+		int32_t handle = INVALID_DEVICE_HANDLE;
+		switch (resource.type)
+		{
+		case CAPTURE_RESOURCE_BUFFER:
+			handle = pDevice->CreateBuffer(resource.usage, resource.data.data(), resource.data.size());
+			buffers[resource.handle] = handle;
+			break;
+
+		case CAPTURE_RESOURCE_TEXTURE:
+			resource.textureDesc.pPixels = resource.data.empty() ? NULL : resource.data.data();
+			handle = pDevice->CreateTexture(resource.textureDesc);
+			textures[resource.handle] = handle;
+			break;
+
+		case CAPTURE_RESOURCE_PIPELINE:
+			handle = pDevice->CreatePipeline(resource.pipelineDesc);
+			pipelines[resource.handle] = handle;
+			break;
+		}
+		if (handle == INVALID_DEVICE_HANDLE)
+		{
+			LOG_ERROR("The %s device could not create a captured resource", pDevice->GetName());
+			return(false);
+		}
+		std::vector<unsigned char>().swap(resource.data);
+	}
+
+	for (std::vector<REPLAY_COMMAND>& commands : m_commandLists)
+	{
+		for (REPLAY_COMMAND& command : commands)
+		{
+			switch (command.type)
+			{
+			case CAPTURE_BIND_PIPELINE:
+				command.argument0 = RemapHandle(pipelines, command.argument0);
+				break;
+
+			case CAPTURE_BIND_TEXTURE:
+				command.argument0 = RemapHandle(textures, command.argument0);
+				break;
+
+			case CAPTURE_BIND_MESH:
+				command.argument0 = RemapHandle(buffers, command.argument0);
+				command.argument1 = RemapHandle(buffers, command.argument1);
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ReplayFrame()
+ ***********************************************************/
+bool CaptureReplayer::ReplayFrame(RenderDevice* pDevice)
+{
+	if (!pDevice->BeginFrame(m_width, m_height, m_frameConstants))
+	{
+		return(false);
+	}
+
+	int capturedLists = (int)m_commandLists.size();
+	int listCount = std::min(capturedLists, pDevice->GetMaxCommandLists());
+	int capturedList = 0;
+	for (int listIndex = 0; listIndex < listCount; listIndex++)
+	{
+		RenderCommandList* pCommandList = pDevice->BeginCommandList(listIndex);
+		int lastCapturedList = (listIndex == listCount - 1) ? capturedLists : capturedList + 1;
+		for (; capturedList < lastCapturedList; capturedList++)
+		{
+			for (const REPLAY_COMMAND& command : m_commandLists[capturedList])
+			{
+				switch (command.type)
+				{
+				case CAPTURE_BIND_PIPELINE:
+					pCommandList->BindPipeline(command.argument0);
+					break;
+
+				case CAPTURE_BIND_TEXTURE:
+					pCommandList->BindTexture(command.argument0);
+					break;
+
+				case CAPTURE_BIND_MESH:
+					pCommandList->BindMesh(command.argument0, command.argument1);
+					break;
+
+				case CAPTURE_SET_DRAW_CONSTANTS:
+					pCommandList->SetDrawConstants(m_drawConstants[command.argument0]);
+					break;
+
+				case CAPTURE_DRAW_INDEXED:
+					pCommandList->DrawIndexed((uint32_t)command.argument0);
+					break;
+				}
+			}
+		}
+		pDevice->EndCommandList(listIndex);
+	}
+
+	pDevice->EndFrame(listCount);
+	return(true);
+}
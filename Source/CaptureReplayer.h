@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// capturereplayer.h
+// ============
+// load a frame captured by the capture render device and submit it again to
+// any render device, with no scene behind it - for timing the command stream
+// on its own against different devices and drivers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CaptureRenderDevice.h"
+
+#include <string>
+#include <vector>
+
+class CaptureReplayer
+{
+public:
+	// constructor
+	CaptureReplayer();
+
+	// read and decode a capture file
+	bool Load(const std::string& filename);
+
+	// create the captured resources on the device, and point the
+	// commands at the handles it returns - called once, before replaying
+	bool CreateResources(RenderDevice* pDevice);
+
+	// submit the captured frame
+	bool ReplayFrame(RenderDevice* pDevice);
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	size_t GetDrawCount() const { return(m_drawCount); }
+	size_t GetCommandCount() const;
+
+private:
+	// a resource as it was created
+	struct CAPTURE_RESOURCE
+	{
+		CAPTURE_RESOURCE_TYPE type;
+		int32_t handle;
+		BUFFER_USAGE usage;
+		TEXTURE_DESC textureDesc;
+		PIPELINE_DESC pipelineDesc;
+		std::vector<unsigned char> data;
+	};
+
+	// one decoded command - the arguments are handles, an index into
+	// the draw constants, or an index count
+	struct REPLAY_COMMAND
+	{
+		CAPTURE_COMMAND_TYPE type;
+		int32_t argument0;
+		int32_t argument1;
+	};
+
+	std::vector<CAPTURE_RESOURCE> m_resources;
+	int m_width;
+	int m_height;
+	FRAME_CONSTANTS m_frameConstants;
+	std::vector<std::vector<REPLAY_COMMAND>> m_commandLists;
+	std::vector<DRAW_CONSTANTS> m_drawConstants;
+	size_t m_drawCount;
+};
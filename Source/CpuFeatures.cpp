@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpufeatures.cpp
+// ============
+// CPUID queries
+//
+// NOTE: this file is built without AVX2 so it can run on any x86 CPU. AVX2
+// needs three things - the AVX2 bit of CPUID leaf 7, the FMA and AVX bits of
+// leaf 1, and the OS having enabled the XMM and YMM state in XCR0, which
+// OSXSAVE says can be read with XGETBV.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace
+{
+	// CPUID leaf 1 ECX bits
+	const uint32_t CPUID_FMA = 1u << 12;
+	const uint32_t CPUID_OSXSAVE = 1u << 27;
+	const uint32_t CPUID_AVX = 1u << 28;
+	// CPUID leaf 7 EBX bit
+	const uint32_t CPUID_AVX2 = 1u << 5;
+	// XCR0 bits for the XMM and YMM register state
+	const uint64_t XCR0_AVX_STATE = 0x6;
+
+	/***********************************************************
+	 *  QueryCpuid()
+	 *
+	 *  Fill EAX, EBX, ECX and EDX for a leaf and subleaf,
+	 *  returning false if the leaf is not supported.
+	 ***********************************************************/
+	bool QueryCpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+	{
+#if defined(_MSC_VER)
+		int values[4];
+		__cpuid(values, 0);
+		if ((uint32_t)values[0] < leaf)
+		{
+			return(false);
+		}
+		__cpuidex(values, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; i++)
+		{
+			registers[i] = (uint32_t)values[i];
+		}
+		return(true);
+#elif defined(__x86_64__) || defined(__i386__)
+		unsigned int a, b, c, d;
+		if (!__get_cpuid_count(leaf, subleaf, &a, &b, &c, &d))
+		{
+			return(false);
+		}
+		registers[0] = a;
+		registers[1] = b;
+		registers[2] = c;
+		registers[3] = d;
+		return(true);
+#else
+		(void)leaf;
+		(void)subleaf;
+		(void)registers;
+		return(false);
+#endif
+	}
+
+	/***********************************************************
+	 *  ReadXcr0()
+	 ***********************************************************/
+	uint64_t ReadXcr0()
+	{
+#if defined(_MSC_VER)
+		return(_xgetbv(0));
+#elif defined(__x86_64__) || defined(__i386__)
+		uint32_t low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return(((uint64_t)high << 32) | low);
+#else
+		return(0);
+#endif
+	}
+
+	/***********************************************************
+	 *  DetectAvx2()
+	 ***********************************************************/
+	bool DetectAvx2()
+	{
+		uint32_t registers[4];
+		if (!QueryCpuid(1, 0, registers))
+		{
+			return(false);
+		}
+		uint32_t leaf1Features = registers[2];
+		if (((leaf1Features & CPUID_FMA) == 0) ||
+			((leaf1Features & CPUID_AVX) == 0) ||
+			((leaf1Features & CPUID_OSXSAVE) == 0))
+		{
+			return(false);
+		}
+		if ((ReadXcr0() & XCR0_AVX_STATE) != XCR0_AVX_STATE)
+		{
+			return(false);
+		}
+
+		if (!QueryCpuid(7, 0, registers))
+		{
+			return(false);
+		}
+		return((registers[1] & CPUID_AVX2) != 0);
+	}
+}
+
+/***********************************************************
+ *  HasAvx2()
+ ***********************************************************/
+bool CpuFeatures::HasAvx2()
+{
+	static const bool bHasAvx2 = DetectAvx2();
+	return(bHasAvx2);
+}
@@ -0,0 +1,15 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpufeatures.h
+// ============
+// what the CPU the program runs on supports, for picking between the AVX2
+// and plain builds of the CPU renderer kernels
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace CpuFeatures
+{
+	// true when the CPU has AVX2 and FMA and the OS saves the AVX
+	// registers - checked once, then cached
+	bool HasAvx2();
+}
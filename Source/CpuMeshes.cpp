@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpumeshes.cpp
+// ============
+// CPU copies of the basic meshes
+//
+// NOTE: the shapes follow the OpenGL basic meshes - the box is a unit cube
+// around the origin, the plane spans -1..1, and the cylinders and cone have
+// radius 1 with their base at y = 0 and top at y = 1, which is what the scene
+// transforms stack on. Caps are mapped with the disc inscribed in the texture.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuMeshes.h"
+
+#include <cmath>
+
+namespace
+{
+	// sides of the round meshes - the cylinder matches the 72 sides
+	// the scene loads it with
+	const int ROUND_MESH_SIDES = 72;
+	const int SPHERE_STACKS = 36;
+
+	const float PI = 3.14159265358979f;
+
+	/***********************************************************
+	 *  AddVertex()
+	 ***********************************************************/
+	uint32_t AddVertex(CPU_MESH& mesh, glm::vec3 position, glm::vec3 normal, glm::vec2 textureCoordinate)
+	{
+		CPU_VERTEX vertex;
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.textureCoordinate = textureCoordinate;
+		mesh.vertices.push_back(vertex);
+		return((uint32_t)mesh.vertices.size() - 1);
+	}
+
+	/***********************************************************
+	 *  AddQuad()
+	 *
+	 *  Add two triangles for the four vertex indices, in order
+	 *  around the quad.
+	 ***********************************************************/
+	void AddQuad(CPU_MESH& mesh, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+	{
+		uint32_t quad[6] = { a, b, c, a, c, d };
+		mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+	}
+
+	/***********************************************************
+	 *  BuildBox()
+	 ***********************************************************/
+	void BuildBox(CPU_MESH& mesh)
+	{
+		// each face as its normal and the two axes across it
+		const glm::vec3 faces[6][3] =
+		{
+			{ glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+			{ glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) },
+			{ glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+			{ glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+			{ glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1) },
+			{ glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) },
+		};
+
+		for (int face = 0; face < 6; face++)
+		{
+			glm::vec3 normal = faces[face][0];
+			glm::vec3 u = faces[face][1];
+			glm::vec3 v = faces[face][2];
+			glm::vec3 center = normal * 0.5f;
+
+			uint32_t a = AddVertex(mesh, center - u * 0.5f - v * 0.5f, normal, glm::vec2(0.0f, 0.0f));
+			uint32_t b = AddVertex(mesh, center + u * 0.5f - v * 0.5f, normal, glm::vec2(1.0f, 0.0f));
+			uint32_t c = AddVertex(mesh, center + u * 0.5f + v * 0.5f, normal, glm::vec2(1.0f, 1.0f));
+			uint32_t d = AddVertex(mesh, center - u * 0.5f + v * 0.5f, normal, glm::vec2(0.0f, 1.0f));
+			AddQuad(mesh, a, b, c, d);
+		}
+	}
+
+	/***********************************************************
+	 *  BuildPlane()
+	 ***********************************************************/
+	void BuildPlane(CPU_MESH& mesh)
+	{
+		glm::vec3 normal(0.0f, 1.0f, 0.0f);
+		uint32_t a = AddVertex(mesh, glm::vec3(-1.0f, 0.0f, 1.0f), normal, glm::vec2(0.0f, 0.0f));
+		uint32_t b = AddVertex(mesh, glm::vec3(1.0f, 0.0f, 1.0f), normal, glm::vec2(1.0f, 0.0f));
+		uint32_t c = AddVertex(mesh, glm::vec3(1.0f, 0.0f, -1.0f), normal, glm::vec2(1.0f, 1.0f));
+		uint32_t d = AddVertex(mesh, glm::vec3(-1.0f, 0.0f, -1.0f), normal, glm::vec2(0.0f, 1.0f));
+		AddQuad(mesh, a, b, c, d);
+	}
+
+	/***********************************************************
+	 *  AddCap()
+	 *
+	 *  Add a flat disc of the given radius at height y, facing
+	 *  up or down.
+	 ***********************************************************/
+	void AddCap(CPU_MESH& mesh, float y, float radius, bool bFacingUp)
+	{
+		glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+		uint32_t center = AddVertex(mesh, glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+		uint32_t first = (uint32_t)mesh.vertices.size();
+
+		for (int side = 0; side <= ROUND_MESH_SIDES; side++)
+		{
+			float angle = 2.0f * PI * (float)side / (float)ROUND_MESH_SIDES;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			AddVertex(mesh, glm::vec3(radius * c, y, radius * s), normal, glm::vec2(0.5f + 0.5f * c, 0.5f + 0.5f * s));
+		}
+		for (int side = 0; side < ROUND_MESH_SIDES; side++)
+		{
+			uint32_t triangle[3] = { center, first + side, first + side + 1 };
+			mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+		}
+	}
+
+	/***********************************************************
+	 *  BuildFrustum()
+	 *
+	 *  Build a capped cylinder from y = 0 to y = 1 with the given
+	 *  bottom and top radius - a cone when the top radius is 0.
+	 ***********************************************************/
+	void BuildFrustum(CPU_MESH& mesh, float bottomRadius, float topRadius)
+	{
+		// the side normal leans out by the change in radius
+		float slope = bottomRadius - topRadius;
+		uint32_t first = (uint32_t)mesh.vertices.size();
+
+		for (int side = 0; side <= ROUND_MESH_SIDES; side++)
+		{
+			float angle = 2.0f * PI * (float)side / (float)ROUND_MESH_SIDES;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			glm::vec3 normal = glm::normalize(glm::vec3(c, slope, s));
+			float u = (float)side / (float)ROUND_MESH_SIDES;
+
+			AddVertex(mesh, glm::vec3(bottomRadius * c, 0.0f, bottomRadius * s), normal, glm::vec2(u, 0.0f));
+			AddVertex(mesh, glm::vec3(topRadius * c, 1.0f, topRadius * s), normal, glm::vec2(u, 1.0f));
+		}
+		for (int side = 0; side < ROUND_MESH_SIDES; side++)
+		{
+			uint32_t bottom = first + 2 * side;
+			AddQuad(mesh, bottom, bottom + 2, bottom + 3, bottom + 1);
+		}
+
+		AddCap(mesh, 0.0f, bottomRadius, false);
+		if (topRadius > 0.0f)
+		{
+			AddCap(mesh, 1.0f, topRadius, true);
+		}
+	}
+
+	/***********************************************************
+	 *  BuildSphere()
+	 ***********************************************************/
+	void BuildSphere(CPU_MESH& mesh)
+	{
+		int slices = ROUND_MESH_SIDES;
+		for (int stack = 0; stack <= SPHERE_STACKS; stack++)
+		{
+			float v = (float)stack / (float)SPHERE_STACKS;
+			float polar = PI * (1.0f - v);
+			for (int slice = 0; slice <= slices; slice++)
+			{
+				float u = (float)slice / (float)slices;
+				float azimuth = 2.0f * PI * u;
+				glm::vec3 normal(
+					std::sin(polar) * std::cos(azimuth),
+					std::cos(polar),
+					std::sin(polar) * std::sin(azimuth));
+				AddVertex(mesh, normal, normal, glm::vec2(u, v));
+			}
+		}
+		for (int stack = 0; stack < SPHERE_STACKS; stack++)
+		{
+			for (int slice = 0; slice < slices; slice++)
+			{
+				uint32_t a = stack * (slices + 1) + slice;
+				uint32_t b = a + slices + 1;
+				AddQuad(mesh, a, a + 1, b + 1, b);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  CpuMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CpuMeshes::CpuMeshes()
+{
+	BuildBox(m_meshes[DRAW_MESH_BOX]);
+	BuildPlane(m_meshes[DRAW_MESH_PLANE]);
+	BuildFrustum(m_meshes[DRAW_MESH_CYLINDER], 1.0f, 1.0f);
+	BuildFrustum(m_meshes[DRAW_MESH_CONE], 1.0f, 0.0f);
+	BuildSphere(m_meshes[DRAW_MESH_SPHERE]);
+	BuildFrustum(m_meshes[DRAW_MESH_TAPERED_CYLINDER], 1.0f, 0.5f);
+}
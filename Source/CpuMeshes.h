@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpumeshes.h
+// ============
+// the basic meshes of the scene as plain vertex and index arrays, for the
+// renderers that run without OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "DrawList.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// a vertex with the attributes the scene vertex shader reads
+struct CPU_VERTEX
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 textureCoordinate;
+};
+
+// an indexed triangle list
+struct CPU_MESH
+{
+	std::vector<CPU_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+};
+
+class CpuMeshes
+{
+public:
+	// constructor - builds every mesh, with the same size, placement and
+	// texture mapping as the OpenGL basic meshes
+	CpuMeshes();
+
+	const CPU_MESH& GetMesh(DRAW_MESH mesh) const { return(m_meshes[mesh]); }
+
+private:
+	CPU_MESH m_meshes[DRAW_MESH_COUNT];
+};
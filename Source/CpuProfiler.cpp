@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpuprofiler.cpp
+// ============
+// per-thread scope buffers and the Chrome trace writer
+//
+// NOTE: a thread's buffer is taken the first time the thread records a
+// scope, so threads that are only named cost nothing until recording
+// starts. New buffers are pushed onto a lock-free list so Stop() can find
+// them. Only the owning thread writes a buffer - it fills the next event
+// and then publishes the new count, so the writer can read any buffer while
+// its thread keeps running. A buffer is never freed, but once its thread
+// has exited and its scopes are written it is handed to the next new
+// thread, so threads that come and go do not add up.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuProfiler.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+
+std::atomic<bool> CpuProfiler::m_bRecording(false);
+
+namespace
+{
+	// scopes each thread can hold - the rest are dropped and counted
+	const uint32_t THREAD_EVENT_CAPACITY = 1 << 15;
+
+	// one finished scope
+	struct TRACE_EVENT
+	{
+		const char* pName;
+		int64_t startTime;
+		int64_t endTime;
+	};
+
+	// who a buffer belongs to, changed under g_ControlMutex
+	enum BUFFER_STATE
+	{
+		BUFFER_OWNED,
+		// the thread exited with scopes still to be written
+		BUFFER_EXITED,
+		// free for the next thread to take
+		BUFFER_FREE
+	};
+
+	// the scopes of one thread
+	struct THREAD_BUFFER
+	{
+		TRACE_EVENT events[THREAD_EVENT_CAPACITY];
+		std::atomic<uint32_t> eventCount;
+		std::atomic<uint32_t> droppedCount;
+		std::atomic<const char*> pThreadName;
+		int threadId;
+		// events already written by an earlier Stop() - the count is
+		// only ever advanced by the owning thread, and only reset when
+		// the buffer is handed to a new thread
+		uint32_t writtenCount;
+		uint32_t writtenDroppedCount;
+		BUFFER_STATE state;
+		THREAD_BUFFER* pNext;
+	};
+
+	/***********************************************************
+	 *  THREAD_BUFFER_RELEASE
+	 *
+	 *  Gives the calling thread's buffer up when the thread
+	 *  exits.
+	 ***********************************************************/
+	struct THREAD_BUFFER_RELEASE
+	{
+		~THREAD_BUFFER_RELEASE();
+	};
+
+	// every thread buffer, newest first
+	std::atomic<THREAD_BUFFER*> g_pThreadBuffers(NULL);
+	std::atomic<int> g_nextThreadId(1);
+	thread_local THREAD_BUFFER* t_pThreadBuffer = NULL;
+	// the thread's name, kept until it has a buffer
+	thread_local const char* t_pThreadName = NULL;
+	thread_local THREAD_BUFFER_RELEASE t_threadBufferRelease;
+
+	// clock the trace timestamps are relative to
+	const std::chrono::steady_clock::time_point g_TraceStartTime = std::chrono::steady_clock::now();
+
+	std::string g_TraceFilename;
+	// Start() and Stop() may come from different threads
+	std::mutex g_ControlMutex;
+
+	/***********************************************************
+	 *  GetThreadBuffer()
+	 *
+	 *  Returns the calling thread's buffer, taking a free one
+	 *  or creating one the first time.
+	 ***********************************************************/
+	THREAD_BUFFER* GetThreadBuffer()
+	{
+		if (NULL == t_pThreadBuffer)
+		{
+			std::lock_guard<std::mutex> lock(g_ControlMutex);
+
+			THREAD_BUFFER* pBuffer = g_pThreadBuffers.load(std::memory_order_acquire);
+			while ((NULL != pBuffer) && (pBuffer->state != BUFFER_FREE))
+			{
+				pBuffer = pBuffer->pNext;
+			}
+
+			bool bCreated = (NULL == pBuffer);
+			if (bCreated)
+			{
+				// the events are left uninitialized so that untouched
+				// pages are never committed
+				pBuffer = new THREAD_BUFFER;
+			}
+			pBuffer->eventCount.store(0, std::memory_order_relaxed);
+			pBuffer->droppedCount.store(0, std::memory_order_relaxed);
+			pBuffer->pThreadName.store(t_pThreadName, std::memory_order_relaxed);
+			pBuffer->threadId = g_nextThreadId++;
+			pBuffer->writtenCount = 0;
+			pBuffer->writtenDroppedCount = 0;
+			pBuffer->state = BUFFER_OWNED;
+
+			if (bCreated)
+			{
+				pBuffer->pNext = g_pThreadBuffers.load(std::memory_order_relaxed);
+				while (!g_pThreadBuffers.compare_exchange_weak(
+					pBuffer->pNext, pBuffer, std::memory_order_release, std::memory_order_relaxed))
+				{
+				}
+			}
+			t_pThreadBuffer = pBuffer;
+			// touched so that its destructor runs when the thread exits
+			(void)&t_threadBufferRelease;
+		}
+		return(t_pThreadBuffer);
+	}
+
+	/***********************************************************
+	 *  ~THREAD_BUFFER_RELEASE()
+	 ***********************************************************/
+	THREAD_BUFFER_RELEASE::~THREAD_BUFFER_RELEASE()
+	{
+		if (NULL == t_pThreadBuffer)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(g_ControlMutex);
+		bool bWritten = (t_pThreadBuffer->eventCount.load(std::memory_order_relaxed) == t_pThreadBuffer->writtenCount);
+		t_pThreadBuffer->state = bWritten ? BUFFER_FREE : BUFFER_EXITED;
+		t_pThreadBuffer = NULL;
+	}
+
+	/***********************************************************
+	 *  WriteJsonString()
+	 ***********************************************************/
+	void WriteJsonString(std::ofstream& file, const char* pText)
+	{
+		file << '"';
+		for (const char* p = pText; *p != '\0'; p++)
+		{
+			if ((*p == '"') || (*p == '\\'))
+			{
+				file << '\\';
+			}
+			if ((unsigned char)*p >= 0x20)
+			{
+				file << *p;
+			}
+		}
+		file << '"';
+	}
+}
+
+/***********************************************************
+ *  Start()
+ ***********************************************************/
+void CpuProfiler::Start(const std::string& traceFilename)
+{
+	std::lock_guard<std::mutex> lock(g_ControlMutex);
+#if !CPU_PROFILER_ENABLED
+	LOG_WARNING("This build has no CPU profiling scopes, %s will be empty", traceFilename.c_str());
+#endif
+	g_TraceFilename = traceFilename;
+	m_bRecording.store(true, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method stops recording and writes every thread's
+ *  scopes as complete ("X") trace events, with a metadata
+ *  event naming each thread.
+ ***********************************************************/
+void CpuProfiler::Stop()
+{
+	std::lock_guard<std::mutex> lock(g_ControlMutex);
+	if (!m_bRecording.exchange(false))
+	{
+		return;
+	}
+
+	std::ofstream file(g_TraceFilename);
+	if (!file)
+	{
+		LOG_ERROR("Could not write trace %s", g_TraceFilename.c_str());
+		return;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool bFirst = true;
+	uint64_t eventCount = 0;
+	uint64_t droppedCount = 0;
+	for (THREAD_BUFFER* pBuffer = g_pThreadBuffers.load(std::memory_order_acquire); NULL != pBuffer; pBuffer = pBuffer->pNext)
+	{
+		// a free buffer has nothing left to write
+		if (pBuffer->state == BUFFER_FREE)
+		{
+			continue;
+		}
+
+		const char* pThreadName = pBuffer->pThreadName.load(std::memory_order_relaxed);
+		if (NULL != pThreadName)
+		{
+			file << (bFirst ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << pBuffer->threadId << ",\"args\":{\"name\":";
+			WriteJsonString(file, pThreadName);
+			file << "}}";
+			bFirst = false;
+		}
+
+		uint32_t count = pBuffer->eventCount.load(std::memory_order_acquire);
+		for (uint32_t i = pBuffer->writtenCount; i < count; i++)
+		{
+			const TRACE_EVENT& event = pBuffer->events[i];
+			char times[64];
+			snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+				event.startTime / 1000.0,
+				(event.endTime - event.startTime) / 1000.0);
+
+			file << (bFirst ? "" : ",\n") << "{\"ph\":\"X\",\"name\":";
+			WriteJsonString(file, event.pName);
+			file << ",\"pid\":1,\"tid\":" << pBuffer->threadId << "," << times << "}";
+			bFirst = false;
+		}
+		uint32_t dropped = pBuffer->droppedCount.load(std::memory_order_relaxed);
+		eventCount += count - pBuffer->writtenCount;
+		droppedCount += dropped - pBuffer->writtenDroppedCount;
+		pBuffer->writtenCount = count;
+		pBuffer->writtenDroppedCount = dropped;
+
+		// an exited thread's buffer is free once its scopes are out
+		if (pBuffer->state == BUFFER_EXITED)
+		{
+			pBuffer->state = BUFFER_FREE;
+		}
+	}
+	file << "\n]}\n";
+
+	LOG_INFO("Wrote %llu CPU scopes to %s", (unsigned long long)eventCount, g_TraceFilename.c_str());
+	if (droppedCount > 0)
+	{
+		LOG_WARNING("%llu CPU scopes were dropped, a thread's buffer was full", (unsigned long long)droppedCount);
+	}
+}
+
+/***********************************************************
+ *  GetTimestamp()
+ ***********************************************************/
+int64_t CpuProfiler::GetTimestamp()
+{
+	return(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - g_TraceStartTime).count());
+}
+
+/***********************************************************
+ *  RecordScope()
+ ***********************************************************/
+void CpuProfiler::RecordScope(const char* pName, int64_t startTime, int64_t endTime)
+{
+	THREAD_BUFFER* pBuffer = GetThreadBuffer();
+	uint32_t count = pBuffer->eventCount.load(std::memory_order_relaxed);
+	if (count >= THREAD_EVENT_CAPACITY)
+	{
+		pBuffer->droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	TRACE_EVENT& event = pBuffer->events[count];
+	event.pName = pName;
+	event.startTime = startTime;
+	event.endTime = endTime;
+	pBuffer->eventCount.store(count + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  SetThreadName()
+ ***********************************************************/
+void CpuProfiler::SetThreadName(const char* pName)
+{
+	t_pThreadName = pName;
+	if (NULL != t_pThreadBuffer)
+	{
+		t_pThreadBuffer->pThreadName.store(pName, std::memory_order_relaxed);
+	}
+}
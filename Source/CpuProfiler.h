@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// cpuprofiler.h
+// ============
+// scoped CPU timing on every thread, written out as a Chrome trace
+//
+//  Each thread records into a buffer of its own with no locks, and Stop()
+//  writes every thread's scopes as trace-event JSON that chrome://tracing
+//  and Perfetto open. Scopes cost a clock read and a store while recording
+//  and almost nothing otherwise, and building with CPU_PROFILER_ENABLED set
+//  to 0 removes the macros entirely.
+//
+//  Usage:
+//      PROFILE_THREAD_NAME("render");
+//      PROFILE_SCOPE("RenderScene");
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// scopes are compiled in unless this is defined to 0
+#ifndef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_ENABLED 1
+#endif
+
+class CpuProfiler
+{
+public:
+	// start recording scopes on every thread, to be written to the
+	// given file by Stop()
+	static void Start(const std::string& traceFilename);
+	// stop recording and write the trace - does nothing if recording
+	// never started
+	static void Stop();
+
+	// true between Start() and Stop()
+	static bool IsRecording() { return(m_bRecording.load(std::memory_order_relaxed)); }
+
+	// nanoseconds on the clock the trace is measured with
+	static int64_t GetTimestamp();
+	// add a finished scope to the calling thread's buffer. The name is
+	// kept, so a string literal is expected.
+	static void RecordScope(const char* pName, int64_t startTime, int64_t endTime);
+	// name the calling thread in the trace
+	static void SetThreadName(const char* pName);
+
+private:
+	static std::atomic<bool> m_bRecording;
+};
+
+/***********************************************************
+ *  CpuProfileScope
+ *
+ *  Records the time between its construction and its end
+ *  as a scope of the calling thread.
+ ***********************************************************/
+class CpuProfileScope
+{
+public:
+	CpuProfileScope(const char* pName)
+	{
+		m_pName = pName;
+		m_startTime = CpuProfiler::IsRecording() ? CpuProfiler::GetTimestamp() : -1;
+	}
+
+	~CpuProfileScope()
+	{
+		if (m_startTime >= 0)
+		{
+			CpuProfiler::RecordScope(m_pName, m_startTime, CpuProfiler::GetTimestamp());
+		}
+	}
+
+private:
+	const char* m_pName;
+	int64_t m_startTime;
+};
+
+#if CPU_PROFILER_ENABLED
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) CpuProfiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#endif
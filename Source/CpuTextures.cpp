@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// cputextures.cpp
+// ============
+// load the scene textures into memory for the CPU renderers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuTextures.h"
+#include "SceneManager.h"
+#include "Logger.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method loads the scene texture files in the order
+ *  the draw list indexes them, as RGBA8 with the bottom row
+ *  first like the OpenGL textures, and box filters each one
+ *  down to a 1x1 mip level.
+ ***********************************************************/
+bool CpuTextures::Load()
+{
+	bool bAllLoaded = true;
+	int textureCount = SceneManager::GetSceneTextureCount();
+	m_textures.assign(textureCount, CPU_TEXTURE());
+
+	stbi_set_flip_vertically_on_load(true);
+
+	for (int i = 0; i < textureCount; i++)
+	{
+		const SceneManager::TEXTURE_FILE& textureFile = SceneManager::GetSceneTextureFile(i);
+		CPU_TEXTURE& texture = m_textures[i];
+		texture.levelCount = 0;
+
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		unsigned char* image = stbi_load(textureFile.filename, &width, &height, &colorChannels, 4);
+		if (NULL == image)
+		{
+			LOG_ERROR("Failed to load texture: %s", textureFile.filename);
+			bAllLoaded = false;
+			continue;
+		}
+
+		// the full chain is under 4/3 of the base level
+		texture.texels.reserve((size_t)width * height * 4 / 3 + 16);
+		texture.texels.resize((size_t)width * height);
+		memcpy(texture.texels.data(), image, (size_t)width * height * 4);
+		stbi_image_free(image);
+
+		texture.levelOffsets[0] = 0;
+		texture.levelWidths[0] = width;
+		texture.levelHeights[0] = height;
+		texture.levelCount = 1;
+
+		while (((width > 1) || (height > 1)) && (texture.levelCount < 16))
+		{
+			int sourceOffset = texture.levelOffsets[texture.levelCount - 1];
+			int sourceWidth = width;
+			int sourceHeight = height;
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+
+			int offset = (int)texture.texels.size();
+			texture.texels.resize(texture.texels.size() + (size_t)width * height);
+
+			for (int y = 0; y < height; y++)
+			{
+				int y0 = std::min(2 * y, sourceHeight - 1);
+				int y1 = std::min(2 * y + 1, sourceHeight - 1);
+				for (int x = 0; x < width; x++)
+				{
+					int x0 = std::min(2 * x, sourceWidth - 1);
+					int x1 = std::min(2 * x + 1, sourceWidth - 1);
+					const int32_t* pSource = &texture.texels[sourceOffset];
+					uint32_t texels[4] = {
+						(uint32_t)pSource[y0 * sourceWidth + x0],
+						(uint32_t)pSource[y0 * sourceWidth + x1],
+						(uint32_t)pSource[y1 * sourceWidth + x0],
+						(uint32_t)pSource[y1 * sourceWidth + x1] };
+
+					uint32_t average = 0;
+					for (int shift = 0; shift < 32; shift += 8)
+					{
+						uint32_t sum = 2;
+						for (int k = 0; k < 4; k++)
+						{
+							sum += (texels[k] >> shift) & 0xFF;
+						}
+						average |= (sum / 4) << shift;
+					}
+					texture.texels[offset + y * width + x] = (int32_t)average;
+				}
+			}
+
+			texture.levelOffsets[texture.levelCount] = offset;
+			texture.levelWidths[texture.levelCount] = width;
+			texture.levelHeights[texture.levelCount] = height;
+			texture.levelCount++;
+		}
+	}
+
+	return(bAllLoaded);
+}
+
+/***********************************************************
+ *  Get()
+ ***********************************************************/
+const CPU_TEXTURE* CpuTextures::Get(int index) const
+{
+	if ((index < 0) || (index >= (int)m_textures.size()) || (m_textures[index].levelCount == 0))
+	{
+		return(NULL);
+	}
+	return(&m_textures[index]);
+}
+
+/***********************************************************
+ *  Sample()
+ *
+ *  This method filters the top level bilinearly with the
+ *  coordinates wrapped, as GL_REPEAT does, and returns the
+ *  color in [0, 1].
+ ***********************************************************/
+glm::vec4 CpuTextures::Sample(const CPU_TEXTURE& texture, const glm::vec2& textureCoordinate)
+{
+	int width = texture.levelWidths[0];
+	int height = texture.levelHeights[0];
+
+	float texelX = (textureCoordinate.x - std::floor(textureCoordinate.x)) * (float)width - 0.5f;
+	float texelY = (textureCoordinate.y - std::floor(textureCoordinate.y)) * (float)height - 0.5f;
+	if (!std::isfinite(texelX) || !std::isfinite(texelY))
+	{
+		texelX = 0.0f;
+		texelY = 0.0f;
+	}
+	float floorX = std::floor(texelX);
+	float floorY = std::floor(texelY);
+	float fractionX = texelX - floorX;
+	float fractionY = texelY - floorY;
+
+	int x0 = ((int)floorX + width) % width;
+	int y0 = ((int)floorY + height) % height;
+	int x1 = (x0 + 1) % width;
+	int y1 = (y0 + 1) % height;
+	uint32_t texels[4] = {
+		(uint32_t)texture.texels[y0 * width + x0],
+		(uint32_t)texture.texels[y0 * width + x1],
+		(uint32_t)texture.texels[y1 * width + x0],
+		(uint32_t)texture.texels[y1 * width + x1] };
+
+	glm::vec4 color;
+	for (int channel = 0; channel < 4; channel++)
+	{
+		int shift = channel * 8;
+		float t00 = (float)((texels[0] >> shift) & 0xFF);
+		float t10 = (float)((texels[1] >> shift) & 0xFF);
+		float t01 = (float)((texels[2] >> shift) & 0xFF);
+		float t11 = (float)((texels[3] >> shift) & 0xFF);
+		float bottom = t00 + (t10 - t00) * fractionX;
+		float top = t01 + (t11 - t01) * fractionX;
+		color[channel] = (bottom + (top - bottom) * fractionY) * (1.0f / 255.0f);
+	}
+	return(color);
+}
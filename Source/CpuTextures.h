@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// cputextures.h
+// ============
+// the scene textures as plain RGBA8 arrays, for the renderers that run
+// without OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// an RGBA8 texture, red in the low byte, bottom row first, with its mip
+// chain stored one level after another
+struct CPU_TEXTURE
+{
+	std::vector<int32_t> texels;
+	int levelCount;
+	int levelOffsets[16];
+	int levelWidths[16];
+	int levelHeights[16];
+};
+
+class CpuTextures
+{
+public:
+	// load the scene textures in the order the draw list indexes them,
+	// and build their mipmaps. Returns false if any failed to load.
+	bool Load();
+
+	// the texture for a draw list index, or NULL if it did not load
+	const CPU_TEXTURE* Get(int index) const;
+
+	// bilinear sample of the top level with repeat wrapping
+	static glm::vec4 Sample(const CPU_TEXTURE& texture, const glm::vec2& textureCoordinate);
+
+private:
+	std::vector<CPU_TEXTURE> m_textures;
+};
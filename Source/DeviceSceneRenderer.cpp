@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+// devicescenerenderer.cpp
+// ============
+// submit the scene's draw list through a render device
+//
+// NOTE: each command list starts from nothing bound, so every run binds its
+// own pipeline and mesh first. Runs are contiguous slices of the draw list
+// and the device submits them in order, so blended draws still land on top
+// of everything drawn before them.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeviceSceneRenderer.h"
+#include "CpuMeshes.h"
+#include "CpuTextures.h"
+#include "Logger.h"
+#include "SceneManager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/***********************************************************
+ *  DeviceSceneRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeviceSceneRenderer::DeviceSceneRenderer(RenderDevice* pDevice, int recordThreadCount)
+{
+	m_pDevice = pDevice;
+
+	// the calling thread works alongside the pool
+	if (recordThreadCount <= 0)
+	{
+		recordThreadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	m_threadCount = recordThreadCount;
+	m_pThreadPool = new ThreadPool(std::max(1, recordThreadCount - 1));
+
+	for (int i = 0; i < DRAW_MESH_COUNT; i++)
+	{
+		m_vertexBuffers[i] = INVALID_DEVICE_HANDLE;
+		m_indexBuffers[i] = INVALID_DEVICE_HANDLE;
+		m_indexCounts[i] = 0;
+	}
+	m_opaquePipeline = INVALID_DEVICE_HANDLE;
+	m_blendPipeline = INVALID_DEVICE_HANDLE;
+	m_lastListCount = 0;
+	m_lastRecordMilliseconds = 0.0;
+}
+
+/***********************************************************
+ *  ~DeviceSceneRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeviceSceneRenderer::~DeviceSceneRenderer()
+{
+	if (NULL != m_pThreadPool)
+	{
+		delete m_pThreadPool;
+		m_pThreadPool = NULL;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ ***********************************************************/
+bool DeviceSceneRenderer::Create()
+{
+	CpuMeshes meshes;
+	for (int i = 0; i < DRAW_MESH_COUNT; i++)
+	{
+		const CPU_MESH& mesh = meshes.GetMesh((DRAW_MESH)i);
+		m_vertexBuffers[i] = m_pDevice->CreateBuffer(
+			BUFFER_USAGE_VERTEX,
+			mesh.vertices.data(),
+			mesh.vertices.size() * sizeof(CPU_VERTEX));
+		m_indexBuffers[i] = m_pDevice->CreateBuffer(
+			BUFFER_USAGE_INDEX,
+			mesh.indices.data(),
+			mesh.indices.size() * sizeof(uint32_t));
+		m_indexCounts[i] = (uint32_t)mesh.indices.size();
+		if ((INVALID_DEVICE_HANDLE == m_vertexBuffers[i]) || (INVALID_DEVICE_HANDLE == m_indexBuffers[i]))
+		{
+			return(false);
+		}
+	}
+
+	// a texture that fails to load draws with the flat color instead
+	CpuTextures textures;
+	textures.Load();
+	m_textures.assign(SceneManager::GetSceneTextureCount(), INVALID_DEVICE_HANDLE);
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		const CPU_TEXTURE* pTexture = textures.Get(i);
+		if (NULL != pTexture)
+		{
+			TEXTURE_DESC desc;
+			desc.width = pTexture->levelWidths[0];
+			desc.height = pTexture->levelHeights[0];
+			desc.pPixels = pTexture->texels.data();
+			desc.bMipmaps = true;
+			m_textures[i] = m_pDevice->CreateTexture(desc);
+		}
+	}
+
+	PIPELINE_DESC opaqueDesc;
+	m_opaquePipeline = m_pDevice->CreatePipeline(opaqueDesc);
+	PIPELINE_DESC blendDesc;
+	blendDesc.bBlend = true;
+	blendDesc.bDepthWrite = false;
+	m_blendPipeline = m_pDevice->CreatePipeline(blendDesc);
+	return((INVALID_DEVICE_HANDLE != m_opaquePipeline) && (INVALID_DEVICE_HANDLE != m_blendPipeline));
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method splits the draw list into one contiguous run
+ *  per command list, records the runs in parallel and hands
+ *  them to the device to submit in order.
+ ***********************************************************/
+bool DeviceSceneRenderer::Render(
+	const DRAW_LIST& drawList,
+	int width,
+	int height,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	FRAME_CONSTANTS frameConstants;
+	frameConstants.view = view;
+	frameConstants.projection = projection;
+	frameConstants.viewPosition = viewPosition;
+	frameConstants.clearColor = drawList.clearColor;
+	frameConstants.bUseLighting = drawList.bUseLighting;
+	frameConstants.lights = drawList.lights;
+	if (!m_pDevice->BeginFrame(width, height, frameConstants))
+	{
+		return(false);
+	}
+
+	const std::vector<DRAW_COMMAND>& commands = drawList.commands;
+	int drawCount = (int)commands.size();
+	int listCount = (drawCount + MIN_DRAWS_PER_LIST - 1) / MIN_DRAWS_PER_LIST;
+	listCount = std::min(listCount, std::min(m_threadCount, m_pDevice->GetMaxCommandLists()));
+
+	auto recordStart = std::chrono::steady_clock::now();
+	RunParallel(listCount, [&](int listIndex)
+		{
+			int first = (int)((int64_t)drawCount * listIndex / listCount);
+			int last = (int)((int64_t)drawCount * (listIndex + 1) / listCount);
+			RenderCommandList* pCommandList = m_pDevice->BeginCommandList(listIndex);
+			RecordDraws(pCommandList, commands, first, last - first);
+			m_pDevice->EndCommandList(listIndex);
+		});
+	m_lastRecordMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - recordStart).count();
+	m_lastListCount = listCount;
+
+	m_pDevice->EndFrame(listCount);
+	return(true);
+}
+
+/***********************************************************
+ *  RecordDraws()
+ *
+ *  This method records a run of draws, only binding what
+ *  changes from one draw to the next.
+ ***********************************************************/
+void DeviceSceneRenderer::RecordDraws(
+	RenderCommandList* pCommandList,
+	const std::vector<DRAW_COMMAND>& commands,
+	int first,
+	int count) const
+{
+	PIPELINE_HANDLE boundPipeline = INVALID_DEVICE_HANDLE;
+	TEXTURE_HANDLE boundTexture = INVALID_DEVICE_HANDLE;
+	int boundMesh = -1;
+
+	for (int i = first; i < first + count; i++)
+	{
+		const DRAW_COMMAND& command = commands[i];
+
+		PIPELINE_HANDLE pipeline = command.bBlend ? m_blendPipeline : m_opaquePipeline;
+		if (pipeline != boundPipeline)
+		{
+			pCommandList->BindPipeline(pipeline);
+			boundPipeline = pipeline;
+		}
+
+		TEXTURE_HANDLE texture = INVALID_DEVICE_HANDLE;
+		if (command.bUseTexture && (command.textureIndex >= 0) && (command.textureIndex < (int)m_textures.size()))
+		{
+			texture = m_textures[command.textureIndex];
+		}
+		if ((INVALID_DEVICE_HANDLE != texture) && (texture != boundTexture))
+		{
+			pCommandList->BindTexture(texture);
+			boundTexture = texture;
+		}
+
+		if ((int)command.mesh != boundMesh)
+		{
+			pCommandList->BindMesh(m_vertexBuffers[command.mesh], m_indexBuffers[command.mesh]);
+			boundMesh = (int)command.mesh;
+		}
+
+		DRAW_CONSTANTS constants;
+		constants.model = command.model;
+		constants.color = command.color;
+		constants.uvScale = command.uvScale;
+		constants.bUseTexture = (INVALID_DEVICE_HANDLE != texture) ? 1 : 0;
+		constants.shininess = command.material.shininess;
+		constants.diffuseColor = glm::vec4(command.material.diffuseColor, 0.0f);
+		constants.specularColor = glm::vec4(command.material.specularColor, 0.0f);
+		pCommandList->SetDrawConstants(constants);
+
+		pCommandList->DrawIndexed(m_indexCounts[command.mesh]);
+	}
+}
+
+/***********************************************************
+ *  RunParallel()
+ ***********************************************************/
+void DeviceSceneRenderer::RunParallel(int taskCount, const std::function<void(int)>& task)
+{
+	std::atomic<int> nextTask(0);
+	auto worker = [&]()
+		{
+			int taskIndex;
+			while ((taskIndex = nextTask++) < taskCount)
+			{
+				task(taskIndex);
+			}
+		};
+
+	int workerCount = std::min(taskCount, m_threadCount) - 1;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_pThreadPool->Submit(worker);
+	}
+	worker();
+	m_pThreadPool->WaitIdle();
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// devicescenerenderer.h
+// ============
+// submit the scene's draw list through a render device - the meshes and
+// textures are uploaded once, and each frame's draws are split into runs
+// that are recorded into command lists on several threads at once
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "DrawList.h"
+#include "RenderDevice.h"
+#include "ThreadPool.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+class DeviceSceneRenderer
+{
+public:
+	// constructor - the device must outlive the renderer. A record thread
+	// count of zero uses every hardware thread.
+	DeviceSceneRenderer(RenderDevice* pDevice, int recordThreadCount);
+	// destructor
+	~DeviceSceneRenderer();
+
+	// upload the basic meshes and scene textures and create the opaque
+	// and blended pipelines. Returns false if the device failed.
+	bool Create();
+
+	// record and submit a frame's draw list with the given camera
+	bool Render(
+		const DRAW_LIST& drawList,
+		int width,
+		int height,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+
+	int GetThreadCount() const { return(m_threadCount); }
+	// command lists the last frame was split into
+	int GetLastListCount() const { return(m_lastListCount); }
+	// time spent recording the last frame's command lists
+	double GetLastRecordMilliseconds() const { return(m_lastRecordMilliseconds); }
+
+	// fewest draws given to a command list of their own - below this the
+	// cost of a list outweighs recording in parallel
+	static const int MIN_DRAWS_PER_LIST = 16;
+
+private:
+	RenderDevice* m_pDevice;
+	ThreadPool* m_pThreadPool;
+	// pool threads used, plus the calling thread
+	int m_threadCount;
+
+	BUFFER_HANDLE m_vertexBuffers[DRAW_MESH_COUNT];
+	BUFFER_HANDLE m_indexBuffers[DRAW_MESH_COUNT];
+	uint32_t m_indexCounts[DRAW_MESH_COUNT];
+	// device texture for each scene texture, INVALID_DEVICE_HANDLE for
+	// any that did not load
+	std::vector<TEXTURE_HANDLE> m_textures;
+	PIPELINE_HANDLE m_opaquePipeline;
+	PIPELINE_HANDLE m_blendPipeline;
+
+	int m_lastListCount;
+	double m_lastRecordMilliseconds;
+
+	void RecordDraws(RenderCommandList* pCommandList, const std::vector<DRAW_COMMAND>& commands, int first, int count) const;
+
+	// run task(0) .. task(taskCount - 1) across the pool and this thread
+	void RunParallel(int taskCount, const std::function<void(int)>& task);
+};
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawlist.h
+// ============
+// the scene as a list of mesh draws with the shader state of each, so that
+// renderers other than the OpenGL one can consume what RenderScene() draws
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// the basic meshes the scene is built from
+enum DRAW_MESH
+{
+	DRAW_MESH_BOX,
+	DRAW_MESH_PLANE,
+	DRAW_MESH_CYLINDER,
+	DRAW_MESH_CONE,
+	DRAW_MESH_SPHERE,
+	DRAW_MESH_TAPERED_CYLINDER,
+	DRAW_MESH_COUNT
+};
+
+// number of point lights in the fragment shader (TOTAL_POINT_LIGHTS)
+const int DRAW_POINT_LIGHTS = 5;
+
+// material values the fragment shader lights with
+struct DRAW_MATERIAL
+{
+	glm::vec3 diffuseColor = glm::vec3(0.8f);
+	glm::vec3 specularColor = glm::vec3(0.2f);
+	float shininess = 8.0f;
+};
+
+// one mesh draw and the shader state it is drawn with
+struct DRAW_COMMAND
+{
+	DRAW_MESH mesh = DRAW_MESH_BOX;
+	glm::mat4 model = glm::mat4(1.0f);
+	// textured draws use the scene texture at textureIndex, the
+	// others the flat color - the color alpha is used either way
+	// when lighting is off
+	bool bUseTexture = false;
+	int textureIndex = 0;
+	glm::vec4 color = glm::vec4(1.0f);
+	glm::vec2 uvScale = glm::vec2(1.0f);
+	DRAW_MATERIAL material;
+	// alpha blended over what is behind, without writing depth
+	bool bBlend = false;
+	// the scene object the draw is part of, for profiling - a string
+	// literal, so consecutive draws of one object share the pointer
+	const char* pObjectName = NULL;
+};
+
+// a directional or point light - position holds the direction for the
+// directional light
+struct DRAW_LIGHT
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 ambient = glm::vec3(0.0f);
+	glm::vec3 diffuse = glm::vec3(0.0f);
+	glm::vec3 specular = glm::vec3(0.0f);
+	bool bActive = false;
+};
+
+// the lights of the scene
+struct DRAW_LIGHTS
+{
+	DRAW_LIGHT directional;
+	DRAW_LIGHT pointLights[DRAW_POINT_LIGHTS];
+};
+
+// everything drawn in one frame, in draw order
+struct DRAW_LIST
+{
+	glm::vec4 clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	bool bUseLighting = true;
+	DRAW_LIGHTS lights;
+	std::vector<DRAW_COMMAND> commands;
+};
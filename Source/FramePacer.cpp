@@ -0,0 +1,188 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// caps frames in flight with fence sync objects and records the latency from
+// input to the completion of the frame that first showed it
+//
+// NOTE: a fence placed right after glfwSwapBuffers() signals once the GPU has
+// finished the frame including the swap, which is the closest point to
+// presentation that OpenGL can observe. Compositor and scanout delay are not
+// included in the measurement. A frame that shows new input also writes a GPU
+// timestamp next to its fence, and the latency ends at that timestamp moved
+// onto the glfwGetTime() clock - not when the fence is noticed, which may be
+// a frame later when it is only polled.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include "GLFW/glfw3.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+
+namespace
+{
+	// number of latency samples kept for the percentile report
+	const size_t LATENCY_SAMPLE_COUNT = 1024;
+	// never wait longer than this for a frame to finish
+	const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer(int maxFramesInFlight)
+{
+	m_maxFramesInFlight = std::max(1, maxFramesInFlight);
+	m_latencySamples.resize(LATENCY_SAMPLE_COUNT, 0.0);
+	m_nextSample = 0;
+	m_sampleCount = 0;
+	m_lastInputSequence = 0;
+}
+
+/***********************************************************
+ *  ~FramePacer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FramePacer::~FramePacer()
+{
+	// the fences must be deleted while the context is still current
+	while (!m_framesInFlight.empty())
+	{
+		glDeleteSync(m_framesInFlight.front().fence);
+		if (m_framesInFlight.front().timestampQuery != 0)
+		{
+			glDeleteQueries(1, &m_framesInFlight.front().timestampQuery);
+		}
+		m_framesInFlight.pop_front();
+	}
+}
+
+/***********************************************************
+ *  WaitForFrameSlot()
+ *
+ *  This method retires every frame that has already finished
+ *  and then waits on the oldest ones until there is room for
+ *  another frame in flight.
+ ***********************************************************/
+void FramePacer::WaitForFrameSlot()
+{
+	// collect finished frames without blocking
+	while (!m_framesInFlight.empty())
+	{
+		GLint status = GL_UNSIGNALED;
+		glGetSynciv(m_framesInFlight.front().fence, GL_SYNC_STATUS,
+			sizeof(status), NULL, &status);
+		if (status != GL_SIGNALED)
+		{
+			break;
+		}
+		RetireOldestFrame(0);
+	}
+
+	// block until the frame count drops below the limit
+	while ((int)m_framesInFlight.size() >= m_maxFramesInFlight)
+	{
+		RetireOldestFrame(FENCE_TIMEOUT_NS);
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method places a fence behind the frame that has just
+ *  been submitted.
+ ***********************************************************/
+void FramePacer::EndFrame(uint64_t inputSequence, double inputTimestamp)
+{
+	FRAME_FENCE frame;
+	frame.timestampQuery = 0;
+	frame.inputTimestamp = 0.0;
+	frame.gpuClockOffset = 0.0;
+
+	// only the first frame to show an input is measured - frames that
+	// show no input newer than an earlier frame's would add the idle
+	// time since the input to the latency
+	if (inputSequence > m_lastInputSequence)
+	{
+		m_lastInputSequence = inputSequence;
+		frame.inputTimestamp = inputTimestamp;
+
+		glGenQueries(1, &frame.timestampQuery);
+		glQueryCounter(frame.timestampQuery, GL_TIMESTAMP);
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		frame.gpuClockOffset = glfwGetTime() - gpuTime * 1.0e-9;
+	}
+
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_framesInFlight.push_back(frame);
+}
+
+/***********************************************************
+ *  RetireOldestFrame()
+ *
+ *  This method waits for the oldest frame in flight to finish
+ *  and records how long after its input it completed.
+ ***********************************************************/
+void FramePacer::RetireOldestFrame(GLuint64 timeoutNanoseconds)
+{
+	FRAME_FENCE frame = m_framesInFlight.front();
+	m_framesInFlight.pop_front();
+
+	GLenum waitResult = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNanoseconds);
+	glDeleteSync(frame.fence);
+	if (frame.timestampQuery == 0)
+	{
+		return;
+	}
+
+	// the timestamp is ready once the fence behind it has signalled,
+	// and a frame that timed out is left unmeasured
+	if ((waitResult == GL_ALREADY_SIGNALED) || (waitResult == GL_CONDITION_SATISFIED))
+	{
+		GLuint64 completeTime = 0;
+		glGetQueryObjectui64v(frame.timestampQuery, GL_QUERY_RESULT, &completeTime);
+		m_latencySamples[m_nextSample] = completeTime * 1.0e-9 + frame.gpuClockOffset - frame.inputTimestamp;
+		m_nextSample = (m_nextSample + 1) % m_latencySamples.size();
+		m_sampleCount++;
+	}
+	glDeleteQueries(1, &frame.timestampQuery);
+}
+
+/***********************************************************
+ *  PrintLatencyReport()
+ *
+ *  This method prints the input-to-present latency over the
+ *  most recent frames.
+ ***********************************************************/
+void FramePacer::PrintLatencyReport()
+{
+	size_t count = std::min(m_sampleCount, m_latencySamples.size());
+	if (count == 0)
+	{
+		LOG_INFO("No input-to-present latency samples recorded");
+		return;
+	}
+
+	std::vector<double> sorted(m_latencySamples.begin(), m_latencySamples.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (double sample : sorted)
+	{
+		total += sample;
+	}
+
+	LOG_INFO("Input-to-present latency over the last %d frames (max %d in flight): "
+		"avg %.2f ms, p50 %.2f ms, p95 %.2f ms, max %.2f ms",
+		(int)count, m_maxFramesInFlight,
+		(total / count) * 1000.0,
+		sorted[count / 2] * 1000.0,
+		sorted[(count * 95) / 100] * 1000.0,
+		sorted[count - 1] * 1000.0);
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// limit the number of frames the driver may queue ahead, and measure the
+// latency from the newest input in a frame until that frame has finished
+// on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class FramePacer
+{
+public:
+	// constructor
+	FramePacer(int maxFramesInFlight);
+	// destructor
+	~FramePacer();
+
+	// block until fewer than the maximum number of frames are in flight -
+	// call on the render thread before building the next frame
+	void WaitForFrameSlot();
+
+	// insert a fence after the frame has been submitted - the sequence
+	// number and time (glfwGetTime) are those of the newest input latched
+	// into the frame, and a sequence of 0 means there is none to measure
+	void EndFrame(uint64_t inputSequence, double inputTimestamp);
+
+	// print the measured input-to-present latency
+	void PrintLatencyReport();
+
+private:
+	struct FRAME_FENCE
+	{
+		GLsync fence;
+		// GPU timestamp written as the frame completes, 0 for a frame
+		// that showed no new input
+		GLuint timestampQuery;
+		double inputTimestamp;
+		// glfwGetTime() minus the GPU clock, in seconds, when the frame
+		// was submitted
+		double gpuClockOffset;
+	};
+
+	// the maximum number of submitted but unfinished frames
+	int m_maxFramesInFlight;
+	// fences for the frames still in flight, oldest first
+	std::deque<FRAME_FENCE> m_framesInFlight;
+	// ring of the most recent latency samples, in seconds
+	std::vector<double> m_latencySamples;
+	// next slot in the latency sample ring
+	size_t m_nextSample;
+	// total number of latency samples recorded
+	size_t m_sampleCount;
+	// newest input sequence number already handed to EndFrame()
+	uint64_t m_lastInputSequence;
+
+	// wait for the oldest fence and record its latency
+	void RetireOldestFrame(GLuint64 timeoutNanoseconds);
+};
@@ -0,0 +1,335 @@
+///////////////////////////////////////////////////////////////////////////////
+// framerecorder.cpp
+// ============
+// asynchronous frame capture
+//
+// NOTE: glReadPixels into a pixel buffer object returns immediately, and a
+// fence marks when the copy is done. The buffer is only mapped once the fence
+// has signalled, a frame or two later, so the render thread never waits for
+// the GPU. The mapped pixels are copied out and encoded on worker threads.
+// Video frames can finish encoding out of order, so they are written strictly
+// by sequence number.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameRecorder.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+
+#include <cstring>
+
+namespace
+{
+	// how long a blocked capture waits for one readback, in nanoseconds
+	const GLuint64 READBACK_WAIT_TIMEOUT = 1000000000;
+}
+
+/***********************************************************
+ *  FrameRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameRecorder::FrameRecorder(int workerCount)
+	: m_encoderPool(workerCount)
+{
+	m_nextSlot = 0;
+	m_maxQueuedFrames = (size_t)m_encoderPool.GetThreadCount() * 2;
+	m_backpressure = BACKPRESSURE_DROP;
+	m_bRecording = false;
+	m_bVideo = false;
+	m_nextSequence = 0;
+	m_droppedFrames = 0;
+	m_encodedFrames = 0;
+	m_nextVideoFrame = 0;
+	m_videoWidth = 0;
+	m_videoHeight = 0;
+	m_framesPerSecond = 60;
+}
+
+/***********************************************************
+ *  ~FrameRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameRecorder::~FrameRecorder()
+{
+	Stop();
+	DestroySlots();
+}
+
+/***********************************************************
+ *  Start()
+ ***********************************************************/
+bool FrameRecorder::Start(const std::string& outputFilename, BACKPRESSURE backpressure, int framesPerSecond)
+{
+	Stop();
+
+	m_outputFilename = outputFilename;
+	m_backpressure = backpressure;
+	m_framesPerSecond = framesPerSecond;
+	m_bVideo = (outputFilename.size() >= 4) &&
+		(outputFilename.compare(outputFilename.size() - 4, 4, ".y4m") == 0);
+
+	if (m_bVideo)
+	{
+		m_videoFile.open(outputFilename, std::ios::binary);
+		if (!m_videoFile.is_open())
+		{
+			LOG_ERROR("Could not create recording: %s", outputFilename.c_str());
+			return(false);
+		}
+		// the header needs the frame size, so it is written with the
+		// first frame
+		m_videoWidth = 0;
+		m_videoHeight = 0;
+		m_nextVideoFrame = 0;
+	}
+
+	m_nextSequence = 0;
+	m_droppedFrames = 0;
+	m_encodedFrames = 0;
+	m_bRecording = true;
+
+	LOG_INFO("Recording to %s with %d encoder threads", outputFilename.c_str(), m_encoderPool.GetThreadCount());
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ ***********************************************************/
+void FrameRecorder::Stop()
+{
+	if (!m_bRecording)
+	{
+		return;
+	}
+
+	// drain the ring, then the encoders
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		CollectReadbacks(i);
+	}
+	m_encoderPool.WaitIdle();
+
+	if (m_bVideo)
+	{
+		std::lock_guard<std::mutex> lock(m_videoMutex);
+		m_videoFile.close();
+		m_finishedVideoFrames.clear();
+	}
+	m_bRecording = false;
+
+	LOG_INFO("Recorded %llu frames to %s, %llu dropped",
+		(unsigned long long)m_encodedFrames.load(),
+		m_outputFilename.c_str(),
+		(unsigned long long)m_droppedFrames);
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method starts the asynchronous readback of a frame
+ *  into the next buffer of the ring, unless the backpressure
+ *  policy drops it.
+ ***********************************************************/
+void FrameRecorder::CaptureFrame(GLuint framebuffer, int width, int height)
+{
+	if ((!m_bRecording) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	CollectReadbacks(-1);
+
+	// the next buffer is still being read back, or the encoders are
+	// behind - either skip the frame or wait for them to catch up
+	bool bSlotBusy = (0 != m_slots[m_nextSlot].fence);
+	bool bEncodersBusy = (m_encoderPool.GetPendingCount() >= m_maxQueuedFrames);
+	if (bSlotBusy || bEncodersBusy)
+	{
+		if (BACKPRESSURE_DROP == m_backpressure)
+		{
+			m_droppedFrames++;
+			return;
+		}
+		while (0 != m_slots[m_nextSlot].fence)
+		{
+			CollectReadbacks(m_nextSlot);
+		}
+		m_encoderPool.WaitForPendingBelow(m_maxQueuedFrames);
+	}
+
+	// a video keeps the size of its first frame
+	if (m_bVideo && (m_videoWidth > 0) && ((width != m_videoWidth) || (height != m_videoHeight)))
+	{
+		LOG_WARNING_THROTTLED(1.0, "Frame size changed while recording video - frame skipped");
+		m_droppedFrames++;
+		return;
+	}
+	if (m_bVideo && (0 == m_videoWidth))
+	{
+		std::lock_guard<std::mutex> lock(m_videoMutex);
+		m_videoWidth = width;
+		m_videoHeight = height;
+		ImageWriter::WriteY4MHeader(m_videoFile, width, height, m_framesPerSecond);
+	}
+
+	READBACK_SLOT& slot = m_slots[m_nextSlot];
+	m_nextSlot = (m_nextSlot + 1) % READBACK_SLOT_COUNT;
+
+	if (0 == slot.buffer)
+	{
+		glGenBuffers(1, &slot.buffer);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if ((width != slot.width) || (height != slot.height))
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+	}
+	slot.width = width;
+	slot.height = height;
+	slot.sequence = m_nextSequence++;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer((0 == framebuffer) ? GL_BACK : GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  CollectReadbacks()
+ *
+ *  This method maps every buffer whose readback is done and
+ *  queues its pixels for encoding. The slot given by waitSlot
+ *  is waited for, the others are only taken when ready.
+ ***********************************************************/
+void FrameRecorder::CollectReadbacks(int waitSlot)
+{
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		READBACK_SLOT& slot = m_slots[i];
+		if (0 == slot.fence)
+		{
+			continue;
+		}
+
+		GLuint64 timeout = (i == waitSlot) ? READBACK_WAIT_TIMEOUT : 0;
+		GLenum waitResult = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if ((GL_ALREADY_SIGNALED != waitResult) && (GL_CONDITION_SATISFIED != waitResult))
+		{
+			continue;
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+
+		// copy out so the buffer can be reused straight away - a frame
+		// that cannot be mapped is still encoded, black, so the video
+		// sequence has no gap
+		std::vector<unsigned char> pixels((size_t)slot.width * slot.height * 4);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)pixels.size(), GL_MAP_READ_BIT);
+		if (NULL != pMapped)
+		{
+			memcpy(pixels.data(), pMapped, pixels.size());
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		else
+		{
+			LOG_ERROR("Could not map a frame readback buffer");
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		uint64_t sequence = slot.sequence;
+		int width = slot.width;
+		int height = slot.height;
+		m_encoderPool.Submit([this, sequence, width, height, pixels = std::move(pixels)]() mutable
+			{
+				EncodeFrame(sequence, width, height, pixels);
+			});
+	}
+}
+
+/***********************************************************
+ *  EncodeFrame()
+ *
+ *  This method runs on an encoder thread. It drops the alpha
+ *  channel, then writes a still or appends to the video.
+ ***********************************************************/
+void FrameRecorder::EncodeFrame(uint64_t sequence, int width, int height, std::vector<unsigned char>& pixels)
+{
+	const size_t pixelCount = (size_t)width * height;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		pixels[i * 3] = pixels[i * 4];
+		pixels[i * 3 + 1] = pixels[i * 4 + 1];
+		pixels[i * 3 + 2] = pixels[i * 4 + 2];
+	}
+
+	if (!m_bVideo)
+	{
+		ImageWriter::WriteImage(GetStillFilename(sequence), width, height, pixels.data());
+		m_encodedFrames++;
+		return;
+	}
+
+	std::vector<uint8_t> frame;
+	ImageWriter::EncodeY4MFrame(width, height, pixels.data(), frame);
+
+	// write this frame and any later ones that were waiting for it
+	std::lock_guard<std::mutex> lock(m_videoMutex);
+	m_finishedVideoFrames[sequence] = std::move(frame);
+	auto next = m_finishedVideoFrames.find(m_nextVideoFrame);
+	while (next != m_finishedVideoFrames.end())
+	{
+		m_videoFile.write((const char*)next->second.data(), next->second.size());
+		m_finishedVideoFrames.erase(next);
+		m_nextVideoFrame++;
+		m_encodedFrames++;
+		next = m_finishedVideoFrames.find(m_nextVideoFrame);
+	}
+}
+
+/***********************************************************
+ *  GetStillFilename()
+ *
+ *  The frame number goes in front of the extension, so that
+ *  "thumb.png" records thumb_000000.png, thumb_000001.png..
+ ***********************************************************/
+std::string FrameRecorder::GetStillFilename(uint64_t sequence) const
+{
+	char number[32];
+	snprintf(number, sizeof(number), "_%06llu", (unsigned long long)sequence);
+
+	size_t extension = m_outputFilename.find_last_of('.');
+	size_t separator = m_outputFilename.find_last_of("/\\");
+	if ((std::string::npos == extension) ||
+		((std::string::npos != separator) && (separator > extension)))
+	{
+		return(m_outputFilename + number);
+	}
+	return(m_outputFilename.substr(0, extension) + number + m_outputFilename.substr(extension));
+}
+
+/***********************************************************
+ *  DestroySlots()
+ ***********************************************************/
+void FrameRecorder::DestroySlots()
+{
+	for (int i = 0; i < READBACK_SLOT_COUNT; i++)
+	{
+		if (0 != m_slots[i].fence)
+		{
+			glDeleteSync(m_slots[i].fence);
+			m_slots[i].fence = 0;
+		}
+		if (0 != m_slots[i].buffer)
+		{
+			glDeleteBuffers(1, &m_slots[i].buffer);
+			m_slots[i].buffer = 0;
+		}
+	}
+}
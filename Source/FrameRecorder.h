@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// framerecorder.h
+// ============
+// record rendered frames without stalling the renderer - frames are read
+// back asynchronously through pixel buffer objects and encoded on a pool of
+// worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class FrameRecorder
+{
+public:
+	// what to do with a frame when the readback ring or the encoders
+	// are still busy with earlier ones
+	enum BACKPRESSURE
+	{
+		BACKPRESSURE_DROP,	// skip the frame, for interactive recording
+		BACKPRESSURE_WAIT	// wait for room, so that no frame is lost
+	};
+
+	// constructor - a worker count of zero sizes the pool to the machine
+	FrameRecorder(int workerCount);
+	// destructor
+	~FrameRecorder();
+
+	// start recording - a .y4m name records a video stream, any other
+	// name records numbered stills in the format of its extension
+	bool Start(const std::string& outputFilename, BACKPRESSURE backpressure, int framesPerSecond);
+	// finish the outstanding frames and close the recording
+	void Stop();
+
+	bool IsRecording() const { return(m_bRecording); }
+
+	// the encoder threads, for other images written off the render
+	// thread
+	ThreadPool* GetEncoderPool() { return(&m_encoderPool); }
+
+	// queue the readback of a drawn frame - framebuffer 0 reads the
+	// back buffer of the window, so call it before swapping
+	void CaptureFrame(GLuint framebuffer, int width, int height);
+
+private:
+	// one pixel buffer in the readback ring
+	struct READBACK_SLOT
+	{
+		GLuint buffer = 0;
+		GLsync fence = 0;
+		uint64_t sequence = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	// number of frames that may be in flight between the GPU and the
+	// encoders before the backpressure policy applies
+	static const int READBACK_SLOT_COUNT = 3;
+
+	ThreadPool m_encoderPool;
+	READBACK_SLOT m_slots[READBACK_SLOT_COUNT];
+	int m_nextSlot;
+	// most frames waiting for or being encoded at once
+	size_t m_maxQueuedFrames;
+
+	std::string m_outputFilename;
+	BACKPRESSURE m_backpressure;
+	bool m_bRecording;
+	bool m_bVideo;
+
+	// frame counts for the report when recording stops
+	uint64_t m_nextSequence;
+	uint64_t m_droppedFrames;
+	std::atomic<uint64_t> m_encodedFrames;
+
+	// encoded video frames wait here until every earlier one is written
+	std::mutex m_videoMutex;
+	std::ofstream m_videoFile;
+	std::map<uint64_t, std::vector<uint8_t>> m_finishedVideoFrames;
+	uint64_t m_nextVideoFrame;
+	int m_videoWidth;
+	int m_videoHeight;
+	int m_framesPerSecond;
+
+	// hand the readbacks the GPU has finished over to the encoders -
+	// optionally waiting for the given slot
+	void CollectReadbacks(int waitSlot);
+	// convert and write one frame (worker thread)
+	void EncodeFrame(uint64_t sequence, int width, int height, std::vector<unsigned char>& pixels);
+	// name of the still image for a frame
+	std::string GetStillFilename(uint64_t sequence) const;
+	void DestroySlots();
+};
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// framestate.h
+// ============
+// immutable snapshot of everything the render thread needs to draw one frame
+//
+//  The simulation thread fills in one of these per simulation step (camera,
+//  animated values, light parameters) and publishes it through a triple
+//  buffer. The render thread only ever reads a published snapshot, so it
+//  never touches the live camera or the animation clock.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+struct FRAME_STATE
+{
+	// monotonically increasing simulation step number
+	uint64_t frameNumber = 0;
+	// time since the previous simulation step, in seconds
+	float deltaTime = 0.0f;
+	// animation clock, in seconds
+	float elapsedSeconds = 0.0f;
+
+	// size of the window framebuffer the view was built for
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+
+	// camera state
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 viewPosition = glm::vec3(0.0f);
+	bool bOrthographicProjection = false;
+	// true when the frame is upscaled temporally instead of blitted
+	bool bTemporalUpscaling = false;
+	// true when several views are drawn side by side in one submission
+	bool bMultiView = false;
+	// true when both eyes are drawn side by side in one submission
+	bool bStereo = false;
+	// bumped each time a panorama capture is requested
+	uint32_t panoramaRequest = 0;
+	// bumped each time the GPU profile is asked to be written out
+	uint32_t gpuProfileRequest = 0;
+	// true while the frames are being recorded
+	bool bRecording = false;
+	// true when the render statistics are drawn over the frame
+	bool bStatsOverlay = false;
+	// vertical field of view of the perspective camera, in degrees
+	float fieldOfView = 45.0f;
+
+	// camera orientation behind the view matrix, so the render thread can
+	// rebuild the view with mouse motion that arrived after this snapshot
+	float cameraYaw = 0.0f;
+	float cameraPitch = 0.0f;
+	float mouseSensitivity = 0.0f;
+	glm::vec3 cameraWorldUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	// running mouse motion totals and sequence number of the last mouse
+	// motion event applied to the camera
+	double mouseTotalX = 0.0;
+	double mouseTotalY = 0.0;
+	uint64_t mouseSequence = 0;
+	// sequence number and time (glfwGetTime) of the newest input event
+	// applied
+	uint64_t inputSequence = 0;
+	double inputTimestamp = 0.0;
+
+	// animated values for the candle flame and glow
+	float flicker = 1.0f;
+	float glowPulse = 1.0f;
+
+	// animated light parameters for the candle point light
+	glm::vec3 candleLightAmbient = glm::vec3(0.0f);
+	glm::vec3 candleLightDiffuse = glm::vec3(0.0f);
+	glm::vec3 candleLightSpecular = glm::vec3(0.0f);
+};
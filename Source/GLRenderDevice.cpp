@@ -0,0 +1,423 @@
+///////////////////////////////////////////////////////////////////////////////
+// glrenderdevice.cpp
+// ============
+// OpenGL implementation of the render device
+//
+// NOTE: OpenGL calls have to come from the thread the context is current
+// on, so a command list here is a plain array of commands with the draw
+// constants beside it. Recording one touches nothing shared, so the lists
+// of a frame can be filled on several threads, and EndFrame() plays them
+// back through the scene shaders in order, only loading the uniforms that
+// differ from the previous draw.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLRenderDevice.h"
+#include "CpuMeshes.h"
+#include "Logger.h"
+
+#include "ShaderManager.h"
+
+#include <cstddef>
+#include <string>
+
+namespace
+{
+	enum GL_COMMAND_TYPE
+	{
+		GL_COMMAND_BIND_PIPELINE,
+		GL_COMMAND_BIND_TEXTURE,
+		GL_COMMAND_BIND_MESH,
+		GL_COMMAND_SET_DRAW_CONSTANTS,
+		GL_COMMAND_DRAW_INDEXED
+	};
+
+	// one recorded command - the arguments are handles, an index into
+	// the list's draw constants, or an index count
+	struct GL_COMMAND
+	{
+		GL_COMMAND_TYPE type;
+		int32_t argument0;
+		int32_t argument1;
+	};
+}
+
+/***********************************************************
+ *  GLCommandList
+ *
+ *  Commands recorded for playback on the context thread.
+ ***********************************************************/
+class GLCommandList : public RenderCommandList
+{
+public:
+	void Reset()
+	{
+		m_commands.clear();
+		m_drawConstants.clear();
+	}
+
+	virtual void BindPipeline(PIPELINE_HANDLE pipeline)
+	{
+		m_commands.push_back(GL_COMMAND{ GL_COMMAND_BIND_PIPELINE, pipeline, 0 });
+	}
+
+	virtual void BindTexture(TEXTURE_HANDLE texture)
+	{
+		m_commands.push_back(GL_COMMAND{ GL_COMMAND_BIND_TEXTURE, texture, 0 });
+	}
+
+	virtual void BindMesh(BUFFER_HANDLE vertexBuffer, BUFFER_HANDLE indexBuffer)
+	{
+		m_commands.push_back(GL_COMMAND{ GL_COMMAND_BIND_MESH, vertexBuffer, indexBuffer });
+	}
+
+	virtual void SetDrawConstants(const DRAW_CONSTANTS& constants)
+	{
+		m_commands.push_back(GL_COMMAND{ GL_COMMAND_SET_DRAW_CONSTANTS, (int32_t)m_drawConstants.size(), 0 });
+		m_drawConstants.push_back(constants);
+	}
+
+	virtual void DrawIndexed(uint32_t indexCount)
+	{
+		m_commands.push_back(GL_COMMAND{ GL_COMMAND_DRAW_INDEXED, (int32_t)indexCount, 0 });
+	}
+
+	const std::vector<GL_COMMAND>& GetCommands() const { return(m_commands); }
+	const DRAW_CONSTANTS& GetDrawConstants(int index) const { return(m_drawConstants[index]); }
+
+private:
+	std::vector<GL_COMMAND> m_commands;
+	std::vector<DRAW_CONSTANTS> m_drawConstants;
+};
+
+/***********************************************************
+ *  GLRenderDevice()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GLRenderDevice::GLRenderDevice()
+{
+	m_pShaderManager = NULL;
+	for (int i = 0; i < MAX_COMMAND_LISTS; i++)
+	{
+		m_commandLists[i] = new GLCommandList();
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~GLRenderDevice()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GLRenderDevice::~GLRenderDevice()
+{
+	for (auto& vertexArray : m_vertexArrays)
+	{
+		glDeleteVertexArrays(1, &vertexArray.second);
+	}
+	m_vertexArrays.clear();
+	for (BUFFER& buffer : m_buffers)
+	{
+		glDeleteBuffers(1, &buffer.buffer);
+	}
+	m_buffers.clear();
+	if (!m_textures.empty())
+	{
+		glDeleteTextures((GLsizei)m_textures.size(), m_textures.data());
+		m_textures.clear();
+	}
+	for (int i = 0; i < MAX_COMMAND_LISTS; i++)
+	{
+		delete m_commandLists[i];
+		m_commandLists[i] = NULL;
+	}
+	if (NULL != m_pShaderManager)
+	{
+		delete m_pShaderManager;
+		m_pShaderManager = NULL;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ ***********************************************************/
+bool GLRenderDevice::Create()
+{
+	m_pShaderManager = new ShaderManager();
+	GLuint programID = m_pShaderManager->LoadShaders(
+		"shaders/vertexShader.glsl",
+		"shaders/fragmentShader.glsl");
+	if (0 == programID)
+	{
+		LOG_ERROR("The OpenGL render device could not load the scene shaders");
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ ***********************************************************/
+BUFFER_HANDLE GLRenderDevice::CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size)
+{
+	BUFFER buffer;
+	buffer.usage = usage;
+	glGenBuffers(1, &buffer.buffer);
+
+	// the index buffer binding is part of the vertex array state, so
+	// it is filled through the array buffer target
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.buffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size, pData, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_buffers.push_back(buffer);
+	return((BUFFER_HANDLE)m_buffers.size() - 1);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ ***********************************************************/
+TEXTURE_HANDLE GLRenderDevice::CreateTexture(const TEXTURE_DESC& desc)
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.bMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, desc.width, desc.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, desc.pPixels);
+	if (desc.bMipmaps)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_textures.push_back(texture);
+	return((TEXTURE_HANDLE)m_textures.size() - 1);
+}
+
+/***********************************************************
+ *  CreatePipeline()
+ ***********************************************************/
+PIPELINE_HANDLE GLRenderDevice::CreatePipeline(const PIPELINE_DESC& desc)
+{
+	m_pipelines.push_back(desc);
+	return((PIPELINE_HANDLE)m_pipelines.size() - 1);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ ***********************************************************/
+bool GLRenderDevice::BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants)
+{
+	if ((NULL == m_pShaderManager) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	m_width = width;
+	m_height = height;
+	m_frameConstants = frameConstants;
+	return(true);
+}
+
+/***********************************************************
+ *  BeginCommandList()
+ ***********************************************************/
+RenderCommandList* GLRenderDevice::BeginCommandList(int listIndex)
+{
+	m_commandLists[listIndex]->Reset();
+	return(m_commandLists[listIndex]);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method clears the bound framebuffer, loads the frame
+ *  constants and plays the recorded lists back in order.
+ ***********************************************************/
+void GLRenderDevice::EndFrame(int listCount)
+{
+	const glm::vec4& clearColor = m_frameConstants.clearColor;
+	glViewport(0, 0, m_width, m_height);
+	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+	glDepthMask(GL_TRUE);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+
+	m_pShaderManager->use();
+	LoadFrameConstants();
+
+	for (int i = 0; i < listCount; i++)
+	{
+		PlayCommandList(*m_commandLists[i]);
+	}
+
+	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+}
+
+/***********************************************************
+ *  LoadFrameConstants()
+ ***********************************************************/
+void GLRenderDevice::LoadFrameConstants()
+{
+	const FRAME_CONSTANTS& frame = m_frameConstants;
+	glm::mat4 viewProjection = frame.projection * frame.view;
+
+	m_pShaderManager->setMat4Value("view", frame.view);
+	m_pShaderManager->setMat4Value("projection", frame.projection);
+	// no motion vectors - this frame and the previous one are the same
+	m_pShaderManager->setMat4Value("currentViewProjection", viewProjection);
+	m_pShaderManager->setMat4Value("previousViewProjection", viewProjection);
+	m_pShaderManager->setVec3Value("viewPosition", frame.viewPosition);
+	m_pShaderManager->setBoolValue("bUseLighting", frame.bUseLighting);
+	m_pShaderManager->setSampler2DValue("objectTexture", 0);
+
+	const DRAW_LIGHT& directional = frame.lights.directional;
+	m_pShaderManager->setVec3Value("directionalLight.direction", directional.position);
+	m_pShaderManager->setVec3Value("directionalLight.ambient", directional.ambient);
+	m_pShaderManager->setVec3Value("directionalLight.diffuse", directional.diffuse);
+	m_pShaderManager->setVec3Value("directionalLight.specular", directional.specular);
+	m_pShaderManager->setIntValue("directionalLight.bActive", directional.bActive);
+
+	for (int i = 0; i < DRAW_POINT_LIGHTS; i++)
+	{
+		const DRAW_LIGHT& pointLight = frame.lights.pointLights[i];
+		std::string prefix = "pointLights[" + std::to_string(i) + "].";
+		m_pShaderManager->setVec3Value(prefix + "position", pointLight.position);
+		m_pShaderManager->setVec3Value(prefix + "ambient", pointLight.ambient);
+		m_pShaderManager->setVec3Value(prefix + "diffuse", pointLight.diffuse);
+		m_pShaderManager->setVec3Value(prefix + "specular", pointLight.specular);
+		m_pShaderManager->setIntValue(prefix + "bActive", pointLight.bActive);
+	}
+	m_pShaderManager->setIntValue("spotLight.bActive", 0);
+}
+
+/***********************************************************
+ *  GetVertexArray()
+ *
+ *  This method returns the vertex array object reading the
+ *  CPU_VERTEX layout from a vertex buffer with an index
+ *  buffer bound, creating it on first use.
+ ***********************************************************/
+GLuint GLRenderDevice::GetVertexArray(BUFFER_HANDLE vertexBuffer, BUFFER_HANDLE indexBuffer)
+{
+	std::pair<BUFFER_HANDLE, BUFFER_HANDLE> key(vertexBuffer, indexBuffer);
+	auto found = m_vertexArrays.find(key);
+	if (found != m_vertexArrays.end())
+	{
+		return(found->second);
+	}
+
+	GLuint vertexArray = 0;
+	glGenVertexArrays(1, &vertexArray);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffers[vertexBuffer].buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffers[indexBuffer].buffer);
+
+	GLsizei stride = (GLsizei)sizeof(CPU_VERTEX);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CPU_VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CPU_VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(CPU_VERTEX, textureCoordinate));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_vertexArrays[key] = vertexArray;
+	return(vertexArray);
+}
+
+/***********************************************************
+ *  PlayCommandList()
+ ***********************************************************/
+void GLRenderDevice::PlayCommandList(const GLCommandList& commandList)
+{
+	// each list starts from a known state, as a Vulkan secondary
+	// command buffer does
+	PIPELINE_HANDLE boundPipeline = INVALID_DEVICE_HANDLE;
+	const DRAW_CONSTANTS* pLoaded = NULL;
+
+	for (const GL_COMMAND& command : commandList.GetCommands())
+	{
+		switch (command.type)
+		{
+		case GL_COMMAND_BIND_PIPELINE:
+			if (command.argument0 != boundPipeline)
+			{
+				const PIPELINE_DESC& pipeline = m_pipelines[command.argument0];
+				if (pipeline.bBlend)
+				{
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				}
+				else
+				{
+					glDisable(GL_BLEND);
+				}
+				glDepthMask(pipeline.bDepthWrite ? GL_TRUE : GL_FALSE);
+				boundPipeline = command.argument0;
+			}
+			break;
+
+		case GL_COMMAND_BIND_TEXTURE:
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, m_textures[command.argument0]);
+			break;
+
+		case GL_COMMAND_BIND_MESH:
+			glBindVertexArray(GetVertexArray(command.argument0, command.argument1));
+			break;
+
+		case GL_COMMAND_SET_DRAW_CONSTANTS:
+		{
+			const DRAW_CONSTANTS& constants = commandList.GetDrawConstants(command.argument0);
+			m_pShaderManager->setMat4Value("model", constants.model);
+			m_pShaderManager->setMat4Value("previousModel", constants.model);
+			if ((NULL == pLoaded) || (constants.bUseTexture != pLoaded->bUseTexture))
+			{
+				m_pShaderManager->setIntValue("bUseTexture", constants.bUseTexture);
+			}
+			if ((NULL == pLoaded) || (constants.color != pLoaded->color))
+			{
+				m_pShaderManager->setVec4Value("objectColor", constants.color);
+			}
+			if ((NULL == pLoaded) || (constants.uvScale != pLoaded->uvScale))
+			{
+				m_pShaderManager->setVec2Value("UVscale", constants.uvScale);
+			}
+			if ((NULL == pLoaded) ||
+				(constants.diffuseColor != pLoaded->diffuseColor) ||
+				(constants.specularColor != pLoaded->specularColor) ||
+				(constants.shininess != pLoaded->shininess))
+			{
+				m_pShaderManager->setVec3Value("material.diffuseColor", glm::vec3(constants.diffuseColor));
+				m_pShaderManager->setVec3Value("material.specularColor", glm::vec3(constants.specularColor));
+				m_pShaderManager->setFloatValue("material.shininess", constants.shininess);
+			}
+			pLoaded = &constants;
+			break;
+		}
+
+		case GL_COMMAND_DRAW_INDEXED:
+			glDrawElements(GL_TRIANGLES, (GLsizei)command.argument0, GL_UNSIGNED_INT, (void*)0);
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  ReadPixels()
+ ***********************************************************/
+void GLRenderDevice::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	pixels.resize((size_t)m_width * m_height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// glrenderdevice.h
+// ============
+// the render device on OpenGL - command lists are recorded into memory on
+// any thread and played back on the thread that owns the context
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderDevice.h"
+
+#include <GL/glew.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+class ShaderManager;
+class GLCommandList;
+
+class GLRenderDevice : public RenderDevice
+{
+public:
+	// constructor - an OpenGL context must be current
+	GLRenderDevice();
+	// destructor
+	virtual ~GLRenderDevice();
+
+	// load the scene shaders. Returns false if they failed to link.
+	bool Create();
+
+	virtual const char* GetName() const { return("OpenGL"); }
+
+	virtual BUFFER_HANDLE CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size);
+	virtual TEXTURE_HANDLE CreateTexture(const TEXTURE_DESC& desc);
+	virtual PIPELINE_HANDLE CreatePipeline(const PIPELINE_DESC& desc);
+
+	virtual int GetMaxCommandLists() const { return(MAX_COMMAND_LISTS); }
+
+	virtual bool BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants);
+	virtual RenderCommandList* BeginCommandList(int listIndex);
+	virtual void EndCommandList(int) {}
+	virtual void EndFrame(int listCount);
+
+	virtual void ReadPixels(std::vector<unsigned char>& pixels);
+
+	static const int MAX_COMMAND_LISTS = 64;
+
+private:
+	struct BUFFER
+	{
+		GLuint buffer;
+		BUFFER_USAGE usage;
+	};
+
+	ShaderManager* m_pShaderManager;
+	std::vector<BUFFER> m_buffers;
+	std::vector<GLuint> m_textures;
+	std::vector<PIPELINE_DESC> m_pipelines;
+	// vertex array objects for the vertex and index buffer pairs drawn
+	std::map<std::pair<BUFFER_HANDLE, BUFFER_HANDLE>, GLuint> m_vertexArrays;
+	GLCommandList* m_commandLists[MAX_COMMAND_LISTS];
+
+	int m_width;
+	int m_height;
+	FRAME_CONSTANTS m_frameConstants;
+
+	void LoadFrameConstants();
+	GLuint GetVertexArray(BUFFER_HANDLE vertexBuffer, BUFFER_HANDLE indexBuffer);
+	void PlayCommandList(const GLCommandList& commandList);
+};
@@ -0,0 +1,357 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuprofiler.cpp
+// ============
+// hierarchical GPU profiling with timestamp queries
+//
+// NOTE: only one GL_TIME_ELAPSED query can be active at a time, and the
+// resolution scaler already keeps one open across the whole scene, so
+// scopes are measured between two GL_TIMESTAMP queries instead, which nest
+// freely. Each frame's queries stay in a ring for FRAME_LATENCY frames
+// before they are read, by which time the GPU has long finished them.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuProfiler.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+/***********************************************************
+ *  GpuProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuProfiler::GpuProfiler()
+{
+	m_currentFrame = 0;
+	m_bRecording = false;
+	m_droppedFrameCount = 0;
+}
+
+/***********************************************************
+ *  ~GpuProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuProfiler::~GpuProfiler()
+{
+	for (int i = 0; i < FRAME_LATENCY; i++)
+	{
+		if (!m_frames[i].queries.empty())
+		{
+			glDeleteQueries((GLsizei)m_frames[i].queries.size(), m_frames[i].queries.data());
+			m_frames[i].queries.clear();
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method reads back the frame that last used this slot
+ *  of the ring, then starts recording into it.
+ ***********************************************************/
+void GpuProfiler::BeginFrame()
+{
+	FRAME_QUERIES& frame = m_frames[m_currentFrame];
+	if (frame.bPending)
+	{
+		CollectFrame(frame);
+	}
+
+	frame.usedQueries = 0;
+	frame.records.clear();
+	frame.bPending = false;
+	m_openRecords.clear();
+	m_bRecording = true;
+}
+
+/***********************************************************
+ *  EndFrame()
+ ***********************************************************/
+void GpuProfiler::EndFrame()
+{
+	if (!m_bRecording)
+	{
+		return;
+	}
+
+	if (!m_openRecords.empty())
+	{
+		LOG_WARNING("GPU profiler frame ended with %d scopes open", (int)m_openRecords.size());
+		while (!m_openRecords.empty())
+		{
+			EndScope();
+		}
+	}
+
+	FRAME_QUERIES& frame = m_frames[m_currentFrame];
+	frame.bPending = !frame.records.empty();
+	m_currentFrame = (m_currentFrame + 1) % FRAME_LATENCY;
+	m_bRecording = false;
+}
+
+/***********************************************************
+ *  BeginScope()
+ ***********************************************************/
+void GpuProfiler::BeginScope(const char* pName)
+{
+	if (!m_bRecording)
+	{
+		return;
+	}
+
+	FRAME_QUERIES& frame = m_frames[m_currentFrame];
+	int parent = m_openRecords.empty() ? -1 : frame.records[m_openRecords.back()].scope;
+
+	SCOPE_RECORD record;
+	record.scope = FindScope(parent, pName);
+	record.beginQuery = AllocateQuery(frame);
+	record.endQuery = -1;
+	glQueryCounter(frame.queries[record.beginQuery], GL_TIMESTAMP);
+
+	m_openRecords.push_back((int)frame.records.size());
+	frame.records.push_back(record);
+}
+
+/***********************************************************
+ *  EndScope()
+ ***********************************************************/
+void GpuProfiler::EndScope()
+{
+	if (!m_bRecording || m_openRecords.empty())
+	{
+		return;
+	}
+
+	FRAME_QUERIES& frame = m_frames[m_currentFrame];
+	SCOPE_RECORD& record = frame.records[m_openRecords.back()];
+	m_openRecords.pop_back();
+
+	record.endQuery = AllocateQuery(frame);
+	glQueryCounter(frame.queries[record.endQuery], GL_TIMESTAMP);
+}
+
+/***********************************************************
+ *  FindScope()
+ *
+ *  This method returns the scope with the given name under
+ *  the given parent, adding it the first time it is seen.
+ ***********************************************************/
+int GpuProfiler::FindScope(int parent, const char* pName)
+{
+	for (int i = 0; i < (int)m_scopes.size(); i++)
+	{
+		if ((m_scopes[i].parent == parent) &&
+			((m_scopeNames[i] == pName) || (strcmp(m_scopeNames[i], pName) == 0)))
+		{
+			return(i);
+		}
+	}
+
+	GPU_PROFILE_SCOPE scope;
+	scope.name = pName;
+	scope.parent = parent;
+	scope.depth = (parent >= 0) ? m_scopes[parent].depth + 1 : 0;
+
+	// children are kept right after the last scope of their parent's
+	// subtree, so walking the list in order visits the tree depth first
+	int insertAt = (int)m_scopes.size();
+	if (parent >= 0)
+	{
+		insertAt = parent + 1;
+		while ((insertAt < (int)m_scopes.size()) && (m_scopes[insertAt].depth > m_scopes[parent].depth))
+		{
+			insertAt++;
+		}
+	}
+
+	// indices after the insertion point move up by one
+	for (GPU_PROFILE_SCOPE& other : m_scopes)
+	{
+		if (other.parent >= insertAt)
+		{
+			other.parent++;
+		}
+	}
+	for (int i = 0; i < FRAME_LATENCY; i++)
+	{
+		for (SCOPE_RECORD& record : m_frames[i].records)
+		{
+			if (record.scope >= insertAt)
+			{
+				record.scope++;
+			}
+		}
+	}
+
+	m_scopes.insert(m_scopes.begin() + insertAt, scope);
+	m_scopeNames.insert(m_scopeNames.begin() + insertAt, pName);
+	m_history.insert(m_history.begin() + insertAt, std::vector<float>());
+	m_frameNanoseconds.insert(m_frameNanoseconds.begin() + insertAt, 0);
+	return(insertAt);
+}
+
+/***********************************************************
+ *  AllocateQuery()
+ *
+ *  This method returns the next unused query of the frame,
+ *  creating more the first time a frame needs them.
+ ***********************************************************/
+int GpuProfiler::AllocateQuery(FRAME_QUERIES& frame)
+{
+	if (frame.usedQueries == (int)frame.queries.size())
+	{
+		size_t previousCount = frame.queries.size();
+		frame.queries.resize(std::max((size_t)32, previousCount * 2));
+		glGenQueries((GLsizei)(frame.queries.size() - previousCount), frame.queries.data() + previousCount);
+	}
+	return(frame.usedQueries++);
+}
+
+/***********************************************************
+ *  CollectFrame()
+ *
+ *  This method reads a finished frame's timestamps and adds
+ *  each scope's time to its history. A frame the GPU has not
+ *  finished yet is dropped rather than waited on.
+ ***********************************************************/
+void GpuProfiler::CollectFrame(FRAME_QUERIES& frame)
+{
+	// timestamps complete in order, so the last one stands for all
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		m_droppedFrameCount++;
+		return;
+	}
+
+	std::fill(m_frameNanoseconds.begin(), m_frameNanoseconds.end(), 0);
+	std::vector<bool> bSeen(m_scopes.size(), false);
+	for (const SCOPE_RECORD& record : frame.records)
+	{
+		GLuint64 beginTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(frame.queries[record.beginQuery], GL_QUERY_RESULT, &beginTime);
+		glGetQueryObjectui64v(frame.queries[record.endQuery], GL_QUERY_RESULT, &endTime);
+		if (endTime > beginTime)
+		{
+			m_frameNanoseconds[record.scope] += endTime - beginTime;
+		}
+		bSeen[record.scope] = true;
+	}
+
+	for (int i = 0; i < (int)m_scopes.size(); i++)
+	{
+		if (bSeen[i])
+		{
+			AddSample(i, (float)(m_frameNanoseconds[i] / 1.0e6));
+		}
+	}
+}
+
+/***********************************************************
+ *  AddSample()
+ *
+ *  This method adds a frame's time to a scope's history and
+ *  updates its rolling statistics.
+ ***********************************************************/
+void GpuProfiler::AddSample(int scopeIndex, float milliseconds)
+{
+	GPU_PROFILE_SCOPE& scope = m_scopes[scopeIndex];
+	std::vector<float>& history = m_history[scopeIndex];
+
+	if ((int)history.size() < HISTORY_FRAMES)
+	{
+		history.push_back(milliseconds);
+	}
+	else
+	{
+		history[scope.frameCount % HISTORY_FRAMES] = milliseconds;
+	}
+	scope.frameCount++;
+	scope.lastMilliseconds = milliseconds;
+
+	double total = 0.0;
+	scope.minimumMilliseconds = history[0];
+	scope.maximumMilliseconds = history[0];
+	for (float sample : history)
+	{
+		total += sample;
+		scope.minimumMilliseconds = std::min(scope.minimumMilliseconds, sample);
+		scope.maximumMilliseconds = std::max(scope.maximumMilliseconds, sample);
+	}
+	scope.averageMilliseconds = (float)(total / history.size());
+}
+
+/***********************************************************
+ *  FormatReport()
+ *
+ *  This method lays the scope tree out as a table, one scope
+ *  per line, children indented under their parent.
+ ***********************************************************/
+std::string GpuProfiler::FormatReport() const
+{
+	std::string report;
+	char line[256];
+
+	snprintf(line, sizeof(line), "%-36s %10s %10s %10s %10s %8s\n",
+		"GPU scope", "last ms", "avg ms", "min ms", "max ms", "frames");
+	report += line;
+	for (const GPU_PROFILE_SCOPE& scope : m_scopes)
+	{
+		std::string name = std::string(scope.depth * 2, ' ') + scope.name;
+		snprintf(line, sizeof(line), "%-36s %10.3f %10.3f %10.3f %10.3f %8llu\n",
+			name.c_str(),
+			scope.lastMilliseconds,
+			scope.averageMilliseconds,
+			scope.minimumMilliseconds,
+			scope.maximumMilliseconds,
+			(unsigned long long)scope.frameCount);
+		report += line;
+	}
+	snprintf(line, sizeof(line), "statistics over the last %d frames, %llu frames dropped\n",
+		HISTORY_FRAMES,
+		(unsigned long long)m_droppedFrameCount);
+	report += line;
+	return(report);
+}
+
+/***********************************************************
+ *  PrintReport()
+ ***********************************************************/
+void GpuProfiler::PrintReport() const
+{
+	if (m_scopes.empty())
+	{
+		return;
+	}
+
+	std::string report = FormatReport();
+	size_t lineStart = 0;
+	while (lineStart < report.size())
+	{
+		size_t lineEnd = report.find('\n', lineStart);
+		LOG_INFO("%s", report.substr(lineStart, lineEnd - lineStart).c_str());
+		lineStart = lineEnd + 1;
+	}
+}
+
+/***********************************************************
+ *  WriteReport()
+ ***********************************************************/
+bool GpuProfiler::WriteReport(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		LOG_ERROR("Could not write GPU profile %s", filename.c_str());
+		return(false);
+	}
+
+	file << FormatReport();
+	return(file.good());
+}
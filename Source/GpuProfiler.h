@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuprofiler.h
+// ============
+// time named, nested scopes of GPU work - passes, and objects within them -
+// and keep rolling statistics of each scope over the last few seconds
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the timings of one scope, identified by its name and its parent
+struct GPU_PROFILE_SCOPE
+{
+	std::string name;
+	// index of the enclosing scope, -1 for a top level scope
+	int parent = -1;
+	int depth = 0;
+	// GPU time of the newest frame the scope ran in, and over the
+	// rolling window - a scope entered several times in a frame counts
+	// the sum
+	float lastMilliseconds = 0.0f;
+	float averageMilliseconds = 0.0f;
+	float minimumMilliseconds = 0.0f;
+	float maximumMilliseconds = 0.0f;
+	// frames the scope has been measured in
+	uint64_t frameCount = 0;
+};
+
+class GpuProfiler
+{
+public:
+	// constructor - an OpenGL context must be current
+	GpuProfiler();
+	// destructor
+	~GpuProfiler();
+
+	// collect the results of the oldest frame in the ring and start
+	// recording scopes for a new one
+	void BeginFrame();
+	// finish the frame - every scope begun must have ended
+	void EndFrame();
+
+	// bracket GPU work with a name. Scopes nest, and the same name under
+	// a different parent is a different scope. The name is kept, so a
+	// string literal is expected.
+	void BeginScope(const char* pName);
+	void EndScope();
+
+	// every scope measured so far, parents before their children
+	const std::vector<GPU_PROFILE_SCOPE>& GetScopes() const { return(m_scopes); }
+	// frames whose results had not arrived when their queries were
+	// needed again, and were dropped
+	uint64_t GetDroppedFrameCount() const { return(m_droppedFrameCount); }
+
+	// log the scope tree, and write it to a text file
+	void PrintReport() const;
+	bool WriteReport(const std::string& filename) const;
+
+	// frames of queries kept in flight, so reading results never waits
+	// on the GPU
+	static const int FRAME_LATENCY = 4;
+	// frames the rolling statistics cover
+	static const int HISTORY_FRAMES = 240;
+
+private:
+	// one entry into a scope, between two timestamp queries
+	struct SCOPE_RECORD
+	{
+		int scope;
+		int beginQuery;
+		int endQuery;
+	};
+
+	// the queries of one frame in the ring
+	struct FRAME_QUERIES
+	{
+		std::vector<GLuint> queries;
+		int usedQueries = 0;
+		std::vector<SCOPE_RECORD> records;
+		bool bPending = false;
+	};
+
+	FRAME_QUERIES m_frames[FRAME_LATENCY];
+	int m_currentFrame;
+	bool m_bRecording;
+	// records of the scopes currently open, innermost last
+	std::vector<int> m_openRecords;
+
+	std::vector<GPU_PROFILE_SCOPE> m_scopes;
+	// names as given to BeginScope(), compared by pointer first
+	std::vector<const char*> m_scopeNames;
+	// ring of per-frame milliseconds for each scope
+	std::vector<std::vector<float>> m_history;
+	// GPU time per scope of the frame being collected
+	std::vector<uint64_t> m_frameNanoseconds;
+	uint64_t m_droppedFrameCount;
+
+	int FindScope(int parent, const char* pName);
+	int AllocateQuery(FRAME_QUERIES& frame);
+	void CollectFrame(FRAME_QUERIES& frame);
+	void AddSample(int scope, float milliseconds);
+	std::string FormatReport() const;
+};
+
+/***********************************************************
+ *  GpuProfileScope
+ *
+ *  Times the GPU work issued for as long as it lives. A NULL
+ *  profiler makes it do nothing.
+ ***********************************************************/
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler* pProfiler, const char* pName)
+	{
+		m_pProfiler = pProfiler;
+		if (NULL != m_pProfiler)
+		{
+			m_pProfiler->BeginScope(pName);
+		}
+	}
+
+	~GpuProfileScope()
+	{
+		if (NULL != m_pProfiler)
+		{
+			m_pProfiler->EndScope();
+		}
+	}
+
+private:
+	GpuProfiler* m_pProfiler;
+};
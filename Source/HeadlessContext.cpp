@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+// headlesscontext.cpp
+// ============
+// windowless OpenGL context through EGL
+//
+// NOTE: the surfaceless platform (EGL_MESA_platform_surfaceless) needs no X11
+// or Wayland connection and no GPU - Mesa falls back to llvmpipe. Drivers
+// without it use the default display. Rendering always goes into framebuffer
+// objects, so the context only needs a surface when the driver lacks
+// EGL_KHR_surfaceless_context, in which case a 1x1 pbuffer is used.
+// Linux only, link with -lEGL.
+//
+// EGL hands every caller the same display, and eglInitialize() does not
+// count how often it was called, so contexts on the same display share one
+// reference count and only the last one to go terminates it.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HeadlessContext.h"
+#include "Logger.h"
+
+#ifdef __linux__
+#include <EGL/eglext.h>
+#include <cstring>
+#include <map>
+#include <mutex>
+#endif
+
+#ifdef __linux__
+namespace
+{
+	// contexts using each initialized display
+	std::mutex g_DisplayMutex;
+	std::map<EGLDisplay, int> g_DisplayReferences;
+
+	/***********************************************************
+	 *  AddDisplayReference()
+	 ***********************************************************/
+	void AddDisplayReference(EGLDisplay display)
+	{
+		std::lock_guard<std::mutex> lock(g_DisplayMutex);
+		g_DisplayReferences[display]++;
+	}
+
+	/***********************************************************
+	 *  ReleaseDisplayReference()
+	 *
+	 *  Terminate the display once no context uses it.
+	 ***********************************************************/
+	void ReleaseDisplayReference(EGLDisplay display)
+	{
+		std::lock_guard<std::mutex> lock(g_DisplayMutex);
+		auto reference = g_DisplayReferences.find(display);
+		if (reference == g_DisplayReferences.end())
+		{
+			return;
+		}
+		if (--reference->second == 0)
+		{
+			g_DisplayReferences.erase(reference);
+			eglTerminate(display);
+		}
+	}
+
+	/***********************************************************
+	 *  HasExtension()
+	 *
+	 *  Return true when the space separated extension list
+	 *  contains the given extension.
+	 ***********************************************************/
+	bool HasExtension(const char* extensions, const char* extension)
+	{
+		if (NULL == extensions)
+		{
+			return(false);
+		}
+
+		size_t length = strlen(extension);
+		const char* pStart = extensions;
+		while ((pStart = strstr(pStart, extension)) != NULL)
+		{
+			bool bStartsWord = (pStart == extensions) || (pStart[-1] == ' ');
+			bool bEndsWord = (pStart[length] == ' ') || (pStart[length] == '\0');
+			if (bStartsWord && bEndsWord)
+			{
+				return(true);
+			}
+			pStart += length;
+		}
+		return(false);
+	}
+}
+#endif
+
+/***********************************************************
+ *  HeadlessContext()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HeadlessContext::HeadlessContext()
+{
+#ifdef __linux__
+	m_display = EGL_NO_DISPLAY;
+	m_context = EGL_NO_CONTEXT;
+	m_surface = EGL_NO_SURFACE;
+#endif
+}
+
+/***********************************************************
+ *  ~HeadlessContext()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HeadlessContext::~HeadlessContext()
+{
+#ifdef __linux__
+	if (EGL_NO_DISPLAY != m_display)
+	{
+		// only let go of this context - another one may be current
+		// on this thread
+		if ((EGL_NO_CONTEXT != m_context) && (eglGetCurrentContext() == m_context))
+		{
+			eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		}
+		if (EGL_NO_SURFACE != m_surface)
+		{
+			eglDestroySurface(m_display, m_surface);
+		}
+		if (EGL_NO_CONTEXT != m_context)
+		{
+			eglDestroyContext(m_display, m_context);
+		}
+		ReleaseDisplayReference(m_display);
+	}
+	m_display = EGL_NO_DISPLAY;
+	m_context = EGL_NO_CONTEXT;
+	m_surface = EGL_NO_SURFACE;
+#endif
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method opens an EGL display, creates an OpenGL core
+ *  context on it and makes it current.
+ ***********************************************************/
+bool HeadlessContext::Create()
+{
+#ifdef __linux__
+	// prefer the surfaceless platform, which needs no display server
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (NULL != eglGetPlatformDisplayEXT)
+		{
+			m_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+	}
+	if (EGL_NO_DISPLAY == m_display)
+	{
+		m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0;
+	EGLint minor = 0;
+	if ((EGL_NO_DISPLAY == m_display) || (!eglInitialize(m_display, &major, &minor)))
+	{
+		LOG_ERROR("Failed to initialize an EGL display");
+		m_display = EGL_NO_DISPLAY;
+		return(false);
+	}
+	AddDisplayReference(m_display);
+	LOG_INFO("EGL %d.%d: %s", major, minor, eglQueryString(m_display, EGL_VENDOR));
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		LOG_ERROR("EGL does not support desktop OpenGL");
+		return(false);
+	}
+
+	const EGLint configAttributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config = NULL;
+	EGLint configCount = 0;
+	if ((!eglChooseConfig(m_display, configAttributes, &config, 1, &configCount)) || (configCount < 1))
+	{
+		LOG_ERROR("No EGL config supports OpenGL rendering");
+		return(false);
+	}
+
+	// the same versions the window asks GLFW for, newest first
+	const EGLint contextVersions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 4, 1 } };
+	for (const EGLint* version : contextVersions)
+	{
+		const EGLint contextAttributes[] =
+		{
+			EGL_CONTEXT_MAJOR_VERSION, version[0],
+			EGL_CONTEXT_MINOR_VERSION, version[1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (EGL_NO_CONTEXT != m_context)
+		{
+			break;
+		}
+	}
+	if (EGL_NO_CONTEXT == m_context)
+	{
+		LOG_ERROR("Failed to create an OpenGL 4.x core context through EGL");
+		return(false);
+	}
+
+	if (!HasExtension(eglQueryString(m_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+	{
+		const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		m_surface = eglCreatePbufferSurface(m_display, config, pbufferAttributes);
+	}
+
+	return(MakeCurrent());
+#else
+	LOG_ERROR("Headless rendering needs EGL, which is only used on Linux");
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  MakeCurrent()
+ ***********************************************************/
+bool HeadlessContext::MakeCurrent()
+{
+#ifdef __linux__
+	if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context))
+	{
+		LOG_ERROR("Failed to make the EGL context current (0x%x)", eglGetError());
+		return(false);
+	}
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  ReleaseCurrent()
+ ***********************************************************/
+void HeadlessContext::ReleaseCurrent()
+{
+#ifdef __linux__
+	if ((EGL_NO_DISPLAY != m_display) && (eglGetCurrentContext() == m_context))
+	{
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	}
+#endif
+}
@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// headlesscontext.h
+// ============
+// create an OpenGL core context without a window or display server, for
+// rendering on servers and in CI
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#endif
+
+class HeadlessContext
+{
+public:
+	// constructor
+	HeadlessContext();
+	// destructor
+	~HeadlessContext();
+
+	// create the context, trying the newest OpenGL 4.x core version first
+	bool Create();
+
+	// make the context current on the calling thread, or release it
+	bool MakeCurrent();
+	void ReleaseCurrent();
+
+private:
+#ifdef __linux__
+	// EGL display, context, and the pbuffer used when the driver
+	// cannot make a context current without any surface
+	EGLDisplay m_display;
+	EGLContext m_context;
+	EGLSurface m_surface;
+#endif
+};
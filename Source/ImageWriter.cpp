@@ -0,0 +1,522 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.cpp
+// ============
+// image and video file output for captured frames
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriter.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+	/***********************************************************
+	 *  Crc32()
+	 *
+	 *  Continue the CRC-32 used by PNG chunks over the bytes.
+	 ***********************************************************/
+	uint32_t Crc32(uint32_t crc, const uint8_t* pBytes, size_t count)
+	{
+		// built once, safely, by whichever encoder thread gets here first
+		static const std::array<uint32_t, 256> table = []()
+		{
+			std::array<uint32_t, 256> entries;
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				entries[n] = c;
+			}
+			return(entries);
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < count; i++)
+		{
+			crc = table[(crc ^ pBytes[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(~crc);
+	}
+
+	/***********************************************************
+	 *  PutBigEndian32()
+	 ***********************************************************/
+	void PutBigEndian32(std::vector<uint8_t>& bytes, uint32_t value)
+	{
+		bytes.push_back((uint8_t)(value >> 24));
+		bytes.push_back((uint8_t)(value >> 16));
+		bytes.push_back((uint8_t)(value >> 8));
+		bytes.push_back((uint8_t)value);
+	}
+
+	/***********************************************************
+	 *  PutPNGChunk()
+	 ***********************************************************/
+	void PutPNGChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+	{
+		PutBigEndian32(png, (uint32_t)data.size());
+		size_t typeStart = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), data.begin(), data.end());
+		PutBigEndian32(png, Crc32(0, &png[typeStart], png.size() - typeStart));
+	}
+
+	/***********************************************************
+	 *  WriteFile()
+	 ***********************************************************/
+	bool WriteFile(const std::string& filename, const std::vector<uint8_t>& bytes)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			LOG_ERROR("Could not write image: %s", filename.c_str());
+			return(false);
+		}
+		file.write((const char*)bytes.data(), bytes.size());
+		return(file.good());
+	}
+
+	/***********************************************************
+	 *  EndsWith()
+	 ***********************************************************/
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		size_t length = strlen(suffix);
+		return((text.size() >= length) &&
+			(text.compare(text.size() - length, length, suffix) == 0));
+	}
+}
+
+/***********************************************************
+ *  WriteImage()
+ ***********************************************************/
+bool ImageWriter::WriteImage(
+	const std::string& filename,
+	int width,
+	int height,
+	const unsigned char* pPixels)
+{
+	if (EndsWith(filename, ".png"))
+	{
+		return(WritePNG(filename, width, height, pPixels));
+	}
+	if (EndsWith(filename, ".qoi"))
+	{
+		return(WriteQOI(filename, width, height, pPixels));
+	}
+	return(WritePPM(filename, width, height, pPixels));
+}
+
+/***********************************************************
+ *  WritePPM()
+ *
+ *  Write the pixels to a binary PPM file, flipping the rows
+ *  so the image is stored top first.
+ ***********************************************************/
+bool ImageWriter::WritePPM(
+	const std::string& filename,
+	int width,
+	int height,
+	const unsigned char* pPixels)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Could not write image: %s", filename.c_str());
+		return(false);
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	const size_t rowSize = (size_t)width * 3;
+	for (int row = height - 1; row >= 0; row--)
+	{
+		file.write((const char*)&pPixels[row * rowSize], rowSize);
+	}
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  WritePNG()
+ *
+ *  Write the pixels as an 8-bit RGB PNG.
+ ***********************************************************/
+bool ImageWriter::WritePNG(
+	const std::string& filename,
+	int width,
+	int height,
+	const unsigned char* pPixels)
+{
+	StreamWriter streamWriter;
+	return(streamWriter.Begin(filename, width, height) &&
+		streamWriter.WriteRows(pPixels, height) &&
+		streamWriter.End());
+}
+
+/***********************************************************
+ *  WriteQOI()
+ *
+ *  Write the pixels as a 3-channel QOI image, following the
+ *  QOI 1.0 specification.
+ ***********************************************************/
+bool ImageWriter::WriteQOI(
+	const std::string& filename,
+	int width,
+	int height,
+	const unsigned char* pPixels)
+{
+	const uint8_t QOI_OP_INDEX = 0x00;
+	const uint8_t QOI_OP_DIFF = 0x40;
+	const uint8_t QOI_OP_LUMA = 0x80;
+	const uint8_t QOI_OP_RUN = 0xC0;
+	const uint8_t QOI_OP_RGB = 0xFE;
+
+	std::vector<uint8_t> qoi;
+	qoi.reserve((size_t)width * height * 4 + 22);
+	qoi.push_back('q');
+	qoi.push_back('o');
+	qoi.push_back('i');
+	qoi.push_back('f');
+	PutBigEndian32(qoi, (uint32_t)width);
+	PutBigEndian32(qoi, (uint32_t)height);
+	qoi.push_back(3);	// RGB
+	qoi.push_back(0);	// sRGB with linear alpha
+
+	uint8_t seen[64][3];
+	memset(seen, 0, sizeof(seen));
+	uint8_t previous[3] = { 0, 0, 0 };
+	int run = 0;
+	const size_t rowSize = (size_t)width * 3;
+
+	for (int row = height - 1; row >= 0; row--)
+	{
+		const uint8_t* pRow = &pPixels[row * rowSize];
+		for (int x = 0; x < width; x++)
+		{
+			const uint8_t* pixel = &pRow[x * 3];
+			bool bLastPixel = (row == 0) && (x == width - 1);
+
+			if ((pixel[0] == previous[0]) && (pixel[1] == previous[1]) && (pixel[2] == previous[2]))
+			{
+				run++;
+				if ((run == 62) || bLastPixel)
+				{
+					qoi.push_back(QOI_OP_RUN | (uint8_t)(run - 1));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				qoi.push_back(QOI_OP_RUN | (uint8_t)(run - 1));
+				run = 0;
+			}
+
+			// alpha is always 255 in the hash
+			int index = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+			if ((seen[index][0] == pixel[0]) && (seen[index][1] == pixel[1]) && (seen[index][2] == pixel[2]))
+			{
+				qoi.push_back(QOI_OP_INDEX | (uint8_t)index);
+			}
+			else
+			{
+				memcpy(seen[index], pixel, 3);
+
+				int8_t dr = (int8_t)(pixel[0] - previous[0]);
+				int8_t dg = (int8_t)(pixel[1] - previous[1]);
+				int8_t db = (int8_t)(pixel[2] - previous[2]);
+				int8_t drdg = (int8_t)(dr - dg);
+				int8_t dbdg = (int8_t)(db - dg);
+
+				if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+				{
+					qoi.push_back(QOI_OP_DIFF | (uint8_t)((dr + 2) << 4) | (uint8_t)((dg + 2) << 2) | (uint8_t)(db + 2));
+				}
+				else if ((dg >= -32) && (dg <= 31) && (drdg >= -8) && (drdg <= 7) && (dbdg >= -8) && (dbdg <= 7))
+				{
+					qoi.push_back(QOI_OP_LUMA | (uint8_t)(dg + 32));
+					qoi.push_back((uint8_t)((drdg + 8) << 4) | (uint8_t)(dbdg + 8));
+				}
+				else
+				{
+					qoi.push_back(QOI_OP_RGB);
+					qoi.push_back(pixel[0]);
+					qoi.push_back(pixel[1]);
+					qoi.push_back(pixel[2]);
+				}
+			}
+			memcpy(previous, pixel, 3);
+		}
+	}
+
+	static const uint8_t endMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	qoi.insert(qoi.end(), endMarker, endMarker + 8);
+
+	return(WriteFile(filename, qoi));
+}
+
+/***********************************************************
+ *  WriteY4MHeader()
+ ***********************************************************/
+void ImageWriter::WriteY4MHeader(
+	std::ofstream& file,
+	int width,
+	int height,
+	int framesPerSecond)
+{
+	file << "YUV4MPEG2 W" << width << " H" << height
+		<< " F" << framesPerSecond << ":1 Ip A1:1 C420jpeg\n";
+}
+
+/***********************************************************
+ *  EncodeY4MFrame()
+ *
+ *  Convert the pixels to BT.601 Y'CbCr with 2x2 subsampled
+ *  chroma, planes stored top row first.
+ ***********************************************************/
+void ImageWriter::EncodeY4MFrame(
+	int width,
+	int height,
+	const unsigned char* pPixels,
+	std::vector<uint8_t>& frame)
+{
+	static const char frameHeader[] = "FRAME\n";
+	const size_t headerSize = sizeof(frameHeader) - 1;
+	const int chromaWidth = (width + 1) / 2;
+	const int chromaHeight = (height + 1) / 2;
+	const size_t lumaSize = (size_t)width * height;
+	const size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+
+	frame.resize(headerSize + lumaSize + chromaSize * 2);
+	memcpy(frame.data(), frameHeader, headerSize);
+	uint8_t* pLuma = &frame[headerSize];
+	uint8_t* pCb = pLuma + lumaSize;
+	uint8_t* pCr = pCb + chromaSize;
+
+	const size_t rowSize = (size_t)width * 3;
+	for (int y = 0; y < height; y++)
+	{
+		const uint8_t* pRow = &pPixels[(height - 1 - y) * rowSize];
+		for (int x = 0; x < width; x++)
+		{
+			const uint8_t* pixel = &pRow[x * 3];
+			pLuma[y * width + x] = (uint8_t)((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+		}
+	}
+
+	for (int cy = 0; cy < chromaHeight; cy++)
+	{
+		for (int cx = 0; cx < chromaWidth; cx++)
+		{
+			// average the 2x2 block, clamped at odd edges
+			int r = 0;
+			int g = 0;
+			int b = 0;
+			for (int dy = 0; dy < 2; dy++)
+			{
+				int y = std::min(cy * 2 + dy, height - 1);
+				const uint8_t* pRow = &pPixels[(height - 1 - y) * rowSize];
+				for (int dx = 0; dx < 2; dx++)
+				{
+					int x = std::min(cx * 2 + dx, width - 1);
+					r += pRow[x * 3];
+					g += pRow[x * 3 + 1];
+					b += pRow[x * 3 + 2];
+				}
+			}
+			r = (r + 2) / 4;
+			g = (g + 2) / 4;
+			b = (b + 2) / 4;
+
+			pCb[cy * chromaWidth + cx] = (uint8_t)std::clamp((-43 * r - 85 * g + 128 * b + 32768) >> 8, 0, 255);
+			pCr[cy * chromaWidth + cx] = (uint8_t)std::clamp((128 * r - 107 * g - 21 * b + 32768) >> 8, 0, 255);
+		}
+	}
+}
+
+/***********************************************************
+ *  StreamWriter()
+ ***********************************************************/
+ImageWriter::StreamWriter::StreamWriter()
+{
+	m_bPNG = false;
+	m_width = 0;
+	m_height = 0;
+	m_rowsWritten = 0;
+	m_adlerA = 1;
+	m_adlerB = 0;
+	m_chunkCrc = 0;
+	m_chunkRemaining = 0;
+	m_blockRemaining = 0;
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  Create the file and write everything that comes before
+ *  the pixel rows. A PNG zlib stream is made of stored
+ *  deflate blocks, so no compressor is needed and each band
+ *  of rows can go out as its own IDAT chunk.
+ ***********************************************************/
+bool ImageWriter::StreamWriter::Begin(const std::string& filename, int width, int height)
+{
+	m_file.open(filename, std::ios::binary);
+	if (!m_file.is_open())
+	{
+		LOG_ERROR("Could not write image: %s", filename.c_str());
+		return(false);
+	}
+
+	m_bPNG = !EndsWith(filename, ".ppm");
+	m_width = width;
+	m_height = height;
+	m_rowsWritten = 0;
+	m_adlerA = 1;
+	m_adlerB = 0;
+
+	if (!m_bPNG)
+	{
+		m_file << "P6\n" << width << " " << height << "\n255\n";
+		return(m_file.good());
+	}
+
+	std::vector<uint8_t> header;
+	PutBigEndian32(header, (uint32_t)width);
+	PutBigEndian32(header, (uint32_t)height);
+	header.push_back(8);	// bit depth
+	header.push_back(2);	// RGB
+	header.push_back(0);	// deflate
+	header.push_back(0);	// adaptive filtering
+	header.push_back(0);	// not interlaced
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<uint8_t> png(signature, signature + 8);
+	PutPNGChunk(png, "IHDR", header);
+
+	// the zlib header opens the first IDAT chunk
+	std::vector<uint8_t> zlibHeader = { 0x78, 0x01 };
+	PutPNGChunk(png, "IDAT", zlibHeader);
+
+	m_file.write((const char*)png.data(), png.size());
+	return(m_file.good());
+}
+
+/***********************************************************
+ *  WriteRows()
+ *
+ *  Append the next rows of the image, from the top down. The
+ *  rows in pRows are given bottom first.
+ ***********************************************************/
+bool ImageWriter::StreamWriter::WriteRows(const unsigned char* pRows, int rowCount)
+{
+	rowCount = std::min(rowCount, m_height - m_rowsWritten);
+	const size_t rowSize = (size_t)m_width * 3;
+
+	if (!m_bPNG)
+	{
+		for (int row = rowCount - 1; row >= 0; row--)
+		{
+			m_file.write((const char*)&pRows[row * rowSize], rowSize);
+		}
+		m_rowsWritten += rowCount;
+		return(m_file.good());
+	}
+
+	// the rows are filtered and split into stored blocks as they are
+	// written, so no copy of the band is made. Each row starts with
+	// its filter type, none here.
+	const size_t dataSize = (rowSize + 1) * rowCount;
+	const size_t blockCount = (dataSize + 65534) / 65535;
+	std::vector<uint8_t> chunkHeader;
+	PutBigEndian32(chunkHeader, (uint32_t)(dataSize + blockCount * 5));
+	chunkHeader.insert(chunkHeader.end(), { 'I', 'D', 'A', 'T' });
+	m_file.write((const char*)chunkHeader.data(), chunkHeader.size());
+	m_chunkCrc = Crc32(0, &chunkHeader[4], 4);
+	m_chunkRemaining = dataSize;
+	m_blockRemaining = 0;
+
+	const uint8_t filterType = 0;
+	for (int row = rowCount - 1; row >= 0; row--)
+	{
+		PutStoredBytes(&filterType, 1);
+		PutStoredBytes(&pRows[row * rowSize], rowSize);
+	}
+
+	std::vector<uint8_t> crc;
+	PutBigEndian32(crc, m_chunkCrc);
+	m_file.write((const char*)crc.data(), crc.size());
+	m_rowsWritten += rowCount;
+
+	return(m_file.good());
+}
+
+/***********************************************************
+ *  PutStoredBytes()
+ *
+ *  Stored blocks hold up to 65535 bytes and are never final -
+ *  End() closes the stream.
+ ***********************************************************/
+void ImageWriter::StreamWriter::PutStoredBytes(const uint8_t* pBytes, size_t count)
+{
+	while (count > 0)
+	{
+		if (m_blockRemaining == 0)
+		{
+			m_blockRemaining = std::min<size_t>(65535, m_chunkRemaining);
+			const uint8_t blockHeader[5] = {
+				0,
+				(uint8_t)m_blockRemaining,
+				(uint8_t)(m_blockRemaining >> 8),
+				(uint8_t)~m_blockRemaining,
+				(uint8_t)(~m_blockRemaining >> 8) };
+			m_file.write((const char*)blockHeader, sizeof(blockHeader));
+			m_chunkCrc = Crc32(m_chunkCrc, blockHeader, sizeof(blockHeader));
+		}
+
+		size_t size = std::min(count, m_blockRemaining);
+		m_file.write((const char*)pBytes, size);
+		m_chunkCrc = Crc32(m_chunkCrc, pBytes, size);
+		for (size_t i = 0; i < size; i++)
+		{
+			m_adlerA = (m_adlerA + pBytes[i]) % 65521;
+			m_adlerB = (m_adlerB + m_adlerA) % 65521;
+		}
+
+		pBytes += size;
+		count -= size;
+		m_blockRemaining -= size;
+		m_chunkRemaining -= size;
+	}
+}
+
+/***********************************************************
+ *  End()
+ ***********************************************************/
+bool ImageWriter::StreamWriter::End()
+{
+	if (m_rowsWritten != m_height)
+	{
+		LOG_WARNING("Image closed after %d of %d rows", m_rowsWritten, m_height);
+	}
+
+	if (m_bPNG)
+	{
+		// an empty final block, then the checksum of all the rows
+		std::vector<uint8_t> tail = { 1, 0, 0, 0xFF, 0xFF };
+		PutBigEndian32(tail, (m_adlerB << 16) | m_adlerA);
+
+		std::vector<uint8_t> png;
+		PutPNGChunk(png, "IDAT", tail);
+		PutPNGChunk(png, "IEND", std::vector<uint8_t>());
+		m_file.write((const char*)png.data(), png.size());
+	}
+
+	m_file.close();
+	return(!m_file.fail());
+}
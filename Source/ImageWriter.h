@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// write rendered frames out to image and video files
+//
+// all pixels are 8-bit RGB with rows given bottom first, the way
+// glReadPixels returns them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ImageWriter
+{
+	// write the image in the format named by the file extension -
+	// .png, .qoi or .ppm
+	bool WriteImage(
+		const std::string& filename,
+		int width,
+		int height,
+		const unsigned char* pPixels);
+
+	// write a binary PPM
+	bool WritePPM(
+		const std::string& filename,
+		int width,
+		int height,
+		const unsigned char* pPixels);
+
+	// write a PNG - the image data is stored without compression, which
+	// keeps encoding cheap enough to run per frame and lets it stream
+	bool WritePNG(
+		const std::string& filename,
+		int width,
+		int height,
+		const unsigned char* pPixels);
+
+	// write a QOI image, a simple lossless format that compresses well
+	// and encodes quickly
+	bool WriteQOI(
+		const std::string& filename,
+		int width,
+		int height,
+		const unsigned char* pPixels);
+
+	// writes an image a band of rows at a time, top band first, so
+	// the whole image never has to be held in memory - .ppm, or PNG
+	// for any other extension
+	class StreamWriter
+	{
+	public:
+		StreamWriter();
+
+		bool Begin(const std::string& filename, int width, int height);
+		// append the next rowCount rows, given bottom first
+		bool WriteRows(const unsigned char* pRows, int rowCount);
+		bool End();
+
+	private:
+		// write image data into the open IDAT chunk, starting a new
+		// stored block whenever the last one is full
+		void PutStoredBytes(const uint8_t* pBytes, size_t count);
+
+		std::ofstream m_file;
+		bool m_bPNG;
+		int m_width;
+		int m_height;
+		int m_rowsWritten;
+		// running Adler-32 of the PNG image data
+		uint32_t m_adlerA;
+		uint32_t m_adlerB;
+		// running CRC of the open IDAT chunk
+		uint32_t m_chunkCrc;
+		// image data left for the open IDAT chunk and its current
+		// stored block
+		size_t m_chunkRemaining;
+		size_t m_blockRemaining;
+	};
+
+	// write the YUV4MPEG2 stream header for 4:2:0 video
+	void WriteY4MHeader(
+		std::ofstream& file,
+		int width,
+		int height,
+		int framesPerSecond);
+
+	// convert the pixels into one YUV4MPEG2 frame, header included,
+	// ready to append to the stream
+	void EncodeY4MFrame(
+		int width,
+		int height,
+		const unsigned char* pPixels,
+		std::vector<uint8_t>& frame);
+}
@@ -0,0 +1,336 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecording.cpp
+// ============
+// the input recording file writer and reader
+//
+// NOTE: the file is a small header followed by one record per step. A step
+// starts with a flags byte, then the camera clock as a double and the
+// animation clock as a float, the framebuffer size only when it changed,
+// and the event count only when there are events. Each event stores just
+// the fields its type uses, with its timestamp as a float offset from the
+// step's clock. Values are written in the machine's byte order - a
+// recording is meant to be replayed where it was captured.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecording.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	const char FILE_MAGIC[4] = { 'I', 'N', 'R', 'C' };
+	const uint32_t FILE_VERSION = 1;
+
+	// step flags
+	const unsigned char STEP_FRAMEBUFFER_SIZE = 0x01;
+	const unsigned char STEP_EVENTS = 0x02;
+
+	/***********************************************************
+	 *  Append()
+	 ***********************************************************/
+	template <typename T>
+	void Append(std::vector<unsigned char>& buffer, T value)
+	{
+		const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(&value);
+		buffer.insert(buffer.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	/***********************************************************
+	 *  Extract()
+	 *
+	 *  Reads the next value, or returns false at the end of the
+	 *  data.
+	 ***********************************************************/
+	template <typename T>
+	bool Extract(const std::vector<unsigned char>& data, size_t& offset, T& value)
+	{
+		if (offset + sizeof(T) > data.size())
+		{
+			return(false);
+		}
+		memcpy(&value, data.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+	m_framebufferWidth = -1;
+	m_framebufferHeight = -1;
+	m_stepCount = 0;
+	m_eventCount = 0;
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ ***********************************************************/
+bool InputRecorder::Start(const std::string& filename)
+{
+	Stop();
+
+	m_file.open(filename, std::ios::binary);
+	if (!m_file)
+	{
+		LOG_ERROR("Could not write input recording %s", filename.c_str());
+		return(false);
+	}
+	m_filename = filename;
+	m_framebufferWidth = -1;
+	m_framebufferHeight = -1;
+	m_stepCount = 0;
+	m_eventCount = 0;
+
+	m_buffer.clear();
+	m_buffer.insert(m_buffer.end(), FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+	Append(m_buffer, FILE_VERSION);
+	m_file.write((const char*)m_buffer.data(), m_buffer.size());
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ ***********************************************************/
+void InputRecorder::Stop()
+{
+	if (!m_file.is_open())
+	{
+		return;
+	}
+
+	m_file.close();
+	LOG_INFO("Recorded %llu steps and %llu input events to %s",
+		(unsigned long long)m_stepCount,
+		(unsigned long long)m_eventCount,
+		m_filename.c_str());
+}
+
+/***********************************************************
+ *  WriteStep()
+ *
+ *  This method encodes the step into a reused buffer, and
+ *  leaves the file stream to batch up the disk writes.
+ ***********************************************************/
+void InputRecorder::WriteStep(const INPUT_STEP& step)
+{
+	if (!m_file.is_open())
+	{
+		return;
+	}
+
+	bool bSizeChanged = (step.framebufferWidth != m_framebufferWidth) ||
+		(step.framebufferHeight != m_framebufferHeight);
+	unsigned char flags = 0;
+	flags |= bSizeChanged ? STEP_FRAMEBUFFER_SIZE : 0;
+	flags |= !step.events.empty() ? STEP_EVENTS : 0;
+
+	m_buffer.clear();
+	Append(m_buffer, flags);
+	Append(m_buffer, step.time);
+	Append(m_buffer, step.animationSeconds);
+	if (bSizeChanged)
+	{
+		Append(m_buffer, (int32_t)step.framebufferWidth);
+		Append(m_buffer, (int32_t)step.framebufferHeight);
+		m_framebufferWidth = step.framebufferWidth;
+		m_framebufferHeight = step.framebufferHeight;
+	}
+	if (!step.events.empty())
+	{
+		Append(m_buffer, (uint32_t)step.events.size());
+	}
+
+	for (const INPUT_EVENT& inputEvent : step.events)
+	{
+		Append(m_buffer, (unsigned char)inputEvent.type);
+		switch (inputEvent.type)
+		{
+		case INPUT_MOUSE_MOVE:
+		case INPUT_SCROLL:
+			Append(m_buffer, inputEvent.xOffset);
+			Append(m_buffer, inputEvent.yOffset);
+			break;
+
+		case INPUT_KEY:
+			Append(m_buffer, (int16_t)inputEvent.key);
+			Append(m_buffer, (unsigned char)inputEvent.action);
+			break;
+		}
+		Append(m_buffer, (float)(inputEvent.timestamp - step.time));
+	}
+
+	m_file.write((const char*)m_buffer.data(), m_buffer.size());
+	m_stepCount++;
+	m_eventCount += step.events.size();
+}
+
+/***********************************************************
+ *  InputReplay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputReplay::InputReplay()
+{
+	m_nextStep = 0;
+}
+
+/***********************************************************
+ *  Open()
+ ***********************************************************/
+bool InputReplay::Open(const std::string& filename)
+{
+	m_steps.clear();
+	m_nextStep = 0;
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		LOG_ERROR("Could not read input recording %s", filename.c_str());
+		return(false);
+	}
+	std::vector<unsigned char> data(
+		(std::istreambuf_iterator<char>(file)),
+		std::istreambuf_iterator<char>());
+
+	size_t offset = sizeof(FILE_MAGIC);
+	uint32_t version = 0;
+	if ((data.size() < sizeof(FILE_MAGIC)) ||
+		(memcmp(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) ||
+		!Extract(data, offset, version) ||
+		(version != FILE_VERSION))
+	{
+		LOG_ERROR("%s is not an input recording", filename.c_str());
+		return(false);
+	}
+
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	// the sequence numbers are not stored - the events are numbered
+	// again as they are read
+	uint64_t mouseSequence = 0;
+	uint64_t inputSequence = 0;
+	uint64_t eventCount = 0;
+	bool bTruncated = false;
+	while (offset < data.size())
+	{
+		INPUT_STEP step;
+		unsigned char flags = 0;
+		if (!Extract(data, offset, flags) ||
+			!Extract(data, offset, step.time) ||
+			!Extract(data, offset, step.animationSeconds))
+		{
+			bTruncated = true;
+			break;
+		}
+		if ((flags & STEP_FRAMEBUFFER_SIZE) != 0)
+		{
+			int32_t width = 0;
+			int32_t height = 0;
+			if (!Extract(data, offset, width) || !Extract(data, offset, height))
+			{
+				bTruncated = true;
+				break;
+			}
+			framebufferWidth = width;
+			framebufferHeight = height;
+		}
+		step.framebufferWidth = framebufferWidth;
+		step.framebufferHeight = framebufferHeight;
+
+		uint32_t stepEventCount = 0;
+		if (((flags & STEP_EVENTS) != 0) && !Extract(data, offset, stepEventCount))
+		{
+			bTruncated = true;
+			break;
+		}
+		for (uint32_t i = 0; (i < stepEventCount) && !bTruncated; i++)
+		{
+			INPUT_EVENT inputEvent = INPUT_EVENT();
+			unsigned char type = 0;
+			bTruncated = !Extract(data, offset, type);
+			inputEvent.type = (INPUT_EVENT_TYPE)type;
+			if (!bTruncated && ((inputEvent.type == INPUT_MOUSE_MOVE) || (inputEvent.type == INPUT_SCROLL)))
+			{
+				bTruncated = !Extract(data, offset, inputEvent.xOffset) || !Extract(data, offset, inputEvent.yOffset);
+			}
+			else if (!bTruncated && (inputEvent.type == INPUT_KEY))
+			{
+				int16_t key = 0;
+				unsigned char action = 0;
+				bTruncated = !Extract(data, offset, key) || !Extract(data, offset, action);
+				inputEvent.key = key;
+				inputEvent.action = action;
+			}
+			else if (!bTruncated)
+			{
+				LOG_ERROR("%s has an unknown input event type %d", filename.c_str(), (int)type);
+				return(false);
+			}
+
+			float timestampOffset = 0.0f;
+			bTruncated = bTruncated || !Extract(data, offset, timestampOffset);
+			inputEvent.timestamp = step.time + timestampOffset;
+			if (inputEvent.type == INPUT_MOUSE_MOVE)
+			{
+				inputEvent.mouseSequence = ++mouseSequence;
+			}
+			inputEvent.inputSequence = ++inputSequence;
+			step.events.push_back(inputEvent);
+		}
+		if (bTruncated)
+		{
+			break;
+		}
+
+		eventCount += step.events.size();
+		m_steps.push_back(step);
+	}
+
+	// a session that was killed leaves a partial last step, and the
+	// steps before it still replay
+	if (bTruncated)
+	{
+		LOG_WARNING("%s ends in the middle of a step, which is dropped", filename.c_str());
+	}
+	if (m_steps.empty())
+	{
+		LOG_ERROR("%s holds no steps to replay", filename.c_str());
+		return(false);
+	}
+
+	LOG_INFO("Replaying %d steps and %llu input events from %s",
+		(int)m_steps.size(),
+		(unsigned long long)eventCount,
+		filename.c_str());
+	return(true);
+}
+
+/***********************************************************
+ *  ReadStep()
+ ***********************************************************/
+bool InputReplay::ReadStep(INPUT_STEP& step)
+{
+	if (IsFinished())
+	{
+		return(false);
+	}
+	step = m_steps[m_nextStep++];
+	return(true);
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecording.h
+// ============
+// record the input and clock of every simulation step of an interactive
+// session to a compact binary file, and play it back step for step
+//
+//  A step holds everything the simulation reads from outside - the input
+//  events applied in it, the camera clock, the animation clock and the
+//  framebuffer size - so replaying the steps in order rebuilds the same
+//  frame snapshots as the recorded session.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// kinds of input forwarded from the input thread
+enum INPUT_EVENT_TYPE
+{
+	INPUT_MOUSE_MOVE,
+	INPUT_SCROLL,
+	INPUT_KEY
+};
+
+// one input event, recorded on the input thread
+struct INPUT_EVENT
+{
+	INPUT_EVENT_TYPE type;
+	int key;
+	int action;
+	float xOffset;
+	float yOffset;
+	uint64_t mouseSequence;
+	// numbers every forwarded event in order, for telling which frame
+	// first showed it
+	uint64_t inputSequence;
+	double timestamp;
+};
+
+// what one simulation step read from the window and the clocks
+struct INPUT_STEP
+{
+	// camera clock (glfwGetTime) and animation clock, in seconds
+	double time = 0.0;
+	float animationSeconds = 0.0f;
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	// events applied in the step, oldest first
+	std::vector<INPUT_EVENT> events;
+};
+
+class InputRecorder
+{
+public:
+	// constructor
+	InputRecorder();
+	// destructor - stops recording
+	~InputRecorder();
+
+	// start writing steps to the given file
+	bool Start(const std::string& filename);
+	// finish the file
+	void Stop();
+
+	bool IsRecording() const { return(m_file.is_open()); }
+
+	// append a step - called on the simulation thread
+	void WriteStep(const INPUT_STEP& step);
+
+private:
+	std::ofstream m_file;
+	std::string m_filename;
+	// the framebuffer size is only written when it changes
+	int m_framebufferWidth;
+	int m_framebufferHeight;
+	uint64_t m_stepCount;
+	uint64_t m_eventCount;
+	std::vector<unsigned char> m_buffer;
+};
+
+class InputReplay
+{
+public:
+	// constructor
+	InputReplay();
+
+	// read every step of a recording into memory, so the replay never
+	// waits on the disk
+	bool Open(const std::string& filename);
+
+	// copy out the next step, or return false once all were read
+	bool ReadStep(INPUT_STEP& step);
+	bool IsFinished() const { return(m_nextStep >= m_steps.size()); }
+
+	size_t GetStepCount() const { return(m_steps.size()); }
+	const INPUT_STEP& GetStep(size_t index) const { return(m_steps[index]); }
+
+private:
+	std::vector<INPUT_STEP> m_steps;
+	size_t m_nextStep;
+};
@@ -0,0 +1,378 @@
+///////////////////////////////////////////////////////////////////////////////
+// logger.cpp
+// ============
+// lock-free multi-producer ring buffer of formatted log messages, drained by
+// a single background writer thread
+//
+// NOTE: the ring is a bounded queue in the style of Dmitry Vyukov's MPMC
+// queue - each slot carries a sequence number that tells producers whether
+// the slot is free and tells the writer whether it has been filled.
+//
+// A throttled call site keeps the last message it suppressed in its own
+// state, and joins a lock-free list the writer thread walks between drains.
+// Once the interval has passed the writer claims the next interval for the
+// site, exactly as a logging call would, and writes the held message - so a
+// burst always ends with its final message and never repeats an old one
+// after a newer one. Sites are never removed from the list, since their
+// state is static.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	// number of slots in the ring - must be a power of two
+	const size_t LOG_RING_SIZE = 1024;
+	// longest message kept, including the terminator
+	const size_t LOG_MESSAGE_SIZE = Logger::MESSAGE_SIZE;
+	// how long the writer sleeps when the ring is empty
+	const std::chrono::milliseconds WRITER_IDLE_INTERVAL(2);
+
+	// states of a call site's held message
+	enum HELD_STATE
+	{
+		HELD_EMPTY = 0,
+		// a thread is writing or taking the message
+		HELD_BUSY,
+		HELD_FULL
+	};
+
+	// labels printed in front of each message, by level
+	const char* const LEVEL_LABELS[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+	// one formatted message
+	struct LOG_SLOT
+	{
+		std::atomic<size_t> sequence;
+		int level;
+		uint32_t suppressedCount;
+		double timestamp;
+		char text[LOG_MESSAGE_SIZE];
+	};
+
+	// the ring buffer shared by all threads
+	struct LOG_RING
+	{
+		LOG_RING()
+		{
+			for (size_t i = 0; i < LOG_RING_SIZE; i++)
+			{
+				slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			enqueuePosition.store(0);
+			dequeuePosition = 0;
+			droppedCount.store(0);
+		}
+
+		LOG_SLOT slots[LOG_RING_SIZE];
+		alignas(64) std::atomic<size_t> enqueuePosition;
+		// only touched by the writer thread
+		alignas(64) size_t dequeuePosition;
+		// messages lost because the ring was full
+		std::atomic<uint32_t> droppedCount;
+	};
+
+	LOG_RING g_LogRing;
+
+	// clock all timestamps are relative to
+	const std::chrono::steady_clock::time_point g_LogStartTime = std::chrono::steady_clock::now();
+
+	// background writer thread
+	std::thread g_WriterThread;
+	std::atomic<bool> g_bWriterRunning(false);
+
+	// throttled call sites that have held a message back
+	std::atomic<Logger::RATE_LIMIT*> g_HoldingSites(nullptr);
+
+	/***********************************************************
+	 *  SecondsSinceStart()
+	 ***********************************************************/
+	double SecondsSinceStart()
+	{
+		return(std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - g_LogStartTime).count());
+	}
+
+	/***********************************************************
+	 *  MicrosecondsSinceStart()
+	 ***********************************************************/
+	int64_t MicrosecondsSinceStart()
+	{
+		return(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - g_LogStartTime).count());
+	}
+
+	/***********************************************************
+	 *  WriteHeldMessages()
+	 *
+	 *  Queue the message each throttled call site held back,
+	 *  once its interval has passed - or right away when the
+	 *  logger is stopping.
+	 ***********************************************************/
+	void WriteHeldMessages(bool bStopping)
+	{
+		Logger::RATE_LIMIT* pSite = g_HoldingSites.load(std::memory_order_acquire);
+		for (; NULL != pSite; pSite = pSite->pNext)
+		{
+			if (pSite->heldState.load(std::memory_order_acquire) != HELD_FULL)
+			{
+				continue;
+			}
+
+			// claim the next interval, so a call racing with this one
+			// is held back rather than logged ahead of an older value
+			int64_t now = MicrosecondsSinceStart();
+			int64_t nextAllowed = pSite->nextAllowedTime.load(std::memory_order_relaxed);
+			if ((!bStopping && (now < nextAllowed)) ||
+				!pSite->nextAllowedTime.compare_exchange_strong(
+					nextAllowed,
+					now + pSite->intervalMicroseconds.load(std::memory_order_relaxed),
+					std::memory_order_relaxed))
+			{
+				continue;
+			}
+
+			int heldState = HELD_FULL;
+			if (!pSite->heldState.compare_exchange_strong(heldState, HELD_BUSY, std::memory_order_acquire))
+			{
+				continue;
+			}
+			char text[LOG_MESSAGE_SIZE];
+			memcpy(text, pSite->heldText, LOG_MESSAGE_SIZE);
+			int level = pSite->heldLevel;
+			pSite->heldState.store(HELD_EMPTY, std::memory_order_release);
+
+			// the held message was counted as suppressed
+			uint32_t suppressedCount = pSite->suppressedCount.exchange(0, std::memory_order_relaxed);
+			Logger::Write(level, (suppressedCount > 0) ? suppressedCount - 1 : 0, "%s", text);
+		}
+	}
+
+	/***********************************************************
+	 *  WriteQueuedMessages()
+	 *
+	 *  Write every filled slot to the console, in order. Returns
+	 *  the number of messages written.
+	 ***********************************************************/
+	size_t WriteQueuedMessages()
+	{
+		size_t written = 0;
+
+		for (;;)
+		{
+			LOG_SLOT& slot = g_LogRing.slots[g_LogRing.dequeuePosition & (LOG_RING_SIZE - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != g_LogRing.dequeuePosition + 1)
+			{
+				break;
+			}
+
+			std::ostream& stream = (slot.level >= LOG_LEVEL_WARNING) ? std::cerr : std::cout;
+			char prefix[48];
+			snprintf(prefix, sizeof(prefix), "[%9.3f] %s: ", slot.timestamp, LEVEL_LABELS[slot.level]);
+			stream << prefix << slot.text;
+			if (slot.suppressedCount > 0)
+			{
+				stream << " (" << slot.suppressedCount << " similar messages suppressed)";
+			}
+			stream << '\n';
+
+			// hand the slot back to the producers
+			slot.sequence.store(g_LogRing.dequeuePosition + LOG_RING_SIZE, std::memory_order_release);
+			g_LogRing.dequeuePosition++;
+			written++;
+		}
+
+		uint32_t dropped = g_LogRing.droppedCount.exchange(0);
+		if (dropped > 0)
+		{
+			std::cerr << "WARNING: " << dropped << " log messages dropped, log ring was full\n";
+		}
+
+		if (written > 0)
+		{
+			std::cout.flush();
+		}
+		return(written);
+	}
+
+	/***********************************************************
+	 *  WriterThreadLoop()
+	 ***********************************************************/
+	void WriterThreadLoop()
+	{
+		while (g_bWriterRunning.load(std::memory_order_relaxed))
+		{
+			WriteHeldMessages(false);
+			if (WriteQueuedMessages() == 0)
+			{
+				std::this_thread::sleep_for(WRITER_IDLE_INTERVAL);
+			}
+		}
+
+		// write whatever was logged or held back during shutdown
+		WriteHeldMessages(true);
+		WriteQueuedMessages();
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method starts the background writer thread.
+ ***********************************************************/
+void Logger::Start()
+{
+	if (g_bWriterRunning.exchange(true) == false)
+	{
+		g_WriterThread = std::thread(WriterThreadLoop);
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method writes the remaining messages and stops the
+ *  background writer thread.
+ ***********************************************************/
+void Logger::Stop()
+{
+	if (g_bWriterRunning.exchange(false) == true)
+	{
+		g_WriterThread.join();
+	}
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method claims a slot in the ring and formats the
+ *  message directly into it. If every slot is taken, the
+ *  message is dropped and counted instead of waiting.
+ ***********************************************************/
+void Logger::Write(int level, uint32_t suppressedCount, const char* format, ...)
+{
+	LOG_SLOT* pSlot = NULL;
+	size_t position = g_LogRing.enqueuePosition.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		pSlot = &g_LogRing.slots[position & (LOG_RING_SIZE - 1)];
+		size_t sequence = pSlot->sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+		if (difference == 0)
+		{
+			// the slot is free - try to claim it
+			if (g_LogRing.enqueuePosition.compare_exchange_weak(
+				position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the writer has not caught up - drop the message
+			g_LogRing.droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			// another producer claimed the slot first
+			position = g_LogRing.enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	if ((level < LOG_LEVEL_DEBUG) || (level > LOG_LEVEL_ERROR))
+	{
+		level = LOG_LEVEL_ERROR;
+	}
+	pSlot->level = level;
+	pSlot->suppressedCount = suppressedCount;
+	pSlot->timestamp = SecondsSinceStart();
+
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(pSlot->text, LOG_MESSAGE_SIZE, format, arguments);
+	va_end(arguments);
+
+	// publish the slot to the writer
+	pSlot->sequence.store(position + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  CheckRateLimit()
+ *
+ *  This method lets at most one message through per interval
+ *  for a call site, and counts the ones it holds back.
+ ***********************************************************/
+bool Logger::CheckRateLimit(RATE_LIMIT& rateLimit, double intervalSeconds, uint32_t& suppressedCount)
+{
+	int64_t now = MicrosecondsSinceStart();
+	int64_t interval = (int64_t)(intervalSeconds * 1000000.0);
+	int64_t nextAllowed = rateLimit.nextAllowedTime.load(std::memory_order_relaxed);
+	rateLimit.intervalMicroseconds.store(interval, std::memory_order_relaxed);
+
+	if ((now < nextAllowed) ||
+		!rateLimit.nextAllowedTime.compare_exchange_strong(
+			nextAllowed, now + interval, std::memory_order_relaxed))
+	{
+		rateLimit.suppressedCount.fetch_add(1, std::memory_order_relaxed);
+		return(false);
+	}
+
+	// this message is newer than any held back
+	int heldState = HELD_FULL;
+	rateLimit.heldState.compare_exchange_strong(heldState, HELD_EMPTY, std::memory_order_relaxed);
+
+	suppressedCount = rateLimit.suppressedCount.exchange(0, std::memory_order_relaxed);
+	return(true);
+}
+
+/***********************************************************
+ *  HoldBack()
+ *
+ *  This method formats a suppressed message into the call
+ *  site's state in place of the one held before, and lists
+ *  the site for the writer thread. If another thread is
+ *  busy with the held message this one is only counted.
+ ***********************************************************/
+void Logger::HoldBack(RATE_LIMIT& rateLimit, int level, const char* format, ...)
+{
+	int heldState = rateLimit.heldState.load(std::memory_order_relaxed);
+	do
+	{
+		if (heldState == HELD_BUSY)
+		{
+			return;
+		}
+	} while (!rateLimit.heldState.compare_exchange_weak(heldState, HELD_BUSY, std::memory_order_acquire));
+
+	if ((level < LOG_LEVEL_DEBUG) || (level > LOG_LEVEL_ERROR))
+	{
+		level = LOG_LEVEL_ERROR;
+	}
+	rateLimit.heldLevel = level;
+
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(rateLimit.heldText, LOG_MESSAGE_SIZE, format, arguments);
+	va_end(arguments);
+
+	rateLimit.heldState.store(HELD_FULL, std::memory_order_release);
+
+	if (!rateLimit.bListed.exchange(true))
+	{
+		RATE_LIMIT* pHead = g_HoldingSites.load(std::memory_order_relaxed);
+		do
+		{
+			rateLimit.pNext = pHead;
+		} while (!g_HoldingSites.compare_exchange_weak(pHead, &rateLimit, std::memory_order_release));
+	}
+}
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// logger.h
+// ============
+// asynchronous logging that never blocks the calling thread
+//
+//  Messages are formatted straight into a slot of a lock-free ring buffer and
+//  written out by a background thread. If the ring is full the message is
+//  dropped and counted instead of waiting. Levels below LOG_MIN_LEVEL are
+//  removed at compile time, and the _THROTTLED variants limit how often a
+//  single call site may log, reporting how many messages were suppressed.
+//  The last message a call site held back is written by the background
+//  thread once its interval has passed, so the final value of a burst is
+//  never lost.
+//
+//  Usage:
+//      LOG_INFO("Loaded texture: %s (%dx%d)", filename, width, height);
+//      LOG_INFO_THROTTLED(0.5, "MovementSpeed = %.1f", speed);
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define LOG_LEVEL_DEBUG   0
+#define LOG_LEVEL_INFO    1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR   3
+
+// messages below this level are compiled out
+#ifndef LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+class Logger
+{
+public:
+	// longest message kept, including the terminator
+	static const size_t MESSAGE_SIZE = 256;
+
+	// per call site state for throttled messages
+	struct RATE_LIMIT
+	{
+		std::atomic<int64_t> nextAllowedTime{ 0 };
+		std::atomic<int64_t> intervalMicroseconds{ 0 };
+		std::atomic<uint32_t> suppressedCount{ 0 };
+
+		// the newest message held back, while heldState is HELD_FULL
+		std::atomic<int> heldState{ 0 };
+		int heldLevel = 0;
+		char heldText[MESSAGE_SIZE];
+		// links the call sites that have held a message back, for
+		// the writer thread
+		std::atomic<bool> bListed{ false };
+		RATE_LIMIT* pNext = nullptr;
+	};
+
+	// start the background writer thread - messages logged before
+	// this call are kept in the ring and written once it starts
+	static void Start();
+	// write out everything still queued and stop the writer thread
+	static void Stop();
+
+	// format a message into the ring buffer - never blocks
+	static void Write(int level, uint32_t suppressedCount, const char* format, ...) LOG_PRINTF_FORMAT(3, 4);
+
+	// returns true if the call site may log now, along with the number
+	// of messages it suppressed since it last logged
+	static bool CheckRateLimit(RATE_LIMIT& rateLimit, double intervalSeconds, uint32_t& suppressedCount);
+	// keep a suppressed message, replacing the one held before, for the
+	// writer thread to write once the call site's interval has passed
+	static void HoldBack(RATE_LIMIT& rateLimit, int level, const char* format, ...) LOG_PRINTF_FORMAT(3, 4);
+};
+
+#define LOG_AT_LEVEL(level, ...) \
+	do { \
+		if ((level) >= LOG_MIN_LEVEL) \
+		{ \
+			Logger::Write((level), 0, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_THROTTLED_AT_LEVEL(level, intervalSeconds, ...) \
+	do { \
+		if ((level) >= LOG_MIN_LEVEL) \
+		{ \
+			static Logger::RATE_LIMIT logRateLimit; \
+			uint32_t logSuppressedCount = 0; \
+			if (Logger::CheckRateLimit(logRateLimit, (intervalSeconds), logSuppressedCount)) \
+			{ \
+				Logger::Write((level), logSuppressedCount, __VA_ARGS__); \
+			} \
+			else \
+			{ \
+				Logger::HoldBack(logRateLimit, (level), __VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+#define LOG_DEBUG(...)   LOG_AT_LEVEL(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT_LEVEL(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT_LEVEL(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT_LEVEL(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#define LOG_DEBUG_THROTTLED(intervalSeconds, ...)   LOG_THROTTLED_AT_LEVEL(LOG_LEVEL_DEBUG, intervalSeconds, __VA_ARGS__)
+#define LOG_INFO_THROTTLED(intervalSeconds, ...)    LOG_THROTTLED_AT_LEVEL(LOG_LEVEL_INFO, intervalSeconds, __VA_ARGS__)
+#define LOG_WARNING_THROTTLED(intervalSeconds, ...) LOG_THROTTLED_AT_LEVEL(LOG_LEVEL_WARNING, intervalSeconds, __VA_ARGS__)
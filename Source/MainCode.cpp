@@ -9,6 +9,13 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <atomic>           // worker thread shutdown flags
+#include <chrono>           // simulation step timing
+#include <thread>           // simulation and render threads
+#include <string>           // command line options
+#include <vector>           // headless frame readback
+#include <algorithm>        // std::max
+#include <cstdio>           // sscanf
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -23,6 +30,39 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "FrameState.h"
+#include "TripleBuffer.h"
+#include "CpuProfiler.h"
+#include "Benchmark.h"
+#include "MicroBenchmark.h"
+#include "SceneMicroBenchmarks.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+#include "PerfCounters.h"
+#include "RenderStats.h"
+#include "StatsOverlay.h"
+#include "ResolutionScaler.h"
+#include "TemporalUpscaler.h"
+#include "MultiViewRenderer.h"
+#include "PanoramaCapture.h"
+#include "HeadlessContext.h"
+#include "InputRecording.h"
+#include "OffscreenTarget.h"
+#include "ImageWriter.h"
+#include "FrameRecorder.h"
+#include "TiledStillRenderer.h"
+#include "RenderServer.h"
+#include "SoftwareRasterizer.h"
+#include "RayTracer.h"
+#include "GLRenderDevice.h"
+#include "NullRenderDevice.h"
+#include "VulkanRenderDevice.h"
+#include "DeviceSceneRenderer.h"
+#include "CaptureRenderDevice.h"
+#include "CaptureReplayer.h"
+#include "StartupProfiler.h"
+#include "StartupLoader.h"
+#include "Logger.h"
 
 // Namespace for declaring global variables
 namespace
@@ -33,18 +73,162 @@ namespace
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
+	// the scene shader files
+	const char* const VERTEX_SHADER_FILE = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILE = "shaders/fragmentShader.glsl";
+	const char* const GEOMETRY_SHADER_FILE = "shaders/multiViewGeometryShader.glsl";
+
 	// scene manager object for managing the 3D scene prepare and render
 	SceneManager* g_SceneManager = nullptr;
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// draws several views of the scene from one submission
+	MultiViewRenderer* g_MultiViewRenderer = nullptr;
+
+	// the simulation thread publishes a new frame snapshot this often
+	const std::chrono::microseconds SIMULATION_INTERVAL(1000000 / 240);
+	// how often input the simulation had no room for is sent again
+	const double INPUT_RETRY_SECONDS = 0.001;
+	// frames the driver may queue ahead - kept low to keep input latency low
+	const int MAX_FRAMES_IN_FLIGHT = 1;
+	// frames the benchmark lets the driver queue, so the CPU and GPU
+	// overlap as they would in a game loop without vsync
+	const int BENCHMARK_FRAMES_IN_FLIGHT = 2;
+
+	// GPU time per frame the render resolution is scaled to hold, and
+	// the range of the scale as a fraction of the window resolution
+	const float TARGET_GPU_FRAME_MS = 1000.0f / 60.0f;
+	const float MIN_RENDER_SCALE = 0.5f;
+	const float MAX_RENDER_SCALE = 1.0f;
+	// with temporal upscaling the history fills in the missing detail,
+	// so the scale is held lower to spend the savings elsewhere
+	const float MAX_TEMPORAL_RENDER_SCALE = 0.7f;
+
+	// size of each cube face and width of the panoramas captured with C
+	const int PANORAMA_FACE_SIZE = 1024;
+	const int PANORAMA_WIDTH = 4096;
+
+	// frame rate written into recorded videos
+	const int RECORDING_FRAMES_PER_SECOND = 60;
+
+	// settings for rendering without a display window, from the command line
+	struct HEADLESS_OPTIONS
+	{
+		bool bEnabled = false;
+		int frameCount = 1;
+		int width = 1000;
+		int height = 800;
+		std::string outputFilename;
+		std::string recordFilename;
+		// a still rendered in tiles, for sizes beyond the framebuffer limits
+		std::string tiledFilename;
+		int tileSize = 2048;
+		int tileThreads = 1;
+		// socket path for serving render requests until shut down
+		std::string serverSocketPath;
+		// draw on the CPU instead of through an OpenGL driver
+		bool bSoftwareRendering = false;
+		int softwareThreads = 0;
+		// ray trace a still of the last frame, refining it with each sample
+		bool bRayTracing = false;
+		int rayTracingSamples = 16;
+		int rayTracingThreads = 0;
+		// rewrite the output each time the sample count doubles
+		bool bProgressive = false;
+		// time the passes across thread counts before the render
+		bool bScalingReport = false;
+		// submit through a render device - "gl", "vulkan" or "null",
+		// which draws nothing - recording the command lists on several
+		// threads
+		std::string renderDevice;
+		int recordThreads = 0;
+		// write a Chrome trace of the CPU scopes on every thread to this
+		// file at exit - with or without a window
+		std::string traceFilename;
+		// write the render statistics of every frame to this CSV file
+		std::string statsCsvFilename;
+		// count the render thread's cycles, instructions, cache and
+		// branch misses per frame and scope into this CSV file - Linux
+		// perf events only
+		std::string perfCountersFilename;
+		// replay the scripted fly-through for this many frames and save
+		// the frame time distribution - in the window unless headless
+		int benchmarkFrames = 0;
+		std::string benchmarkFilename = "benchmark.json";
+		// fail when a timing is slower than this baseline by more than
+		// the threshold, in percent
+		std::string baselineFilename;
+		double regressionThreshold = 5.0;
+		// time the scene's hot paths in isolation and save the results as
+		// Google Benchmark JSON - the mesh generators run in a headless
+		// context unless the null device is asked for
+		std::string microBenchmarkFilename;
+		std::string microBenchmarkFilter;
+		// save the input and clocks of every simulation step of the
+		// session, or replay a saved session in the window one frame per
+		// step in place of the live input
+		std::string recordInputFilename;
+		std::string replayInputFilename;
+		// save the resources and last frame sent to the render device,
+		// or submit a saved frame again and again with nothing else
+		// running, to time the command stream on one device or driver
+		std::string captureFilename;
+		std::string replayCaptureFilename;
+		// do all of startup on the main thread in order, to compare
+		// with the textures, meshes and shader files loading alongside
+		// the window and context
+		bool bSerialStartup = false;
+	};
+
+	// accumulated cost of drawing in one view mode, so stereo can be
+	// compared with mono
+	struct VIEW_MODE_COST
+	{
+		double cpuMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		uint64_t frames = 0;
+	};
+
+	// when main() started, for the startup time
+	std::chrono::steady_clock::time_point g_ApplicationStartTime;
+
+	// frame snapshots handed from the simulation thread to the render thread
+	TripleBuffer<FRAME_STATE> g_FrameStates;
+	// what the last simulation step read from the window and the clocks
+	INPUT_STEP g_InputStep;
+	// writes every step when recording, and supplies them when replaying
+	InputRecorder* g_pInputRecorder = nullptr;
+	InputReplay* g_pInputReplay = nullptr;
+	// cleared by the input thread to ask the worker threads to stop
+	std::atomic<bool> g_bWorkerThreadsRunning(false);
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
-bool InitializeGLEW();
+bool InitializeGLEW(bool bHeadless = false);
+bool ParseCommandLine(int argc, char* argv[], HEADLESS_OPTIONS& headlessOptions);
+void CreateSceneObjects(StartupLoader* pStartupLoader = NULL);
+void DestroySceneObjects();
+int RunHeadless(const HEADLESS_OPTIONS& headlessOptions);
+int RenderTiledStill(const HEADLESS_OPTIONS& headlessOptions, HeadlessContext* pHeadlessContext);
+int RunRenderServer(const HEADLESS_OPTIONS& headlessOptions);
+int RunSoftwareRenderer(const HEADLESS_OPTIONS& headlessOptions);
+int RunRayTracer(const HEADLESS_OPTIONS& headlessOptions);
+void PrintRayTracingScalingReport(RayTracer& rayTracer);
+RenderDevice* CreateHeadlessDevice(const std::string& deviceName, int width, int height, HeadlessContext& headlessContext, OffscreenTarget*& pOffscreenTarget);
+int RunDeviceRenderer(const HEADLESS_OPTIONS& headlessOptions);
+int RunCaptureReplay(const HEADLESS_OPTIONS& headlessOptions);
+int RunBenchmark(const HEADLESS_OPTIONS& headlessOptions, GLFWwindow* pWindow);
+int RunMicroBenchmarks(const HEADLESS_OPTIONS& headlessOptions);
+void UpdateSimulation(uint64_t frameNumber);
+void SimulationThreadLoop(uint64_t firstFrameNumber);
+void RenderThreadLoop(std::string perfCountersFilename, uint64_t nextFrameNumber);
+void RenderFrames(const std::string& perfCountersFilename, uint64_t nextFrameNumber);
+bool StartPerfCounters(PerfCounters& perfCounters, const std::string& filename);
+void PrintStereoCostReport(const VIEW_MODE_COST& monoCost, const VIEW_MODE_COST& stereoCost);
 
 
 /***********************************************************
@@ -55,9 +239,74 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	g_ApplicationStartTime = std::chrono::steady_clock::now();
+
+	// start writing log messages in the background
+	Logger::Start();
+
+	HEADLESS_OPTIONS headlessOptions;
+	if (!ParseCommandLine(argc, argv, headlessOptions))
+	{
+		Logger::Stop();
+		return(EXIT_FAILURE);
+	}
+
+	// time startup and every frame until the application exits
+	PROFILE_THREAD_NAME("main");
+	if (!headlessOptions.traceFilename.empty())
+	{
+		CpuProfiler::Start(headlessOptions.traceFilename);
+	}
+	if (!headlessOptions.statsCsvFilename.empty())
+	{
+		RenderStats::OpenCsv(headlessOptions.statsCsvFilename);
+	}
+
+	// time the hot paths on their own instead of drawing frames
+	if (!headlessOptions.microBenchmarkFilename.empty())
+	{
+		int result = RunMicroBenchmarks(headlessOptions);
+		CpuProfiler::Stop();
+		RenderStats::CloseCsv();
+		Logger::Stop();
+		return(result);
+	}
+
+	// submit a captured frame on its own, without the scene
+	if (!headlessOptions.replayCaptureFilename.empty())
+	{
+		int result = RunCaptureReplay(headlessOptions);
+		CpuProfiler::Stop();
+		RenderStats::CloseCsv();
+		Logger::Stop();
+		return(result);
+	}
+
+	// render without a window or display server when asked to
+	if (headlessOptions.bEnabled)
+	{
+		int result = RunHeadless(headlessOptions);
+		CpuProfiler::Stop();
+		RenderStats::CloseCsv();
+		Logger::Stop();
+		return(result);
+	}
+
+	// time each phase of startup up to the first frame on screen, and
+	// do the work that needs no context on worker threads while the
+	// window and context come up
+	StartupProfiler::Start(g_ApplicationStartTime);
+	StartupLoader startupLoader(!headlessOptions.bSerialStartup);
+	// the shader manager only compiles from file paths, so of the
+	// shaders just the geometry shader is read ahead
+	startupLoader.Start({ GEOMETRY_SHADER_FILE });
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
+		CpuProfiler::Stop();
+		RenderStats::CloseCsv();
+		Logger::Stop();
 		return(EXIT_FAILURE);
 	}
 
@@ -68,50 +317,373 @@ int main(int argc, char* argv[])
 		g_ShaderManager);
 
 	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	{
+		StartupPhase startupPhase("CreateDisplayWindow");
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
 	{
+		CpuProfiler::Stop();
+		RenderStats::CloseCsv();
+		Logger::Stop();
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	// load the shaders and prepare the 3D scene
+	CreateSceneObjects(&startupLoader);
+	startupLoader.Finish();
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	// measure the scripted fly-through instead of running interactively
+	if (headlessOptions.benchmarkFrames > 0)
+	{
+		// the benchmark times its own frames, so startup is reported
+		// up to the scene being ready
+		StartupProfiler::Finish();
+		int result = RunBenchmark(headlessOptions, g_Window);
+		DestroySceneObjects();
+		CpuProfiler::Stop();
+		RenderStats::CloseCsv();
+		Logger::Stop();
+		return(result);
+	}
+
+	// replay a recorded session in place of the live input, and record
+	// this one when asked to
+	InputReplay inputReplay;
+	InputRecorder inputRecorder;
+	if (!headlessOptions.replayInputFilename.empty())
+	{
+		if (!inputReplay.Open(headlessOptions.replayInputFilename))
+		{
+			DestroySceneObjects();
+			CpuProfiler::Stop();
+			RenderStats::CloseCsv();
+			Logger::Stop();
+			return(EXIT_FAILURE);
+		}
+		g_pInputReplay = &inputReplay;
+
+		// the views are drawn exactly as they were simulated, in a
+		// window of the recorded size
+		g_ViewManager->SetLateLatching(false);
+		const INPUT_STEP& firstStep = inputReplay.GetStep(0);
+		if ((firstStep.framebufferWidth > 0) && (firstStep.framebufferHeight > 0))
+		{
+			glfwSetWindowSize(g_Window, firstStep.framebufferWidth, firstStep.framebufferHeight);
+		}
+	}
+	if (!headlessOptions.recordInputFilename.empty() &&
+		inputRecorder.Start(headlessOptions.recordInputFilename))
+	{
+		g_pInputRecorder = &inputRecorder;
+	}
+
+	// publish an initial snapshot so the render thread always has
+	// something valid to draw
+	uint64_t frameNumber = 0;
+	{
+		StartupPhase startupPhase("FirstSimulationStep");
+		UpdateSimulation(frameNumber++);
+	}
+
+	// the render thread owns the OpenGL context from here on, the
+	// simulation runs on its own thread, and this thread does nothing
+	// but wait for window events so that input is never held up. A
+	// replay steps the simulation on the render thread instead, so
+	// that each recorded step is drawn exactly once.
+	glfwMakeContextCurrent(NULL);
+	g_bWorkerThreadsRunning = true;
+	std::thread simulationThread;
+	if (NULL == g_pInputReplay)
+	{
+		simulationThread = std::thread(SimulationThreadLoop, frameNumber);
+	}
+	std::thread renderThread(RenderThreadLoop, headlessOptions.perfCountersFilename, frameNumber);
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// sleep until the next GLFW events arrive, or only briefly
+		// while input is waiting for room in the simulation's queue
+		if (ViewManager::FlushPendingInput())
+		{
+			glfwWaitEventsTimeout(INPUT_RETRY_SECONDS);
+		}
+		else
+		{
+			glfwWaitEvents();
+		}
+	}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// stop the worker threads and take the OpenGL context back so the
+	// manager objects can release their resources
+	g_bWorkerThreadsRunning = false;
+	if (simulationThread.joinable())
+	{
+		simulationThread.join();
+	}
+	renderThread.join();
+	glfwMakeContextCurrent(g_Window);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+	// exit() skips the destructors, so the recording is finished here
+	inputRecorder.Stop();
+	g_pInputRecorder = nullptr;
+	g_pInputReplay = nullptr;
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+	// clear the allocated manager objects from memory
+	DestroySceneObjects();
 
+	// write out the trace and any remaining log messages
+	CpuProfiler::Stop();
+	RenderStats::CloseCsv();
+	Logger::Stop();
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+	// Terminates the program successfully
+	exit(EXIT_SUCCESS); 
+}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function reads the command line options. Returns
+ *  false when an option is not recognized.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[], HEADLESS_OPTIONS& headlessOptions)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		bool bHasValue = (i + 1 < argc);
+
+		if (option == "--headless")
+		{
+			headlessOptions.bEnabled = true;
+		}
+		else if ((option == "--frames") && bHasValue)
+		{
+			headlessOptions.frameCount = std::max(1, atoi(argv[++i]));
+		}
+		else if ((option == "--size") && bHasValue)
+		{
+			int width = 0;
+			int height = 0;
+			if ((sscanf(argv[++i], "%dx%d", &width, &height) != 2) || (width <= 0) || (height <= 0))
+			{
+				LOG_ERROR("--size expects WIDTHxHEIGHT, got %s", argv[i]);
+				return(false);
+			}
+			headlessOptions.width = width;
+			headlessOptions.height = height;
+		}
+		else if ((option == "--output") && bHasValue)
+		{
+			headlessOptions.outputFilename = argv[++i];
+		}
+		else if ((option == "--record") && bHasValue)
+		{
+			headlessOptions.recordFilename = argv[++i];
+		}
+		else if ((option == "--tiled") && bHasValue)
+		{
+			headlessOptions.tiledFilename = argv[++i];
+		}
+		else if ((option == "--tile-size") && bHasValue)
+		{
+			headlessOptions.tileSize = std::max(16, atoi(argv[++i]));
+		}
+		else if ((option == "--tile-threads") && bHasValue)
+		{
+			headlessOptions.tileThreads = std::max(1, atoi(argv[++i]));
+		}
+		else if ((option == "--serve") && bHasValue)
+		{
+			// the server always runs without a window
+			headlessOptions.bEnabled = true;
+			headlessOptions.serverSocketPath = argv[++i];
+		}
+		else if (option == "--software")
+		{
+			// the software renderer needs no window or context
+			headlessOptions.bEnabled = true;
+			headlessOptions.bSoftwareRendering = true;
+		}
+		else if ((option == "--software-threads") && bHasValue)
+		{
+			headlessOptions.softwareThreads = std::max(0, atoi(argv[++i]));
+		}
+		else if (option == "--raytrace")
+		{
+			// the ray tracer needs no window or context either
+			headlessOptions.bEnabled = true;
+			headlessOptions.bRayTracing = true;
+		}
+		else if ((option == "--samples") && bHasValue)
+		{
+			headlessOptions.rayTracingSamples = std::max(1, atoi(argv[++i]));
+		}
+		else if ((option == "--raytrace-threads") && bHasValue)
+		{
+			headlessOptions.rayTracingThreads = std::max(0, atoi(argv[++i]));
+		}
+		else if (option == "--progressive")
+		{
+			headlessOptions.bProgressive = true;
+		}
+		else if (option == "--scaling-report")
+		{
+			headlessOptions.bScalingReport = true;
+		}
+		else if ((option == "--device") && bHasValue)
+		{
+			headlessOptions.bEnabled = true;
+			headlessOptions.renderDevice = argv[++i];
+			if ((headlessOptions.renderDevice != "gl") &&
+				(headlessOptions.renderDevice != "vulkan") &&
+				(headlessOptions.renderDevice != "null"))
+			{
+				LOG_ERROR("--device expects gl, vulkan or null, got %s", argv[i]);
+				return(false);
+			}
+		}
+		else if ((option == "--record-threads") && bHasValue)
+		{
+			headlessOptions.recordThreads = std::max(0, atoi(argv[++i]));
+		}
+		else if ((option == "--trace") && bHasValue)
+		{
+			headlessOptions.traceFilename = argv[++i];
+		}
+		else if ((option == "--stats-csv") && bHasValue)
+		{
+			headlessOptions.statsCsvFilename = argv[++i];
+		}
+		else if ((option == "--perf-counters") && bHasValue)
+		{
+			headlessOptions.perfCountersFilename = argv[++i];
+		}
+		else if ((option == "--benchmark") && bHasValue)
+		{
+			headlessOptions.benchmarkFrames = std::max(1, atoi(argv[++i]));
+		}
+		else if ((option == "--benchmark-output") && bHasValue)
+		{
+			headlessOptions.benchmarkFilename = argv[++i];
+		}
+		else if ((option == "--baseline") && bHasValue)
+		{
+			headlessOptions.baselineFilename = argv[++i];
+		}
+		else if ((option == "--regression-threshold") && bHasValue)
+		{
+			headlessOptions.regressionThreshold = std::max(0.0, atof(argv[++i]));
+		}
+		else if ((option == "--microbench") && bHasValue)
+		{
+			headlessOptions.microBenchmarkFilename = argv[++i];
+		}
+		else if ((option == "--microbench-filter") && bHasValue)
+		{
+			headlessOptions.microBenchmarkFilter = argv[++i];
+		}
+		else if ((option == "--record-input") && bHasValue)
+		{
+			headlessOptions.recordInputFilename = argv[++i];
+		}
+		else if ((option == "--replay-input") && bHasValue)
+		{
+			headlessOptions.replayInputFilename = argv[++i];
+		}
+		else if ((option == "--capture") && bHasValue)
+		{
+			headlessOptions.bEnabled = true;
+			headlessOptions.captureFilename = argv[++i];
+		}
+		else if ((option == "--replay-capture") && bHasValue)
+		{
+			headlessOptions.replayCaptureFilename = argv[++i];
+		}
+		else if (option == "--serial-startup")
+		{
+			headlessOptions.bSerialStartup = true;
+		}
+		else
+		{
+			LOG_ERROR("Unknown option %s", option.c_str());
+			LOG_INFO("Usage: %s [--headless [--frames N] [--size WIDTHxHEIGHT] [--output image.png|qoi|ppm] [--record video.y4m|stills.png|stills.qoi] [--tiled image.png|ppm [--tile-size N] [--tile-threads N]] [--software [--software-threads N]] [--raytrace [--samples N] [--progressive] [--raytrace-threads N] [--scaling-report]] [--device gl|vulkan|null [--record-threads N]] | --serve socket] [--trace trace.json] [--stats-csv stats.csv] [--perf-counters counters.csv] [--benchmark N [--benchmark-output results.json] [--baseline baseline.json [--regression-threshold PERCENT]]] [--microbench results.json [--microbench-filter TEXT]] [--record-input session.input] [--replay-input session.input] [--capture frame.capture] [--replay-capture frame.capture [--device gl|vulkan|null] [--frames N] [--output image.png]] [--serial-startup]", argv[0]);
+			return(false);
+		}
 	}
 
-	// clear the allocated manager objects from memory
+	// frames are captured at the render device, so capturing goes
+	// through one
+	if (!headlessOptions.captureFilename.empty() && headlessOptions.renderDevice.empty())
+	{
+		headlessOptions.renderDevice = "gl";
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	CreateSceneObjects()
+ *
+ *  This function loads the shaders and prepares the 3D scene
+ *  once an OpenGL context is current, with the files read
+ *  and the textures decoded by the startup loader when one
+ *  is given.
+ ***********************************************************/
+void CreateSceneObjects(StartupLoader* pStartupLoader)
+{
+	PROFILE_SCOPE("CreateSceneObjects");
+
+	// load the shader code from the external GLSL files
+	{
+		StartupPhase startupPhase("LoadShaders");
+		g_ShaderManager->LoadShaders(
+			VERTEX_SHADER_FILE,
+			FRAGMENT_SHADER_FILE);
+		g_ShaderManager->use();
+	}
+
+	// try to create a new scene manager object and prepare the 3D scene
+	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->PrepareScene((NULL != pStartupLoader) ? pStartupLoader->WaitForSceneAssets() : NULL);
+
+	// the multi-view programs are only linked once views are drawn,
+	// so this just keeps the geometry shader source
+	{
+		if (NULL != pStartupLoader)
+		{
+			pStartupLoader->WaitForShaderFiles();
+		}
+		StartupPhase startupPhase("LoadGeometryShader");
+		g_MultiViewRenderer = new MultiViewRenderer(
+			g_ShaderManager,
+			g_SceneManager,
+			VERTEX_SHADER_FILE,
+			FRAGMENT_SHADER_FILE);
+		if ((NULL != pStartupLoader) && !pStartupLoader->GetShaderFile(GEOMETRY_SHADER_FILE).empty())
+		{
+			g_MultiViewRenderer->LoadGeometryShaderSource(pStartupLoader->GetShaderFile(GEOMETRY_SHADER_FILE));
+		}
+		else
+		{
+			g_MultiViewRenderer->LoadGeometryShader(GEOMETRY_SHADER_FILE);
+		}
+	}
+}
+
+/***********************************************************
+ *	DestroySceneObjects()
+ *
+ *  This function clears the allocated manager objects from
+ *  memory, while the OpenGL context is still current.
+ ***********************************************************/
+void DestroySceneObjects()
+{
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -122,14 +694,1365 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_MultiViewRenderer)
+	{
+		delete g_MultiViewRenderer;
+		g_MultiViewRenderer = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+/***********************************************************
+ *	RunHeadless()
+ *
+ *  This function renders the scene into an offscreen target
+ *  through a windowless EGL context, so that it runs on
+ *  machines without a display server or GPU. The frames are
+ *  stepped on this thread, and the last one can be written
+ *  to an image file.
+ ***********************************************************/
+int RunHeadless(const HEADLESS_OPTIONS& headlessOptions)
+{
+	if (headlessOptions.bSoftwareRendering)
+	{
+		return(RunSoftwareRenderer(headlessOptions));
+	}
+	if (headlessOptions.bRayTracing)
+	{
+		return(RunRayTracer(headlessOptions));
+	}
+	if (!headlessOptions.renderDevice.empty())
+	{
+		return(RunDeviceRenderer(headlessOptions));
+	}
+
+	HeadlessContext headlessContext;
+	if (!headlessContext.Create())
+	{
+		return(EXIT_FAILURE);
+	}
+	if (InitializeGLEW(true) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	g_ShaderManager = new ShaderManager();
+	g_ViewManager = new ViewManager(g_ShaderManager);
+	g_ViewManager->SetFramebufferSize(headlessOptions.width, headlessOptions.height);
+
+	// the display window normally sets up blending
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	CreateSceneObjects();
+
+	if (headlessOptions.benchmarkFrames > 0)
+	{
+		int result = RunBenchmark(headlessOptions, NULL);
+		DestroySceneObjects();
+		return(result);
+	}
+	if (!headlessOptions.tiledFilename.empty())
+	{
+		int result = RenderTiledStill(headlessOptions, &headlessContext);
+		DestroySceneObjects();
+		return(result);
+	}
+	if (!headlessOptions.serverSocketPath.empty())
+	{
+		int result = RunRenderServer(headlessOptions);
+		DestroySceneObjects();
+		return(result);
+	}
+
+	// the target is released before the scene objects, while the
+	// context is still current
+	{
+		OffscreenTarget offscreenTarget;
+		offscreenTarget.Resize(headlessOptions.width, headlessOptions.height);
+
+		// batch recording keeps every frame
+		FrameRecorder frameRecorder(0);
+		if (!headlessOptions.recordFilename.empty())
+		{
+			frameRecorder.Start(
+				headlessOptions.recordFilename,
+				FrameRecorder::BACKPRESSURE_WAIT,
+				RECORDING_FRAMES_PER_SECOND);
+		}
+
+		PerfCounters perfCounters;
+		if (StartPerfCounters(perfCounters, headlessOptions.perfCountersFilename))
+		{
+			g_SceneManager->SetPerfCounters(&perfCounters);
+		}
+
+		auto renderStart = std::chrono::steady_clock::now();
+		auto frameStart = renderStart;
+		for (int frame = 0; frame < headlessOptions.frameCount; frame++)
+		{
+			perfCounters.BeginFrame();
+			UpdateSimulation((uint64_t)frame);
+			g_FrameStates.Consume();
+			const FRAME_STATE& frameState = g_FrameStates.GetReadBuffer();
+
+			offscreenTarget.Bind();
+			glEnable(GL_DEPTH_TEST);
+			auto submitStart = std::chrono::steady_clock::now();
+			{
+				PerfCounterScope perfScope(&perfCounters, "prepare view");
+				g_ViewManager->PrepareSceneView(frameState);
+			}
+			{
+				PerfCounterScope perfScope(&perfCounters, "render scene");
+				g_SceneManager->RenderScene(frameState);
+			}
+			auto submitEnd = std::chrono::steady_clock::now();
+
+			frameRecorder.CaptureFrame(
+				offscreenTarget.GetFramebuffer(),
+				offscreenTarget.GetWidth(),
+				offscreenTarget.GetHeight());
+
+			// there is no GPU timer without the resolution scaler
+			auto frameEnd = std::chrono::steady_clock::now();
+			double frameMilliseconds = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+			RenderStats::EndFrame(
+				frameMilliseconds,
+				std::chrono::duration<double, std::milli>(submitEnd - submitStart).count(),
+				0.0);
+			perfCounters.EndFrame(frameMilliseconds);
+			frameStart = frameEnd;
+		}
+		frameRecorder.Stop();
+		glFinish();
+		g_SceneManager->SetPerfCounters(NULL);
+		perfCounters.PrintReport();
+
+		double renderMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - renderStart).count();
+		LOG_INFO("Rendered %d headless frames at %dx%d, %.3f ms per frame",
+			headlessOptions.frameCount,
+			headlessOptions.width,
+			headlessOptions.height,
+			renderMilliseconds / headlessOptions.frameCount);
+
+		if (!headlessOptions.outputFilename.empty())
+		{
+			std::vector<unsigned char> pixels;
+			offscreenTarget.ReadPixels(pixels);
+			if (ImageWriter::WriteImage(
+				headlessOptions.outputFilename,
+				offscreenTarget.GetWidth(),
+				offscreenTarget.GetHeight(),
+				pixels.data()))
+			{
+				LOG_INFO("Wrote %s", headlessOptions.outputFilename.c_str());
+			}
+		}
+	}
+
+	DestroySceneObjects();
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RenderTiledStill()
+ *
+ *  This function steps the simulation to the last frame and
+ *  renders it in tiles, so the still can be far larger than
+ *  a framebuffer and is never held in memory as a whole.
+ ***********************************************************/
+int RenderTiledStill(const HEADLESS_OPTIONS& headlessOptions, HeadlessContext* pHeadlessContext)
+{
+	for (int frame = 0; frame < headlessOptions.frameCount; frame++)
+	{
+		UpdateSimulation((uint64_t)frame);
+	}
+	g_FrameStates.Consume();
+	const FRAME_STATE& frameState = g_FrameStates.GetReadBuffer();
+
+	TiledStillRenderer tiledStillRenderer(headlessOptions.tileSize);
+	if ((headlessOptions.tileThreads <= 1) ||
+		(tiledStillRenderer.CreateWorkerContexts(headlessOptions.tileThreads, pHeadlessContext) == 0))
+	{
+		tiledStillRenderer.UseCurrentContext(g_ShaderManager, g_SceneManager);
+	}
+
+	if (!tiledStillRenderer.Render(
+		frameState,
+		headlessOptions.width,
+		headlessOptions.height,
+		headlessOptions.tiledFilename))
+	{
+		return(EXIT_FAILURE);
+	}
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RunRenderServer()
+ *
+ *  This function keeps the prepared scene resident and
+ *  renders batches of camera requests from local clients
+ *  until one asks the server to shut down. The simulation is
+ *  stepped once per batch to keep the lighting animated.
+ ***********************************************************/
+int RunRenderServer(const HEADLESS_OPTIONS& headlessOptions)
+{
+	RenderServer renderServer(g_ShaderManager, g_SceneManager);
+	if (!renderServer.Open(headlessOptions.serverSocketPath))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	uint64_t frameNumber = 0;
+	while (renderServer.WaitForRequests())
+	{
+		UpdateSimulation(frameNumber++);
+		g_FrameStates.Consume();
+		renderServer.RenderBatch(g_FrameStates.GetReadBuffer());
+	}
+
+	LOG_INFO("Render server stopped");
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RunSoftwareRenderer()
+ *
+ *  This function renders the headless frames with the CPU
+ *  rasterizer, for machines with no OpenGL driver at all.
+ *  The scene builds the same draw list it submits to OpenGL
+ *  and the rasterizer draws it with the scene shader model.
+ ***********************************************************/
+int RunSoftwareRenderer(const HEADLESS_OPTIONS& headlessOptions)
+{
+	// no shader manager - the managers only describe the scene
+	g_ViewManager = new ViewManager(NULL);
+	g_ViewManager->SetFramebufferSize(headlessOptions.width, headlessOptions.height);
+	g_SceneManager = new SceneManager(NULL);
+	g_SceneManager->PrepareSceneDescription();
+
+	SoftwareRasterizer softwareRasterizer(headlessOptions.softwareThreads);
+	softwareRasterizer.LoadTextures();
+	softwareRasterizer.Resize(headlessOptions.width, headlessOptions.height);
+
+	DRAW_LIST drawList;
+	auto renderStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < headlessOptions.frameCount; frame++)
+	{
+		UpdateSimulation((uint64_t)frame);
+		g_FrameStates.Consume();
+		const FRAME_STATE& frameState = g_FrameStates.GetReadBuffer();
+
+		g_SceneManager->BuildDrawList(frameState, drawList);
+		softwareRasterizer.Render(
+			drawList,
+			frameState.view,
+			frameState.projection,
+			frameState.viewPosition);
+	}
+
+	double renderMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - renderStart).count();
+	LOG_INFO("Rendered %d software frames at %dx%d on %d threads (%s), %.3f ms per frame",
+		headlessOptions.frameCount,
+		headlessOptions.width,
+		headlessOptions.height,
+		softwareRasterizer.GetThreadCount(),
+		softwareRasterizer.UsesAvx2() ? "AVX2" : "no AVX2",
+		renderMilliseconds / headlessOptions.frameCount);
+
+	if (!headlessOptions.outputFilename.empty())
+	{
+		std::vector<unsigned char> pixels;
+		softwareRasterizer.ReadPixels(pixels);
+		if (ImageWriter::WriteImage(
+			headlessOptions.outputFilename,
+			softwareRasterizer.GetWidth(),
+			softwareRasterizer.GetHeight(),
+			pixels.data()))
+		{
+			LOG_INFO("Wrote %s", headlessOptions.outputFilename.c_str());
+		}
+	}
+
+	DestroySceneObjects();
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RunRayTracer()
+ *
+ *  This function ray traces a still of the last frame on the
+ *  CPU, one sample per pixel per pass. In progressive mode
+ *  the output is rewritten each time the sample count
+ *  doubles, so a long render can be checked while it runs.
+ ***********************************************************/
+int RunRayTracer(const HEADLESS_OPTIONS& headlessOptions)
+{
+	// no shader manager - the managers only describe the scene
+	g_ViewManager = new ViewManager(NULL);
+	g_ViewManager->SetFramebufferSize(headlessOptions.width, headlessOptions.height);
+	g_SceneManager = new SceneManager(NULL);
+	g_SceneManager->PrepareSceneDescription();
+
+	for (int frame = 0; frame < headlessOptions.frameCount; frame++)
+	{
+		UpdateSimulation((uint64_t)frame);
+	}
+	g_FrameStates.Consume();
+	const FRAME_STATE& frameState = g_FrameStates.GetReadBuffer();
+
+	DRAW_LIST drawList;
+	g_SceneManager->BuildDrawList(frameState, drawList);
+
+	RayTracer rayTracer(headlessOptions.rayTracingThreads);
+	rayTracer.LoadTextures();
+
+	auto buildStart = std::chrono::steady_clock::now();
+	rayTracer.BuildScene(drawList);
+	double buildMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - buildStart).count();
+	LOG_INFO("Built BVH of %d nodes over %d primitives in %.3f ms",
+		rayTracer.GetNodeCount(),
+		rayTracer.GetPrimitiveCount(),
+		buildMilliseconds);
+
+	rayTracer.SetCamera(
+		headlessOptions.width,
+		headlessOptions.height,
+		frameState.view,
+		frameState.projection,
+		frameState.viewPosition);
+
+	if (headlessOptions.bScalingReport)
+	{
+		PrintRayTracingScalingReport(rayTracer);
+		rayTracer.SetThreadCount(headlessOptions.rayTracingThreads);
+		rayTracer.SetCamera(
+			headlessOptions.width,
+			headlessOptions.height,
+			frameState.view,
+			frameState.projection,
+			frameState.viewPosition);
+	}
+
+	std::vector<unsigned char> pixels;
+	int nextWrite = 1;
+	auto renderStart = std::chrono::steady_clock::now();
+	for (int sample = 1; sample <= headlessOptions.rayTracingSamples; sample++)
+	{
+		rayTracer.RenderPass();
+
+		bool bLastSample = (sample == headlessOptions.rayTracingSamples);
+		if (headlessOptions.bProgressive && (sample == nextWrite) && !bLastSample)
+		{
+			nextWrite *= 2;
+			double elapsedSeconds = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - renderStart).count();
+			LOG_INFO("Ray traced %d samples per pixel in %.2f s", sample, elapsedSeconds);
+
+			if (!headlessOptions.outputFilename.empty())
+			{
+				rayTracer.ReadPixels(pixels);
+				ImageWriter::WriteImage(
+					headlessOptions.outputFilename,
+					rayTracer.GetWidth(),
+					rayTracer.GetHeight(),
+					pixels.data());
+			}
+		}
+	}
+
+	double renderMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - renderStart).count();
+	LOG_INFO("Ray traced %dx%d at %d samples per pixel on %d threads (%s), %.3f ms per sample",
+		headlessOptions.width,
+		headlessOptions.height,
+		rayTracer.GetSampleCount(),
+		rayTracer.GetThreadCount(),
+		rayTracer.UsesAvx2() ? "AVX2" : "no AVX2",
+		renderMilliseconds / rayTracer.GetSampleCount());
+
+	if (!headlessOptions.outputFilename.empty())
+	{
+		rayTracer.ReadPixels(pixels);
+		if (ImageWriter::WriteImage(
+			headlessOptions.outputFilename,
+			rayTracer.GetWidth(),
+			rayTracer.GetHeight(),
+			pixels.data()))
+		{
+			LOG_INFO("Wrote %s", headlessOptions.outputFilename.c_str());
+		}
+	}
+
+	DestroySceneObjects();
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	PrintRayTracingScalingReport()
+ *
+ *  This function times ray tracing passes on 1, 2, 4, ...
+ *  threads up to the hardware thread count and logs the
+ *  speedup and parallel efficiency of each against one
+ *  thread.
+ ***********************************************************/
+void PrintRayTracingScalingReport(RayTracer& rayTracer)
+{
+	const int PASSES_PER_COUNT = 4;
+
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<int> threadCounts;
+	for (int threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(hardwareThreads);
+
+	double singleThreadMilliseconds = 0.0;
+	for (int threadCount : threadCounts)
+	{
+		rayTracer.SetThreadCount(threadCount);
+
+		// one untimed pass to warm the caches and wake the threads
+		rayTracer.RenderPass();
+		auto passStart = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < PASSES_PER_COUNT; pass++)
+		{
+			rayTracer.RenderPass();
+		}
+		double passMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - passStart).count() / PASSES_PER_COUNT;
+
+		if (threadCount == 1)
+		{
+			singleThreadMilliseconds = passMilliseconds;
+		}
+		double speedup = (passMilliseconds > 0.0) ? singleThreadMilliseconds / passMilliseconds : 0.0;
+		LOG_INFO("Ray tracing scaling: %2d threads, %.3f ms per pass, %.2fx speedup, %.0f%% efficiency",
+			threadCount,
+			passMilliseconds,
+			speedup,
+			100.0 * speedup / threadCount);
+	}
+}
+
+/***********************************************************
+ *	CreateHeadlessDevice()
+ *
+ *  This function creates the named render device. The
+ *  OpenGL device gets a windowless context and an offscreen
+ *  target of the given size to draw into, which the caller
+ *  deletes after the device. Returns NULL on failure.
+ ***********************************************************/
+RenderDevice* CreateHeadlessDevice(const std::string& deviceName, int width, int height, HeadlessContext& headlessContext, OffscreenTarget*& pOffscreenTarget)
+{
+	pOffscreenTarget = NULL;
+	if (deviceName == "null")
+	{
+		return(new NullRenderDevice());
+	}
+	if (deviceName == "vulkan")
+	{
+		VulkanRenderDevice* pVulkanDevice = new VulkanRenderDevice();
+		if (!pVulkanDevice->Create())
+		{
+			delete pVulkanDevice;
+			return(NULL);
+		}
+		return(pVulkanDevice);
+	}
+
+	if (!headlessContext.Create() || (InitializeGLEW(true) == false))
+	{
+		return(NULL);
+	}
+	// the device draws into whatever framebuffer is bound
+	pOffscreenTarget = new OffscreenTarget();
+	pOffscreenTarget->Resize(width, height);
+	pOffscreenTarget->Bind();
+
+	GLRenderDevice* pGLDevice = new GLRenderDevice();
+	if (!pGLDevice->Create())
+	{
+		delete pGLDevice;
+		delete pOffscreenTarget;
+		pOffscreenTarget = NULL;
+		return(NULL);
+	}
+	return(pGLDevice);
+}
+
+/***********************************************************
+ *	RunDeviceRenderer()
+ *
+ *  This function renders the headless frames through the
+ *  render device interface, on OpenGL or on Vulkan, which
+ *  needs no OpenGL context and runs on lavapipe where there
+ *  is no GPU. The draw list is recorded into command lists
+ *  on several threads and submitted in order. The null
+ *  device draws nothing, which leaves only the CPU cost of
+ *  building and recording each frame.
+ ***********************************************************/
+int RunDeviceRenderer(const HEADLESS_OPTIONS& headlessOptions)
+{
+	// the context outlives every OpenGL object below
+	HeadlessContext headlessContext;
+	OffscreenTarget* pOffscreenTarget = NULL;
+	RenderDevice* pDevice = CreateHeadlessDevice(
+		headlessOptions.renderDevice,
+		headlessOptions.width,
+		headlessOptions.height,
+		headlessContext,
+		pOffscreenTarget);
+	if (NULL == pDevice)
+	{
+		return(EXIT_FAILURE);
+	}
+	NullRenderDevice* pNullDevice = NULL;
+	if (headlessOptions.renderDevice == "null")
+	{
+		pNullDevice = static_cast<NullRenderDevice*>(pDevice);
+	}
+
+	// record what reaches the device, to save the last frame
+	CaptureRenderDevice* pCaptureDevice = NULL;
+	if (!headlessOptions.captureFilename.empty())
+	{
+		pCaptureDevice = new CaptureRenderDevice(pDevice);
+	}
+
+	// no shader manager - the managers only describe the scene
+	g_ViewManager = new ViewManager(NULL);
+	g_ViewManager->SetFramebufferSize(headlessOptions.width, headlessOptions.height);
+	g_SceneManager = new SceneManager(NULL);
+	g_SceneManager->PrepareSceneDescription();
+
+	int result = EXIT_FAILURE;
+	DeviceSceneRenderer* pSceneRenderer = new DeviceSceneRenderer(
+		(NULL != pCaptureDevice) ? pCaptureDevice : pDevice,
+		headlessOptions.recordThreads);
+	if (pSceneRenderer->Create())
+	{
+		DRAW_LIST drawList;
+		double buildMilliseconds = 0.0;
+		double recordMilliseconds = 0.0;
+		auto renderStart = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < headlessOptions.frameCount; frame++)
+		{
+			UpdateSimulation((uint64_t)frame);
+			g_FrameStates.Consume();
+			const FRAME_STATE& frameState = g_FrameStates.GetReadBuffer();
+
+			auto buildStart = std::chrono::steady_clock::now();
+			g_SceneManager->BuildDrawList(frameState, drawList);
+			buildMilliseconds += std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - buildStart).count();
+			pSceneRenderer->Render(
+				drawList,
+				headlessOptions.width,
+				headlessOptions.height,
+				frameState.view,
+				frameState.projection,
+				frameState.viewPosition);
+			recordMilliseconds += pSceneRenderer->GetLastRecordMilliseconds();
+		}
+
+		double renderMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - renderStart).count();
+		LOG_INFO("Rendered %d frames through %s at %dx%d, %.3f ms per frame, %.3f ms recording %d command lists on %d threads",
+			headlessOptions.frameCount,
+			pDevice->GetName(),
+			headlessOptions.width,
+			headlessOptions.height,
+			renderMilliseconds / headlessOptions.frameCount,
+			recordMilliseconds / headlessOptions.frameCount,
+			pSceneRenderer->GetLastListCount(),
+			pSceneRenderer->GetThreadCount());
+		LOG_INFO("Building the draw list took %.3f ms per frame", buildMilliseconds / headlessOptions.frameCount);
+		if (NULL != pNullDevice)
+		{
+			// with nothing drawn, the frame rate is the CPU's limit
+			const NULL_DEVICE_COUNTERS& counters = pNullDevice->GetFrameCounters();
+			LOG_INFO("%.0f frames per second, each with %llu draws, %llu pipeline, %llu texture and %llu mesh binds and %llu constant updates",
+				1000.0 * headlessOptions.frameCount / renderMilliseconds,
+				(unsigned long long)counters.draws,
+				(unsigned long long)counters.pipelineBinds,
+				(unsigned long long)counters.textureBinds,
+				(unsigned long long)counters.meshBinds,
+				(unsigned long long)counters.constantUpdates);
+		}
+
+		if (!headlessOptions.outputFilename.empty())
+		{
+			std::vector<unsigned char> pixels;
+			pDevice->ReadPixels(pixels);
+			if (ImageWriter::WriteImage(
+				headlessOptions.outputFilename,
+				headlessOptions.width,
+				headlessOptions.height,
+				pixels.data()))
+			{
+				LOG_INFO("Wrote %s", headlessOptions.outputFilename.c_str());
+			}
+		}
+		result = EXIT_SUCCESS;
+		if ((NULL != pCaptureDevice) && !pCaptureDevice->WriteCapture(headlessOptions.captureFilename))
+		{
+			result = EXIT_FAILURE;
+		}
+	}
+
+	delete pSceneRenderer;
+	if (NULL != pCaptureDevice)
+	{
+		delete pCaptureDevice;
+	}
+	delete pDevice;
+	if (NULL != pOffscreenTarget)
+	{
+		delete pOffscreenTarget;
+	}
+	DestroySceneObjects();
+
+	return(result);
+}
+
+/***********************************************************
+ *	RunCaptureReplay()
+ *
+ *  This function loads a captured frame and submits it the
+ *  requested number of times with nothing else running, so
+ *  the timings are the cost of the command stream alone on
+ *  the chosen device. The driver behind the OpenGL device
+ *  is picked the usual Mesa way, for example with
+ *  LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe for the
+ *  CPU rasterizer or MESA_LOADER_DRIVER_OVERRIDE=zink for
+ *  OpenGL over Vulkan.
+ ***********************************************************/
+int RunCaptureReplay(const HEADLESS_OPTIONS& headlessOptions)
+{
+	CaptureReplayer replayer;
+	if (!replayer.Load(headlessOptions.replayCaptureFilename))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	HeadlessContext headlessContext;
+	OffscreenTarget* pOffscreenTarget = NULL;
+	RenderDevice* pDevice = CreateHeadlessDevice(
+		headlessOptions.renderDevice.empty() ? "gl" : headlessOptions.renderDevice,
+		replayer.GetWidth(),
+		replayer.GetHeight(),
+		headlessContext,
+		pOffscreenTarget);
+	if (NULL == pDevice)
+	{
+		return(EXIT_FAILURE);
+	}
+	if (!replayer.CreateResources(pDevice) || !replayer.ReplayFrame(pDevice))
+	{
+		delete pDevice;
+		if (NULL != pOffscreenTarget)
+		{
+			delete pOffscreenTarget;
+		}
+		return(EXIT_FAILURE);
+	}
+
+	// the frame above was left untimed, to settle the driver's state
+	// and shader caches - the read back at the end waits for the last
+	// frame to finish, so the total includes the device's work
+	std::vector<double> submitMilliseconds;
+	submitMilliseconds.reserve(headlessOptions.frameCount);
+	auto replayStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < headlessOptions.frameCount; frame++)
+	{
+		auto submitStart = std::chrono::steady_clock::now();
+		replayer.ReplayFrame(pDevice);
+		submitMilliseconds.push_back(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - submitStart).count());
+	}
+	std::vector<unsigned char> pixels;
+	pDevice->ReadPixels(pixels);
+	double replayMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - replayStart).count();
+
+	std::sort(submitMilliseconds.begin(), submitMilliseconds.end());
+	size_t frameCount = submitMilliseconds.size();
+	LOG_INFO("Replayed %s %d times through %s: %.3f ms per frame, %d draws and %d commands each",
+		headlessOptions.replayCaptureFilename.c_str(),
+		(int)frameCount,
+		pDevice->GetName(),
+		replayMilliseconds / frameCount,
+		(int)replayer.GetDrawCount(),
+		(int)replayer.GetCommandCount());
+	LOG_INFO("Submitting took %.3f ms median, %.3f ms 95th percentile, %.3f ms at most",
+		submitMilliseconds[frameCount / 2],
+		submitMilliseconds[std::min(frameCount - 1, frameCount * 95 / 100)],
+		submitMilliseconds[frameCount - 1]);
+
+	if (!headlessOptions.outputFilename.empty() &&
+		ImageWriter::WriteImage(headlessOptions.outputFilename, replayer.GetWidth(), replayer.GetHeight(), pixels.data()))
+	{
+		LOG_INFO("Wrote %s", headlessOptions.outputFilename.c_str());
+	}
+
+	delete pDevice;
+	if (NULL != pOffscreenTarget)
+	{
+		delete pOffscreenTarget;
+	}
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RunBenchmark()
+ *
+ *  This function draws the scripted fly-through with vsync
+ *  off - into the window, or an offscreen target without
+ *  one - and reports the distribution of the frame times.
+ *  Returns failure when a timing regressed past the
+ *  baseline threshold.
+ ***********************************************************/
+int RunBenchmark(const HEADLESS_OPTIONS& headlessOptions, GLFWwindow* pWindow)
+{
+	PROFILE_SCOPE("RunBenchmark");
+
+	double startupMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - g_ApplicationStartTime).count();
+
+	int width = headlessOptions.width;
+	int height = headlessOptions.height;
+	OffscreenTarget offscreenTarget;
+	if (NULL != pWindow)
+	{
+		// present as soon as each frame is done rather than on vblank
+		glfwSwapInterval(0);
+		glfwGetFramebufferSize(pWindow, &width, &height);
+	}
+	else
+	{
+		offscreenTarget.Resize(width, height);
+	}
+
+	// the path alone moves the camera
+	g_ViewManager->SetLateLatching(false);
+
+	Benchmark benchmark(headlessOptions.benchmarkFrames);
+	int totalFrames = benchmark.GetTotalFrames();
+	FramePacer framePacer(BENCHMARK_FRAMES_IN_FLIGHT);
+	PerfCounters perfCounters;
+	if (StartPerfCounters(perfCounters, headlessOptions.perfCountersFilename))
+	{
+		g_SceneManager->SetPerfCounters(&perfCounters);
+	}
+
+	// one GPU timer per frame, only read once the run is over so the
+	// CPU never waits on a result
+	std::vector<GLuint> gpuQueries(totalFrames);
+	glGenQueries(totalFrames, gpuQueries.data());
+	std::vector<double> frameMilliseconds(totalFrames, 0.0);
+	std::vector<double> cpuMilliseconds(totalFrames, 0.0);
+
+	LOG_INFO("Benchmarking %d frames at %dx%d", headlessOptions.benchmarkFrames, width, height);
+	int drawnFrames = 0;
+	auto frameStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < totalFrames; frame++)
+	{
+		framePacer.WaitForFrameSlot();
+		perfCounters.BeginFrame();
+
+		// the camera and the candle only depend on the frame index
+		FRAME_STATE frameState;
+		benchmark.BuildFrameState(frame, width, height, frameState);
+		g_SceneManager->UpdateSceneAnimation(frameState, Benchmark::GetFrameSeconds(frame));
+
+		if (NULL != pWindow)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glViewport(0, 0, width, height);
+		}
+		else
+		{
+			offscreenTarget.Bind();
+		}
+		glEnable(GL_DEPTH_TEST);
+
+		glBeginQuery(GL_TIME_ELAPSED, gpuQueries[frame]);
+		auto submitStart = std::chrono::steady_clock::now();
+		{
+			PerfCounterScope perfScope(&perfCounters, "prepare view");
+			g_ViewManager->PrepareSceneView(frameState);
+		}
+		{
+			PerfCounterScope perfScope(&perfCounters, "render scene");
+			g_SceneManager->RenderScene(frameState);
+		}
+		auto submitEnd = std::chrono::steady_clock::now();
+		glEndQuery(GL_TIME_ELAPSED);
+
+		if (NULL != pWindow)
+		{
+			PROFILE_SCOPE("glfwSwapBuffers");
+			glfwSwapBuffers(pWindow);
+			glfwPollEvents();
+		}
+		framePacer.EndFrame(0, 0.0);
+
+		auto frameEnd = std::chrono::steady_clock::now();
+		frameMilliseconds[frame] = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+		cpuMilliseconds[frame] = std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+		frameStart = frameEnd;
+		RenderStats::EndFrame(frameMilliseconds[frame], cpuMilliseconds[frame], 0.0);
+		perfCounters.EndFrame(frameMilliseconds[frame]);
+		drawnFrames++;
+
+		if ((NULL != pWindow) && glfwWindowShouldClose(pWindow))
+		{
+			break;
+		}
+	}
+	glFinish();
+	g_SceneManager->SetPerfCounters(NULL);
+
+	for (int frame = 0; frame < drawnFrames; frame++)
+	{
+		GLuint64 gpuNanoseconds = 0;
+		glGetQueryObjectui64v(gpuQueries[frame], GL_QUERY_RESULT, &gpuNanoseconds);
+		benchmark.AddFrame(frame, frameMilliseconds[frame], cpuMilliseconds[frame], gpuNanoseconds / 1.0e6);
+	}
+	glDeleteQueries(totalFrames, gpuQueries.data());
+
+	if (drawnFrames < totalFrames)
+	{
+		LOG_ERROR("The benchmark was closed after %d of %d frames", drawnFrames, totalFrames);
+		return(EXIT_FAILURE);
+	}
+
+	BENCHMARK_RESULTS results = benchmark.GetResults(startupMilliseconds, width, height);
+	results.drawCalls = RenderStats::GetLastFrame().drawCalls;
+	results.triangles = RenderStats::GetLastFrame().triangles;
+	Benchmark::PrintResults(results);
+	perfCounters.PrintReport();
+	if (Benchmark::WriteResults(headlessOptions.benchmarkFilename, results))
+	{
+		LOG_INFO("Wrote %s", headlessOptions.benchmarkFilename.c_str());
+	}
+
+	if (!headlessOptions.baselineFilename.empty())
+	{
+		BENCHMARK_RESULTS baseline;
+		if (!Benchmark::ReadResults(headlessOptions.baselineFilename, baseline))
+		{
+			return(EXIT_FAILURE);
+		}
+		if (!Benchmark::CompareWithBaseline(results, baseline, headlessOptions.regressionThreshold))
+		{
+			LOG_ERROR("The benchmark regressed against %s", headlessOptions.baselineFilename.c_str());
+			return(EXIT_FAILURE);
+		}
+	}
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RunMicroBenchmarks()
+ *
+ *  This function times the scene's per-draw helpers, its
+ *  draw lists and its mesh generators one at a time. Only
+ *  the mesh generators touch OpenGL - they run in a headless
+ *  context, and with the null device, or without a context,
+ *  the CPU meshes are timed in their place.
+ ***********************************************************/
+int RunMicroBenchmarks(const HEADLESS_OPTIONS& headlessOptions)
+{
+	PROFILE_SCOPE("RunMicroBenchmarks");
+
+	// the context outlives the meshes created in it
+	HeadlessContext headlessContext;
+	bool bOpenGL = false;
+	if (headlessOptions.renderDevice != "null")
+	{
+		bOpenGL = headlessContext.Create() && InitializeGLEW(true);
+		if (!bOpenGL)
+		{
+			LOG_WARNING("No OpenGL context, timing the CPU meshes in place of the mesh generators");
+		}
+	}
+	const char* pBackend = bOpenGL ? "gl" : "null";
+
+	MicroBenchmark microBenchmark;
+	microBenchmark.SetFilter(headlessOptions.microBenchmarkFilter);
+	SceneMicroBenchmarks sceneMicroBenchmarks;
+	sceneMicroBenchmarks.Register(microBenchmark, bOpenGL);
+
+	LOG_INFO("Running microbenchmarks on the %s backend", pBackend);
+	if (microBenchmark.Run() == 0)
+	{
+		return(EXIT_FAILURE);
+	}
+	microBenchmark.PrintResults();
+
+	if (!microBenchmark.WriteResults(headlessOptions.microBenchmarkFilename, pBackend))
+	{
+		return(EXIT_FAILURE);
+	}
+	LOG_INFO("Wrote %s", headlessOptions.microBenchmarkFilename.c_str());
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	UpdateSimulation()
+ *
+ *  This function runs one simulation step and publishes the
+ *  resulting frame snapshot for the render thread.
+ ***********************************************************/
+void UpdateSimulation(uint64_t frameNumber)
+{
+	PROFILE_SCOPE("UpdateSimulation");
+
+	FRAME_STATE& frameState = g_FrameStates.GetWriteBuffer();
+
+	frameState.frameNumber = frameNumber;
+
+	// read the step's clocks and input from the window, or from the
+	// recording being replayed - past its end no more input arrives
+	if (NULL != g_pInputReplay)
+	{
+		g_ViewManager->DiscardLiveInput();
+		if (!g_pInputReplay->ReadStep(g_InputStep))
+		{
+			g_InputStep.events.clear();
+		}
+	}
+	else
+	{
+		g_ViewManager->CaptureInputStep(g_InputStep);
+		g_InputStep.animationSeconds = SceneManager::GetAnimationSeconds();
+	}
+	if (NULL != g_pInputRecorder)
+	{
+		g_pInputRecorder->WriteStep(g_InputStep);
+	}
+
+	// process input and move the camera
+	g_ViewManager->UpdateSceneView(frameState, g_InputStep);
+
+	// advance the flicker animation
+	g_SceneManager->UpdateSceneAnimation(frameState, g_InputStep.animationSeconds);
+
+	g_FrameStates.Publish();
+}
+
+/***********************************************************
+ *	SimulationThreadLoop()
+ *
+ *  This function runs on the simulation thread. It steps the
+ *  simulation at a fixed rate, independent of how quickly
+ *  the render thread manages to draw.
+ ***********************************************************/
+void SimulationThreadLoop(uint64_t firstFrameNumber)
+{
+	PROFILE_THREAD_NAME("simulation");
+
+	uint64_t frameNumber = firstFrameNumber;
+	std::chrono::steady_clock::time_point nextStep = std::chrono::steady_clock::now();
+
+	while (g_bWorkerThreadsRunning)
+	{
+		UpdateSimulation(frameNumber++);
+
+		// skip ahead instead of trying to catch up after a stall
+		nextStep += SIMULATION_INTERVAL;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (nextStep < now)
+		{
+			nextStep = now;
+		}
+		std::this_thread::sleep_until(nextStep);
+	}
+}
+
+/***********************************************************
+ *	RenderThreadLoop()
+ *
+ *  This function runs on the render thread. It always draws
+ *  the most recent published frame snapshot, so slow OpenGL
+ *  submission never holds up input or the simulation.
+ ***********************************************************/
+void RenderThreadLoop(std::string perfCountersFilename, uint64_t nextFrameNumber)
+{
+	PROFILE_THREAD_NAME("render");
+
+	glfwMakeContextCurrent(g_Window);
+
+	// the frame resources are released inside RenderFrames(), while
+	// the context is still current on this thread
+	RenderFrames(perfCountersFilename, nextFrameNumber);
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *	RenderFrames()
+ *
+ *  This function draws frames on the render thread until the
+ *  application shuts down, or a replayed session runs out of
+ *  steps.
+ ***********************************************************/
+void RenderFrames(const std::string& perfCountersFilename, uint64_t nextFrameNumber)
+{
+	// startup ends once this thread is set up and its first frame is
+	// on screen
+	int64_t firstFrameStart = StartupProfiler::IsTiming() ? StartupProfiler::GetTimestamp() : -1;
+
+	// limits how far the driver may queue ahead of the display
+	FramePacer framePacer(MAX_FRAMES_IN_FLIGHT);
+	// renders the scene offscreen at a resolution that holds the
+	// GPU frame time target, and upscales it to the window
+	ResolutionScaler resolutionScaler(
+		TARGET_GPU_FRAME_MS,
+		MIN_RENDER_SCALE,
+		MAX_RENDER_SCALE);
+	// rebuilds the window resolution from jittered frames when enabled
+	TemporalUpscaler temporalUpscaler;
+	bool bTemporalUpscaling = false;
+	// submission and GPU cost of mono and stereo frames
+	VIEW_MODE_COST monoCost;
+	VIEW_MODE_COST stereoCost;
+	bool bStereo = false;
+	// records what the window shows, dropping frames rather than
+	// slowing the interactive frame rate
+	FrameRecorder frameRecorder(0);
+	// 360 degree captures of the scene around the camera, written by
+	// the recorder's encoder threads
+	PanoramaCapture panoramaCapture(
+		g_MultiViewRenderer,
+		frameRecorder.GetEncoderPool(),
+		PANORAMA_FACE_SIZE,
+		PANORAMA_WIDTH);
+	uint32_t panoramaRequest = 0;
+	uint32_t recordingCount = 0;
+	bool bRecording = false;
+	// times the passes and the scene objects on the GPU, written out
+	// with G
+	GpuProfiler gpuProfiler;
+	uint32_t gpuProfileRequest = 0;
+	g_SceneManager->SetGpuProfiler(&gpuProfiler);
+	// draws the last frame's render statistics when toggled with I
+	StatsOverlay statsOverlay;
+	auto previousFrameStart = std::chrono::steady_clock::now();
+	// whether a replayed step has been drawn yet
+	bool bReplayStepped = false;
+	// CPU hardware counters of this thread, when asked for
+	PerfCounters perfCounters;
+	if (StartPerfCounters(perfCounters, perfCountersFilename))
+	{
+		g_SceneManager->SetPerfCounters(&perfCounters);
+	}
+
+	while (g_bWorkerThreadsRunning)
+	{
+		// wait for a frame slot before picking up input, so the
+		// snapshot is as fresh as possible when it gets drawn
+		{
+			PROFILE_SCOPE("WaitForFrameSlot");
+			framePacer.WaitForFrameSlot();
+		}
+
+		// a replay steps the simulation once per frame, in lockstep.
+		// The main thread already published the first recorded step,
+		// so the first frame draws it without stepping.
+		if (NULL != g_pInputReplay)
+		{
+			if (bReplayStepped)
+			{
+				if (g_pInputReplay->IsFinished())
+				{
+					LOG_INFO("Replayed all %d recorded steps", (int)g_pInputReplay->GetStepCount());
+					glfwSetWindowShouldClose(g_Window, true);
+					glfwPostEmptyEvent();
+					break;
+				}
+				UpdateSimulation(nextFrameNumber++);
+			}
+			bReplayStepped = true;
+		}
+		perfCounters.BeginFrame();
+
+		// pick up the latest snapshot - if none was published since
+		// the last frame, the previous one is simply drawn again
+		g_FrameStates.Consume();
+		const FRAME_STATE& frameState = g_FrameStates.GetReadBuffer();
+
+		// nothing to draw while the window is minimized
+		if ((frameState.framebufferWidth <= 0) || (frameState.framebufferHeight <= 0))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+
+		// follow window resizes, then redirect the scene into the
+		// offscreen framebuffer at the current render scale
+		// the motion vectors only describe the main camera, so the
+		// multi-view mode is upscaled with the plain blit
+		bool bMultiView = (frameState.bMultiView || frameState.bStereo) && g_MultiViewRenderer->IsAvailable();
+
+		// report what stereo cost each time it is switched off
+		bool bStereoWanted = frameState.bStereo && bMultiView;
+		if (bStereo && !bStereoWanted)
+		{
+			PrintStereoCostReport(monoCost, stereoCost);
+		}
+		bStereo = bStereoWanted;
+		bool bTemporalUpscalingWanted = frameState.bTemporalUpscaling && !bMultiView;
+		if (bTemporalUpscalingWanted != bTemporalUpscaling)
+		{
+			bTemporalUpscaling = bTemporalUpscalingWanted;
+			resolutionScaler.SetScaleRange(
+				MIN_RENDER_SCALE,
+				bTemporalUpscaling ? MAX_TEMPORAL_RENDER_SCALE : MAX_RENDER_SCALE);
+			resolutionScaler.SetTemporalUpscaler(bTemporalUpscaling ? &temporalUpscaler : NULL);
+			temporalUpscaler.ResetHistory();
+		}
+		resolutionScaler.Resize(frameState.framebufferWidth, frameState.framebufferHeight);
+		gpuProfiler.BeginFrame();
+		resolutionScaler.BeginFrame();
+		gpuProfiler.BeginScope("scene");
+
+		// shift the projection by a sub-pixel amount each frame so
+		// the history samples the scene at new positions
+		glm::vec2 projectionJitter(0.0f, 0.0f);
+		if (bTemporalUpscaling)
+		{
+			glm::vec2 jitter = temporalUpscaler.NextJitter();
+			projectionJitter = glm::vec2(
+				2.0f * jitter.x / (float)resolutionScaler.GetRenderWidth(),
+				2.0f * jitter.y / (float)resolutionScaler.GetRenderHeight());
+		}
+		g_ViewManager->SetProjectionJitter(projectionJitter);
+
+		// Enable z-depth
+		glEnable(GL_DEPTH_TEST);
+
+		// Clear the frame and z buffers
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// convert from 3D object space to 2D view, latching the
+		// newest mouse motion right before the scene is submitted
+		auto submitStart = std::chrono::steady_clock::now();
+		double frameMilliseconds = std::chrono::duration<double, std::milli>(submitStart - previousFrameStart).count();
+		previousFrameStart = submitStart;
+		{
+			PerfCounterScope perfScope(&perfCounters, "prepare view");
+			g_ViewManager->PrepareSceneView(frameState);
+		}
+
+		// route the scene into every view in a single submission
+		if (bMultiView)
+		{
+			MultiViewRenderer::VIEW views[MultiViewRenderer::MAX_VIEWS];
+			int viewCount = g_ViewManager->GetMultiViews(frameState, views);
+			if (g_MultiViewRenderer->BeginViews(
+				views,
+				viewCount,
+				resolutionScaler.GetRenderWidth(),
+				resolutionScaler.GetRenderHeight()))
+			{
+				g_ViewManager->LoadPreparedView(g_MultiViewRenderer->GetShaderManager());
+			}
+		}
+
+		// refresh the 3D scene
+		{
+			PerfCounterScope perfScope(&perfCounters, "render scene");
+			g_SceneManager->RenderScene(frameState);
+		}
+
+		if (bMultiView)
+		{
+			g_MultiViewRenderer->EndViews(
+				resolutionScaler.GetRenderWidth(),
+				resolutionScaler.GetRenderHeight());
+		}
+		gpuProfiler.EndScope();
+		double submitMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - submitStart).count();
+
+		// the GPU time is scaled back to the full window resolution so
+		// that dynamic resolution changes don't hide the stereo cost
+		if (!bMultiView || bStereo)
+		{
+			VIEW_MODE_COST& cost = bStereo ? stereoCost : monoCost;
+			float renderScale = resolutionScaler.GetRenderScale();
+			cost.cpuMilliseconds += submitMilliseconds;
+			cost.gpuMilliseconds += resolutionScaler.GetGpuFrameMilliseconds() / (renderScale * renderScale);
+			cost.frames++;
+		}
+
+		// upscale the offscreen image into the window
+		temporalUpscaler.SetCameraMatrices(
+			g_ViewManager->GetCurrentViewProjection(),
+			g_ViewManager->GetPreviousViewProjection());
+		gpuProfiler.BeginScope(bTemporalUpscaling ? "temporal upscale" : "upscale");
+		resolutionScaler.EndFrame();
+		gpuProfiler.EndScope();
+
+		// capture after the frame so the panorama sees the same scene -
+		// an earlier capture is handed to the encoders once it is read back
+		panoramaCapture.CollectReadback(false);
+		if (frameState.panoramaRequest != panoramaRequest)
+		{
+			panoramaRequest = frameState.panoramaRequest;
+			GpuProfileScope panoramaScope(&gpuProfiler, "panorama");
+			panoramaCapture.Capture(
+				g_SceneManager,
+				frameState,
+				"panorama_" + std::to_string(panoramaRequest) + ".png");
+		}
+
+		// the counters close before the overlay so it doesn't count
+		// itself, and it shows the frame that just finished - it goes
+		// into the window before the recording reads it back
+		RenderStats::EndFrame(
+			frameMilliseconds,
+			submitMilliseconds,
+			resolutionScaler.GetGpuFrameMilliseconds());
+		if (frameState.bStatsOverlay)
+		{
+			GpuProfileScope overlayScope(&gpuProfiler, "stats overlay");
+			statsOverlay.Draw(
+				RenderStats::GetLastFrame(),
+				frameState.framebufferWidth,
+				frameState.framebufferHeight);
+		}
+
+		// start or stop recording, then queue this frame's readback
+		// before the back buffer is swapped away
+		if (frameState.bRecording != bRecording)
+		{
+			bRecording = frameState.bRecording;
+			if (bRecording)
+			{
+				frameRecorder.Start(
+					"recording_" + std::to_string(++recordingCount) + ".y4m",
+					FrameRecorder::BACKPRESSURE_DROP,
+					RECORDING_FRAMES_PER_SECOND);
+			}
+			else
+			{
+				frameRecorder.Stop();
+			}
+		}
+		gpuProfiler.BeginScope("recording readback");
+		frameRecorder.CaptureFrame(0, frameState.framebufferWidth, frameState.framebufferHeight);
+		gpuProfiler.EndScope();
+		gpuProfiler.EndFrame();
+
+		if (frameState.gpuProfileRequest != gpuProfileRequest)
+		{
+			gpuProfileRequest = frameState.gpuProfileRequest;
+			std::string filename = "gpu_profile_" + std::to_string(gpuProfileRequest) + ".txt";
+			if (gpuProfiler.WriteReport(filename))
+			{
+				LOG_INFO("Wrote %s", filename.c_str());
+			}
+		}
+
+		// the swap can block on the display, so it is left out
+		perfCounters.EndFrame(frameMilliseconds);
+
+		// Flips the the back buffer with the front buffer every frame.
+		{
+			PROFILE_SCOPE("glfwSwapBuffers");
+			glfwSwapBuffers(g_Window);
+		}
+		if (firstFrameStart >= 0)
+		{
+			StartupProfiler::RecordPhase("FirstFrame", firstFrameStart, StartupProfiler::GetTimestamp(), { "FirstSimulationStep" });
+			StartupProfiler::Finish();
+			firstFrameStart = -1;
+		}
+
+		// replayed input carries the recording session's clock, so
+		// its latency is meaningless and the frame goes unmeasured
+		if (NULL != g_pInputReplay)
+		{
+			framePacer.EndFrame(0, 0.0);
+		}
+		else
+		{
+			framePacer.EndFrame(
+				g_ViewManager->GetLatchedInputSequence(),
+				g_ViewManager->GetLatchedInputTimestamp());
+		}
+	}
+
+	g_SceneManager->SetGpuProfiler(NULL);
+	g_SceneManager->SetPerfCounters(NULL);
+	framePacer.PrintLatencyReport();
+	gpuProfiler.PrintReport();
+	perfCounters.PrintReport();
+	if (stereoCost.frames > 0)
+	{
+		PrintStereoCostReport(monoCost, stereoCost);
+	}
+}
+
+/***********************************************************
+ *	StartPerfCounters()
+ *
+ *  This function opens the CPU hardware counters for the
+ *  calling thread when a CSV file was asked for. Returns
+ *  false when counting is off or unavailable.
+ ***********************************************************/
+bool StartPerfCounters(PerfCounters& perfCounters, const std::string& filename)
+{
+	if (filename.empty() || !perfCounters.Open())
+	{
+		return(false);
+	}
+
+	perfCounters.OpenCsv(filename);
+	return(true);
+}
+
+/***********************************************************
+ *	PrintStereoCostReport()
+ *
+ *  This function logs the average CPU submission time and
+ *  full-resolution GPU time of stereo frames next to mono.
+ ***********************************************************/
+void PrintStereoCostReport(const VIEW_MODE_COST& monoCost, const VIEW_MODE_COST& stereoCost)
+{
+	if ((monoCost.frames == 0) || (stereoCost.frames == 0))
+	{
+		return;
+	}
+
+	double monoCpu = monoCost.cpuMilliseconds / monoCost.frames;
+	double monoGpu = monoCost.gpuMilliseconds / monoCost.frames;
+	double stereoCpu = stereoCost.cpuMilliseconds / stereoCost.frames;
+	double stereoGpu = stereoCost.gpuMilliseconds / stereoCost.frames;
+
+	LOG_INFO("Stereo cost vs mono over %llu/%llu frames: CPU %.3f ms vs %.3f ms (%.2fx), GPU %.3f ms vs %.3f ms (%.2fx)",
+		(unsigned long long)stereoCost.frames,
+		(unsigned long long)monoCost.frames,
+		stereoCpu, monoCpu, (monoCpu > 0.0) ? stereoCpu / monoCpu : 0.0,
+		stereoGpu, monoGpu, (monoGpu > 0.0) ? stereoGpu / monoGpu : 0.0);
 }
 
 /***********************************************************
@@ -139,6 +2062,8 @@ int main(int argc, char* argv[])
  ***********************************************************/
 bool InitializeGLFW()
 {
+	StartupPhase startupPhase("InitializeGLFW");
+
 	// GLFW: initialize and configure library
 	// --------------------------------------
 	glfwInit();
@@ -164,24 +2089,34 @@ bool InitializeGLFW()
  *
  *  This function is used to initialize the GLEW library.
  ***********************************************************/
-bool InitializeGLEW()
+bool InitializeGLEW(bool bHeadless)
 {
+	StartupPhase startupPhase("InitializeGLEW");
+
 	// GLEW: initialize
 	// -----------------------------------------
 	GLenum GLEWInitResult = GLEW_OK;
 
 	// try to initialize the GLEW library
 	GLEWInitResult = glewInit();
+
+	// GLEW built for GLX reports a missing X display after it has
+	// already loaded the OpenGL entry points of an EGL context
+	if (bHeadless && (GLEW_ERROR_NO_GLX_DISPLAY == GLEWInitResult))
+	{
+		GLEWInitResult = GLEW_OK;
+	}
+
 	if (GLEW_OK != GLEWInitResult)
 	{
-		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
+		LOG_ERROR("%s", (const char*)glewGetErrorString(GLEWInitResult));
 		return false;
 	}
 	// GLEW: end -------------------------------
 
 	// Displays a successful OpenGL initialization message
-	std::cout << "INFO: OpenGL Successfully Initialized\n";
-	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
+	LOG_INFO("OpenGL Successfully Initialized");
+	LOG_INFO("OpenGL Version: %s", (const char*)glGetString(GL_VERSION));
 
 	return(true);
 }
\ No newline at end of file
@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+// microbenchmark.cpp
+// ============
+// iteration calibration, repeated runs and the Google Benchmark JSON writer
+//
+// NOTE: the iteration count grows from one until a run lasts at least
+// MINIMUM_SECONDS, by at most ten times per step, like Google Benchmark
+// does. The calibration runs double as the warm-up and are not reported.
+// The CPU time is the process clock, which matches the real time as long
+// as nothing else runs on other threads.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MicroBenchmark.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+const double MicroBenchmark::MINIMUM_SECONDS = 0.1;
+
+namespace
+{
+	/***********************************************************
+	 *  GetMean()
+	 ***********************************************************/
+	double GetMean(const std::vector<double>& values)
+	{
+		double total = 0.0;
+		for (double value : values)
+		{
+			total += value;
+		}
+		return(values.empty() ? 0.0 : total / values.size());
+	}
+
+	/***********************************************************
+	 *  GetMedian()
+	 ***********************************************************/
+	double GetMedian(std::vector<double> values)
+	{
+		if (values.empty())
+		{
+			return(0.0);
+		}
+		std::sort(values.begin(), values.end());
+		size_t middle = values.size() / 2;
+		return(((values.size() % 2) == 1) ? values[middle] : (values[middle - 1] + values[middle]) * 0.5);
+	}
+
+	/***********************************************************
+	 *  GetStandardDeviation()
+	 *
+	 *  The sample standard deviation, as Google Benchmark
+	 *  reports it.
+	 ***********************************************************/
+	double GetStandardDeviation(const std::vector<double>& values)
+	{
+		if (values.size() < 2)
+		{
+			return(0.0);
+		}
+		double mean = GetMean(values);
+		double total = 0.0;
+		for (double value : values)
+		{
+			total += (value - mean) * (value - mean);
+		}
+		return(sqrt(total / (values.size() - 1)));
+	}
+
+	/***********************************************************
+	 *  WriteRun()
+	 *
+	 *  Writes one entry of the benchmarks array.
+	 ***********************************************************/
+	void WriteRun(
+		std::ofstream& file,
+		const MICRO_BENCHMARK_RESULT& result,
+		int familyIndex,
+		int repetitionIndex,
+		const char* pAggregateName,
+		double realNanoseconds,
+		double cpuNanoseconds)
+	{
+		std::string name = result.name;
+		if (NULL != pAggregateName)
+		{
+			name += std::string("_") + pAggregateName;
+		}
+
+		char text[512];
+		snprintf(text, sizeof(text),
+			"    {\n      \"name\": \"%s\",\n      \"family_index\": %d,\n      \"per_family_instance_index\": 0,\n      \"run_name\": \"%s\",\n      \"run_type\": \"%s\",\n      \"repetitions\": %d,\n",
+			name.c_str(),
+			familyIndex,
+			result.name.c_str(),
+			(NULL != pAggregateName) ? "aggregate" : "iteration",
+			(int)result.realNanoseconds.size());
+		file << text;
+		if (NULL != pAggregateName)
+		{
+			snprintf(text, sizeof(text),
+				"      \"threads\": 1,\n      \"aggregate_name\": \"%s\",\n      \"aggregate_unit\": \"time\",\n",
+				pAggregateName);
+		}
+		else
+		{
+			snprintf(text, sizeof(text),
+				"      \"repetition_index\": %d,\n      \"threads\": 1,\n",
+				repetitionIndex);
+		}
+		file << text;
+
+		snprintf(text, sizeof(text),
+			"      \"iterations\": %llu,\n      \"real_time\": %.6e,\n      \"cpu_time\": %.6e,\n      \"time_unit\": \"ns\"",
+			(unsigned long long)result.iterations,
+			realNanoseconds,
+			cpuNanoseconds);
+		file << text;
+
+		// a deviation has no throughput
+		if ((result.itemsPerIteration > 0) && (cpuNanoseconds > 0.0) &&
+			((NULL == pAggregateName) || (std::string(pAggregateName) != "stddev")))
+		{
+			snprintf(text, sizeof(text), ",\n      \"items_per_second\": %.6e",
+				result.itemsPerIteration * 1.0e9 / cpuNanoseconds);
+			file << text;
+		}
+		file << "\n    }";
+	}
+}
+
+/***********************************************************
+ *  MicroBenchmarkState()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MicroBenchmarkState::MicroBenchmarkState(uint64_t iterations)
+{
+	m_iterations = iterations;
+	m_remainingIterations = iterations;
+	m_itemsPerIteration = 0;
+	m_bTiming = false;
+	m_cpuStart = 0;
+	m_realNanoseconds = 0.0;
+	m_cpuNanoseconds = 0.0;
+}
+
+/***********************************************************
+ *  PauseTiming()
+ ***********************************************************/
+void MicroBenchmarkState::PauseTiming()
+{
+	if (!m_bTiming)
+	{
+		return;
+	}
+	std::clock_t cpuEnd = std::clock();
+	std::chrono::steady_clock::time_point realEnd = std::chrono::steady_clock::now();
+	m_realNanoseconds += std::chrono::duration<double, std::nano>(realEnd - m_realStart).count();
+	m_cpuNanoseconds += (double)(cpuEnd - m_cpuStart) * 1.0e9 / CLOCKS_PER_SEC;
+	m_bTiming = false;
+}
+
+/***********************************************************
+ *  ResumeTiming()
+ ***********************************************************/
+void MicroBenchmarkState::ResumeTiming()
+{
+	if (m_bTiming)
+	{
+		return;
+	}
+	m_bTiming = true;
+	m_cpuStart = std::clock();
+	m_realStart = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  MicroBenchmarkUseCharPointer()
+ *
+ *  Defined out of line so the compiler cannot see that the
+ *  value goes nowhere.
+ ***********************************************************/
+void MicroBenchmarkUseCharPointer(const volatile char*)
+{
+}
+
+/***********************************************************
+ *  MicroBenchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MicroBenchmark::MicroBenchmark()
+{
+}
+
+/***********************************************************
+ *  Add()
+ ***********************************************************/
+void MicroBenchmark::Add(
+	const std::string& name,
+	std::function<void(MicroBenchmarkState&)> function,
+	uint64_t maximumIterations)
+{
+	ENTRY entry;
+	entry.name = name;
+	entry.function = function;
+	entry.maximumIterations = std::max((uint64_t)1, maximumIterations);
+	m_entries.push_back(entry);
+}
+
+/***********************************************************
+ *  CalibrateIterations()
+ *
+ *  This method finds how many iterations make a run last at
+ *  least MINIMUM_SECONDS.
+ ***********************************************************/
+uint64_t MicroBenchmark::CalibrateIterations(const ENTRY& entry)
+{
+	uint64_t iterations = 1;
+	for (;;)
+	{
+		MicroBenchmarkState state(iterations);
+		entry.function(state);
+		double seconds = state.GetRealNanoseconds() / 1.0e9;
+		if ((seconds >= MINIMUM_SECONDS) || (iterations >= entry.maximumIterations))
+		{
+			return(iterations);
+		}
+
+		// aim a little past the minimum so the next run is usually the
+		// last one
+		double multiplier = (seconds > 0.0) ? (MINIMUM_SECONDS * 1.4 / seconds) : 10.0;
+		multiplier = std::min(multiplier, 10.0);
+		uint64_t nextIterations = (uint64_t)(iterations * multiplier);
+		iterations = std::min(std::max(nextIterations, iterations + 1), entry.maximumIterations);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ ***********************************************************/
+int MicroBenchmark::Run()
+{
+	m_results.clear();
+	for (const ENTRY& entry : m_entries)
+	{
+		if (!m_filter.empty() && (entry.name.find(m_filter) == std::string::npos))
+		{
+			continue;
+		}
+
+		MICRO_BENCHMARK_RESULT result;
+		result.name = entry.name;
+		result.iterations = CalibrateIterations(entry);
+		for (int repetition = 0; repetition < REPETITIONS; repetition++)
+		{
+			MicroBenchmarkState state(result.iterations);
+			entry.function(state);
+			result.itemsPerIteration = state.GetItemsPerIteration();
+			result.realNanoseconds.push_back(state.GetRealNanoseconds() / result.iterations);
+			result.cpuNanoseconds.push_back(state.GetCpuNanoseconds() / result.iterations);
+		}
+		m_results.push_back(result);
+	}
+
+	if (m_results.empty())
+	{
+		LOG_WARNING("No microbenchmark matches %s", m_filter.c_str());
+	}
+	return((int)m_results.size());
+}
+
+/***********************************************************
+ *  PrintResults()
+ ***********************************************************/
+void MicroBenchmark::PrintResults() const
+{
+	LOG_INFO("%-40s %14s %14s %14s %12s", "Microbenchmark", "median ns", "mean ns", "stddev ns", "iterations");
+	for (const MICRO_BENCHMARK_RESULT& result : m_results)
+	{
+		LOG_INFO("%-40s %14.2f %14.2f %14.2f %12llu",
+			result.name.c_str(),
+			GetMedian(result.realNanoseconds),
+			GetMean(result.realNanoseconds),
+			GetStandardDeviation(result.realNanoseconds),
+			(unsigned long long)result.iterations);
+	}
+}
+
+/***********************************************************
+ *  WriteResults()
+ *
+ *  This method writes the results in the layout Google
+ *  Benchmark uses for --benchmark_format=json, so its
+ *  compare.py can diff two runs.
+ ***********************************************************/
+bool MicroBenchmark::WriteResults(const std::string& filename, const std::string& backend) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		LOG_ERROR("Could not write microbenchmark results %s", filename.c_str());
+		return(false);
+	}
+
+	char date[64] = "";
+	std::time_t now = std::time(NULL);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	char text[512];
+	snprintf(text, sizeof(text),
+		"{\n  \"context\": {\n    \"date\": \"%s\",\n    \"num_cpus\": %d,\n    \"backend\": \"%s\",\n    \"library_build_type\": \"%s\"\n  },\n  \"benchmarks\": [\n",
+		date,
+		std::max(1, (int)std::thread::hardware_concurrency()),
+		backend.c_str(),
+#ifdef NDEBUG
+		"release"
+#else
+		"debug"
+#endif
+		);
+	file << text;
+
+	bool bFirst = true;
+	for (int i = 0; i < (int)m_results.size(); i++)
+	{
+		const MICRO_BENCHMARK_RESULT& result = m_results[i];
+		for (int repetition = 0; repetition < (int)result.realNanoseconds.size(); repetition++)
+		{
+			file << (bFirst ? "" : ",\n");
+			WriteRun(file, result, i, repetition, NULL,
+				result.realNanoseconds[repetition],
+				result.cpuNanoseconds[repetition]);
+			bFirst = false;
+		}
+		file << ",\n";
+		WriteRun(file, result, i, 0, "mean", GetMean(result.realNanoseconds), GetMean(result.cpuNanoseconds));
+		file << ",\n";
+		WriteRun(file, result, i, 0, "median", GetMedian(result.realNanoseconds), GetMedian(result.cpuNanoseconds));
+		file << ",\n";
+		WriteRun(file, result, i, 0, "stddev", GetStandardDeviation(result.realNanoseconds), GetStandardDeviation(result.cpuNanoseconds));
+	}
+	file << "\n  ]\n}\n";
+	return(file.good());
+}
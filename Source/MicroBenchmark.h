@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+// microbenchmark.h
+// ============
+// time small functions in isolation - each benchmark loops over the code
+// under test, the loop count is calibrated to a minimum run time, and the
+// runs are repeated and written out as Google Benchmark JSON
+//
+//  Usage:
+//      microBenchmark.Add("SetTransformations", [&](MicroBenchmarkState& state)
+//      {
+//          while (state.KeepRunning())
+//          {
+//              ...
+//          }
+//      });
+//      microBenchmark.Run();
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  MicroBenchmarkState
+ *
+ *  The iterations of one timed run of a benchmark, and the
+ *  clocks measuring it.
+ ***********************************************************/
+class MicroBenchmarkState
+{
+public:
+	// constructor - the run loops the given number of times
+	MicroBenchmarkState(uint64_t iterations);
+
+	// true while iterations remain - the first call starts the clocks and
+	// the last one stops them
+	bool KeepRunning()
+	{
+		if (m_remainingIterations > 0)
+		{
+			if (m_remainingIterations == m_iterations)
+			{
+				ResumeTiming();
+			}
+			m_remainingIterations--;
+			return(true);
+		}
+		PauseTiming();
+		return(false);
+	}
+
+	// leave per-iteration setup and cleanup out of the times
+	void PauseTiming();
+	void ResumeTiming();
+
+	// the work one iteration does, for the throughput - draws recorded,
+	// layers placed and so on
+	void SetItemsPerIteration(uint64_t items) { m_itemsPerIteration = items; }
+
+	uint64_t GetIterations() const { return(m_iterations); }
+	uint64_t GetItemsPerIteration() const { return(m_itemsPerIteration); }
+	// time measured while the clocks ran, in nanoseconds
+	double GetRealNanoseconds() const { return(m_realNanoseconds); }
+	double GetCpuNanoseconds() const { return(m_cpuNanoseconds); }
+
+private:
+	uint64_t m_iterations;
+	uint64_t m_remainingIterations;
+	uint64_t m_itemsPerIteration;
+	bool m_bTiming;
+	std::chrono::steady_clock::time_point m_realStart;
+	std::clock_t m_cpuStart;
+	double m_realNanoseconds;
+	double m_cpuNanoseconds;
+};
+
+// keep the compiler from optimizing away a value the benchmark computes
+// but never uses
+void MicroBenchmarkUseCharPointer(const volatile char* pValue);
+
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	MicroBenchmarkUseCharPointer(&reinterpret_cast<const volatile char&>(value));
+#endif
+}
+
+// the measured runs of one benchmark, in nanoseconds per iteration
+struct MICRO_BENCHMARK_RESULT
+{
+	std::string name;
+	uint64_t iterations = 0;
+	uint64_t itemsPerIteration = 0;
+	std::vector<double> realNanoseconds;
+	std::vector<double> cpuNanoseconds;
+};
+
+class MicroBenchmark
+{
+public:
+	// constructor
+	MicroBenchmark();
+
+	// add a benchmark. The calibration stops at the given iteration count
+	// for code that uses up a resource on each call.
+	void Add(
+		const std::string& name,
+		std::function<void(MicroBenchmarkState&)> function,
+		uint64_t maximumIterations = MAXIMUM_ITERATIONS);
+
+	// only run the benchmarks whose name contains this text
+	void SetFilter(const std::string& filter) { m_filter = filter; }
+
+	// calibrate and time every benchmark that passes the filter, and
+	// return how many ran
+	int Run();
+
+	// log the results, and write them as Google Benchmark JSON - each
+	// repetition, then its mean, median and standard deviation
+	void PrintResults() const;
+	bool WriteResults(const std::string& filename, const std::string& backend) const;
+
+	// shortest a timed run may be, in seconds, and times each benchmark
+	// is repeated once calibrated
+	static const double MINIMUM_SECONDS;
+	static const int REPETITIONS = 5;
+	static const uint64_t MAXIMUM_ITERATIONS = 1000000000;
+
+private:
+	struct ENTRY
+	{
+		std::string name;
+		std::function<void(MicroBenchmarkState&)> function;
+		uint64_t maximumIterations;
+	};
+
+	std::vector<ENTRY> m_entries;
+	std::vector<MICRO_BENCHMARK_RESULT> m_results;
+	std::string m_filter;
+
+	uint64_t CalibrateIterations(const ENTRY& entry);
+};
@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewrenderer.cpp
+// ============
+// single-submission multi-view rendering
+//
+// NOTE: the shape meshes issue their own non-instanced draw calls, so the
+// views cannot be selected with gl_InstanceID. Instead a geometry shader with
+// one invocation per view transforms each triangle by that view's matrix and
+// routes it with gl_ViewportIndex, or gl_Layer for layered targets such as
+// cube maps. Triangles entirely outside a view's frustum are dropped for that
+// view. The scene is submitted once however many views are shown.
+//
+// The geometry shader is linked with the scene's vertex and fragment shaders
+// into programs of its own - one with MAX_VIEWS invocations for viewports and
+// one with MAX_LAYERS for layered targets - so the scene program, and every
+// single-view frame, runs without it. While a multi-view program is bound
+// the scene manager draws through it and loads its lights into it again,
+// and the caller loads the view into it with GetShaderManager().
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MultiViewRenderer.h"
+#include "Logger.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/***********************************************************
+ *  MultiViewRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MultiViewRenderer::MultiViewRenderer(
+	ShaderManager* pShaderManager,
+	SceneManager* pSceneManager,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_vertexShaderPath = vertexShaderPath;
+	m_fragmentShaderPath = fragmentShaderPath;
+	m_viewportProgram.pShaderManager = NULL;
+	m_viewportProgram.bFailed = false;
+	m_layeredProgram.pShaderManager = NULL;
+	m_layeredProgram.bFailed = false;
+	m_pActiveProgram = NULL;
+	m_bAvailable = false;
+}
+
+/***********************************************************
+ *  ~MultiViewRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MultiViewRenderer::~MultiViewRenderer()
+{
+	if (NULL != m_viewportProgram.pShaderManager)
+	{
+		delete m_viewportProgram.pShaderManager;
+		m_viewportProgram.pShaderManager = NULL;
+	}
+	if (NULL != m_layeredProgram.pShaderManager)
+	{
+		delete m_layeredProgram.pShaderManager;
+		m_layeredProgram.pShaderManager = NULL;
+	}
+	m_pActiveProgram = NULL;
+	m_pSceneManager = NULL;
+	m_pShaderManager = NULL;
+}
+
+/***********************************************************
+ *  LoadGeometryShader()
+ *
+ *  This method reads the multi-view geometry shader. The
+ *  programs using it are linked when first needed, and on
+ *  any failure the scene keeps rendering a single view.
+ ***********************************************************/
+bool MultiViewRenderer::LoadGeometryShader(const char* geometryShaderPath)
+{
+	std::ifstream shaderFile(geometryShaderPath);
+	if (!shaderFile.is_open())
+	{
+		LOG_ERROR("Could not open geometry shader: %s", geometryShaderPath);
+		return(false);
+	}
+	std::stringstream shaderStream;
+	shaderStream << shaderFile.rdbuf();
+
+	return(LoadGeometryShaderSource(shaderStream.str()));
+}
+
+/***********************************************************
+ *  LoadGeometryShaderSource()
+ *
+ *  This method does the work of LoadGeometryShader() with
+ *  source code that was already read.
+ ***********************************************************/
+bool MultiViewRenderer::LoadGeometryShaderSource(const std::string& shaderCode)
+{
+	if ((NULL == m_pShaderManager) || (NULL == m_pSceneManager) || shaderCode.empty())
+	{
+		return(false);
+	}
+
+	// viewport arrays and geometry shader invocations need OpenGL 4.1
+	if (!GLEW_VERSION_4_1)
+	{
+		LOG_WARNING("Multi-view rendering needs OpenGL 4.1 - disabled");
+		return(false);
+	}
+
+	m_geometryShaderCode = shaderCode;
+	m_bAvailable = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method compiles the geometry shader with the given
+ *  invocation count and links it with the scene shaders.
+ ***********************************************************/
+bool MultiViewRenderer::LinkProgram(VIEW_PROGRAM& viewProgram, int viewCount, bool bLayered)
+{
+	// the variant is chosen with defines placed after the #version
+	// line, which has to stay first
+	std::string shaderCode = m_geometryShaderCode;
+	std::string defines = "#define VIEW_COUNT " + std::to_string(viewCount) + "\n";
+	if (bLayered)
+	{
+		defines += "#define LAYERED\n";
+	}
+	size_t versionEnd = shaderCode.find('\n');
+	shaderCode.insert((versionEnd == std::string::npos) ? shaderCode.size() : versionEnd + 1, defines);
+	const char* pShaderCode = shaderCode.c_str();
+
+	GLint success = 0;
+	char infoLog[512];
+
+	GLuint geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+	glShaderSource(geometryShader, 1, &pShaderCode, NULL);
+	glCompileShader(geometryShader);
+	glGetShaderiv(geometryShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(geometryShader, sizeof(infoLog), NULL, infoLog);
+		LOG_ERROR("Geometry shader compile failed: %s", infoLog);
+		glDeleteShader(geometryShader);
+		return(false);
+	}
+
+	// the shader manager does not expose its program, so take it
+	// from the current binding
+	viewProgram.pShaderManager = new ShaderManager();
+	viewProgram.pShaderManager->LoadShaders(m_vertexShaderPath.c_str(), m_fragmentShaderPath.c_str());
+	viewProgram.pShaderManager->use();
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+	glAttachShader((GLuint)program, geometryShader);
+	glLinkProgram((GLuint)program);
+	glDeleteShader(geometryShader);
+	glGetProgramiv((GLuint)program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog((GLuint)program, sizeof(infoLog), NULL, infoLog);
+		LOG_ERROR("Multi-view program link failed: %s", infoLog);
+		delete viewProgram.pShaderManager;
+		viewProgram.pShaderManager = NULL;
+		m_pShaderManager->use();
+		return(false);
+	}
+
+	viewProgram.viewCountLocation = glGetUniformLocation((GLuint)program, "viewCount");
+	for (int i = 0; i < MAX_LAYERS; i++)
+	{
+		std::string name = "viewProjections[" + std::to_string(i) + "]";
+		viewProgram.viewProjectionLocations[i] = (i < viewCount) ?
+			glGetUniformLocation((GLuint)program, name.c_str()) : -1;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindProgram()
+ *
+ *  This method makes a multi-view program the one the scene
+ *  is drawn with, linking it on first use.
+ ***********************************************************/
+bool MultiViewRenderer::BindProgram(VIEW_PROGRAM& viewProgram, int viewCount, bool bLayered)
+{
+	if ((NULL == viewProgram.pShaderManager) && !viewProgram.bFailed)
+	{
+		viewProgram.bFailed = !LinkProgram(viewProgram, viewCount, bLayered);
+	}
+	if (viewProgram.bFailed)
+	{
+		m_pShaderManager->use();
+		return(false);
+	}
+
+	viewProgram.pShaderManager->use();
+	m_pSceneManager->SetShaderManager(viewProgram.pShaderManager);
+	m_pActiveProgram = &viewProgram;
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginViews()
+ *
+ *  This method lays out one viewport per view and loads the
+ *  view matrices, so that the next draws reach all views.
+ ***********************************************************/
+bool MultiViewRenderer::BeginViews(const VIEW* pViews, int viewCount, int renderWidth, int renderHeight)
+{
+	if ((!m_bAvailable) || (NULL == pViews) || (viewCount <= 0))
+	{
+		return(false);
+	}
+	if (viewCount > MAX_VIEWS)
+	{
+		viewCount = MAX_VIEWS;
+	}
+
+	if (!BindProgram(m_viewportProgram, MAX_VIEWS, false))
+	{
+		m_bAvailable = false;
+		return(false);
+	}
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		glViewportIndexedf(
+			i,
+			pViews[i].x * renderWidth,
+			pViews[i].y * renderHeight,
+			pViews[i].width * renderWidth,
+			pViews[i].height * renderHeight);
+		glUniformMatrix4fv(m_viewportProgram.viewProjectionLocations[i], 1, GL_FALSE, glm::value_ptr(pViews[i].viewProjection));
+	}
+	glUniform1i(m_viewportProgram.viewCountLocation, viewCount);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginLayeredViews()
+ *
+ *  This method loads one view matrix per layer, so that the
+ *  next draws reach every layer of the bound framebuffer.
+ *  The caller sets the viewport to the layer size.
+ ***********************************************************/
+bool MultiViewRenderer::BeginLayeredViews(const glm::mat4* pViewProjections, int viewCount)
+{
+	if ((!m_bAvailable) || (NULL == pViewProjections) || (viewCount <= 0))
+	{
+		return(false);
+	}
+	if (viewCount > MAX_LAYERS)
+	{
+		viewCount = MAX_LAYERS;
+	}
+
+	if (!BindProgram(m_layeredProgram, MAX_LAYERS, true))
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		glUniformMatrix4fv(m_layeredProgram.viewProjectionLocations[i], 1, GL_FALSE, glm::value_ptr(pViewProjections[i]));
+	}
+	glUniform1i(m_layeredProgram.viewCountLocation, viewCount);
+
+	return(true);
+}
+
+/***********************************************************
+ *  EndViews()
+ *
+ *  This method goes back to the scene program and restores
+ *  the single full-size viewport.
+ ***********************************************************/
+void MultiViewRenderer::EndViews(int renderWidth, int renderHeight)
+{
+	if (NULL == m_pActiveProgram)
+	{
+		return;
+	}
+
+	m_pSceneManager->SetShaderManager(m_pShaderManager);
+	m_pShaderManager->use();
+	m_pActiveProgram = NULL;
+
+	// glViewport resets every viewport in the array
+	glViewport(0, 0, renderWidth, renderHeight);
+}
+
+/***********************************************************
+ *  GetShaderManager()
+ ***********************************************************/
+ShaderManager* MultiViewRenderer::GetShaderManager() const
+{
+	return((NULL != m_pActiveProgram) ? m_pActiveProgram->pShaderManager : m_pShaderManager);
+}
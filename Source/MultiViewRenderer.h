@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewrenderer.h
+// ============
+// draw the scene into several viewports from a single submission, using a
+// geometry shader that replicates each triangle once per view. The shader
+// lives in programs of its own, so single-view frames never run it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "SceneManager.h"
+
+#include <GL/glew.h>
+
+#include <string>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+class MultiViewRenderer
+{
+public:
+	// most viewports and layered target layers one submission can draw -
+	// the invocation counts of the two geometry shader variants
+	static const int MAX_VIEWS = 4;
+	static const int MAX_LAYERS = 6;
+
+	// one view of the scene and the part of the render target it fills,
+	// as fractions of the render size
+	struct VIEW
+	{
+		glm::mat4 viewProjection;
+		float x;
+		float y;
+		float width;
+		float height;
+	};
+
+	// constructor - the multi-view programs are linked from the scene's
+	// vertex and fragment shader files, and the scene manager is pointed
+	// at them while views are being drawn
+	MultiViewRenderer(
+		ShaderManager* pShaderManager,
+		SceneManager* pSceneManager,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+	// destructor
+	~MultiViewRenderer();
+
+	// load the multi-view geometry shader - the programs using it are
+	// linked the first time they are needed
+	bool LoadGeometryShader(const char* geometryShaderPath);
+	// the same with the shader source already in memory
+	bool LoadGeometryShaderSource(const std::string& shaderCode);
+
+	// true when the geometry shader is loaded and the viewport program
+	// has not failed to link
+	bool IsAvailable() const { return(m_bAvailable); }
+
+	// route the following draws into the given views. Returns false if
+	// they will only reach the single full view.
+	bool BeginViews(const VIEW* pViews, int viewCount, int renderWidth, int renderHeight);
+	// route the following draws into the layers of the bound layered
+	// framebuffer, one view-projection per layer
+	bool BeginLayeredViews(const glm::mat4* pViewProjections, int viewCount);
+	// go back to drawing a single view with the scene program
+	void EndViews(int renderWidth, int renderHeight);
+
+	// the program the scene is drawn with between a Begin and
+	// EndViews(), for loading the view into it
+	ShaderManager* GetShaderManager() const;
+
+private:
+	// the scene shaders linked with one variant of the geometry shader
+	struct VIEW_PROGRAM
+	{
+		// NULL until the program is first used
+		ShaderManager* pShaderManager;
+		// locations of the view uniforms, looked up once after linking
+		GLint viewCountLocation;
+		GLint viewProjectionLocations[MAX_LAYERS];
+		// set once linking fails, so it is not tried every frame
+		bool bFailed;
+	};
+
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to scene manager object
+	SceneManager* m_pSceneManager;
+	// files the multi-view programs take their other stages from
+	std::string m_vertexShaderPath;
+	std::string m_fragmentShaderPath;
+	// source of the geometry shader
+	std::string m_geometryShaderCode;
+	// MAX_VIEWS viewports, and MAX_LAYERS layers
+	VIEW_PROGRAM m_viewportProgram;
+	VIEW_PROGRAM m_layeredProgram;
+	// the program bound between a Begin and EndViews(), else NULL
+	VIEW_PROGRAM* m_pActiveProgram;
+	// true while the viewport program can be used
+	bool m_bAvailable;
+
+	// link a variant with one invocation per view
+	bool LinkProgram(VIEW_PROGRAM& viewProgram, int viewCount, bool bLayered);
+	// link the variant if needed and draw the scene with it
+	bool BindProgram(VIEW_PROGRAM& viewProgram, int viewCount, bool bLayered);
+};
@@ -0,0 +1,188 @@
+///////////////////////////////////////////////////////////////////////////////
+// nullrenderdevice.cpp
+// ============
+// render device that only counts what it is asked to do
+//
+// NOTE: resources are handed out as increasing handles with nothing behind
+// them, and each command list keeps its own counters, so recording on
+// several threads shares nothing until EndFrame() adds the lists up.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NullRenderDevice.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  NullCommandList
+ *
+ *  Counts the calls recorded into it.
+ ***********************************************************/
+class NullCommandList : public RenderCommandList
+{
+public:
+	void Reset()
+	{
+		m_counters = NULL_DEVICE_COUNTERS();
+	}
+
+	virtual void BindPipeline(PIPELINE_HANDLE)
+	{
+		m_counters.pipelineBinds++;
+	}
+
+	virtual void BindTexture(TEXTURE_HANDLE)
+	{
+		m_counters.textureBinds++;
+	}
+
+	virtual void BindMesh(BUFFER_HANDLE, BUFFER_HANDLE)
+	{
+		m_counters.meshBinds++;
+	}
+
+	virtual void SetDrawConstants(const DRAW_CONSTANTS& constants)
+	{
+		// copied like a real backend would, so the cost stays in the frame
+		m_drawConstants = constants;
+		m_counters.constantUpdates++;
+	}
+
+	virtual void DrawIndexed(uint32_t indexCount)
+	{
+		m_counters.draws++;
+		m_counters.indices += indexCount;
+	}
+
+	const NULL_DEVICE_COUNTERS& GetCounters() const { return(m_counters); }
+
+private:
+	NULL_DEVICE_COUNTERS m_counters;
+	DRAW_CONSTANTS m_drawConstants;
+};
+
+namespace
+{
+	void AddCounters(NULL_DEVICE_COUNTERS& total, const NULL_DEVICE_COUNTERS& counters)
+	{
+		total.pipelineBinds += counters.pipelineBinds;
+		total.textureBinds += counters.textureBinds;
+		total.meshBinds += counters.meshBinds;
+		total.constantUpdates += counters.constantUpdates;
+		total.draws += counters.draws;
+		total.indices += counters.indices;
+	}
+}
+
+/***********************************************************
+ *  NullRenderDevice()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+NullRenderDevice::NullRenderDevice()
+{
+	m_bufferCount = 0;
+	m_textureCount = 0;
+	m_pipelineCount = 0;
+	for (int i = 0; i < MAX_COMMAND_LISTS; i++)
+	{
+		m_commandLists[i] = new NullCommandList();
+	}
+	m_width = 0;
+	m_height = 0;
+	m_clearColor = glm::vec4(0.0f);
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~NullRenderDevice()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+NullRenderDevice::~NullRenderDevice()
+{
+	for (int i = 0; i < MAX_COMMAND_LISTS; i++)
+	{
+		delete m_commandLists[i];
+		m_commandLists[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ ***********************************************************/
+BUFFER_HANDLE NullRenderDevice::CreateBuffer(BUFFER_USAGE, const void*, size_t)
+{
+	return(m_bufferCount++);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ ***********************************************************/
+TEXTURE_HANDLE NullRenderDevice::CreateTexture(const TEXTURE_DESC&)
+{
+	return(m_textureCount++);
+}
+
+/***********************************************************
+ *  CreatePipeline()
+ ***********************************************************/
+PIPELINE_HANDLE NullRenderDevice::CreatePipeline(const PIPELINE_DESC&)
+{
+	return(m_pipelineCount++);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ ***********************************************************/
+bool NullRenderDevice::BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants)
+{
+	m_width = width;
+	m_height = height;
+	m_clearColor = frameConstants.clearColor;
+	return(true);
+}
+
+/***********************************************************
+ *  BeginCommandList()
+ ***********************************************************/
+RenderCommandList* NullRenderDevice::BeginCommandList(int listIndex)
+{
+	m_commandLists[listIndex]->Reset();
+	return(m_commandLists[listIndex]);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method adds up the calls recorded into the lists.
+ ***********************************************************/
+void NullRenderDevice::EndFrame(int listCount)
+{
+	m_frameCounters = NULL_DEVICE_COUNTERS();
+	for (int i = 0; i < listCount; i++)
+	{
+		AddCounters(m_frameCounters, m_commandLists[i]->GetCounters());
+	}
+	AddCounters(m_totalCounters, m_frameCounters);
+	m_frameCount++;
+}
+
+/***********************************************************
+ *  ReadPixels()
+ ***********************************************************/
+void NullRenderDevice::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	unsigned char clearColor[3];
+	for (int channel = 0; channel < 3; channel++)
+	{
+		clearColor[channel] = (unsigned char)(std::min(std::max(m_clearColor[channel], 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	pixels.resize((size_t)m_width * m_height * 3);
+	for (size_t i = 0; i < pixels.size(); i += 3)
+	{
+		pixels[i] = clearColor[0];
+		pixels[i + 1] = clearColor[1];
+		pixels[i + 2] = clearColor[2];
+	}
+}
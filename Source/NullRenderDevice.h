@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// nullrenderdevice.h
+// ============
+// a render device that draws nothing - every call is counted and dropped,
+// so the scene can be built and submitted with no context or driver and the
+// time that is left is the CPU cost of building the frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderDevice.h"
+
+#include <cstdint>
+#include <vector>
+
+// calls made through the device's command lists
+struct NULL_DEVICE_COUNTERS
+{
+	uint64_t pipelineBinds = 0;
+	uint64_t textureBinds = 0;
+	uint64_t meshBinds = 0;
+	uint64_t constantUpdates = 0;
+	uint64_t draws = 0;
+	uint64_t indices = 0;
+};
+
+class NullCommandList;
+
+class NullRenderDevice : public RenderDevice
+{
+public:
+	// constructor
+	NullRenderDevice();
+	// destructor
+	virtual ~NullRenderDevice();
+
+	virtual const char* GetName() const { return("null device"); }
+
+	virtual BUFFER_HANDLE CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size);
+	virtual TEXTURE_HANDLE CreateTexture(const TEXTURE_DESC& desc);
+	virtual PIPELINE_HANDLE CreatePipeline(const PIPELINE_DESC& desc);
+
+	virtual int GetMaxCommandLists() const { return(MAX_COMMAND_LISTS); }
+
+	virtual bool BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants);
+	virtual RenderCommandList* BeginCommandList(int listIndex);
+	virtual void EndCommandList(int) {}
+	virtual void EndFrame(int listCount);
+
+	// fills the frame with its clear color
+	virtual void ReadPixels(std::vector<unsigned char>& pixels);
+
+	// calls made by the last frame, and by every frame so far
+	const NULL_DEVICE_COUNTERS& GetFrameCounters() const { return(m_frameCounters); }
+	const NULL_DEVICE_COUNTERS& GetTotalCounters() const { return(m_totalCounters); }
+	int GetFrameCount() const { return(m_frameCount); }
+
+	static const int MAX_COMMAND_LISTS = 64;
+
+private:
+	int m_bufferCount;
+	int m_textureCount;
+	int m_pipelineCount;
+	NullCommandList* m_commandLists[MAX_COMMAND_LISTS];
+
+	int m_width;
+	int m_height;
+	glm::vec4 m_clearColor;
+
+	NULL_DEVICE_COUNTERS m_frameCounters;
+	NULL_DEVICE_COUNTERS m_totalCounters;
+	int m_frameCount;
+};
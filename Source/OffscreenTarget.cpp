@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.cpp
+// ============
+// offscreen framebuffer object
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OffscreenTarget.h"
+#include "Logger.h"
+
+/***********************************************************
+ *  OffscreenTarget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OffscreenTarget::OffscreenTarget()
+{
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthRenderbuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~OffscreenTarget()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OffscreenTarget::~OffscreenTarget()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Resize()
+ ***********************************************************/
+void OffscreenTarget::Resize(int width, int height)
+{
+	if ((width == m_width) && (height == m_height) && (0 != m_framebuffer))
+	{
+		return;
+	}
+	Destroy();
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG_ERROR("Offscreen framebuffer is incomplete");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_width = width;
+	m_height = height;
+}
+
+/***********************************************************
+ *  Bind()
+ ***********************************************************/
+void OffscreenTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  ReadPixels()
+ ***********************************************************/
+void OffscreenTarget::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	pixels.resize((size_t)m_width * m_height * 3);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ ***********************************************************/
+void OffscreenTarget::Destroy()
+{
+	if (0 != m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+		glDeleteTextures(1, &m_colorTexture);
+	}
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthRenderbuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
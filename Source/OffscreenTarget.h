@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.h
+// ============
+// a color and depth framebuffer object for rendering without a window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+class OffscreenTarget
+{
+public:
+	// constructor
+	OffscreenTarget();
+	// destructor
+	~OffscreenTarget();
+
+	// (re)allocate the target at the given size
+	void Resize(int width, int height);
+
+	// redirect rendering into the target and cover it with the viewport
+	void Bind();
+
+	// copy the color image into 8-bit RGB pixels, bottom row first
+	void ReadPixels(std::vector<unsigned char>& pixels);
+
+	GLuint GetFramebuffer() const { return(m_framebuffer); }
+	GLuint GetColorTexture() const { return(m_colorTexture); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+
+private:
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthRenderbuffer;
+	int m_width;
+	int m_height;
+
+	void Destroy();
+};
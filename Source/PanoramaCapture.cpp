@@ -0,0 +1,363 @@
+///////////////////////////////////////////////////////////////////////////////
+// panoramacapture.cpp
+// ============
+// single-pass cube map capture and equirectangular unwrap
+//
+// NOTE: the cube map is attached as a layered target, and the multi-view
+// geometry shader sends every triangle to each face it touches through
+// gl_Layer. A capture therefore costs one scene submission rather than six.
+// The panorama is read back into a pixel buffer with a fence, as the frame
+// recorder does, and only mapped once the fence has signalled a frame or so
+// later. The image is encoded and written on the encoder pool, so the render
+// thread never waits for the GPU or the disk.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PanoramaCapture.h"
+#include "ViewManager.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	// number of faces of a cube map
+	const int CUBE_FACE_COUNT = 6;
+	// texture unit the cube map is read from - kept clear of the units
+	// the scene textures are bound to once at startup
+	const int PANORAMA_TEXTURE_UNIT = 12;
+	// how long a capture waits for the one before it, in nanoseconds
+	const GLuint64 READBACK_WAIT_TIMEOUT = 1000000000;
+
+	// look direction and up vector of each cube face, in the order of
+	// the GL_TEXTURE_CUBE_MAP_POSITIVE_X.. layers
+	const glm::vec3 CUBE_FACE_DIRECTIONS[CUBE_FACE_COUNT] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 CUBE_FACE_UPS[CUBE_FACE_COUNT] =
+	{
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+/***********************************************************
+ *  PanoramaCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PanoramaCapture::PanoramaCapture(
+	MultiViewRenderer* pMultiViewRenderer,
+	ThreadPool* pEncoderPool,
+	int faceSize,
+	int panoramaWidth)
+{
+	m_pMultiViewRenderer = pMultiViewRenderer;
+	m_pEncoderPool = pEncoderPool;
+	m_faceSize = faceSize;
+	m_panoramaWidth = panoramaWidth;
+	m_panoramaHeight = panoramaWidth / 2;
+
+	m_pPanoramaShader = new ShaderManager();
+	m_pPanoramaShader->LoadShaders(
+		"shaders/panoramaVertexShader.glsl",
+		"shaders/panoramaFragmentShader.glsl");
+
+	glGenVertexArrays(1, &m_vertexArray);
+
+	m_cubeFramebuffer = 0;
+	m_cubeColorTexture = 0;
+	m_cubeDepthTexture = 0;
+	m_panoramaFramebuffer = 0;
+	m_panoramaTexture = 0;
+	m_pixelBuffer = 0;
+	m_readbackFence = 0;
+	m_renderThreadMilliseconds = 0.0;
+}
+
+/***********************************************************
+ *  ~PanoramaCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PanoramaCapture::~PanoramaCapture()
+{
+	// a capture still being read back is finished rather than lost
+	CollectReadback(true);
+	DestroyTargets();
+	glDeleteVertexArrays(1, &m_vertexArray);
+
+	if (NULL != m_pPanoramaShader)
+	{
+		delete m_pPanoramaShader;
+		m_pPanoramaShader = NULL;
+	}
+	m_pMultiViewRenderer = NULL;
+	m_pEncoderPool = NULL;
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method draws the scene into all six cube faces in a
+ *  single submission, unwraps the cube map into the panorama
+ *  and writes it out.
+ ***********************************************************/
+bool PanoramaCapture::Capture(
+	SceneManager* pSceneManager,
+	const FRAME_STATE& frameState,
+	const std::string& filename)
+{
+	if ((NULL == pSceneManager) ||
+		(NULL == m_pMultiViewRenderer) ||
+		(NULL == m_pEncoderPool) ||
+		(!m_pMultiViewRenderer->IsAvailable()))
+	{
+		LOG_WARNING("Panorama capture needs multi-view rendering - skipped");
+		return(false);
+	}
+
+	// the targets are shared, so an earlier capture has to be read
+	// back before they are drawn into again
+	CollectReadback(true);
+
+	auto captureStart = std::chrono::steady_clock::now();
+
+	// the targets are only needed while capturing, so they are
+	// created on first use
+	if (0 == m_cubeFramebuffer)
+	{
+		CreateTargets();
+	}
+
+	// one 90 degree view per face, all from the camera position
+	glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+	glm::mat4 faceViewProjections[CUBE_FACE_COUNT];
+	for (int i = 0; i < CUBE_FACE_COUNT; i++)
+	{
+		faceViewProjections[i] = faceProjection * glm::lookAt(
+			frameState.viewPosition,
+			frameState.viewPosition + CUBE_FACE_DIRECTIONS[i],
+			CUBE_FACE_UPS[i]);
+	}
+
+	// the scene clears the whole layered target itself
+	glBindFramebuffer(GL_FRAMEBUFFER, m_cubeFramebuffer);
+	glViewport(0, 0, m_faceSize, m_faceSize);
+	glEnable(GL_DEPTH_TEST);
+
+	if (!m_pMultiViewRenderer->BeginLayeredViews(faceViewProjections, CUBE_FACE_COUNT))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		LOG_WARNING("Panorama capture could not draw the cube faces - skipped");
+		return(false);
+	}
+	// the geometry shader places the triangles, but the lighting
+	// still needs the camera position
+	ViewManager::LoadViewIntoShader(
+		m_pMultiViewRenderer->GetShaderManager(),
+		glm::lookAt(frameState.viewPosition, frameState.viewPosition + CUBE_FACE_DIRECTIONS[0], CUBE_FACE_UPS[0]),
+		faceProjection,
+		frameState.viewPosition);
+	pSceneManager->RenderAuxiliaryScene(frameState);
+	m_pMultiViewRenderer->EndViews(m_faceSize, m_faceSize);
+
+	// unwrap the cube into the panorama
+	GLint sceneProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &sceneProgram);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_panoramaFramebuffer);
+	glViewport(0, 0, m_panoramaWidth, m_panoramaHeight);
+	glDisable(GL_DEPTH_TEST);
+
+	glActiveTexture(GL_TEXTURE0 + PANORAMA_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeColorTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pPanoramaShader->use();
+	m_pPanoramaShader->setIntValue("sceneCube", PANORAMA_TEXTURE_UNIT);
+
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	// start reading the panorama back - rows arrive bottom first
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_panoramaWidth, m_panoramaHeight, GL_RGB, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glUseProgram(sceneProgram);
+	glEnable(GL_DEPTH_TEST);
+
+	m_pendingFilename = filename;
+	m_captureStart = captureStart;
+	m_renderThreadMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - captureStart).count();
+
+	return(true);
+}
+
+/***********************************************************
+ *  CollectReadback()
+ *
+ *  This method copies a finished readback out of the pixel
+ *  buffer and queues the image to be written. The cost is
+ *  logged once it is on disk, from the start of the capture.
+ ***********************************************************/
+void PanoramaCapture::CollectReadback(bool bWait)
+{
+	if (0 == m_readbackFence)
+	{
+		return;
+	}
+
+	auto collectStart = std::chrono::steady_clock::now();
+	GLuint64 timeout = bWait ? READBACK_WAIT_TIMEOUT : 0;
+	GLenum waitResult = glClientWaitSync(m_readbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	if ((GL_ALREADY_SIGNALED != waitResult) && (GL_CONDITION_SATISFIED != waitResult))
+	{
+		if (!bWait)
+		{
+			return;
+		}
+		LOG_WARNING("Panorama readback timed out - %s skipped", m_pendingFilename.c_str());
+		glDeleteSync(m_readbackFence);
+		m_readbackFence = 0;
+		return;
+	}
+	glDeleteSync(m_readbackFence);
+	m_readbackFence = 0;
+
+	// copy out so the buffer is free for the next capture
+	std::shared_ptr<std::vector<unsigned char>> pPixels =
+		std::make_shared<std::vector<unsigned char>>((size_t)m_panoramaWidth * m_panoramaHeight * 3);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffer);
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)pPixels->size(), GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		memcpy(pPixels->data(), pMapped, pPixels->size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (NULL == pMapped)
+	{
+		LOG_ERROR("Could not map the panorama readback buffer - %s skipped", m_pendingFilename.c_str());
+		return;
+	}
+
+	double renderThreadMilliseconds = m_renderThreadMilliseconds + std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - collectStart).count();
+	std::string filename = m_pendingFilename;
+	auto captureStart = m_captureStart;
+	int width = m_panoramaWidth;
+	int height = m_panoramaHeight;
+	m_pEncoderPool->Submit([pPixels, filename, captureStart, renderThreadMilliseconds, width, height]()
+		{
+			if (!ImageWriter::WriteImage(filename, width, height, pPixels->data()))
+			{
+				return;
+			}
+			double captureMilliseconds = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - captureStart).count();
+			LOG_INFO("Panorama %s captured (%dx%d) in %.2f ms, %.2f ms of it on the render thread",
+				filename.c_str(), width, height, captureMilliseconds, renderThreadMilliseconds);
+		});
+}
+
+/***********************************************************
+ *  CreateTargets()
+ ***********************************************************/
+void PanoramaCapture::CreateTargets()
+{
+	glGenTextures(1, &m_cubeColorTexture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeColorTexture);
+	for (int i = 0; i < CUBE_FACE_COUNT; i++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA8,
+			m_faceSize, m_faceSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &m_cubeDepthTexture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeDepthTexture);
+	for (int i = 0; i < CUBE_FACE_COUNT; i++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT24,
+			m_faceSize, m_faceSize, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	// attaching the whole cube map makes the framebuffer layered
+	glGenFramebuffers(1, &m_cubeFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_cubeFramebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_cubeColorTexture, 0);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cubeDepthTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG_ERROR("Panorama cube framebuffer is incomplete");
+	}
+
+	glGenTextures(1, &m_panoramaTexture);
+	glBindTexture(GL_TEXTURE_2D, m_panoramaTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_panoramaWidth, m_panoramaHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_panoramaFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_panoramaFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_panoramaTexture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenBuffers(1, &m_pixelBuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)m_panoramaWidth * m_panoramaHeight * 3, NULL, GL_STREAM_READ);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DestroyTargets()
+ ***********************************************************/
+void PanoramaCapture::DestroyTargets()
+{
+	if (0 != m_cubeFramebuffer)
+	{
+		glDeleteFramebuffers(1, &m_cubeFramebuffer);
+		glDeleteTextures(1, &m_cubeColorTexture);
+		glDeleteTextures(1, &m_cubeDepthTexture);
+		glDeleteFramebuffers(1, &m_panoramaFramebuffer);
+		glDeleteTextures(1, &m_panoramaTexture);
+		glDeleteBuffers(1, &m_pixelBuffer);
+	}
+	m_cubeFramebuffer = 0;
+	m_cubeColorTexture = 0;
+	m_cubeDepthTexture = 0;
+	m_panoramaFramebuffer = 0;
+	m_panoramaTexture = 0;
+	m_pixelBuffer = 0;
+}
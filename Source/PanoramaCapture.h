@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// panoramacapture.h
+// ============
+// capture a 360 degree panorama of the scene - all six cube faces are drawn
+// in a single submission and unwrapped to an equirectangular image on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "SceneManager.h"
+#include "MultiViewRenderer.h"
+#include "FrameState.h"
+#include "ThreadPool.h"
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+
+class PanoramaCapture
+{
+public:
+	// constructor - the panoramas are encoded and written on the
+	// encoder pool, which must outlive this object's pending captures
+	PanoramaCapture(
+		MultiViewRenderer* pMultiViewRenderer,
+		ThreadPool* pEncoderPool,
+		int faceSize,
+		int panoramaWidth);
+	// destructor
+	~PanoramaCapture();
+
+	// draw the scene around the camera position of the frame snapshot and
+	// start reading the panorama back, to be written to an image file
+	bool Capture(
+		SceneManager* pSceneManager,
+		const FRAME_STATE& frameState,
+		const std::string& filename);
+	// hand a finished readback to the encoder pool - call once a frame,
+	// optionally waiting for the GPU
+	void CollectReadback(bool bWait);
+
+private:
+	// draws all cube faces in one pass
+	MultiViewRenderer* m_pMultiViewRenderer;
+	// encodes and writes the finished panoramas
+	ThreadPool* m_pEncoderPool;
+	// shader program that unwraps the cube map
+	ShaderManager* m_pPanoramaShader;
+	// empty vertex array for the full-screen triangle
+	GLuint m_vertexArray;
+
+	// layered cube map target for the scene
+	GLuint m_cubeFramebuffer;
+	GLuint m_cubeColorTexture;
+	GLuint m_cubeDepthTexture;
+	int m_faceSize;
+
+	// equirectangular output, twice as wide as it is high
+	GLuint m_panoramaFramebuffer;
+	GLuint m_panoramaTexture;
+	int m_panoramaWidth;
+	int m_panoramaHeight;
+
+	// pixel buffer the panorama is read back into, and the fence
+	// that signals when it is filled, 0 when no readback is pending
+	GLuint m_pixelBuffer;
+	GLsync m_readbackFence;
+	// the pending capture - its file, when it started and the render
+	// thread time it has taken so far
+	std::string m_pendingFilename;
+	std::chrono::steady_clock::time_point m_captureStart;
+	double m_renderThreadMilliseconds;
+
+	void CreateTargets();
+	void DestroyTargets();
+};
@@ -0,0 +1,452 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.cpp
+// ============
+// grouped perf event counters with per-frame and per-scope deltas
+//
+// NOTE: the counters are opened as one group under a task clock leader, so
+// a single read() returns them all, taken at the same instant, and a
+// counter the CPU or the virtual machine lacks simply drops out of the
+// group. When the kernel has to share the hardware counters between
+// groups, each value is scaled by how long the group actually ran. Linux
+// only.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerfCounters.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// what each counter is called in the log and the CSV
+	const char* const COUNTER_NAMES[] =
+	{
+		"task clock",
+		"cycles",
+		"instructions",
+		"cache misses",
+		"branch misses"
+	};
+
+	/***********************************************************
+	 *  Difference()
+	 *
+	 *  Return the counts between two reads.
+	 ***********************************************************/
+	PERF_COUNTER_VALUES Difference(const PERF_COUNTER_VALUES& end, const PERF_COUNTER_VALUES& start)
+	{
+		PERF_COUNTER_VALUES values;
+		values.taskClock = end.taskClock - start.taskClock;
+		values.cycles = end.cycles - start.cycles;
+		values.instructions = end.instructions - start.instructions;
+		values.cacheMisses = end.cacheMisses - start.cacheMisses;
+		values.branchMisses = end.branchMisses - start.branchMisses;
+		return(values);
+	}
+
+	/***********************************************************
+	 *  Accumulate()
+	 ***********************************************************/
+	void Accumulate(PERF_COUNTER_VALUES& total, const PERF_COUNTER_VALUES& values)
+	{
+		total.taskClock += values.taskClock;
+		total.cycles += values.cycles;
+		total.instructions += values.instructions;
+		total.cacheMisses += values.cacheMisses;
+		total.branchMisses += values.branchMisses;
+	}
+
+#ifdef __linux__
+	/***********************************************************
+	 *  OpenCounter()
+	 *
+	 *  Open one counter of the calling thread, in user space
+	 *  only, joining the given group. Returns -1 on failure.
+	 ***********************************************************/
+	int OpenCounter(uint32_t type, uint64_t config, int groupFd)
+	{
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = type;
+		attributes.config = config;
+		// the whole group is started at once by the leader
+		attributes.disabled = (groupFd < 0) ? 1 : 0;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return((int)syscall(__NR_perf_event_open, &attributes, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+	}
+#endif
+}
+
+/***********************************************************
+ *  PerfCounters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PerfCounters::PerfCounters()
+{
+	m_groupFd = -1;
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		m_counterFds[i] = -1;
+		m_groupIndex[i] = -1;
+	}
+	m_groupSize = 0;
+
+	m_bInFrame = false;
+	m_totalFrameMilliseconds = 0.0;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~PerfCounters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	// the leader is closed last
+	for (int i = COUNTER_COUNT - 1; i >= 0; i--)
+	{
+		if (m_counterFds[i] >= 0)
+		{
+			close(m_counterFds[i]);
+			m_counterFds[i] = -1;
+		}
+	}
+#endif
+	m_groupFd = -1;
+}
+
+/***********************************************************
+ *  Open()
+ ***********************************************************/
+bool PerfCounters::Open()
+{
+#ifdef __linux__
+	if (IsOpen())
+	{
+		return(true);
+	}
+
+	const uint32_t types[COUNTER_COUNT] =
+	{
+		PERF_TYPE_SOFTWARE,
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE
+	};
+	const uint64_t configs[COUNTER_COUNT] =
+	{
+		PERF_COUNT_SW_TASK_CLOCK,
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		m_counterFds[i] = OpenCounter(types[i], configs[i], m_groupFd);
+		if (m_counterFds[i] < 0)
+		{
+			if (i == COUNTER_TASK_CLOCK)
+			{
+				LOG_WARNING("Performance counters are unavailable (perf_event_open: %s) - check /proc/sys/kernel/perf_event_paranoid", strerror(errno));
+				return(false);
+			}
+			LOG_WARNING("The %s counter is unavailable and is reported as 0", COUNTER_NAMES[i]);
+			continue;
+		}
+
+		// values come back in the order the counters joined the group
+		m_groupIndex[i] = m_groupSize++;
+		if (m_groupFd < 0)
+		{
+			m_groupFd = m_counterFds[i];
+		}
+	}
+
+	ioctl(m_groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	LOG_INFO("Counting %d CPU performance counters", m_groupSize);
+	return(true);
+#else
+	LOG_WARNING("Performance counters are only available on Linux");
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  OpenCsv()
+ ***********************************************************/
+bool PerfCounters::OpenCsv(const std::string& filename)
+{
+	m_csvFile.open(filename);
+	if (!m_csvFile)
+	{
+		LOG_ERROR("Could not write performance counters %s", filename.c_str());
+		return(false);
+	}
+
+	m_csvFile << "frame,scope,frame_ms,task_clock_ns,cycles,instructions,ipc,cache_misses,branch_misses\n";
+	return(true);
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method reads the whole group at once, scaling each
+ *  count up for the time the group was not running.
+ ***********************************************************/
+bool PerfCounters::Read(PERF_COUNTER_VALUES& values) const
+{
+#ifdef __linux__
+	// the count, the enabled and running times, then one value per
+	// counter in the group
+	uint64_t buffer[3 + COUNTER_COUNT];
+	ssize_t size = read(m_groupFd, buffer, sizeof(buffer));
+	if (size < (ssize_t)((3 + m_groupSize) * sizeof(uint64_t)))
+	{
+		return(false);
+	}
+
+	double scale = 1.0;
+	if ((buffer[2] > 0) && (buffer[2] < buffer[1]))
+	{
+		scale = (double)buffer[1] / (double)buffer[2];
+	}
+
+	uint64_t counts[COUNTER_COUNT];
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		counts[i] = (m_groupIndex[i] >= 0) ? (uint64_t)(buffer[3 + m_groupIndex[i]] * scale) : 0;
+	}
+	values.taskClock = counts[COUNTER_TASK_CLOCK];
+	values.cycles = counts[COUNTER_CYCLES];
+	values.instructions = counts[COUNTER_INSTRUCTIONS];
+	values.cacheMisses = counts[COUNTER_CACHE_MISSES];
+	values.branchMisses = counts[COUNTER_BRANCH_MISSES];
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  BeginFrame()
+ ***********************************************************/
+void PerfCounters::BeginFrame()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	m_openScopes.clear();
+	for (size_t i = 0; i < m_scopes.size(); i++)
+	{
+		m_frameScopeValues[i] = PERF_COUNTER_VALUES();
+		m_bScopeInFrame[i] = false;
+	}
+	m_bInFrame = Read(m_frameStart);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method closes the frame and every scope it ran, and
+ *  writes their counts to the CSV file when one is open.
+ ***********************************************************/
+void PerfCounters::EndFrame(double frameMilliseconds)
+{
+	if (!m_bInFrame)
+	{
+		return;
+	}
+	m_bInFrame = false;
+
+	if (!m_openScopes.empty())
+	{
+		LOG_WARNING("Performance counter frame ended with %d scopes open", (int)m_openScopes.size());
+		while (!m_openScopes.empty())
+		{
+			EndScope();
+		}
+	}
+
+	PERF_COUNTER_VALUES frameEnd;
+	if (!Read(frameEnd))
+	{
+		return;
+	}
+	m_lastFrame = Difference(frameEnd, m_frameStart);
+	Accumulate(m_totalFrames, m_lastFrame);
+	m_totalFrameMilliseconds += frameMilliseconds;
+	m_frameCount++;
+	WriteCsvRow("frame", frameMilliseconds, m_lastFrame);
+
+	for (size_t i = 0; i < m_scopes.size(); i++)
+	{
+		if (m_bScopeInFrame[i])
+		{
+			PERF_COUNTER_SCOPE& scope = m_scopes[i];
+			scope.lastFrame = m_frameScopeValues[i];
+			Accumulate(scope.total, scope.lastFrame);
+			scope.frameCount++;
+			WriteCsvRow(scope.name.c_str(), frameMilliseconds, scope.lastFrame);
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginScope()
+ ***********************************************************/
+void PerfCounters::BeginScope(const char* pName)
+{
+	if (!m_bInFrame)
+	{
+		return;
+	}
+
+	OPEN_SCOPE openScope;
+	openScope.scope = FindScope(pName);
+	m_openScopes.push_back(openScope);
+	// read last, so finding the scope is not counted in it
+	if (!Read(m_openScopes.back().start))
+	{
+		m_openScopes.pop_back();
+	}
+}
+
+/***********************************************************
+ *  EndScope()
+ ***********************************************************/
+void PerfCounters::EndScope()
+{
+	if (!m_bInFrame || m_openScopes.empty())
+	{
+		return;
+	}
+
+	PERF_COUNTER_VALUES end;
+	bool bRead = Read(end);
+	OPEN_SCOPE openScope = m_openScopes.back();
+	m_openScopes.pop_back();
+	if (bRead)
+	{
+		Accumulate(m_frameScopeValues[openScope.scope], Difference(end, openScope.start));
+		m_bScopeInFrame[openScope.scope] = true;
+	}
+}
+
+/***********************************************************
+ *  FindScope()
+ *
+ *  This method returns the scope with the given name, adding
+ *  it the first time it is seen. Scopes are kept in the order
+ *  they first begin, so parents come before their children.
+ ***********************************************************/
+int PerfCounters::FindScope(const char* pName)
+{
+	for (int i = 0; i < (int)m_scopes.size(); i++)
+	{
+		if ((m_scopeNames[i] == pName) || (strcmp(m_scopeNames[i], pName) == 0))
+		{
+			return(i);
+		}
+	}
+
+	PERF_COUNTER_SCOPE scope;
+	scope.name = pName;
+	scope.depth = (int)m_openScopes.size();
+	m_scopes.push_back(scope);
+	m_scopeNames.push_back(pName);
+	m_frameScopeValues.push_back(PERF_COUNTER_VALUES());
+	m_bScopeInFrame.push_back(false);
+	return((int)m_scopes.size() - 1);
+}
+
+/***********************************************************
+ *  WriteCsvRow()
+ ***********************************************************/
+void PerfCounters::WriteCsvRow(const char* pName, double frameMilliseconds, const PERF_COUNTER_VALUES& values)
+{
+	if (!m_csvFile.is_open())
+	{
+		return;
+	}
+
+	char ipc[32];
+	snprintf(ipc, sizeof(ipc), "%.3f", values.GetIpc());
+	m_csvFile << (m_frameCount - 1) << "," << pName << "," << frameMilliseconds << ","
+		<< values.taskClock << ","
+		<< values.cycles << ","
+		<< values.instructions << ","
+		<< ipc << ","
+		<< values.cacheMisses << ","
+		<< values.branchMisses << "\n";
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method logs the average counts per frame, for the
+ *  whole frame and for each scope over the frames it ran in.
+ ***********************************************************/
+void PerfCounters::PrintReport() const
+{
+	if (m_frameCount == 0)
+	{
+		return;
+	}
+
+	LOG_INFO("%-32s %9s %12s %12s %6s %10s %10s", "CPU counters per frame", "cpu ms", "cycles", "instructions", "IPC", "cache miss", "branch miss");
+
+	std::vector<std::string> names;
+	std::vector<const PERF_COUNTER_VALUES*> totals;
+	std::vector<uint64_t> frames;
+	names.push_back("frame");
+	totals.push_back(&m_totalFrames);
+	frames.push_back(m_frameCount);
+	for (const PERF_COUNTER_SCOPE& scope : m_scopes)
+	{
+		if (scope.frameCount > 0)
+		{
+			names.push_back(std::string(2 + scope.depth * 2, ' ') + scope.name);
+			totals.push_back(&scope.total);
+			frames.push_back(scope.frameCount);
+		}
+	}
+
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		const PERF_COUNTER_VALUES& total = *totals[i];
+		double frameCount = (double)frames[i];
+		LOG_INFO("%-32s %9.3f %12.0f %12.0f %6.2f %10.0f %10.0f",
+			names[i].c_str(),
+			total.taskClock / frameCount / 1.0e6,
+			total.cycles / frameCount,
+			total.instructions / frameCount,
+			total.GetIpc(),
+			total.cacheMisses / frameCount,
+			total.branchMisses / frameCount);
+	}
+	LOG_INFO("over %llu frames averaging %.3f ms",
+		(unsigned long long)m_frameCount,
+		m_totalFrameMilliseconds / m_frameCount);
+}
@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.h
+// ============
+// CPU hardware performance counters of the render thread - cycles,
+// instructions, cache misses and branch mispredictions - read as one group
+// at frame and scope boundaries through Linux perf events
+//
+//  The counters only count the thread that opened them, so Open() is
+//  called on the render thread and every scope must come from it. Where
+//  perf events are unavailable, Open() fails and the scopes do nothing.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// the counts of one interval
+struct PERF_COUNTER_VALUES
+{
+	// CPU time of the thread, in nanoseconds
+	uint64_t taskClock = 0;
+	uint64_t cycles = 0;
+	uint64_t instructions = 0;
+	// last level cache misses
+	uint64_t cacheMisses = 0;
+	uint64_t branchMisses = 0;
+
+	// instructions retired per cycle
+	double GetIpc() const { return((cycles > 0) ? (double)instructions / (double)cycles : 0.0); }
+};
+
+// the counts of one named scope
+struct PERF_COUNTER_SCOPE
+{
+	std::string name;
+	// nesting of the scope the first time it was entered
+	int depth = 0;
+	// the newest frame the scope ran in - a scope entered several times
+	// in a frame counts the sum - and all frames so far
+	PERF_COUNTER_VALUES lastFrame;
+	PERF_COUNTER_VALUES total;
+	uint64_t frameCount = 0;
+};
+
+class PerfCounters
+{
+public:
+	// constructor
+	PerfCounters();
+	// destructor
+	~PerfCounters();
+
+	// open the counters for the calling thread. Returns false when perf
+	// events are unavailable; counters the CPU lacks are left out.
+	bool Open();
+	bool IsOpen() const { return(m_groupFd >= 0); }
+
+	// write the deltas of every frame and scope to a CSV file
+	bool OpenCsv(const std::string& filename);
+
+	// bracket one frame, given the frame time to report alongside it
+	void BeginFrame();
+	void EndFrame(double frameMilliseconds);
+
+	// bracket work with a name - the counts of nested scopes are also
+	// part of their parent's. The name is kept, so a string literal is
+	// expected.
+	void BeginScope(const char* pName);
+	void EndScope();
+
+	// counts of the last finished frame, and each scope measured so far
+	const PERF_COUNTER_VALUES& GetLastFrame() const { return(m_lastFrame); }
+	const std::vector<PERF_COUNTER_SCOPE>& GetScopes() const { return(m_scopes); }
+
+	// log the average per frame of the frame and every scope
+	void PrintReport() const;
+
+private:
+	enum COUNTER
+	{
+		COUNTER_TASK_CLOCK,
+		COUNTER_CYCLES,
+		COUNTER_INSTRUCTIONS,
+		COUNTER_CACHE_MISSES,
+		COUNTER_BRANCH_MISSES,
+		COUNTER_COUNT
+	};
+
+	// one scope that has begun and not ended
+	struct OPEN_SCOPE
+	{
+		int scope;
+		PERF_COUNTER_VALUES start;
+	};
+
+	// the group leader, and each counter's file and position in a group
+	// read, -1 when it could not be opened
+	int m_groupFd;
+	int m_counterFds[COUNTER_COUNT];
+	int m_groupIndex[COUNTER_COUNT];
+	int m_groupSize;
+
+	bool m_bInFrame;
+	PERF_COUNTER_VALUES m_frameStart;
+	PERF_COUNTER_VALUES m_lastFrame;
+	PERF_COUNTER_VALUES m_totalFrames;
+	double m_totalFrameMilliseconds;
+	uint64_t m_frameCount;
+
+	std::vector<OPEN_SCOPE> m_openScopes;
+	std::vector<PERF_COUNTER_SCOPE> m_scopes;
+	// names as given to BeginScope(), compared by pointer first
+	std::vector<const char*> m_scopeNames;
+	// counts of each scope in the current frame
+	std::vector<PERF_COUNTER_VALUES> m_frameScopeValues;
+	std::vector<bool> m_bScopeInFrame;
+
+	std::ofstream m_csvFile;
+
+	bool Read(PERF_COUNTER_VALUES& values) const;
+	int FindScope(const char* pName);
+	void WriteCsvRow(const char* pName, double frameMilliseconds, const PERF_COUNTER_VALUES& values);
+};
+
+/***********************************************************
+ *  PerfCounterScope
+ *
+ *  Counts the calling thread's work for as long as it lives.
+ *  A NULL or unopened counter set makes it do nothing.
+ ***********************************************************/
+class PerfCounterScope
+{
+public:
+	PerfCounterScope(PerfCounters* pCounters, const char* pName)
+	{
+		m_pCounters = ((NULL != pCounters) && pCounters->IsOpen()) ? pCounters : NULL;
+		if (NULL != m_pCounters)
+		{
+			m_pCounters->BeginScope(pName);
+		}
+	}
+
+	~PerfCounterScope()
+	{
+		if (NULL != m_pCounters)
+		{
+			m_pCounters->EndScope();
+		}
+	}
+
+private:
+	PerfCounters* m_pCounters;
+};
@@ -0,0 +1,826 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracer.cpp
+// ============
+// packet ray tracing of the draw list
+//
+// NOTE: every draw command of the list becomes primitives in world space -
+// spheres stay analytic and are intersected in object space through the
+// inverse model matrix, the other meshes become triangles. A BVH is built
+// over them with the surface area heuristic over binned centroids. Each
+// pass traces one jittered sample per pixel, eight pixels per packet, with
+// the packet walking the tree together and every triangle or sphere tested
+// against all eight rays at once. Hit points are shaded with the Phong
+// model of fragmentShader.glsl, with shadow packets toward each scene light.
+// Blended surfaces such as the flame glow are composited front to back by
+// tracing on past them. Passes add up in an accumulation buffer, so more
+// passes refine the antialiasing. The packet traversal runs in the kernels of
+// RayTracerKernels.inl - the AVX2 build when CpuFeatures::HasAvx2() says the
+// CPU runs it, the plain one otherwise. This file is built for any x86 CPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RayTracer.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cfloat>
+
+namespace
+{
+	// size of the square screen tiles handed to the threads
+	const int TILE_SIZE = 16;
+	// a packet covers 4x2 pixels
+	const int PACKET_WIDTH = 4;
+	const int PACKET_HEIGHT = 2;
+	// SAH bins per axis
+	const int SAH_BINS = 12;
+	// blended surfaces a ray may pass through
+	const int MAX_LAYERS = 8;
+	// offset of secondary rays off the surface they start on
+	const float RAY_EPSILON = 1.0e-3f;
+
+	/***********************************************************
+	 *  RadicalInverse()
+	 *
+	 *  The Halton sequence value of an index in a prime base.
+	 ***********************************************************/
+	float RadicalInverse(uint32_t index, uint32_t base)
+	{
+		float inverseBase = 1.0f / (float)base;
+		float scale = inverseBase;
+		float value = 0.0f;
+		while (index > 0)
+		{
+			value += (float)(index % base) * scale;
+			index /= base;
+			scale *= inverseBase;
+		}
+		return(value);
+	}
+
+	/***********************************************************
+	 *  HashPixel()
+	 *
+	 *  Scramble a pixel position into 32 well mixed bits.
+	 ***********************************************************/
+	uint32_t HashPixel(uint32_t x, uint32_t y)
+	{
+		uint32_t hash = x * 0x8DA6B343u ^ y * 0xD8163841u;
+		hash ^= hash >> 16;
+		hash *= 0x7FEB352Du;
+		hash ^= hash >> 15;
+		hash *= 0x846CA68Bu;
+		hash ^= hash >> 16;
+		return(hash);
+	}
+
+	float SurfaceArea(const glm::vec3& minimum, const glm::vec3& maximum)
+	{
+		glm::vec3 extent = glm::max(maximum - minimum, glm::vec3(0.0f));
+		return(2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x));
+	}
+}
+
+/***********************************************************
+ *  RayTracer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RayTracer::RayTracer(int threadCount)
+{
+	m_pThreadPool = NULL;
+	m_threadCount = 0;
+	SetThreadCount(threadCount);
+
+	m_bAvx2 = CpuFeatures::HasAvx2();
+	m_pTraceClosest = m_bAvx2 ? RayTracerAvx2::TraceClosest : RayTracerScalar::TraceClosest;
+	m_pTraceOccluded = m_bAvx2 ? RayTracerAvx2::TraceOccluded : RayTracerScalar::TraceOccluded;
+
+	m_clearColor = glm::vec3(0.0f);
+	m_bUseLighting = false;
+	m_width = 0;
+	m_height = 0;
+	m_inverseViewProjection = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_sampleCount = 0;
+}
+
+/***********************************************************
+ *  ~RayTracer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RayTracer::~RayTracer()
+{
+	if (NULL != m_pThreadPool)
+	{
+		delete m_pThreadPool;
+		m_pThreadPool = NULL;
+	}
+}
+
+/***********************************************************
+ *  SetThreadCount()
+ ***********************************************************/
+void RayTracer::SetThreadCount(int threadCount)
+{
+	// the calling thread works alongside the pool
+	if (threadCount <= 0)
+	{
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	if ((NULL != m_pThreadPool) && (threadCount == m_threadCount))
+	{
+		return;
+	}
+
+	if (NULL != m_pThreadPool)
+	{
+		delete m_pThreadPool;
+	}
+	m_threadCount = threadCount;
+	m_pThreadPool = new ThreadPool(std::max(1, threadCount - 1));
+}
+
+/***********************************************************
+ *  LoadTextures()
+ ***********************************************************/
+bool RayTracer::LoadTextures()
+{
+	return(m_textures.Load());
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method turns the draw list into world space
+ *  primitives, decides which of them cast shadows for each
+ *  light, and builds the BVH over them.
+ ***********************************************************/
+void RayTracer::BuildScene(const DRAW_LIST& drawList)
+{
+	m_commands = drawList.commands;
+	m_clearColor = glm::vec3(drawList.clearColor.r, drawList.clearColor.g, drawList.clearColor.b);
+	m_bUseLighting = drawList.bUseLighting;
+
+	// the lights the shader would skip are dropped here
+	m_lights.clear();
+	if (drawList.lights.directional.bActive)
+	{
+		SHADING_LIGHT light;
+		light.bDirectional = true;
+		light.vector = glm::normalize(-drawList.lights.directional.position);
+		light.ambient = drawList.lights.directional.ambient;
+		light.diffuse = drawList.lights.directional.diffuse;
+		light.specular = drawList.lights.directional.specular;
+		light.shadowBit = 1u << m_lights.size();
+		m_lights.push_back(light);
+	}
+	for (int i = 0; i < DRAW_POINT_LIGHTS; i++)
+	{
+		const DRAW_LIGHT& pointLight = drawList.lights.pointLights[i];
+		if (pointLight.bActive)
+		{
+			SHADING_LIGHT light;
+			light.bDirectional = false;
+			light.vector = pointLight.position;
+			light.ambient = pointLight.ambient;
+			light.diffuse = pointLight.diffuse;
+			light.specular = pointLight.specular;
+			light.shadowBit = 1u << m_lights.size();
+			m_lights.push_back(light);
+		}
+	}
+
+	m_triangles.clear();
+	m_spheres.clear();
+	m_primitives.clear();
+	std::vector<BOUNDS> primitiveBounds;
+	std::vector<glm::vec3> centroids;
+
+	for (size_t commandIndex = 0; commandIndex < m_commands.size(); commandIndex++)
+	{
+		const DRAW_COMMAND& command = m_commands[commandIndex];
+		size_t firstPrimitive = m_primitives.size();
+		BOUNDS commandBounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+
+		if (DRAW_MESH_SPHERE == command.mesh)
+		{
+			// the box around the unit sphere, moved to world space
+			BOUNDS bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+			for (int corner = 0; corner < 8; corner++)
+			{
+				glm::vec4 point = command.model * glm::vec4(
+					(corner & 1) ? 1.0f : -1.0f,
+					(corner & 2) ? 1.0f : -1.0f,
+					(corner & 4) ? 1.0f : -1.0f,
+					1.0f);
+				bounds.minimum = glm::min(bounds.minimum, glm::vec3(point));
+				bounds.maximum = glm::max(bounds.maximum, glm::vec3(point));
+			}
+
+			SPHERE sphere;
+			sphere.inverseModel = glm::inverse(command.model);
+			sphere.uvScale = command.uvScale;
+
+			PRIMITIVE primitive;
+			primitive.type = RAY_PRIMITIVE_SPHERE;
+			primitive.dataIndex = (int)m_spheres.size();
+			primitive.commandIndex = (int)commandIndex;
+			primitive.shadowMask = 0;
+			m_spheres.push_back(sphere);
+			m_primitives.push_back(primitive);
+			primitiveBounds.push_back(bounds);
+			centroids.push_back((bounds.minimum + bounds.maximum) * 0.5f);
+			commandBounds = bounds;
+		}
+		else
+		{
+			const CPU_MESH& mesh = m_meshes.GetMesh(command.mesh);
+			std::vector<glm::vec3> positions(mesh.vertices.size());
+			for (size_t i = 0; i < mesh.vertices.size(); i++)
+			{
+				positions[i] = glm::vec3(command.model * glm::vec4(mesh.vertices[i].position, 1.0f));
+			}
+
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+			{
+				const CPU_VERTEX* vertices[3] = {
+					&mesh.vertices[mesh.indices[i]],
+					&mesh.vertices[mesh.indices[i + 1]],
+					&mesh.vertices[mesh.indices[i + 2]] };
+				glm::vec3 p0 = positions[mesh.indices[i]];
+				glm::vec3 p1 = positions[mesh.indices[i + 1]];
+				glm::vec3 p2 = positions[mesh.indices[i + 2]];
+
+				TRIANGLE triangle;
+				triangle.vertex0 = p0;
+				triangle.edge1 = p1 - p0;
+				triangle.edge2 = p2 - p0;
+				if (glm::length(glm::cross(triangle.edge1, triangle.edge2)) <= 0.0f)
+				{
+					continue;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					triangle.normals[k] = vertices[k]->normal;
+					triangle.textureCoordinates[k] = vertices[k]->textureCoordinate * command.uvScale;
+				}
+
+				BOUNDS bounds;
+				bounds.minimum = glm::min(p0, glm::min(p1, p2));
+				bounds.maximum = glm::max(p0, glm::max(p1, p2));
+
+				PRIMITIVE primitive;
+				primitive.type = RAY_PRIMITIVE_TRIANGLE;
+				primitive.dataIndex = (int)m_triangles.size();
+				primitive.commandIndex = (int)commandIndex;
+				primitive.shadowMask = 0;
+				m_triangles.push_back(triangle);
+				m_primitives.push_back(primitive);
+				primitiveBounds.push_back(bounds);
+				centroids.push_back((bounds.minimum + bounds.maximum) * 0.5f);
+				commandBounds.minimum = glm::min(commandBounds.minimum, bounds.minimum);
+				commandBounds.maximum = glm::max(commandBounds.maximum, bounds.maximum);
+			}
+		}
+
+		// translucent draws cast no shadows, and neither does geometry
+		// around a point light, like the flame around the candle light
+		uint32_t shadowMask = 0;
+		if (!command.bBlend)
+		{
+			for (const SHADING_LIGHT& light : m_lights)
+			{
+				bool bEnclosesLight = !light.bDirectional &&
+					glm::all(glm::greaterThanEqual(light.vector, commandBounds.minimum)) &&
+					glm::all(glm::lessThanEqual(light.vector, commandBounds.maximum));
+				if (!bEnclosesLight)
+				{
+					shadowMask |= light.shadowBit;
+				}
+			}
+		}
+		for (size_t i = firstPrimitive; i < m_primitives.size(); i++)
+		{
+			m_primitives[i].shadowMask = shadowMask;
+		}
+	}
+
+	// build the tree over an index order, then put the primitives in it
+	m_nodes.clear();
+	if (!m_primitives.empty())
+	{
+		std::vector<int> order(m_primitives.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = (int)i;
+		}
+		m_nodes.reserve(2 * m_primitives.size());
+		m_nodes.push_back(NODE());
+		BuildNode(primitiveBounds, centroids, order, 0, 0, (int)order.size(), 0);
+
+		std::vector<PRIMITIVE> ordered(m_primitives.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			ordered[i] = m_primitives[order[i]];
+		}
+		m_primitives.swap(ordered);
+	}
+
+	m_sampleCount = 0;
+	std::fill(m_accumulation.begin(), m_accumulation.end(), 0.0f);
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method fills in a node for a range of the primitive
+ *  order, splitting it where the surface area heuristic
+ *  over binned centroids is lowest, unless a leaf is
+ *  cheaper. Returns the depth of the subtree.
+ ***********************************************************/
+int RayTracer::BuildNode(
+	const std::vector<BOUNDS>& primitiveBounds,
+	const std::vector<glm::vec3>& centroids,
+	std::vector<int>& order,
+	int nodeIndex,
+	int first,
+	int count,
+	int depth)
+{
+	BOUNDS bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	BOUNDS centroidBounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	for (int i = first; i < first + count; i++)
+	{
+		bounds.minimum = glm::min(bounds.minimum, primitiveBounds[order[i]].minimum);
+		bounds.maximum = glm::max(bounds.maximum, primitiveBounds[order[i]].maximum);
+		centroidBounds.minimum = glm::min(centroidBounds.minimum, centroids[order[i]]);
+		centroidBounds.maximum = glm::max(centroidBounds.maximum, centroids[order[i]]);
+	}
+	m_nodes[nodeIndex].bounds = bounds;
+	m_nodes[nodeIndex].firstIndex = first;
+	m_nodes[nodeIndex].primitiveCount = (int16_t)count;
+	m_nodes[nodeIndex].axis = 0;
+
+	if ((count <= 2) || (depth >= RAY_MAX_TREE_DEPTH))
+	{
+		return(depth);
+	}
+
+	// bin the centroids along each axis and sweep for the cheapest split
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidBounds.maximum[axis] - centroidBounds.minimum[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		int binCounts[SAH_BINS] = {};
+		BOUNDS binBounds[SAH_BINS];
+		for (int bin = 0; bin < SAH_BINS; bin++)
+		{
+			binBounds[bin].minimum = glm::vec3(FLT_MAX);
+			binBounds[bin].maximum = glm::vec3(-FLT_MAX);
+		}
+		float binScale = (float)SAH_BINS / extent;
+		for (int i = first; i < first + count; i++)
+		{
+			int bin = std::min(SAH_BINS - 1, (int)((centroids[order[i]][axis] - centroidBounds.minimum[axis]) * binScale));
+			binCounts[bin]++;
+			binBounds[bin].minimum = glm::min(binBounds[bin].minimum, primitiveBounds[order[i]].minimum);
+			binBounds[bin].maximum = glm::max(binBounds[bin].maximum, primitiveBounds[order[i]].maximum);
+		}
+
+		// right side areas and counts, swept from the end
+		float rightAreas[SAH_BINS];
+		int rightCounts[SAH_BINS];
+		BOUNDS sweep = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		int sweepCount = 0;
+		for (int bin = SAH_BINS - 1; bin > 0; bin--)
+		{
+			sweep.minimum = glm::min(sweep.minimum, binBounds[bin].minimum);
+			sweep.maximum = glm::max(sweep.maximum, binBounds[bin].maximum);
+			sweepCount += binCounts[bin];
+			rightAreas[bin] = SurfaceArea(sweep.minimum, sweep.maximum);
+			rightCounts[bin] = sweepCount;
+		}
+
+		sweep.minimum = glm::vec3(FLT_MAX);
+		sweep.maximum = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int split = 1; split < SAH_BINS; split++)
+		{
+			sweep.minimum = glm::min(sweep.minimum, binBounds[split - 1].minimum);
+			sweep.maximum = glm::max(sweep.maximum, binBounds[split - 1].maximum);
+			sweepCount += binCounts[split - 1];
+			if ((sweepCount == 0) || (rightCounts[split] == 0))
+			{
+				continue;
+			}
+			float cost = SurfaceArea(sweep.minimum, sweep.maximum) * (float)sweepCount +
+				rightAreas[split] * (float)rightCounts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// a traversal step costs about one intersection
+	float nodeArea = SurfaceArea(bounds.minimum, bounds.maximum);
+	float leafCost = nodeArea * (float)count;
+	float splitCost = nodeArea + bestCost;
+	int middle = first + count / 2;
+	if (bestAxis >= 0)
+	{
+		if ((splitCost >= leafCost) && (count <= 8))
+		{
+			return(depth);
+		}
+
+		float binScale = (float)SAH_BINS / (centroidBounds.maximum[bestAxis] - centroidBounds.minimum[bestAxis]);
+		float minimum = centroidBounds.minimum[bestAxis];
+		middle = (int)(std::partition(order.begin() + first, order.begin() + first + count,
+			[&](int index)
+			{
+				int bin = std::min(SAH_BINS - 1, (int)((centroids[index][bestAxis] - minimum) * binScale));
+				return(bin < bestSplit);
+			}) - order.begin());
+	}
+	else if (count <= 8)
+	{
+		// every centroid in one spot - nothing to split on
+		return(depth);
+	}
+
+	int leftIndex = (int)m_nodes.size();
+	m_nodes.push_back(NODE());
+	m_nodes.push_back(NODE());
+	m_nodes[nodeIndex].firstIndex = leftIndex;
+	m_nodes[nodeIndex].primitiveCount = 0;
+	m_nodes[nodeIndex].axis = (int16_t)std::max(0, bestAxis);
+
+	int leftDepth = BuildNode(primitiveBounds, centroids, order, leftIndex, first, middle - first, depth + 1);
+	int rightDepth = BuildNode(primitiveBounds, centroids, order, leftIndex + 1, middle, first + count - middle, depth + 1);
+	return(std::max(leftDepth, rightDepth));
+}
+
+/***********************************************************
+ *  SetCamera()
+ ***********************************************************/
+void RayTracer::SetCamera(
+	int width,
+	int height,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	m_width = width;
+	m_height = height;
+	m_inverseViewProjection = glm::inverse(projection * view);
+	m_viewPosition = viewPosition;
+
+	m_accumulation.assign((size_t)width * height * 3, 0.0f);
+	m_sampleCount = 0;
+}
+
+/***********************************************************
+ *  RenderPass()
+ *
+ *  This method traces one sample for every pixel, a tile of
+ *  the image per task, and adds it to the accumulation.
+ ***********************************************************/
+void RayTracer::RenderPass()
+{
+	if ((m_width <= 0) || (m_height <= 0))
+	{
+		return;
+	}
+
+	int tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+	RunParallel(tilesX * tilesY, [&](int tileIndex)
+		{
+			int tileX = (tileIndex % tilesX) * TILE_SIZE;
+			int tileY = (tileIndex / tilesX) * TILE_SIZE;
+			int tileMaxX = std::min(tileX + TILE_SIZE, m_width);
+			int tileMaxY = std::min(tileY + TILE_SIZE, m_height);
+
+			for (int y = tileY; y < tileMaxY; y += PACKET_HEIGHT)
+			{
+				for (int x = tileX; x < tileMaxX; x += PACKET_WIDTH)
+				{
+					float colors[PACKET_WIDTH * PACKET_HEIGHT * 3];
+					TraceBlock(x / PACKET_WIDTH, y / PACKET_HEIGHT, colors);
+
+					for (int lane = 0; lane < PACKET_WIDTH * PACKET_HEIGHT; lane++)
+					{
+						int pixelX = x + (lane % PACKET_WIDTH);
+						int pixelY = y + (lane / PACKET_WIDTH);
+						if ((pixelX < tileMaxX) && (pixelY < tileMaxY))
+						{
+							float* pPixel = &m_accumulation[((size_t)pixelY * m_width + pixelX) * 3];
+							pPixel[0] += colors[lane * 3 + 0];
+							pPixel[1] += colors[lane * 3 + 1];
+							pPixel[2] += colors[lane * 3 + 2];
+						}
+					}
+				}
+			}
+		});
+
+	m_sampleCount++;
+}
+
+/***********************************************************
+ *  ReadPixels()
+ ***********************************************************/
+void RayTracer::ReadPixels(std::vector<unsigned char>& pixels) const
+{
+	pixels.resize((size_t)m_width * m_height * 3);
+	float scale = 255.0f / (float)std::max(1, m_sampleCount);
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		float value = m_accumulation[i] * scale + 0.5f;
+		pixels[i] = (unsigned char)std::min(255.0f, std::max(0.0f, value));
+	}
+}
+
+/***********************************************************
+ *  TraceBlock()
+ *
+ *  This method traces and shades one jittered sample for
+ *  each pixel of a 4x2 block, writing RGB per lane.
+ ***********************************************************/
+void RayTracer::TraceBlock(int blockX, int blockY, float* pColors) const
+{
+	const int LANES = RAY_PACKET_LANES;
+
+	RAY_SCENE scene;
+	scene.pNodes = m_nodes.data();
+	scene.nodeCount = (int)m_nodes.size();
+	scene.pPrimitives = m_primitives.data();
+	scene.pTriangles = m_triangles.data();
+	scene.pSpheres = m_spheres.data();
+
+	// the first pass samples pixel centers, the later ones follow a
+	// Halton sequence rotated per pixel
+	float jitterX = 0.5f;
+	float jitterY = 0.5f;
+	if (m_sampleCount > 0)
+	{
+		jitterX = RadicalInverse((uint32_t)m_sampleCount, 2);
+		jitterY = RadicalInverse((uint32_t)m_sampleCount, 3);
+	}
+
+	RAY_PACKET_INPUT packet;
+	int activeBits = 0;
+	for (int lane = 0; lane < LANES; lane++)
+	{
+		int pixelX = blockX * PACKET_WIDTH + (lane % PACKET_WIDTH);
+		int pixelY = blockY * PACKET_HEIGHT + (lane / PACKET_WIDTH);
+		float offsetX = jitterX;
+		float offsetY = jitterY;
+		if (m_sampleCount > 0)
+		{
+			uint32_t hash = HashPixel((uint32_t)pixelX, (uint32_t)pixelY);
+			offsetX += (float)(hash & 0xFFFF) * (1.0f / 65536.0f);
+			offsetY += (float)(hash >> 16) * (1.0f / 65536.0f);
+			offsetX -= std::floor(offsetX);
+			offsetY -= std::floor(offsetY);
+		}
+
+		float ndcX = 2.0f * ((float)pixelX + offsetX) / (float)m_width - 1.0f;
+		float ndcY = 2.0f * ((float)pixelY + offsetY) / (float)m_height - 1.0f;
+		glm::vec4 nearPoint = m_inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+		glm::vec4 farPoint = m_inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+		glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+		glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			packet.origin[axis][lane] = origin[axis];
+			packet.direction[axis][lane] = direction[axis];
+		}
+		if ((pixelX < m_width) && (pixelY < m_height))
+		{
+			activeBits |= 1 << lane;
+		}
+	}
+
+	glm::vec3 colors[LANES];
+	float transmittance[LANES];
+	for (int lane = 0; lane < LANES; lane++)
+	{
+		colors[lane] = glm::vec3(0.0f);
+		transmittance[lane] = 1.0f;
+		packet.tMin[lane] = 0.0f;
+		packet.tMax[lane] = FLT_MAX;
+	}
+
+	for (int layer = 0; (layer < MAX_LAYERS) && (activeBits != 0); layer++)
+	{
+		packet.activeBits = activeBits;
+
+		RAY_PACKET_HITS hits;
+		m_pTraceClosest(scene, packet, hits);
+		const float* hitT = hits.t;
+		const float* hitU = hits.u;
+		const float* hitV = hits.v;
+		const int32_t* hitPrimitive = hits.primitive;
+
+		// surface attributes of every hit
+		glm::vec3 positions[LANES];
+		glm::vec3 normals[LANES];
+		glm::vec4 baseColors[LANES];
+		const DRAW_COMMAND* pCommands[LANES] = {};
+		int hitBits = 0;
+		for (int lane = 0; lane < LANES; lane++)
+		{
+			if (!(activeBits & (1 << lane)))
+			{
+				continue;
+			}
+			if (hitPrimitive[lane] < 0)
+			{
+				colors[lane] += transmittance[lane] * m_clearColor;
+				activeBits &= ~(1 << lane);
+				continue;
+			}
+
+			hitBits |= 1 << lane;
+			const PRIMITIVE& primitive = m_primitives[hitPrimitive[lane]];
+			const DRAW_COMMAND& command = m_commands[primitive.commandIndex];
+			glm::vec3 origin(packet.origin[0][lane], packet.origin[1][lane], packet.origin[2][lane]);
+			glm::vec3 direction(packet.direction[0][lane], packet.direction[1][lane], packet.direction[2][lane]);
+			positions[lane] = origin + direction * hitT[lane];
+			pCommands[lane] = &command;
+
+			glm::vec2 textureCoordinate;
+			if (RAY_PRIMITIVE_TRIANGLE == primitive.type)
+			{
+				const TRIANGLE& triangle = m_triangles[primitive.dataIndex];
+				float w = 1.0f - hitU[lane] - hitV[lane];
+				normals[lane] = triangle.normals[0] * w + triangle.normals[1] * hitU[lane] + triangle.normals[2] * hitV[lane];
+				textureCoordinate = triangle.textureCoordinates[0] * w +
+					triangle.textureCoordinates[1] * hitU[lane] +
+					triangle.textureCoordinates[2] * hitV[lane];
+			}
+			else
+			{
+				// the sphere mesh normal is its object space position
+				const SPHERE& sphere = m_spheres[primitive.dataIndex];
+				glm::vec3 objectPosition = glm::vec3(sphere.inverseModel * glm::vec4(positions[lane], 1.0f));
+				normals[lane] = objectPosition;
+				float u = std::atan2(objectPosition.z, objectPosition.x) * (0.5f / 3.14159265f);
+				float v = 1.0f - std::acos(std::max(-1.0f, std::min(1.0f, glm::normalize(objectPosition).y))) * (1.0f / 3.14159265f);
+				textureCoordinate = glm::vec2(u - std::floor(u), v) * sphere.uvScale;
+			}
+			normals[lane] = glm::normalize(normals[lane]);
+
+			if (command.bUseTexture)
+			{
+				const CPU_TEXTURE* pTexture = m_textures.Get(command.textureIndex);
+				baseColors[lane] = (NULL != pTexture) ?
+					CpuTextures::Sample(*pTexture, textureCoordinate) :
+					glm::vec4(1.0f);
+			}
+			else
+			{
+				baseColors[lane] = command.color;
+			}
+		}
+		if (hitBits == 0)
+		{
+			break;
+		}
+
+		// one shadow packet per light
+		int visibleBits[32] = {};
+		if (m_bUseLighting)
+		{
+			RAY_PACKET_INPUT shadowPacket;
+			shadowPacket.activeBits = hitBits;
+			for (size_t lightIndex = 0; lightIndex < m_lights.size(); lightIndex++)
+			{
+				const SHADING_LIGHT& light = m_lights[lightIndex];
+				for (int lane = 0; lane < LANES; lane++)
+				{
+					glm::vec3 origin = (hitBits & (1 << lane)) ? positions[lane] : glm::vec3(0.0f);
+					glm::vec3 toLight = light.bDirectional ? light.vector : light.vector - origin;
+					float length = light.bDirectional ? FLT_MAX : glm::length(toLight);
+					glm::vec3 direction = (length > 0.0f) ? toLight / (light.bDirectional ? 1.0f : length) : glm::vec3(0.0f, 1.0f, 0.0f);
+					for (int axis = 0; axis < 3; axis++)
+					{
+						shadowPacket.origin[axis][lane] = origin[axis];
+						shadowPacket.direction[axis][lane] = direction[axis];
+					}
+					shadowPacket.tMin[lane] = RAY_EPSILON;
+					shadowPacket.tMax[lane] = length - RAY_EPSILON;
+				}
+
+				visibleBits[lightIndex] = hitBits & ~m_pTraceOccluded(scene, shadowPacket, light.shadowBit);
+			}
+		}
+
+		// shade as fragmentShader.glsl does, then composite
+		for (int lane = 0; lane < LANES; lane++)
+		{
+			if (!(hitBits & (1 << lane)))
+			{
+				continue;
+			}
+
+			const DRAW_COMMAND& command = *pCommands[lane];
+			glm::vec3 base = glm::vec3(baseColors[lane]);
+			glm::vec3 shaded = base;
+			if (m_bUseLighting)
+			{
+				glm::vec3 viewDirection = glm::normalize(m_viewPosition - positions[lane]);
+				shaded = glm::vec3(0.0f);
+				for (size_t lightIndex = 0; lightIndex < m_lights.size(); lightIndex++)
+				{
+					const SHADING_LIGHT& light = m_lights[lightIndex];
+					shaded += light.ambient * base;
+					if (!(visibleBits[lightIndex] & (1 << lane)))
+					{
+						continue;
+					}
+
+					glm::vec3 lightDirection = light.bDirectional ?
+						light.vector :
+						glm::normalize(light.vector - positions[lane]);
+					float normalDotLight = glm::dot(normals[lane], lightDirection);
+					glm::vec3 reflection = 2.0f * normalDotLight * normals[lane] - lightDirection;
+					float specular = std::pow(std::max(glm::dot(viewDirection, reflection), 0.0f), command.material.shininess);
+
+					shaded += light.diffuse * command.material.diffuseColor * std::max(normalDotLight, 0.0f) * base;
+					// point lights leave the base color out of the specular
+					// term, as the shader does
+					glm::vec3 specularTerm = light.specular * command.material.specularColor * specular;
+					shaded += light.bDirectional ? specularTerm * base : specularTerm;
+				}
+			}
+			shaded = glm::clamp(shaded, glm::vec3(0.0f), glm::vec3(1.0f));
+
+			float alpha = command.bBlend ? std::min(1.0f, std::max(0.0f, baseColors[lane].a)) : 1.0f;
+			colors[lane] += transmittance[lane] * alpha * shaded;
+			transmittance[lane] *= 1.0f - alpha;
+
+			// keep going through translucent surfaces
+			if (transmittance[lane] > (1.0f / 512.0f))
+			{
+				packet.tMin[lane] = hitT[lane] + RAY_EPSILON;
+			}
+			else
+			{
+				activeBits &= ~(1 << lane);
+			}
+		}
+
+	}
+
+	// rays still passing through layers see the background
+	for (int lane = 0; lane < LANES; lane++)
+	{
+		if (activeBits & (1 << lane))
+		{
+			colors[lane] += transmittance[lane] * m_clearColor;
+		}
+		pColors[lane * 3 + 0] = colors[lane].x;
+		pColors[lane * 3 + 1] = colors[lane].y;
+		pColors[lane * 3 + 2] = colors[lane].z;
+	}
+}
+
+/***********************************************************
+ *  RunParallel()
+ ***********************************************************/
+void RayTracer::RunParallel(int taskCount, const std::function<void(int)>& task)
+{
+	std::atomic<int> nextTask(0);
+	auto worker = [&]()
+		{
+			int taskIndex;
+			while ((taskIndex = nextTask++) < taskCount)
+			{
+				task(taskIndex);
+			}
+		};
+
+	int workerCount = std::min(taskCount, m_threadCount) - 1;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_pThreadPool->Submit(worker);
+	}
+	worker();
+	m_pThreadPool->WaitIdle();
+}
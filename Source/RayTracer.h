@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracer.h
+// ============
+// trace the scene's draw list on the CPU for offline stills - a SAH BVH
+// over the scene primitives, packets of eight rays, shadows from every
+// scene light, and progressive antialiasing across all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "DrawList.h"
+#include "CpuMeshes.h"
+#include "CpuTextures.h"
+#include "ThreadPool.h"
+#include "RayTracerKernels.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class RayTracer
+{
+public:
+	// constructor - a thread count of zero uses every hardware thread
+	RayTracer(int threadCount);
+	// destructor
+	~RayTracer();
+
+	// change the number of threads the passes run on
+	void SetThreadCount(int threadCount);
+
+	// load the scene textures
+	bool LoadTextures();
+
+	// build the primitives and BVH for a frame's draw list
+	void BuildScene(const DRAW_LIST& drawList);
+
+	// set the image size and camera, and start accumulating again
+	void SetCamera(
+		int width,
+		int height,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+
+	// trace one more sample for every pixel
+	void RenderPass();
+
+	// copy the average of the samples so far into 8-bit RGB pixels,
+	// bottom row first
+	void ReadPixels(std::vector<unsigned char>& pixels) const;
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	int GetThreadCount() const { return(m_threadCount); }
+	int GetSampleCount() const { return(m_sampleCount); }
+	int GetPrimitiveCount() const { return((int)m_primitives.size()); }
+	int GetNodeCount() const { return((int)m_nodes.size()); }
+	// whether the packets are traced with the AVX2 kernels
+	bool UsesAvx2() const { return(m_bAvx2); }
+
+private:
+	// the scene, laid out as the kernels read it
+	typedef RAY_PRIMITIVE PRIMITIVE;
+	typedef RAY_TRIANGLE TRIANGLE;
+	typedef RAY_SPHERE SPHERE;
+	typedef RAY_BOUNDS BOUNDS;
+	typedef RAY_NODE NODE;
+
+	// an active light, ready for shading
+	struct SHADING_LIGHT
+	{
+		bool bDirectional;
+		// position, or the direction toward a directional light
+		glm::vec3 vector;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		// bit tested against PRIMITIVE::shadowMask
+		uint32_t shadowBit;
+	};
+
+	ThreadPool* m_pThreadPool;
+	// pool threads used, plus the calling thread
+	int m_threadCount;
+	CpuMeshes m_meshes;
+	CpuTextures m_textures;
+	// the packet traversal, AVX2 when the CPU has it
+	bool m_bAvx2;
+	RAY_TRACE_CLOSEST m_pTraceClosest;
+	RAY_TRACE_OCCLUDED m_pTraceOccluded;
+
+	// the scene
+	std::vector<DRAW_COMMAND> m_commands;
+	std::vector<TRIANGLE> m_triangles;
+	std::vector<SPHERE> m_spheres;
+	std::vector<PRIMITIVE> m_primitives;
+	std::vector<NODE> m_nodes;
+	std::vector<SHADING_LIGHT> m_lights;
+	glm::vec3 m_clearColor;
+	bool m_bUseLighting;
+
+	// the camera and the accumulated samples
+	int m_width;
+	int m_height;
+	glm::mat4 m_inverseViewProjection;
+	glm::vec3 m_viewPosition;
+	std::vector<float> m_accumulation;
+	int m_sampleCount;
+
+	int BuildNode(
+		const std::vector<BOUNDS>& primitiveBounds,
+		const std::vector<glm::vec3>& centroids,
+		std::vector<int>& order,
+		int nodeIndex,
+		int first,
+		int count,
+		int depth);
+	void TraceBlock(int blockX, int blockY, float* pColors) const;
+
+	// run task(0) .. task(taskCount - 1) across the pool and this thread
+	void RunParallel(int taskCount, const std::function<void(int)>& task);
+};
@@ -0,0 +1,12 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytraceravx2.cpp
+// ============
+// the ray tracer kernels built for AVX2 and FMA
+//
+// NOTE: this is the only ray tracer file built with AVX2 enabled
+// (/arch:AVX2, -mavx2 -mfma). The ray tracer calls into it only after
+// CpuFeatures::HasAvx2() has confirmed the CPU and OS support it.
+///////////////////////////////////////////////////////////////////////////////
+
+#define RAY_KERNEL_NAMESPACE RayTracerAvx2
+#include "RayTracerKernels.inl"
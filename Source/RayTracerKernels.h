@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracerkernels.h
+// ============
+// the packet traversal of the ray tracer, built once for AVX2 and once for
+// any x86 CPU
+//
+// the kernels read the scene through the structures below. They only read
+// the members of the glm types and never call into glm or the standard
+// library, so nothing built with AVX2 enabled is shared with the rest of
+// the program.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// rays in a packet
+const int RAY_PACKET_LANES = 8;
+// deepest the BVH is allowed to grow, within the traversal stack
+const int RAY_MAX_TREE_DEPTH = 60;
+
+enum RAY_PRIMITIVE_TYPE
+{
+	RAY_PRIMITIVE_TRIANGLE,
+	RAY_PRIMITIVE_SPHERE
+};
+
+// an entry of the BVH leaves
+struct RAY_PRIMITIVE
+{
+	RAY_PRIMITIVE_TYPE type;
+	// index into the triangles or the spheres
+	int dataIndex;
+	int commandIndex;
+	// bit per light the primitive casts a shadow for
+	uint32_t shadowMask;
+};
+
+// a world space triangle, with the untransformed normals and scaled
+// texture coordinates the scene shaders interpolate
+struct RAY_TRIANGLE
+{
+	glm::vec3 vertex0;
+	glm::vec3 edge1;
+	glm::vec3 edge2;
+	glm::vec3 normals[3];
+	glm::vec2 textureCoordinates[3];
+};
+
+// the unit sphere mesh under a model transform, intersected exactly
+struct RAY_SPHERE
+{
+	// world to object space
+	glm::mat4 inverseModel;
+	glm::vec2 uvScale;
+};
+
+// an axis aligned bounding box
+struct RAY_BOUNDS
+{
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+};
+
+// a node of the flattened BVH. Children of an inner node are stored
+// next to each other.
+struct RAY_NODE
+{
+	RAY_BOUNDS bounds;
+	// first primitive of a leaf, or the left child of an inner node
+	int32_t firstIndex;
+	// primitives in a leaf, zero for an inner node
+	int16_t primitiveCount;
+	// split axis of an inner node
+	int16_t axis;
+};
+
+// the BVH and what its leaves point at
+struct RAY_SCENE
+{
+	const RAY_NODE* pNodes;
+	int nodeCount;
+	const RAY_PRIMITIVE* pPrimitives;
+	const RAY_TRIANGLE* pTriangles;
+	const RAY_SPHERE* pSpheres;
+};
+
+// a packet of rays, one value per lane
+struct RAY_PACKET_INPUT
+{
+	float origin[3][RAY_PACKET_LANES];
+	float direction[3][RAY_PACKET_LANES];
+	float tMin[RAY_PACKET_LANES];
+	float tMax[RAY_PACKET_LANES];
+	// bit per lane that is traced
+	int activeBits;
+};
+
+// the closest hit of each ray of a packet
+struct RAY_PACKET_HITS
+{
+	float t[RAY_PACKET_LANES];
+	float u[RAY_PACKET_LANES];
+	float v[RAY_PACKET_LANES];
+	// index into the primitives, or -1 for a miss
+	int32_t primitive[RAY_PACKET_LANES];
+};
+
+// find the closest hit of each active ray
+typedef void (*RAY_TRACE_CLOSEST)(const RAY_SCENE& scene, const RAY_PACKET_INPUT& packet, RAY_PACKET_HITS& hits);
+// find the active rays blocked by a shadow caster for the light,
+// returned as lane bits
+typedef int (*RAY_TRACE_OCCLUDED)(const RAY_SCENE& scene, const RAY_PACKET_INPUT& packet, uint32_t shadowBit);
+
+namespace RayTracerAvx2
+{
+	// only call when CpuFeatures::HasAvx2() is true
+	void TraceClosest(const RAY_SCENE& scene, const RAY_PACKET_INPUT& packet, RAY_PACKET_HITS& hits);
+	int TraceOccluded(const RAY_SCENE& scene, const RAY_PACKET_INPUT& packet, uint32_t shadowBit);
+}
+
+namespace RayTracerScalar
+{
+	void TraceClosest(const RAY_SCENE& scene, const RAY_PACKET_INPUT& packet, RAY_PACKET_HITS& hits);
+	int TraceOccluded(const RAY_SCENE& scene, const RAY_PACKET_INPUT& packet, uint32_t shadowBit);
+}
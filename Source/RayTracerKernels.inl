@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracerkernels.inl
+// ============
+// body of the ray tracer kernels, included by RayTracerAvx2.cpp and
+// RayTracerScalar.cpp
+//
+// NOTE: the including file names the namespace of the entry points in
+// RAY_KERNEL_NAMESPACE. Everything else here has internal linkage, and only
+// Simd8.h is called into, so no inline function built for one instruction
+// set can be picked by the linker for a caller built for the other. The
+// packet walks the tree together, with every triangle or sphere tested
+// against all eight rays at once.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RayTracerKernels.h"
+#include "Simd8.h"
+
+using namespace SIMD8_NAMESPACE;
+
+namespace
+{
+	// three Float8 lanes of vectors
+	struct VEC3X8
+	{
+		Float8 x;
+		Float8 y;
+		Float8 z;
+	};
+
+	// eight rays traced together
+	struct RAY_PACKET
+	{
+		VEC3X8 origin;
+		VEC3X8 direction;
+		VEC3X8 inverseDirection;
+		Float8 tMin;
+		Float8 tMax;
+		Mask8 active;
+	};
+
+	inline Float8 Dot(const VEC3X8& a, const VEC3X8& b)
+	{
+		return(MultiplyAdd(a.x, b.x, MultiplyAdd(a.y, b.y, a.z * b.z)));
+	}
+
+	inline VEC3X8 Cross(const VEC3X8& a, const VEC3X8& b)
+	{
+		return(VEC3X8{
+			a.y * b.z - a.z * b.y,
+			a.z * b.x - a.x * b.z,
+			a.x * b.y - a.y * b.x });
+	}
+
+	inline VEC3X8 Broadcast(const glm::vec3& a)
+	{
+		return(VEC3X8{ Float8(a.x), Float8(a.y), Float8(a.z) });
+	}
+
+	/***********************************************************
+	 *  InverseDirection()
+	 *
+	 *  1 / d for the slab test, keeping zero components from
+	 *  producing NaNs.
+	 ***********************************************************/
+	inline Float8 InverseDirection(Float8 direction)
+	{
+		Float8 tiny(1.0e-20f);
+		Mask8 bNearZero = (direction < tiny) & (direction > -tiny);
+		return(Float8(1.0f) / Select(bNearZero, tiny, direction));
+	}
+
+	/***********************************************************
+	 *  LoadPacket()
+	 ***********************************************************/
+	RAY_PACKET LoadPacket(const RAY_PACKET_INPUT& input)
+	{
+		alignas(32) int32_t laneBits[RAY_PACKET_LANES];
+		for (int lane = 0; lane < RAY_PACKET_LANES; lane++)
+		{
+			laneBits[lane] = (input.activeBits & (1 << lane)) ? -1 : 0;
+		}
+
+		RAY_PACKET packet;
+		packet.origin = VEC3X8{ Float8::Load(input.origin[0]), Float8::Load(input.origin[1]), Float8::Load(input.origin[2]) };
+		packet.direction = VEC3X8{ Float8::Load(input.direction[0]), Float8::Load(input.direction[1]), Float8::Load(input.direction[2]) };
+		packet.inverseDirection = VEC3X8{
+			InverseDirection(packet.direction.x),
+			InverseDirection(packet.direction.y),
+			InverseDirection(packet.direction.z) };
+		packet.tMin = Float8::Load(input.tMin);
+		packet.tMax = Float8::Load(input.tMax);
+		packet.active = Int8::Load(laneBits) == Int8(-1);
+		return(packet);
+	}
+
+	/***********************************************************
+	 *  IntersectBounds()
+	 *
+	 *  Slab test of the packet against a box, limited to each
+	 *  ray's current interval.
+	 ***********************************************************/
+	inline Mask8 IntersectBounds(const glm::vec3& minimum, const glm::vec3& maximum, const RAY_PACKET& packet, Float8 tFar)
+	{
+		Float8 x0 = (Float8(minimum.x) - packet.origin.x) * packet.inverseDirection.x;
+		Float8 x1 = (Float8(maximum.x) - packet.origin.x) * packet.inverseDirection.x;
+		Float8 y0 = (Float8(minimum.y) - packet.origin.y) * packet.inverseDirection.y;
+		Float8 y1 = (Float8(maximum.y) - packet.origin.y) * packet.inverseDirection.y;
+		Float8 z0 = (Float8(minimum.z) - packet.origin.z) * packet.inverseDirection.z;
+		Float8 z1 = (Float8(maximum.z) - packet.origin.z) * packet.inverseDirection.z;
+		Float8 tEnter = Max(Max(Min(x0, x1), Min(y0, y1)), Max(Min(z0, z1), packet.tMin));
+		Float8 tExit = Min(Min(Max(x0, x1), Max(y0, y1)), Min(Max(z0, z1), tFar));
+		return(packet.active & (tEnter <= tExit));
+	}
+
+	/***********************************************************
+	 *  IntersectTriangle()
+	 *
+	 *  Moller-Trumbore test of the packet against a triangle,
+	 *  from either side. Returns the rays hitting it closer
+	 *  than tFar, with the distance and barycentrics.
+	 ***********************************************************/
+	inline Mask8 IntersectTriangle(
+		const RAY_TRIANGLE& triangle,
+		const RAY_PACKET& packet,
+		Float8 tFar,
+		Float8& t,
+		Float8& u,
+		Float8& v)
+	{
+		VEC3X8 e1 = Broadcast(triangle.edge1);
+		VEC3X8 e2 = Broadcast(triangle.edge2);
+		VEC3X8 p = Cross(packet.direction, e2);
+		Float8 determinant = Dot(e1, p);
+		Mask8 bValid = (determinant > Float8(1.0e-12f)) | (determinant < Float8(-1.0e-12f));
+		Float8 inverseDeterminant = Float8(1.0f) / determinant;
+
+		VEC3X8 s = {
+			packet.origin.x - Float8(triangle.vertex0.x),
+			packet.origin.y - Float8(triangle.vertex0.y),
+			packet.origin.z - Float8(triangle.vertex0.z) };
+		u = Dot(s, p) * inverseDeterminant;
+		VEC3X8 q = Cross(s, e1);
+		v = Dot(packet.direction, q) * inverseDeterminant;
+		t = Dot(e2, q) * inverseDeterminant;
+
+		Float8 zero(0.0f);
+		return(packet.active & bValid &
+			(u >= zero) & (v >= zero) & ((u + v) <= Float8(1.0f)) &
+			(t > packet.tMin) & (t < tFar));
+	}
+
+	/***********************************************************
+	 *  IntersectSphere()
+	 *
+	 *  Test of the packet against the unit sphere under the
+	 *  inverse of a model matrix. The ray parameter is the same
+	 *  in both spaces, so t needs no conversion back.
+	 ***********************************************************/
+	inline Mask8 IntersectSphere(const RAY_SPHERE& sphere, const RAY_PACKET& packet, Float8 tFar, Float8& t)
+	{
+		// the sixteen floats of the matrix, column by column
+		const float* m = reinterpret_cast<const float*>(&sphere.inverseModel);
+		VEC3X8 origin = {
+			MultiplyAdd(Float8(m[0]), packet.origin.x, MultiplyAdd(Float8(m[4]), packet.origin.y, MultiplyAdd(Float8(m[8]), packet.origin.z, Float8(m[12])))),
+			MultiplyAdd(Float8(m[1]), packet.origin.x, MultiplyAdd(Float8(m[5]), packet.origin.y, MultiplyAdd(Float8(m[9]), packet.origin.z, Float8(m[13])))),
+			MultiplyAdd(Float8(m[2]), packet.origin.x, MultiplyAdd(Float8(m[6]), packet.origin.y, MultiplyAdd(Float8(m[10]), packet.origin.z, Float8(m[14])))) };
+		VEC3X8 direction = {
+			MultiplyAdd(Float8(m[0]), packet.direction.x, MultiplyAdd(Float8(m[4]), packet.direction.y, Float8(m[8]) * packet.direction.z)),
+			MultiplyAdd(Float8(m[1]), packet.direction.x, MultiplyAdd(Float8(m[5]), packet.direction.y, Float8(m[9]) * packet.direction.z)),
+			MultiplyAdd(Float8(m[2]), packet.direction.x, MultiplyAdd(Float8(m[6]), packet.direction.y, Float8(m[10]) * packet.direction.z)) };
+
+		Float8 a = Dot(direction, direction);
+		Float8 b = Dot(origin, direction);
+		Float8 c = Dot(origin, origin) - Float8(1.0f);
+		Float8 discriminant = b * b - a * c;
+		Float8 root = Sqrt(Max(discriminant, Float8(0.0f)));
+		Float8 inverseA = Float8(1.0f) / a;
+		Float8 tNear = (-b - root) * inverseA;
+		Float8 tOther = (-b + root) * inverseA;
+		t = Select(tNear > packet.tMin, tNear, tOther);
+
+		return(packet.active & (discriminant >= Float8(0.0f)) & (t > packet.tMin) & (t < tFar));
+	}
+}
+
+namespace RAY_KERNEL_NAMESPACE
+{
+
+/***********************************************************
+ *  TraceClosest()
+ *
+ *  This function walks the BVH with the packet, front to
+ *  back along the direction of its first ray, and finds the
+ *  closest hit of each active ray.
+ ***********************************************************/
+void TraceClosest(const RAY_SCENE& scene, const RAY_PACKET_INPUT& input, RAY_PACKET_HITS& output)
+{
+	RAY_PACKET packet = LoadPacket(input);
+	Float8 hitT = packet.tMax;
+	Float8 hitU(0.0f);
+	Float8 hitV(0.0f);
+	Int8 hitPrimitive(-1);
+
+	int activeBits = packet.active.Bits();
+	if ((scene.nodeCount > 0) && (activeBits != 0))
+	{
+		int leadLane = 0;
+		while (!(activeBits & (1 << leadLane)))
+		{
+			leadLane++;
+		}
+		bool bNegative[3] = {
+			input.direction[0][leadLane] < 0.0f,
+			input.direction[1][leadLane] < 0.0f,
+			input.direction[2][leadLane] < 0.0f };
+
+		int stack[RAY_MAX_TREE_DEPTH * 2 + 2];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0)
+		{
+			const RAY_NODE& node = scene.pNodes[stack[--stackSize]];
+			if (!IntersectBounds(node.bounds.minimum, node.bounds.maximum, packet, hitT).Any())
+			{
+				continue;
+			}
+
+			if (node.primitiveCount == 0)
+			{
+				// push the far child first so the near one is popped next
+				int nearChild = node.firstIndex + (bNegative[node.axis] ? 1 : 0);
+				int farChild = node.firstIndex + (bNegative[node.axis] ? 0 : 1);
+				stack[stackSize++] = farChild;
+				stack[stackSize++] = nearChild;
+				continue;
+			}
+
+			for (int i = node.firstIndex; i < node.firstIndex + node.primitiveCount; i++)
+			{
+				const RAY_PRIMITIVE& primitive = scene.pPrimitives[i];
+				Float8 t;
+				Float8 u(0.0f);
+				Float8 v(0.0f);
+				Mask8 bHit;
+				if (RAY_PRIMITIVE_TRIANGLE == primitive.type)
+				{
+					bHit = IntersectTriangle(scene.pTriangles[primitive.dataIndex], packet, hitT, t, u, v);
+				}
+				else
+				{
+					bHit = IntersectSphere(scene.pSpheres[primitive.dataIndex], packet, hitT, t);
+				}
+
+				if (bHit.Any())
+				{
+					hitT = Select(bHit, t, hitT);
+					hitU = Select(bHit, u, hitU);
+					hitV = Select(bHit, v, hitV);
+					hitPrimitive = Select(bHit, Int8(i), hitPrimitive);
+				}
+			}
+		}
+	}
+
+	hitT.Store(output.t);
+	hitU.Store(output.u);
+	hitV.Store(output.v);
+	hitPrimitive.Store(output.primitive);
+}
+
+/***********************************************************
+ *  TraceOccluded()
+ *
+ *  This function finds which active rays of the packet hit a
+ *  shadow caster for the light before tMax, stopping as soon
+ *  as all of them have. Returns the blocked lanes as bits.
+ ***********************************************************/
+int TraceOccluded(const RAY_SCENE& scene, const RAY_PACKET_INPUT& input, uint32_t shadowBit)
+{
+	if ((scene.nodeCount <= 0) || (input.activeBits == 0))
+	{
+		return(0);
+	}
+
+	RAY_PACKET packet = LoadPacket(input);
+	RAY_PACKET remaining = packet;
+	Mask8 occluded(false);
+
+	int stack[RAY_MAX_TREE_DEPTH * 2 + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const RAY_NODE& node = scene.pNodes[stack[--stackSize]];
+		if (!IntersectBounds(node.bounds.minimum, node.bounds.maximum, remaining, remaining.tMax).Any())
+		{
+			continue;
+		}
+
+		if (node.primitiveCount == 0)
+		{
+			stack[stackSize++] = node.firstIndex + 1;
+			stack[stackSize++] = node.firstIndex;
+			continue;
+		}
+
+		for (int i = node.firstIndex; i < node.firstIndex + node.primitiveCount; i++)
+		{
+			const RAY_PRIMITIVE& primitive = scene.pPrimitives[i];
+			if (!(primitive.shadowMask & shadowBit))
+			{
+				continue;
+			}
+
+			Float8 t;
+			Float8 u;
+			Float8 v;
+			Mask8 bHit;
+			if (RAY_PRIMITIVE_TRIANGLE == primitive.type)
+			{
+				bHit = IntersectTriangle(scene.pTriangles[primitive.dataIndex], remaining, remaining.tMax, t, u, v);
+			}
+			else
+			{
+				bHit = IntersectSphere(scene.pSpheres[primitive.dataIndex], remaining, remaining.tMax, t);
+			}
+
+			if (bHit.Any())
+			{
+				occluded = occluded | bHit;
+				remaining.active = packet.active & ~occluded;
+				if (!remaining.active.Any())
+				{
+					return(occluded.Bits());
+				}
+			}
+		}
+	}
+
+	return(occluded.Bits());
+}
+
+}
@@ -0,0 +1,9 @@
+///////////////////////////////////////////////////////////////////////////////
+// raytracerscalar.cpp
+// ============
+// the ray tracer kernels built for any x86 CPU, used when AVX2 is missing
+///////////////////////////////////////////////////////////////////////////////
+
+#define SIMD8_FORCE_SCALAR
+#define RAY_KERNEL_NAMESPACE RayTracerScalar
+#include "RayTracerKernels.inl"
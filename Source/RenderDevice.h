@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderdevice.h
+// ============
+// thin interface over a graphics API - buffers, textures, pipelines and
+// command lists - so the scene can be submitted through OpenGL or Vulkan
+//
+//  Command lists are recorded between BeginFrame() and EndFrame(). Each
+//  list index may be recorded on its own thread at the same time as the
+//  others, and EndFrame() submits the lists in index order, so splitting a
+//  draw list into contiguous runs keeps the draw order.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "DrawList.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// handles to device resources, INVALID_DEVICE_HANDLE when creation failed
+typedef int32_t BUFFER_HANDLE;
+typedef int32_t TEXTURE_HANDLE;
+typedef int32_t PIPELINE_HANDLE;
+const int32_t INVALID_DEVICE_HANDLE = -1;
+
+enum BUFFER_USAGE
+{
+	// CPU_VERTEX data - position, normal, texture coordinate
+	BUFFER_USAGE_VERTEX,
+	// 32-bit indices
+	BUFFER_USAGE_INDEX
+};
+
+// an RGBA8 image, red in the low byte, bottom row first
+struct TEXTURE_DESC
+{
+	int width = 0;
+	int height = 0;
+	const void* pPixels = NULL;
+	bool bMipmaps = true;
+};
+
+// fixed function state around the scene shaders
+struct PIPELINE_DESC
+{
+	// source alpha blending
+	bool bBlend = false;
+	// whether passing fragments write depth
+	bool bDepthWrite = true;
+};
+
+// values shared by every draw of a frame
+struct FRAME_CONSTANTS
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 viewPosition = glm::vec3(0.0f);
+	glm::vec4 clearColor = glm::vec4(0.0f);
+	bool bUseLighting = false;
+	DRAW_LIGHTS lights;
+};
+
+// values that change per draw. The layout is the 128 bytes of Vulkan
+// push constants every implementation supports.
+struct DRAW_CONSTANTS
+{
+	glm::mat4 model;
+	glm::vec4 color;
+	glm::vec2 uvScale;
+	int32_t bUseTexture;
+	float shininess;
+	// xyz used
+	glm::vec4 diffuseColor;
+	glm::vec4 specularColor;
+};
+
+class RenderCommandList
+{
+public:
+	virtual ~RenderCommandList() {}
+
+	virtual void BindPipeline(PIPELINE_HANDLE pipeline) = 0;
+	virtual void BindTexture(TEXTURE_HANDLE texture) = 0;
+	virtual void BindMesh(BUFFER_HANDLE vertexBuffer, BUFFER_HANDLE indexBuffer) = 0;
+	virtual void SetDrawConstants(const DRAW_CONSTANTS& constants) = 0;
+	virtual void DrawIndexed(uint32_t indexCount) = 0;
+};
+
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// name of the backend and the device it runs on, for logging
+	virtual const char* GetName() const = 0;
+
+	// resources - created from the thread that owns the device
+	virtual BUFFER_HANDLE CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size) = 0;
+	virtual TEXTURE_HANDLE CreateTexture(const TEXTURE_DESC& desc) = 0;
+	virtual PIPELINE_HANDLE CreatePipeline(const PIPELINE_DESC& desc) = 0;
+
+	// the most command lists a frame can be split into
+	virtual int GetMaxCommandLists() const = 0;
+
+	// start a frame of the given size. The target is cleared to the
+	// clear color when the lists are submitted.
+	virtual bool BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants) = 0;
+	// start and finish recording one list - may be called from any thread,
+	// one thread per list index
+	virtual RenderCommandList* BeginCommandList(int listIndex) = 0;
+	virtual void EndCommandList(int listIndex) = 0;
+	// submit lists 0 to listCount - 1 in order
+	virtual void EndFrame(int listCount) = 0;
+
+	// copy the last frame into 8-bit RGB pixels, bottom row first
+	virtual void ReadPixels(std::vector<unsigned char>& pixels) = 0;
+};
@@ -0,0 +1,630 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.cpp
+// ============
+// batched rendering of camera requests from local clients
+//
+// NOTE: requests that arrive together are rendered as one batch. The batch
+// is grouped by image size so each group reuses one render target, and every
+// image is read back into its own pixel pack buffer, so all the draws and
+// copies are queued before the first result is mapped - the GPU never waits
+// for the CPU in between. Pixels travel through shared memory that the
+// client owns; only the small request and reply structures go through the
+// socket. Linux only.
+//
+// Batching saves the target setup and the readback stalls, not the scene
+// submission: every image is still its own RenderScene() call. The layered
+// multi-view program could draw several same-size cameras in one call, but
+// the fragment shader lights with a single viewPosition, so every camera but
+// one would get the wrong specular highlights. The throughput report counts
+// scene submissions per image so that cost stays visible.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderServer.h"
+#include "ViewManager.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef __linux__
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// most requests rendered in one batch
+	const size_t MAX_BATCH_REQUESTS = 64;
+	// largest image side a request may ask for
+	const uint32_t MAX_IMAGE_SIZE = 8192;
+	// seconds between throughput reports
+	const double REPORT_INTERVAL_SECONDS = 5.0;
+
+#ifdef __linux__
+	// set by SIGINT and SIGTERM to stop the server cleanly
+	volatile sig_atomic_t g_bStopSignal = 0;
+
+	/***********************************************************
+	 *  HandleStopSignal()
+	 ***********************************************************/
+	void HandleStopSignal(int)
+	{
+		g_bStopSignal = 1;
+	}
+#endif
+
+	/***********************************************************
+	 *  IsValidRequest()
+	 *
+	 *  Return true when the request asks for an image size and
+	 *  camera that can be rendered.
+	 ***********************************************************/
+	bool IsValidRequest(const RenderServer::RENDER_REQUEST& request)
+	{
+		if ((request.width == 0) || (request.height == 0) ||
+			(request.width > MAX_IMAGE_SIZE) || (request.height > MAX_IMAGE_SIZE))
+		{
+			return(false);
+		}
+		if (!(request.flags & RenderServer::REQUEST_ORTHOGRAPHIC) &&
+			!((request.fieldOfView > 0.0f) && (request.fieldOfView < 180.0f)))
+		{
+			return(false);
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  SecondsNow()
+	 ***********************************************************/
+	double SecondsNow()
+	{
+		return(std::chrono::duration<double>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+/***********************************************************
+ *  RenderServer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderServer::RenderServer(ShaderManager* pShaderManager, SceneManager* pSceneManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_listenSocket = -1;
+	m_bShutdownRequested = false;
+	m_imagesSinceReport = 0;
+	m_batchesSinceReport = 0;
+	m_submissionsSinceReport = 0;
+	m_lastReportTime = SecondsNow();
+}
+
+/***********************************************************
+ *  ~RenderServer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderServer::~RenderServer()
+{
+	Close();
+
+	for (auto& target : m_targets)
+	{
+		delete target.second;
+	}
+	m_targets.clear();
+
+	if (!m_pixelBuffers.empty())
+	{
+		glDeleteBuffers((GLsizei)m_pixelBuffers.size(), m_pixelBuffers.data());
+		m_pixelBuffers.clear();
+	}
+}
+
+/***********************************************************
+ *  Open()
+ ***********************************************************/
+bool RenderServer::Open(const std::string& socketPath)
+{
+#ifdef __linux__
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		LOG_ERROR("Render server socket path is too long: %s", socketPath.c_str());
+		return(false);
+	}
+	strcpy(address.sun_path, socketPath.c_str());
+
+	m_listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_listenSocket < 0)
+	{
+		LOG_ERROR("Could not create the render server socket (errno %d)", errno);
+		return(false);
+	}
+
+	unlink(socketPath.c_str());
+	if ((bind(m_listenSocket, (sockaddr*)&address, sizeof(address)) != 0) ||
+		(listen(m_listenSocket, SOMAXCONN) != 0))
+	{
+		LOG_ERROR("Could not listen on %s (errno %d)", socketPath.c_str(), errno);
+		close(m_listenSocket);
+		m_listenSocket = -1;
+		return(false);
+	}
+	m_socketPath = socketPath;
+
+	signal(SIGINT, HandleStopSignal);
+	signal(SIGTERM, HandleStopSignal);
+
+	LOG_INFO("Render server listening on %s", socketPath.c_str());
+	return(true);
+#else
+	LOG_ERROR("The render server needs Unix domain sockets and is only available on Linux");
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  WaitForRequests()
+ *
+ *  This method sleeps in poll() until a client sends data,
+ *  then keeps draining every socket that is ready without
+ *  sleeping, so requests sent together share a batch.
+ ***********************************************************/
+bool RenderServer::WaitForRequests()
+{
+#ifdef __linux__
+	while (m_queue.empty())
+	{
+		if (g_bStopSignal || m_bShutdownRequested)
+		{
+			return(false);
+		}
+
+		// requests read ahead of an earlier batch go first
+		for (size_t i = 0; i < m_clients.size();)
+		{
+			QueueRequests(m_clients[i]);
+			if (m_clients[i].socket < 0)
+			{
+				CloseClient(i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		int timeoutMilliseconds = m_queue.empty() ? 250 : 0;
+		while (m_queue.size() < MAX_BATCH_REQUESTS)
+		{
+			std::vector<pollfd> pollSockets;
+			pollSockets.push_back({ m_listenSocket, POLLIN, 0 });
+			for (const CLIENT& client : m_clients)
+			{
+				pollSockets.push_back({ client.socket, POLLIN, 0 });
+			}
+
+			int readyCount = poll(pollSockets.data(), (nfds_t)pollSockets.size(), timeoutMilliseconds);
+			if (readyCount <= 0)
+			{
+				break;
+			}
+			timeoutMilliseconds = 0;
+
+			// serve the clients first, from the back so closing one
+			// does not shift the ones still to be visited
+			for (size_t i = m_clients.size(); i > 0; i--)
+			{
+				if (pollSockets[i].revents != 0)
+				{
+					ReceiveRequests(m_clients[i - 1]);
+					if (m_clients[i - 1].socket < 0)
+					{
+						CloseClient(i - 1);
+					}
+				}
+			}
+			if (pollSockets[0].revents & POLLIN)
+			{
+				AcceptClients();
+			}
+		}
+	}
+
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  RenderBatch()
+ *
+ *  This method draws every queued request, grouped by size,
+ *  queueing the readbacks as it goes, then collects the
+ *  images and replies in the same order.
+ ***********************************************************/
+void RenderServer::RenderBatch(const FRAME_STATE& frameState)
+{
+	// keep the arrival order within a size
+	std::stable_sort(m_queue.begin(), m_queue.end(),
+		[](const QUEUED_REQUEST& a, const QUEUED_REQUEST& b)
+		{
+			if (a.request.width != b.request.width)
+			{
+				return(a.request.width < b.request.width);
+			}
+			return(a.request.height < b.request.height);
+		});
+
+	if (m_pixelBuffers.size() < m_queue.size())
+	{
+		size_t firstNew = m_pixelBuffers.size();
+		m_pixelBuffers.resize(m_queue.size());
+		glGenBuffers((GLsizei)(m_queue.size() - firstNew), &m_pixelBuffers[firstNew]);
+	}
+
+	std::map<std::pair<int, int>, OffscreenTarget*> usedTargets;
+	m_pShaderManager->use();
+	glEnable(GL_DEPTH_TEST);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	for (size_t i = 0; i < m_queue.size(); i++)
+	{
+		const RENDER_REQUEST& request = m_queue[i].request;
+		if (!IsValidRequest(request))
+		{
+			continue;
+		}
+
+		std::pair<int, int> size((int)request.width, (int)request.height);
+		OffscreenTarget*& pTarget = usedTargets[size];
+		if (NULL == pTarget)
+		{
+			auto cached = m_targets.find(size);
+			if (cached != m_targets.end())
+			{
+				pTarget = cached->second;
+				m_targets.erase(cached);
+			}
+			else
+			{
+				pTarget = new OffscreenTarget();
+				pTarget->Resize(size.first, size.second);
+			}
+		}
+
+		glm::vec3 eye(request.eye[0], request.eye[1], request.eye[2]);
+		glm::vec3 target(request.target[0], request.target[1], request.target[2]);
+		glm::vec3 up(request.up[0], request.up[1], request.up[2]);
+		float aspect = (float)request.width / (float)request.height;
+
+		// the same projections the interactive camera uses
+		glm::mat4 projection;
+		if (request.flags & REQUEST_ORTHOGRAPHIC)
+		{
+			float orthoSize = 5.0f;
+			projection = glm::ortho(-orthoSize * aspect, orthoSize * aspect, -orthoSize, orthoSize, 0.1f, 500.0f);
+		}
+		else
+		{
+			projection = glm::perspective(glm::radians(request.fieldOfView), aspect, 0.1f, 100.0f);
+		}
+
+		pTarget->Bind();
+		ViewManager::LoadViewIntoShader(m_pShaderManager, glm::lookAt(eye, target, up), projection, eye);
+		m_pSceneManager->RenderScene(frameState);
+		m_submissionsSinceReport++;
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, pTarget->GetFramebuffer());
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)request.width * request.height * 3, NULL, GL_STREAM_READ);
+		glReadPixels(0, 0, request.width, request.height, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// collect the images in the order they were drawn
+	for (size_t i = 0; i < m_queue.size(); i++)
+	{
+		DeliverImage(m_queue[i], m_pixelBuffers[i]);
+	}
+
+	// every request sizes its buffer anyway, so the storage is given
+	// back rather than held at the largest batch's images, and the
+	// buffers beyond this batch are deleted
+	for (size_t i = 0; i < m_queue.size(); i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixelBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, 0, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (m_pixelBuffers.size() > m_queue.size())
+	{
+		glDeleteBuffers((GLsizei)(m_pixelBuffers.size() - m_queue.size()), &m_pixelBuffers[m_queue.size()]);
+		m_pixelBuffers.resize(m_queue.size());
+	}
+
+	// sizes that were not asked for in this batch give up their targets
+	for (auto& target : m_targets)
+	{
+		delete target.second;
+	}
+	m_targets.swap(usedTargets);
+
+	m_imagesSinceReport += m_queue.size();
+	m_batchesSinceReport++;
+	m_queue.clear();
+
+	double now = SecondsNow();
+	if (now - m_lastReportTime >= REPORT_INTERVAL_SECONDS)
+	{
+		double seconds = now - m_lastReportTime;
+		LOG_INFO("Render server: %.1f images/s, %.1f images per batch, %.2f scene submissions per image",
+			m_imagesSinceReport / seconds,
+			(double)m_imagesSinceReport / (double)m_batchesSinceReport,
+			(double)m_submissionsSinceReport / (double)m_imagesSinceReport);
+		m_imagesSinceReport = 0;
+		m_batchesSinceReport = 0;
+		m_submissionsSinceReport = 0;
+		m_lastReportTime = now;
+	}
+}
+
+/***********************************************************
+ *  AcceptClients()
+ ***********************************************************/
+void RenderServer::AcceptClients()
+{
+#ifdef __linux__
+	int clientSocket;
+	while ((clientSocket = accept4(m_listenSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+	{
+		CLIENT client;
+		client.socket = clientSocket;
+		m_clients.push_back(client);
+	}
+#endif
+}
+
+/***********************************************************
+ *  ReceiveRequests()
+ *
+ *  This method reads what the client has sent, at most a
+ *  batch of requests ahead, and queues the complete requests
+ *  while the batch has room. A client sending faster than
+ *  it is served is held back by its own socket buffer. The
+ *  socket is set to -1 when the client hung up or sent
+ *  something that is not a request.
+ ***********************************************************/
+void RenderServer::ReceiveRequests(CLIENT& client)
+{
+#ifdef __linux__
+	const size_t maxReceivedBytes = MAX_BATCH_REQUESTS * sizeof(RENDER_REQUEST);
+	unsigned char buffer[4096];
+	bool bHungUp = false;
+	while (client.received.size() < maxReceivedBytes)
+	{
+		ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+		{
+			bHungUp = (received == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK));
+			break;
+		}
+		client.received.insert(client.received.end(), buffer, buffer + received);
+	}
+
+	QueueRequests(client);
+	if (bHungUp && (client.socket >= 0))
+	{
+		HangUp(client);
+	}
+#endif
+}
+
+/***********************************************************
+ *  QueueRequests()
+ *
+ *  This method queues the complete requests already read
+ *  from the client, until the batch is full. The rest wait
+ *  for the next batch.
+ ***********************************************************/
+void RenderServer::QueueRequests(CLIENT& client)
+{
+	size_t offset = 0;
+	while ((m_queue.size() < MAX_BATCH_REQUESTS) &&
+		(client.received.size() - offset >= sizeof(RENDER_REQUEST)))
+	{
+		QUEUED_REQUEST queuedRequest;
+		memcpy(&queuedRequest.request, &client.received[offset], sizeof(RENDER_REQUEST));
+		offset += sizeof(RENDER_REQUEST);
+
+		RENDER_REQUEST& request = queuedRequest.request;
+		if (request.magic != REQUEST_MAGIC)
+		{
+			LOG_WARNING("Render server dropped a client that sent a malformed request");
+			HangUp(client);
+			return;
+		}
+		request.sharedMemoryName[sizeof(request.sharedMemoryName) - 1] = '\0';
+		request.outputFilename[sizeof(request.outputFilename) - 1] = '\0';
+
+		if (request.flags & REQUEST_SHUTDOWN)
+		{
+			m_bShutdownRequested = true;
+			SendReply(client.socket, request, STATUS_OK);
+			continue;
+		}
+
+		queuedRequest.clientSocket = client.socket;
+		m_queue.push_back(queuedRequest);
+	}
+	client.received.erase(client.received.begin(), client.received.begin() + offset);
+}
+
+/***********************************************************
+ *  HangUp()
+ *
+ *  This method closes the client's socket and sets it to -1.
+ *  Its queued requests are still rendered, but the replies
+ *  have nowhere to go, and requests it sent beyond the batch
+ *  are dropped.
+ ***********************************************************/
+void RenderServer::HangUp(CLIENT& client)
+{
+#ifdef __linux__
+	for (QUEUED_REQUEST& queuedRequest : m_queue)
+	{
+		if (queuedRequest.clientSocket == client.socket)
+		{
+			queuedRequest.clientSocket = -1;
+		}
+	}
+	close(client.socket);
+	client.socket = -1;
+	client.received.clear();
+#endif
+}
+
+/***********************************************************
+ *  CloseClient()
+ ***********************************************************/
+void RenderServer::CloseClient(size_t index)
+{
+	m_clients.erase(m_clients.begin() + index);
+}
+
+/***********************************************************
+ *  DeliverImage()
+ *
+ *  This method maps the request's pixel buffer, copies the
+ *  image into the client's shared memory and/or an image
+ *  file, and sends the reply.
+ ***********************************************************/
+void RenderServer::DeliverImage(const QUEUED_REQUEST& queuedRequest, GLuint pixelBuffer)
+{
+	const RENDER_REQUEST& request = queuedRequest.request;
+	if (!IsValidRequest(request))
+	{
+		SendReply(queuedRequest.clientSocket, request, STATUS_BAD_REQUEST);
+		return;
+	}
+
+	size_t byteCount = (size_t)request.width * request.height * 3;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+	const unsigned char* pPixels = (const unsigned char*)glMapBufferRange(
+		GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)byteCount, GL_MAP_READ_BIT);
+
+	uint32_t status = STATUS_OK;
+	if (NULL == pPixels)
+	{
+		status = STATUS_WRITE_FAILED;
+	}
+
+#ifdef __linux__
+	if ((status == STATUS_OK) && (request.sharedMemoryName[0] != '\0'))
+	{
+		status = STATUS_SHARED_MEMORY_FAILED;
+		int sharedMemory = shm_open(request.sharedMemoryName, O_RDWR, 0);
+		struct stat sharedMemoryStat;
+		if ((sharedMemory >= 0) &&
+			(fstat(sharedMemory, &sharedMemoryStat) == 0) &&
+			((size_t)sharedMemoryStat.st_size >= byteCount))
+		{
+			void* pMapped = mmap(NULL, byteCount, PROT_WRITE, MAP_SHARED, sharedMemory, 0);
+			if (pMapped != MAP_FAILED)
+			{
+				memcpy(pMapped, pPixels, byteCount);
+				munmap(pMapped, byteCount);
+				status = STATUS_OK;
+			}
+		}
+		if (sharedMemory >= 0)
+		{
+			close(sharedMemory);
+		}
+	}
+#endif
+
+	if ((status == STATUS_OK) && (request.outputFilename[0] != '\0'))
+	{
+		if (!ImageWriter::WriteImage(request.outputFilename, (int)request.width, (int)request.height, pPixels))
+		{
+			status = STATUS_WRITE_FAILED;
+		}
+	}
+
+	if (NULL != pPixels)
+	{
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	SendReply(queuedRequest.clientSocket, request, status);
+}
+
+/***********************************************************
+ *  SendReply()
+ ***********************************************************/
+void RenderServer::SendReply(int clientSocket, const RENDER_REQUEST& request, uint32_t status)
+{
+#ifdef __linux__
+	if (clientSocket < 0)
+	{
+		return;
+	}
+
+	RENDER_REPLY reply;
+	reply.magic = REPLY_MAGIC;
+	reply.requestId = request.requestId;
+	reply.status = status;
+	reply.width = request.width;
+	reply.height = request.height;
+	reply.byteCount = (status == STATUS_OK) ? request.width * request.height * 3 : 0;
+
+	// replies are tiny, so a full socket buffer means the client
+	// stopped reading - it finds out when its connection is closed
+	if (send(clientSocket, &reply, sizeof(reply), MSG_NOSIGNAL) != (ssize_t)sizeof(reply))
+	{
+		LOG_WARNING("Render server could not reply to request %u", request.requestId);
+	}
+#endif
+}
+
+/***********************************************************
+ *  Close()
+ ***********************************************************/
+void RenderServer::Close()
+{
+#ifdef __linux__
+	for (const CLIENT& client : m_clients)
+	{
+		close(client.socket);
+	}
+	m_clients.clear();
+
+	if (m_listenSocket >= 0)
+	{
+		close(m_listenSocket);
+		unlink(m_socketPath.c_str());
+		m_listenSocket = -1;
+	}
+#endif
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.h
+// ============
+// long-running headless render server - keeps the scene loaded and renders
+// camera requests from local clients over a Unix domain socket
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "SceneManager.h"
+#include "OffscreenTarget.h"
+#include "FrameState.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class RenderServer
+{
+public:
+	// request flags
+	enum REQUEST_FLAGS
+	{
+		REQUEST_ORTHOGRAPHIC = 1,
+		// stop the server once the queued requests are done
+		REQUEST_SHUTDOWN = 2
+	};
+
+	// reply status codes
+	enum REPLY_STATUS
+	{
+		STATUS_OK = 0,
+		STATUS_BAD_REQUEST,
+		STATUS_SHARED_MEMORY_FAILED,
+		STATUS_WRITE_FAILED
+	};
+
+	// fixed-size request a client writes to the socket. The image goes
+	// into the client's POSIX shared memory object, as 8-bit RGB rows
+	// bottom first, and/or into an image file.
+	struct RENDER_REQUEST
+	{
+		uint32_t magic;
+		uint32_t requestId;
+		uint32_t flags;
+		uint32_t width;
+		uint32_t height;
+		float eye[3];
+		float target[3];
+		float up[3];
+		// vertical field of view in degrees, ignored for orthographic
+		float fieldOfView;
+		// name passed to shm_open, at least width * height * 3 bytes
+		char sharedMemoryName[64];
+		char outputFilename[256];
+	};
+
+	// fixed-size reply written back for every request, in the order
+	// the requests were rendered
+	struct RENDER_REPLY
+	{
+		uint32_t magic;
+		uint32_t requestId;
+		uint32_t status;
+		uint32_t width;
+		uint32_t height;
+		uint32_t byteCount;
+	};
+
+	static const uint32_t REQUEST_MAGIC = 0x51525352;	// "RSRQ"
+	static const uint32_t REPLY_MAGIC = 0x50525352;		// "RSRP"
+
+	// constructor - renders with the scene objects of the current context
+	RenderServer(ShaderManager* pShaderManager, SceneManager* pSceneManager);
+	// destructor
+	~RenderServer();
+
+	// listen on the socket path, replacing a stale socket file
+	bool Open(const std::string& socketPath);
+
+	// wait until requests are queued, gathering everything that is
+	// ready into the next batch. Returns false once the server should
+	// stop.
+	bool WaitForRequests();
+
+	// render the queued batch, lit by the animation state of the frame
+	// snapshot, and reply to the clients
+	void RenderBatch(const FRAME_STATE& frameState);
+
+private:
+	// a connected client and its partly received request
+	struct CLIENT
+	{
+		int socket;
+		std::vector<unsigned char> received;
+	};
+
+	// a request waiting in the batch and the client it came from
+	struct QUEUED_REQUEST
+	{
+		RENDER_REQUEST request;
+		int clientSocket;
+	};
+
+	ShaderManager* m_pShaderManager;
+	SceneManager* m_pSceneManager;
+
+	int m_listenSocket;
+	std::string m_socketPath;
+	std::vector<CLIENT> m_clients;
+	std::vector<QUEUED_REQUEST> m_queue;
+	bool m_bShutdownRequested;
+
+	// render targets kept between batches, one per image size
+	std::map<std::pair<int, int>, OffscreenTarget*> m_targets;
+	// pixel pack buffers, one per request of the batch, emptied once
+	// the batch is delivered
+	std::vector<GLuint> m_pixelBuffers;
+
+	// throughput since the last report
+	uint64_t m_imagesSinceReport;
+	uint64_t m_batchesSinceReport;
+	// RenderScene() calls since the last report
+	uint64_t m_submissionsSinceReport;
+	double m_lastReportTime;
+
+	void AcceptClients();
+	void ReceiveRequests(CLIENT& client);
+	void QueueRequests(CLIENT& client);
+	void HangUp(CLIENT& client);
+	void CloseClient(size_t index);
+	void DeliverImage(const QUEUED_REQUEST& queuedRequest, GLuint pixelBuffer);
+	void SendReply(int clientSocket, const RENDER_REQUEST& request, uint32_t status);
+	void Close();
+};
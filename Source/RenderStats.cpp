@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstats.cpp
+// ============
+// frame latching and the CSV dump of the render statistics
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderStats.h"
+#include "Logger.h"
+
+#include <fstream>
+
+RENDER_STATS RenderStats::m_current;
+RENDER_STATS RenderStats::m_lastFrame;
+
+namespace
+{
+	std::ofstream g_CsvFile;
+	std::string g_CsvFilename;
+	uint64_t g_FrameIndex = 0;
+}
+
+/***********************************************************
+ *  EndFrame()
+ ***********************************************************/
+void RenderStats::EndFrame(double frameMilliseconds, double cpuMilliseconds, double gpuMilliseconds)
+{
+	m_lastFrame = m_current;
+	m_lastFrame.frameMilliseconds = frameMilliseconds;
+	m_lastFrame.cpuMilliseconds = cpuMilliseconds;
+	m_lastFrame.gpuMilliseconds = gpuMilliseconds;
+	m_current = RENDER_STATS();
+
+	if (g_CsvFile.is_open())
+	{
+		g_CsvFile << g_FrameIndex << ","
+			<< m_lastFrame.drawCalls << ","
+			<< m_lastFrame.triangles << ","
+			<< m_lastFrame.uniformWrites << ","
+			<< m_lastFrame.textureBinds << ","
+			<< m_lastFrame.stateChanges << ","
+			<< m_lastFrame.bytesUploaded << ","
+			<< m_lastFrame.frameMilliseconds << ","
+			<< m_lastFrame.cpuMilliseconds << ","
+			<< m_lastFrame.gpuMilliseconds << "\n";
+	}
+	g_FrameIndex++;
+}
+
+/***********************************************************
+ *  OpenCsv()
+ ***********************************************************/
+bool RenderStats::OpenCsv(const std::string& filename)
+{
+	CloseCsv();
+
+	g_CsvFile.open(filename);
+	if (!g_CsvFile)
+	{
+		LOG_ERROR("Could not write render statistics %s", filename.c_str());
+		return(false);
+	}
+
+	g_CsvFilename = filename;
+	// the counter columns are named for the scene manager, the only
+	// code that feeds them
+	g_CsvFile << "frame,scene_draw_calls,scene_triangles,scene_uniform_writes,scene_texture_binds,"
+		"scene_state_changes,scene_bytes_uploaded,frame_ms,cpu_ms,gpu_ms\n";
+	return(true);
+}
+
+/***********************************************************
+ *  CloseCsv()
+ ***********************************************************/
+void RenderStats::CloseCsv()
+{
+	if (g_CsvFile.is_open())
+	{
+		g_CsvFile.close();
+		LOG_INFO("Wrote render statistics to %s", g_CsvFilename.c_str());
+	}
+}
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstats.h
+// ============
+// per-frame counters of the work the scene manager hands to OpenGL - draws,
+// triangles, uniform writes, binds, state changes and uploaded bytes - with
+// the frame, CPU and GPU times, latched once a frame for the overlay and the
+// CSV dump
+//
+//  The counters are plain integers bumped by the render thread that owns
+//  the context, so counting costs an add at each call site. Only the scene
+//  manager counts - the upscaling, overlay and capture passes are left out.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// what one frame cost - the counters cover the scene manager's work only
+struct RENDER_STATS
+{
+	uint64_t drawCalls = 0;
+	uint64_t triangles = 0;
+	uint64_t uniformWrites = 0;
+	// sampler switches and texture binds
+	uint64_t textureBinds = 0;
+	// program, blend and depth write changes
+	uint64_t stateChanges = 0;
+	// texture, buffer and uniform data sent to the driver
+	uint64_t bytesUploaded = 0;
+
+	// time since the previous frame, CPU time spent submitting the frame,
+	// and GPU time of the scene
+	double frameMilliseconds = 0.0;
+	double cpuMilliseconds = 0.0;
+	double gpuMilliseconds = 0.0;
+};
+
+class RenderStats
+{
+public:
+	// the counters of the frame being rendered
+	static RENDER_STATS& Current() { return(m_current); }
+	// the counters of the last finished frame
+	static const RENDER_STATS& GetLastFrame() { return(m_lastFrame); }
+
+	// latch the frame with its times, write it to the CSV file if one is
+	// open, and start counting the next frame from zero
+	static void EndFrame(double frameMilliseconds, double cpuMilliseconds, double gpuMilliseconds);
+
+	// write one row per frame to a CSV file until CloseCsv()
+	static bool OpenCsv(const std::string& filename);
+	static void CloseCsv();
+
+private:
+	static RENDER_STATS m_current;
+	static RENDER_STATS m_lastFrame;
+};
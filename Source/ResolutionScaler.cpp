@@ -0,0 +1,317 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.cpp
+// ============
+// dynamic resolution scaling driven by GPU timer queries
+//
+// NOTE: the scene's fragment cost grows with the number of pixels, which is
+// the square of the per-axis scale. The controller therefore scales by the
+// square root of the ratio between the target and the measured frame time,
+// and only ever moves a small step per frame to avoid visible pumping.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResolutionScaler.h"
+#include "TemporalUpscaler.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// weight of the newest sample in the smoothed GPU frame time
+	const float GPU_TIME_SMOOTHING = 0.1f;
+	// the scale is left alone while the frame time is inside this band
+	// around the target
+	const float SCALE_UP_THRESHOLD = 0.85f;
+	const float SCALE_DOWN_THRESHOLD = 1.05f;
+	// largest change of the render scale per frame
+	const float MAX_SCALE_STEP = 0.02f;
+}
+
+/***********************************************************
+ *  ResolutionScaler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ResolutionScaler::ResolutionScaler(
+	float targetFrameMilliseconds,
+	float minimumScale,
+	float maximumScale)
+{
+	m_targetFrameMilliseconds = targetFrameMilliseconds;
+	m_minimumScale = minimumScale;
+	m_maximumScale = maximumScale;
+	m_allocatedScale = maximumScale;
+	m_renderScale = maximumScale;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_outputWidth = 0;
+	m_outputHeight = 0;
+
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_motionTexture = 0;
+	m_depthTexture = 0;
+	m_framebufferWidth = 0;
+	m_framebufferHeight = 0;
+	m_pTemporalUpscaler = NULL;
+
+	glGenQueries(QUERY_COUNT, m_timerQueries);
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_bQueryPending[i] = false;
+	}
+	m_nextQuery = 0;
+	m_gpuFrameMilliseconds = targetFrameMilliseconds;
+}
+
+/***********************************************************
+ *  ~ResolutionScaler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResolutionScaler::~ResolutionScaler()
+{
+	DestroyFramebuffer();
+	glDeleteQueries(QUERY_COUNT, m_timerQueries);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method reallocates the offscreen framebuffer when the
+ *  window framebuffer changes size.
+ ***********************************************************/
+void ResolutionScaler::Resize(int outputWidth, int outputHeight)
+{
+	if ((outputWidth == m_outputWidth) && (outputHeight == m_outputHeight))
+	{
+		return;
+	}
+
+	m_outputWidth = outputWidth;
+	m_outputHeight = outputHeight;
+
+	DestroyFramebuffer();
+	if ((outputWidth > 0) && (outputHeight > 0))
+	{
+		CreateFramebuffer(
+			std::max(1, (int)std::ceil(outputWidth * m_allocatedScale)),
+			std::max(1, (int)std::ceil(outputHeight * m_allocatedScale)));
+	}
+	UpdateRenderScale(m_gpuFrameMilliseconds);
+}
+
+/***********************************************************
+ *  SetScaleRange()
+ ***********************************************************/
+void ResolutionScaler::SetScaleRange(float minimumScale, float maximumScale)
+{
+	m_maximumScale = std::min(maximumScale, m_allocatedScale);
+	m_minimumScale = std::min(minimumScale, m_maximumScale);
+	m_renderScale = std::max(m_minimumScale, std::min(m_maximumScale, m_renderScale));
+	UpdateRenderScale(m_gpuFrameMilliseconds);
+}
+
+/***********************************************************
+ *  SetTemporalUpscaler()
+ ***********************************************************/
+void ResolutionScaler::SetTemporalUpscaler(TemporalUpscaler* pTemporalUpscaler)
+{
+	m_pTemporalUpscaler = pTemporalUpscaler;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method picks the render scale from the latest GPU
+ *  timings and redirects rendering into the offscreen
+ *  framebuffer.
+ ***********************************************************/
+void ResolutionScaler::BeginFrame()
+{
+	CollectTimerResults();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	// motion vectors are only written when something will read them
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers((NULL != m_pTemporalUpscaler) ? 2 : 1, drawBuffers);
+
+	// keep clears inside the part of the framebuffer in use
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, m_renderWidth, m_renderHeight);
+
+	// reuse the oldest query - if its result never arrived it is
+	// simply discarded
+	glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_nextQuery]);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method stops the GPU timer and upscales the rendered
+ *  image into the window framebuffer.
+ ***********************************************************/
+void ResolutionScaler::EndFrame()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	m_bQueryPending[m_nextQuery] = true;
+	m_nextQuery = (m_nextQuery + 1) % QUERY_COUNT;
+
+	glDisable(GL_SCISSOR_TEST);
+
+	if (NULL != m_pTemporalUpscaler)
+	{
+		m_pTemporalUpscaler->Resolve(
+			m_colorTexture,
+			m_motionTexture,
+			m_depthTexture,
+			m_renderWidth,
+			m_renderHeight,
+			m_framebufferWidth,
+			m_framebufferHeight,
+			m_outputWidth,
+			m_outputHeight);
+	}
+	else
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(
+			0, 0, m_renderWidth, m_renderHeight,
+			0, 0, m_outputWidth, m_outputHeight,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_outputWidth, m_outputHeight);
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method allocates the offscreen color and depth
+ *  buffers.
+ ***********************************************************/
+void ResolutionScaler::CreateFramebuffer(int width, int height)
+{
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// screen-space motion, read by the temporal upscaler
+	glGenTextures(1, &m_motionTexture);
+	glBindTexture(GL_TEXTURE_2D, m_motionTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// depth is a texture so the upscaler can tell background from objects
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_motionTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG_ERROR("Offscreen framebuffer %dx%d is incomplete", width, height);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+}
+
+/***********************************************************
+ *  DestroyFramebuffer()
+ ***********************************************************/
+void ResolutionScaler::DestroyFramebuffer()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures(1, &m_depthTexture);
+		glDeleteTextures(1, &m_motionTexture);
+		glDeleteTextures(1, &m_colorTexture);
+	}
+	m_framebuffer = 0;
+	m_depthTexture = 0;
+	m_motionTexture = 0;
+	m_colorTexture = 0;
+	m_framebufferWidth = 0;
+	m_framebufferHeight = 0;
+}
+
+/***********************************************************
+ *  CollectTimerResults()
+ *
+ *  This method reads every timer query whose result is
+ *  already available, without ever waiting for the GPU.
+ ***********************************************************/
+void ResolutionScaler::CollectTimerResults()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int query = (m_nextQuery + i) % QUERY_COUNT;
+		if (!m_bQueryPending[query])
+		{
+			continue;
+		}
+
+		GLint available = 0;
+		glGetQueryObjectiv(m_timerQueries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			continue;
+		}
+
+		GLuint64 elapsedNanoseconds = 0;
+		glGetQueryObjectui64v(m_timerQueries[query], GL_QUERY_RESULT, &elapsedNanoseconds);
+		m_bQueryPending[query] = false;
+
+		m_gpuFrameMilliseconds += GPU_TIME_SMOOTHING *
+			((float)(elapsedNanoseconds / 1.0e6) - m_gpuFrameMilliseconds);
+		UpdateRenderScale(m_gpuFrameMilliseconds);
+	}
+}
+
+/***********************************************************
+ *  UpdateRenderScale()
+ *
+ *  This method nudges the render scale towards the one that
+ *  would hold the target frame time.
+ ***********************************************************/
+void ResolutionScaler::UpdateRenderScale(float gpuMilliseconds)
+{
+	if (gpuMilliseconds > 0.0f)
+	{
+		float ratio = gpuMilliseconds / m_targetFrameMilliseconds;
+		if ((ratio > SCALE_DOWN_THRESHOLD) || (ratio < SCALE_UP_THRESHOLD))
+		{
+			float desiredScale = m_renderScale / std::sqrt(ratio);
+			float step = std::max(-MAX_SCALE_STEP, std::min(MAX_SCALE_STEP, desiredScale - m_renderScale));
+			m_renderScale = std::max(m_minimumScale, std::min(m_maximumScale, m_renderScale + step));
+		}
+	}
+
+	m_renderWidth = std::max(1, std::min(m_framebufferWidth, (int)(m_outputWidth * m_renderScale)));
+	m_renderHeight = std::max(1, std::min(m_framebufferHeight, (int)(m_outputHeight * m_renderScale)));
+
+	LOG_DEBUG_THROTTLED(1.0, "Render scale %.2f (%dx%d), GPU frame %.2f ms",
+		m_renderScale, m_renderWidth, m_renderHeight, gpuMilliseconds);
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.h
+// ============
+// render the scene into an offscreen framebuffer whose resolution follows a
+// GPU frame time target, then upscale it to the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class TemporalUpscaler;
+
+class ResolutionScaler
+{
+public:
+	// constructor
+	ResolutionScaler(
+		float targetFrameMilliseconds,
+		float minimumScale,
+		float maximumScale);
+	// destructor
+	~ResolutionScaler();
+
+	// set the size of the window framebuffer being rendered to
+	void Resize(int outputWidth, int outputHeight);
+
+	// narrow the range the render scale may move in - limited to the
+	// maximum scale given to the constructor
+	void SetScaleRange(float minimumScale, float maximumScale);
+
+	// upscale through the temporal upscaler instead of a plain blit,
+	// or pass NULL to go back to the blit
+	void SetTemporalUpscaler(TemporalUpscaler* pTemporalUpscaler);
+
+	// bind the offscreen framebuffer at the current render scale and
+	// start timing the frame on the GPU
+	void BeginFrame();
+	// stop timing and upscale the rendered image into the window
+	void EndFrame();
+
+	// the size the scene is currently rendered at
+	int GetRenderWidth() const { return(m_renderWidth); }
+	int GetRenderHeight() const { return(m_renderHeight); }
+	// the current fraction of the window resolution, per axis
+	float GetRenderScale() const { return(m_renderScale); }
+	// the smoothed GPU time of the scene, in milliseconds
+	float GetGpuFrameMilliseconds() const { return(m_gpuFrameMilliseconds); }
+
+private:
+	// number of timer queries kept in flight so results never stall
+	static const int QUERY_COUNT = 4;
+
+	// GPU frame time the scale is adjusted to hold
+	float m_targetFrameMilliseconds;
+	// limits for the render scale
+	float m_minimumScale;
+	float m_maximumScale;
+	// scale the offscreen framebuffer is allocated for
+	float m_allocatedScale;
+	// current render scale and the resulting render size
+	float m_renderScale;
+	int m_renderWidth;
+	int m_renderHeight;
+	// size of the window framebuffer
+	int m_outputWidth;
+	int m_outputHeight;
+
+	// offscreen framebuffer, allocated at the maximum scale so that
+	// scale changes only move the viewport
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_motionTexture;
+	GLuint m_depthTexture;
+	int m_framebufferWidth;
+	int m_framebufferHeight;
+
+	// ring of GL_TIME_ELAPSED queries
+	GLuint m_timerQueries[QUERY_COUNT];
+	bool m_bQueryPending[QUERY_COUNT];
+	int m_nextQuery;
+	// exponentially smoothed GPU frame time
+	float m_gpuFrameMilliseconds;
+
+	// optional temporal upscaler replacing the blit
+	TemporalUpscaler* m_pTemporalUpscaler;
+
+	void CreateFramebuffer(int width, int height);
+	void DestroyFramebuffer();
+	void CollectTimerResults();
+	void UpdateRenderScale(float gpuMilliseconds);
+};
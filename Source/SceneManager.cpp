@@ -23,6 +23,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "CpuMeshes.h"
+#include "CpuProfiler.h"
+#include "GpuProfiler.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+#include "RenderStats.h"
+#include "StartupProfiler.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -40,12 +47,37 @@
 namespace
 {
     const char* g_ModelName = "model";
+    const char* g_PreviousModelName = "previousModel";
     const char* g_ColorValueName = "objectColor";
     const char* g_TextureValueName = "objectTexture";
     const char* g_UseTextureName = "bUseTexture";
     const char* g_UseLightingName = "bUseLighting";
 
     static const std::chrono::steady_clock::time_point g_StartTime = std::chrono::steady_clock::now();
+
+    // all textures used in the scene
+    const SceneManager::TEXTURE_FILE g_SceneTextures[] =
+    {
+        { "textures/wood.jpg", "wood" },
+        { "textures/metal.jpg", "metal" },
+        { "textures/candle.jpg", "candle" },
+        { "textures/book.jpg", "book" },
+        { "textures/page.jpg", "page" },
+        { "textures/pen.jpg", "pen" },
+        { "textures/inkpot.png", "inkpot" },
+        { "textures/cloth.jpg", "cloth" },
+    };
+    const int g_SceneTextureCount = (int)(sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]));
+
+    /***********************************************************
+     *  SameLight()
+     ***********************************************************/
+    bool SameLight(const DRAW_LIGHT& a, const DRAW_LIGHT& b)
+    {
+        return (a.position == b.position) && (a.ambient == b.ambient) &&
+            (a.diffuse == b.diffuse) && (a.specular == b.specular) &&
+            (a.bActive == b.bActive);
+    }
 }
 
 /***********************************************************
@@ -54,14 +86,24 @@ namespace
 SceneManager::SceneManager(ShaderManager* pShaderManager)
 {
     m_pShaderManager = pShaderManager;
-    m_basicMeshes = new ShapeMeshes();
+    // the meshes are created by PrepareScene(), with a context current
+    m_basicMeshes = NULL;
 
     for (int i = 0; i < 16; i++)
     {
         m_textureIDs[i].tag = "/0";
         m_textureIDs[i].ID = -1;
+        m_textureSlots[i] = -1;
+    }
+    for (int i = 0; i < DRAW_MESH_COUNT; i++)
+    {
+        m_meshTriangles[i] = 0;
     }
     m_loadedTextures = 0;
+    m_pDrawList = NULL;
+    m_pGpuProfiler = NULL;
+    m_pPerfCounters = NULL;
+    m_bShaderLightsLoaded = false;
 }
 
 /***********************************************************
@@ -77,56 +119,115 @@ SceneManager::~SceneManager()
 }
 
 /***********************************************************
- *  CreateGLTexture()
+ *  PrepareTextureDecoding()
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+void SceneManager::PrepareTextureDecoding()
 {
+    stbi_set_flip_vertically_on_load(true);
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ ***********************************************************/
+bool SceneManager::DecodeTexture(const char* filename, DECODED_TEXTURE& texture)
+{
+    PROFILE_SCOPE("DecodeTexture");
+
     int width = 0;
     int height = 0;
     int colorChannels = 0;
-    GLuint textureID = 0;
-
-    stbi_set_flip_vertically_on_load(true);
 
     unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, 0);
 
     if (image)
     {
-        std::cout << "Loaded texture: " << filename << " (" << width << "x" << height << ", channels: " << colorChannels << ")\n";
+        LOG_INFO("Loaded texture: %s (%dx%d, channels: %d)", filename, width, height, colorChannels);
 
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        texture.pixels.assign(image, image + (size_t)width * height * colorChannels);
+        texture.width = width;
+        texture.height = height;
+        texture.colorChannels = colorChannels;
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        stbi_image_free(image);
+        return true;
+    }
 
-        if (colorChannels == 3)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-        else if (colorChannels == 4)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-        else
-        {
-            std::cout << "Unsupported channel count: " << colorChannels << std::endl;
-            stbi_image_free(image);
-            return false;
-        }
+    LOG_ERROR("Failed to load texture: %s", filename);
+    return false;
+}
 
-        glGenerateMipmap(GL_TEXTURE_2D);
+/***********************************************************
+ *  CountMeshTriangles()
+ ***********************************************************/
+void SceneManager::CountMeshTriangles(uint32_t meshTriangles[DRAW_MESH_COUNT])
+{
+    // the CPU copies are tessellated like the basic meshes, so their
+    // index counts give the triangles each draw submits
+    CpuMeshes cpuMeshes;
+    for (int i = 0; i < DRAW_MESH_COUNT; i++)
+    {
+        meshTriangles[i] = (uint32_t)(cpuMeshes.GetMesh((DRAW_MESH)i).indices.size() / 3);
+    }
+}
 
-        stbi_image_free(image);
-        glBindTexture(GL_TEXTURE_2D, 0);
+/***********************************************************
+ *  CreateGLTexture()
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+{
+    PROFILE_SCOPE("CreateGLTexture");
 
-        m_textureIDs[m_loadedTextures].ID = textureID;
-        m_textureIDs[m_loadedTextures].tag = tag;
-        m_loadedTextures++;
+    PrepareTextureDecoding();
 
-        return true;
+    DECODED_TEXTURE texture;
+    if (!DecodeTexture(filename, texture))
+    {
+        return false;
     }
+    return UploadGLTexture(texture, tag);
+}
 
-    std::cout << "Failed to load texture: " << filename << std::endl;
-    return false;
+/***********************************************************
+ *  UploadGLTexture()
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(const DECODED_TEXTURE& texture, std::string tag)
+{
+    PROFILE_SCOPE("UploadGLTexture");
+
+    GLenum internalFormat = GL_RGB8;
+    GLenum format = GL_RGB;
+    if (texture.colorChannels == 4)
+    {
+        internalFormat = GL_RGBA8;
+        format = GL_RGBA;
+    }
+    else if (texture.colorChannels != 3)
+    {
+        LOG_ERROR("Unsupported channel count: %d", texture.colorChannels);
+        return false;
+    }
+
+    GLuint textureID = 0;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texture.width, texture.height, 0, format, GL_UNSIGNED_BYTE, texture.pixels.data());
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+    RenderStats::Current().bytesUploaded += (uint64_t)texture.pixels.size();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_textureIDs[m_loadedTextures].ID = textureID;
+    m_textureIDs[m_loadedTextures].tag = tag;
+    m_loadedTextures++;
+
+    return true;
 }
 
 /***********************************************************
@@ -139,6 +240,7 @@ void SceneManager::BindGLTextures()
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
     }
+    RenderStats::Current().textureBinds += m_loadedTextures;
 }
 
 /***********************************************************
@@ -180,6 +282,22 @@ int SceneManager::FindTextureSlot(std::string tag)
     return -1;
 }
 
+/***********************************************************
+ *  GetSceneTextureCount()
+ ***********************************************************/
+int SceneManager::GetSceneTextureCount()
+{
+    return g_SceneTextureCount;
+}
+
+/***********************************************************
+ *  GetSceneTextureFile()
+ ***********************************************************/
+const SceneManager::TEXTURE_FILE& SceneManager::GetSceneTextureFile(int index)
+{
+    return g_SceneTextures[index];
+}
+
 /***********************************************************
  *  SetTransformations()
  ***********************************************************/
@@ -200,10 +318,7 @@ void SceneManager::SetTransformations(
 
     modelView = translation * rotationZ * rotationY * rotationX * scale;
 
-    if (m_pShaderManager)
-    {
-        m_pShaderManager->setMat4Value(g_ModelName, modelView);
-    }
+    m_drawState.model = modelView;
 }
 
 /***********************************************************
@@ -217,11 +332,8 @@ void SceneManager::SetShaderColor(
 {
     glm::vec4 currentColor(redColorValue, greenColorValue, blueColorValue, alphaValue);
 
-    if (m_pShaderManager)
-    {
-        m_pShaderManager->setIntValue(g_UseTextureName, false);
-        m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-    }
+    m_drawState.bUseTexture = false;
+    m_drawState.color = currentColor;
 }
 
 /***********************************************************
@@ -229,13 +341,17 @@ void SceneManager::SetShaderColor(
  ***********************************************************/
 void SceneManager::SetShaderTexture(std::string textureTag)
 {
-    if (m_pShaderManager)
-    {
-        m_pShaderManager->setIntValue(g_UseTextureName, true);
+    m_drawState.bUseTexture = true;
 
-        int textureSlot = FindTextureSlot(textureTag);
-        if (textureSlot < 0) textureSlot = 0;
-        m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+    // unknown tags fall back to the first texture
+    m_drawState.textureIndex = 0;
+    for (int i = 0; i < g_SceneTextureCount; i++)
+    {
+        if (textureTag == g_SceneTextures[i].tag)
+        {
+            m_drawState.textureIndex = i;
+            break;
+        }
     }
 }
 
@@ -244,10 +360,7 @@ void SceneManager::SetShaderTexture(std::string textureTag)
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-    if (m_pShaderManager)
-    {
-        m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-    }
+    m_drawState.uvScale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -303,8 +416,6 @@ void SceneManager::DefineObjectMaterials()
  ***********************************************************/
 void SceneManager::SetShaderMaterial(const std::string& materialTag)
 {
-    if (!m_pShaderManager) return;
-
     OBJECT_MATERIAL selected;
     bool found = false;
     for (auto& mat : m_objectMaterials)
@@ -324,9 +435,9 @@ void SceneManager::SetShaderMaterial(const std::string& materialTag)
         selected.shininess = 8.0f;
     }
 
-    m_pShaderManager->setVec3Value("material.diffuseColor", selected.diffuseColor);
-    m_pShaderManager->setVec3Value("material.specularColor", selected.specularColor);
-    m_pShaderManager->setFloatValue("material.shininess", selected.shininess);
+    m_drawState.material.diffuseColor = selected.diffuseColor;
+    m_drawState.material.specularColor = selected.specularColor;
+    m_drawState.material.shininess = selected.shininess;
 }
 
 /***********************************************************
@@ -334,6 +445,27 @@ void SceneManager::SetShaderMaterial(const std::string& materialTag)
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
+    // Directional light (soft top-down)
+    m_lights.directional.position = glm::vec3(-0.2f, -1.0f, -0.3f);
+    m_lights.directional.ambient = glm::vec3(0.12f, 0.12f, 0.12f);
+    m_lights.directional.diffuse = glm::vec3(0.55f, 0.52f, 0.48f);
+    m_lights.directional.specular = glm::vec3(0.4f, 0.4f, 0.4f);
+    m_lights.directional.bActive = true;
+
+    // Point light 0 - warm candle light
+    m_lights.pointLights[0].position = glm::vec3(0.0f, 3.0f, 0.0f);
+    m_lights.pointLights[0].ambient = glm::vec3(0.06f, 0.03f, 0.02f);  // small warm ambient
+    m_lights.pointLights[0].diffuse = glm::vec3(0.95f, 0.6f, 0.25f);  // warm bright
+    m_lights.pointLights[0].specular = glm::vec3(1.0f, 0.8f, 0.5f);
+    m_lights.pointLights[0].bActive = true;
+
+    // Point light 1 - cool fill light to the left/back to avoid pure black shadows
+    m_lights.pointLights[1].position = glm::vec3(-4.0f, 5.0f, -2.0f);
+    m_lights.pointLights[1].ambient = glm::vec3(0.03f, 0.03f, 0.05f);
+    m_lights.pointLights[1].diffuse = glm::vec3(0.35f, 0.45f, 0.6f);
+    m_lights.pointLights[1].specular = glm::vec3(0.35f, 0.35f, 0.4f);
+    m_lights.pointLights[1].bActive = true;
+
     if (!m_pShaderManager) return;
 
     // Making sure the shader program is active
@@ -342,44 +474,62 @@ void SceneManager::SetupSceneLights()
     // Turn lighting on
     m_pShaderManager->setBoolValue("bUseLighting", true);
 
-    // Directional light (soft top-down)
-    m_pShaderManager->setVec3Value("directionalLight.direction", -0.2f, -1.0f, -0.3f);
-    m_pShaderManager->setVec3Value("directionalLight.ambient", 0.12f, 0.12f, 0.12f);
-    m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.55f, 0.52f, 0.48f);
-    m_pShaderManager->setVec3Value("directionalLight.specular", 0.4f, 0.4f, 0.4f);
-    m_pShaderManager->setIntValue("directionalLight.bActive", true);
-
-    // Point light 0 - warm candle light
-    m_pShaderManager->setVec3Value("pointLights[0].position", 0.0f, 3.0f, 0.0f);
-    m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.06f, 0.03f, 0.02f);  // small warm ambient
-    m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.95f, 0.6f, 0.25f);  // warm bright
-    m_pShaderManager->setVec3Value("pointLights[0].specular", 1.0f, 0.8f, 0.5f);
-    m_pShaderManager->setIntValue("pointLights[0].bActive", true);
-
-    // Point light 1 - cool fill light to the left/back to avoid pure black shadows
-    m_pShaderManager->setVec3Value("pointLights[1].position", -4.0f, 5.0f, -2.0f);
-    m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.03f, 0.03f, 0.05f);
-    m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.35f, 0.45f, 0.6f);
-    m_pShaderManager->setVec3Value("pointLights[1].specular", 0.35f, 0.35f, 0.4f);
-    m_pShaderManager->setIntValue("pointLights[1].bActive", true);
+    LoadLightIntoShader("directionalLight", m_lights.directional, true);
+    for (int i = 0; i < DRAW_POINT_LIGHTS; i++)
+    {
+        std::string name = "pointLights[" + std::to_string(i) + "]";
+        LoadLightIntoShader(name.c_str(), m_lights.pointLights[i], false);
+    }
+    m_shaderLights = m_lights;
 
     m_pShaderManager->setIntValue("spotLight.bActive", false);
+    m_bShaderLightsLoaded = true;
+}
+
+/***********************************************************
+ *  LoadLightIntoShader()
+ ***********************************************************/
+void SceneManager::LoadLightIntoShader(const char* name, const DRAW_LIGHT& light, bool bDirectional)
+{
+    std::string prefix = std::string(name) + ".";
+    m_pShaderManager->setVec3Value(prefix + (bDirectional ? "direction" : "position"), light.position);
+    m_pShaderManager->setVec3Value(prefix + "ambient", light.ambient);
+    m_pShaderManager->setVec3Value(prefix + "diffuse", light.diffuse);
+    m_pShaderManager->setVec3Value(prefix + "specular", light.specular);
+    m_pShaderManager->setIntValue(prefix + "bActive", light.bActive);
+
+    RENDER_STATS& stats = RenderStats::Current();
+    stats.uniformWrites += 5;
+    stats.bytesUploaded += 4 * sizeof(glm::vec3) + sizeof(int);
 }
 
 /***********************************************************
  *  LoadSceneTextures()
  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+void SceneManager::LoadSceneTextures(const DECODED_TEXTURE* pDecodedTextures)
 {
-    // loading all textures used in the scene
-    CreateGLTexture("textures/wood.jpg", "wood");
-    CreateGLTexture("textures/metal.jpg", "metal");
-    CreateGLTexture("textures/candle.jpg", "candle");
-    CreateGLTexture("textures/book.jpg", "book");
-    CreateGLTexture("textures/page.jpg", "page");
-    CreateGLTexture("textures/pen.jpg", "pen");
-    CreateGLTexture("textures/inkpot.png", "inkpot");
-    CreateGLTexture("textures/cloth.jpg", "cloth");
+    PROFILE_SCOPE("LoadSceneTextures");
+    StartupPhase startupPhase("LoadSceneTextures");
+
+    // loading all textures used in the scene, decoding them here unless
+    // that was done ahead of time - a texture that failed to decode
+    // has no pixels
+    for (int i = 0; i < g_SceneTextureCount; i++)
+    {
+        bool bLoaded = false;
+        if (NULL == pDecodedTextures)
+        {
+            bLoaded = CreateGLTexture(g_SceneTextures[i].filename, g_SceneTextures[i].tag);
+        }
+        else if (!pDecodedTextures[i].pixels.empty())
+        {
+            bLoaded = UploadGLTexture(pDecodedTextures[i], g_SceneTextures[i].tag);
+        }
+        if (bLoaded)
+        {
+            m_textureSlots[i] = m_loadedTextures - 1;
+        }
+    }
 
     BindGLTextures();
 }
@@ -387,52 +537,158 @@ void SceneManager::LoadSceneTextures()
 /***********************************************************
  *  PrepareScene()
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::PrepareScene(const SCENE_ASSETS* pAssets)
 {
-    LoadSceneTextures(); // loading all textures first
+    PROFILE_SCOPE("PrepareScene");
+
+    // loading all textures first
+    LoadSceneTextures((NULL != pAssets) ? pAssets->textures : NULL);
 
-    m_basicMeshes->LoadBoxMesh();
-    m_basicMeshes->LoadPlaneMesh();
-    m_basicMeshes->LoadCylinderMesh(1.0f, 1.0f, 72);
-    m_basicMeshes->LoadConeMesh();
-    m_basicMeshes->LoadPrismMesh();
-    m_basicMeshes->LoadPyramid4Mesh();
-    m_basicMeshes->LoadSphereMesh();
-    m_basicMeshes->LoadTaperedCylinderMesh();
-    m_basicMeshes->LoadTorusMesh();
+    // the basic meshes build their buffers as they are generated, so
+    // they are made here with the context current
+    {
+        StartupPhase startupPhase("LoadMeshes");
+        m_basicMeshes = new ShapeMeshes();
+        m_basicMeshes->LoadBoxMesh();
+        m_basicMeshes->LoadPlaneMesh();
+        m_basicMeshes->LoadCylinderMesh(1.0f, 1.0f, 72);
+        m_basicMeshes->LoadConeMesh();
+        m_basicMeshes->LoadPrismMesh();
+        m_basicMeshes->LoadPyramid4Mesh();
+        m_basicMeshes->LoadSphereMesh();
+        m_basicMeshes->LoadTaperedCylinderMesh();
+        m_basicMeshes->LoadTorusMesh();
+    }
 
+    if (NULL != pAssets)
+    {
+        for (int i = 0; i < DRAW_MESH_COUNT; i++)
+        {
+            m_meshTriangles[i] = pAssets->meshTriangles[i];
+        }
+    }
+    else
+    {
+        StartupPhase startupPhase("CountMeshTriangles");
+        CountMeshTriangles(m_meshTriangles);
+    }
+
+    PrepareSceneDescription();
+}
+
+/***********************************************************
+ *  PrepareSceneDescription()
+ ***********************************************************/
+void SceneManager::PrepareSceneDescription()
+{
     DefineObjectMaterials();
     SetupSceneLights();
 }
 
+/***********************************************************
+ *  UpdateSceneAnimation()
+ ***********************************************************/
+void SceneManager::UpdateSceneAnimation(FRAME_STATE& frameState)
+{
+    UpdateSceneAnimation(frameState, GetAnimationSeconds());
+}
+
+/***********************************************************
+ *  GetAnimationSeconds()
+ ***********************************************************/
+float SceneManager::GetAnimationSeconds()
+{
+    return std::chrono::duration<float>(
+        std::chrono::steady_clock::now() - g_StartTime).count();
+}
+
+/***********************************************************
+ *  UpdateSceneAnimation()
+ *
+ *  Advance the animation to the given time on a clock the
+ *  caller controls, so replays flicker the same way.
+ ***********************************************************/
+void SceneManager::UpdateSceneAnimation(FRAME_STATE& frameState, float elapsedSeconds)
+{
+    // candle light animation
+    float flicker = 0.92f + 0.12f * std::sin(elapsedSeconds * 12.0f)
+        + 0.03f * std::sin(elapsedSeconds * 37.0f);
+
+    glm::vec3 baseDiffuse(0.95f, 0.60f, 0.25f);
+    glm::vec3 baseAmbient(0.07f, 0.04f, 0.02f);
+
+    frameState.elapsedSeconds = elapsedSeconds;
+    frameState.flicker = flicker;
+    frameState.glowPulse = 1.0f + 0.08f * std::sin(elapsedSeconds * 8.0f);
+    frameState.candleLightDiffuse = baseDiffuse * flicker;
+    frameState.candleLightAmbient = baseAmbient * (0.6f + 0.4f * flicker);
+    frameState.candleLightSpecular = glm::vec3(1.0f, 0.8f, 0.5f) * flicker;
+}
+
 /***********************************************************
  *  RenderScene()
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::RenderScene(const FRAME_STATE& frameState)
+{
+    PROFILE_SCOPE("RenderScene");
+
+    // the model matrices are built on the CPU, then sent as uniforms
+    // with the draws
+    {
+        PerfCounterScope perfScope(m_pPerfCounters, "build transforms");
+        BuildDrawList(frameState, m_drawList);
+    }
+    {
+        PerfCounterScope perfScope(m_pPerfCounters, "submit uniforms and draws");
+        SubmitDrawList(m_drawList, true);
+    }
+}
+
+/***********************************************************
+ *  RenderAuxiliaryScene()
+ *
+ *  This method draws the frame like RenderScene(), but the
+ *  model matrices the motion vectors start from next frame
+ *  are left as the last interactive frame set them.
+ ***********************************************************/
+void SceneManager::RenderAuxiliaryScene(const FRAME_STATE& frameState)
 {
+    PROFILE_SCOPE("RenderAuxiliaryScene");
+
+    BuildDrawList(frameState, m_drawList);
+    SubmitDrawList(m_drawList, false);
+}
+
+/***********************************************************
+ *  BuildDrawList()
+ ***********************************************************/
+void SceneManager::BuildDrawList(const FRAME_STATE& frameState, DRAW_LIST& drawList)
+{
+    PROFILE_SCOPE("BuildDrawList");
+
     glm::vec3 scaleXYZ;
     glm::vec3 positionXYZ;
 
-    // background color
-    glClearColor(0.74f, 0.72f, 0.70f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_pDrawList = &drawList;
+    m_pDrawList->commands.clear();
+    m_pDrawList->lights = m_lights;
+    m_drawState = DRAW_COMMAND();
 
-    if (m_pShaderManager)
-    {
-        m_pShaderManager->use();
-        m_pShaderManager->setBoolValue("bUseLighting", true);
-    }
+    // background color
+    m_pDrawList->clearColor = glm::vec4(0.74f, 0.72f, 0.70f, 1.0f);
+    m_pDrawList->bUseLighting = true;
 
     // ---------------------------
     // TABLE
     // ---------------------------
+    SetObjectName("table");
     scaleXYZ = glm::vec3(22.0f, 0.4f, 12.0f);
     positionXYZ = glm::vec3(0.0f, -0.3f, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("wood");
     SetTextureUVScale(8.0f, 8.0f);
     SetShaderMaterial("cement");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(DRAW_MESH_BOX);
 
     // ---------------------------
     // CANDLE HOLDER + CANDLE
@@ -440,13 +696,15 @@ void SceneManager::RenderScene()
     glm::vec3 candleOffset = glm::vec3(-3.5f, 0.0f, -3.0f);
     float currentY = 0.0f;
 
+    SetObjectName("candle holder");
+
     // base of the candle holder
     scaleXYZ = glm::vec3(1.6f, 0.6f, 1.6f);
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("metal");
     SetTextureUVScale(4.0f, 2.0f);
-    m_basicMeshes->DrawTaperedCylinderMesh();
+    DrawMesh(DRAW_MESH_TAPERED_CYLINDER);
     currentY += 0.6f;
 
     // stem part
@@ -455,7 +713,7 @@ void SceneManager::RenderScene()
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("metal");
     SetTextureUVScale(2.5f, 0.5f);
-    m_basicMeshes->DrawCylinderMesh();
+    DrawMesh(DRAW_MESH_CYLINDER);
     currentY += 1.0f;
 
     // small metal sphere decoration
@@ -463,7 +721,7 @@ void SceneManager::RenderScene()
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("metal");
-    m_basicMeshes->DrawSphereMesh();
+    DrawMesh(DRAW_MESH_SPHERE);
     currentY += 0.15f;
 
     // upper stem
@@ -471,7 +729,7 @@ void SceneManager::RenderScene()
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("metal");
-    m_basicMeshes->DrawCylinderMesh();
+    DrawMesh(DRAW_MESH_CYLINDER);
     currentY += 0.8f;
 
     // cup part
@@ -479,91 +737,324 @@ void SceneManager::RenderScene()
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY + 0.7f, 0.0f);
     SetTransformations(scaleXYZ, 180, 0, 0, positionXYZ);
     SetShaderTexture("metal");
-    m_basicMeshes->DrawTaperedCylinderMesh();
+    DrawMesh(DRAW_MESH_TAPERED_CYLINDER);
 
     // rim on top of the cup
     scaleXYZ = glm::vec3(1.2f, 0.2f, 1.2f);
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY + 0.7f, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("metal");
-    m_basicMeshes->DrawCylinderMesh();
+    DrawMesh(DRAW_MESH_CYLINDER);
     currentY += 1.0f;
 
+    SetObjectName("candle");
+
     // candle itself
     scaleXYZ = glm::vec3(0.9f, 2.0f, 0.9f);
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY - 0.2f, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderTexture("candle");
     SetTextureUVScale(1.0f, 0.8f);
-    m_basicMeshes->DrawCylinderMesh();
+    DrawMesh(DRAW_MESH_CYLINDER);
 
     // wick
     scaleXYZ = glm::vec3(0.04f, 0.05f, 0.04f);
     positionXYZ = candleOffset + glm::vec3(0.0f, currentY + 1.8f, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderColor(0.05f, 0.05f, 0.05f, 1.0f);
-    m_basicMeshes->DrawCylinderMesh();
+    DrawMesh(DRAW_MESH_CYLINDER);
 
-    // candle light animation
-    float elapsedSeconds = std::chrono::duration<float>(
-        std::chrono::steady_clock::now() - g_StartTime).count();
-    float flicker = 0.92f + 0.12f * std::sin(elapsedSeconds * 12.0f)
-        + 0.03f * std::sin(elapsedSeconds * 37.0f);
+    // candle light animation, as recorded by the simulation thread
+    float flicker = frameState.flicker;
 
     glm::vec3 flamePos = candleOffset + glm::vec3(0.0f, currentY + 2.0f, 0.0f);
-    if (m_pShaderManager)
-    {
-        m_pShaderManager->use();
-        m_pShaderManager->setVec3Value("pointLights[0].position", flamePos);
-
-        glm::vec3 baseDiffuse(0.95f, 0.60f, 0.25f);
-        glm::vec3 baseAmbient(0.07f, 0.04f, 0.02f);
-
-        glm::vec3 flickerDiffuse = baseDiffuse * flicker;
-        glm::vec3 flickerAmbient = baseAmbient * (0.6f + 0.4f * flicker);
-
-        m_pShaderManager->setVec3Value("pointLights[0].diffuse", flickerDiffuse);
-        m_pShaderManager->setVec3Value("pointLights[0].ambient", flickerAmbient);
-        m_pShaderManager->setVec3Value("pointLights[0].specular",
-            1.0f * flicker, 0.8f * flicker, 0.5f * flicker);
-        m_pShaderManager->setIntValue("pointLights[0].bActive", true);
-    }
+    DRAW_LIGHT& candleLight = m_pDrawList->lights.pointLights[0];
+    candleLight.position = flamePos;
+    candleLight.diffuse = frameState.candleLightDiffuse;
+    candleLight.ambient = frameState.candleLightAmbient;
+    candleLight.specular = frameState.candleLightSpecular;
+    candleLight.bActive = true;
 
     // flame core
+    SetObjectName("flame");
     scaleXYZ = glm::vec3(0.05f, 0.25f, 0.05f);
     SetTransformations(scaleXYZ, 0, 0, 0, flamePos);
     SetShaderColor(1.2f * flicker, 0.95f * flicker, 0.45f * flicker, 1.0f);
-    m_basicMeshes->DrawSphereMesh();
+    DrawMesh(DRAW_MESH_SPHERE);
 
     // glow around the flame
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE);
+    SetObjectName("flame glow");
+    m_drawState.bBlend = true;
 
-    float glowPulse = 1.0f + 0.08f * std::sin(elapsedSeconds * 8.0f);
+    float glowPulse = frameState.glowPulse;
     scaleXYZ = glm::vec3(0.12f * glowPulse, 0.40f * glowPulse, 0.12f * glowPulse);
     positionXYZ = flamePos + glm::vec3(0.0f, 0.05f, 0.0f);
     SetTransformations(scaleXYZ, 0, 0, 0, positionXYZ);
     SetShaderColor(1.0f, 0.9f, 0.7f, 0.3f * (0.9f + 0.1f * flicker));
-    m_basicMeshes->DrawSphereMesh();
+    DrawMesh(DRAW_MESH_SPHERE);
 
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    m_drawState.bBlend = false;
 
     // book + pen + ink setup
     DrawBookSetup();
+
+    m_pDrawList = NULL;
+}
+
+
+/***********************************************************
+ *  SetObjectName()
+ ***********************************************************/
+void SceneManager::SetObjectName(const char* pObjectName)
+{
+    m_drawState.pObjectName = pObjectName;
+}
+
+/***********************************************************
+ *  DrawMesh()
+ ***********************************************************/
+void SceneManager::DrawMesh(DRAW_MESH mesh)
+{
+    m_drawState.mesh = mesh;
+    m_pDrawList->commands.push_back(m_drawState);
+}
+
+/***********************************************************
+ *  SubmitDrawList()
+ ***********************************************************/
+void SceneManager::SubmitDrawList(const DRAW_LIST& drawList, bool bKeepModels)
+{
+    PROFILE_SCOPE("SubmitDrawList");
+
+    glClearColor(drawList.clearColor.r, drawList.clearColor.g, drawList.clearColor.b, drawList.clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (!m_pShaderManager || !m_basicMeshes) return;
+
+    // counted into the frame's statistics as the calls are made
+    RENDER_STATS& stats = RenderStats::Current();
+
+    m_pShaderManager->use();
+    m_pShaderManager->setBoolValue(g_UseLightingName, drawList.bUseLighting);
+    stats.stateChanges++;
+    stats.uniformWrites++;
+    stats.bytesUploaded += sizeof(int);
+
+    // in practice only the candle light changes between frames, unless
+    // the program was switched and has none loaded yet
+    if (!m_bShaderLightsLoaded)
+    {
+        m_pShaderManager->setIntValue("spotLight.bActive", false);
+        stats.uniformWrites++;
+        stats.bytesUploaded += sizeof(int);
+    }
+    if (!m_bShaderLightsLoaded || !SameLight(drawList.lights.directional, m_shaderLights.directional))
+    {
+        LoadLightIntoShader("directionalLight", drawList.lights.directional, true);
+    }
+    for (int i = 0; i < DRAW_POINT_LIGHTS; i++)
+    {
+        if (!m_bShaderLightsLoaded || !SameLight(drawList.lights.pointLights[i], m_shaderLights.pointLights[i]))
+        {
+            std::string name = "pointLights[" + std::to_string(i) + "]";
+            LoadLightIntoShader(name.c_str(), drawList.lights.pointLights[i], false);
+        }
+    }
+    m_shaderLights = drawList.lights;
+    m_bShaderLightsLoaded = true;
+
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    stats.stateChanges += 2;
+    bool bBlending = false;
+
+    // the values loaded into the shader so far this frame
+    int loadedUseTexture = -1;
+    int loadedTextureSlot = -1;
+    bool bColorLoaded = false;
+    glm::vec4 loadedColor;
+    bool bUVScaleLoaded = false;
+    glm::vec2 loadedUVScale;
+    bool bMaterialLoaded = false;
+    DRAW_MATERIAL loadedMaterial;
+
+    // each run of draws of one object is timed as a scope
+    const char* pProfiledObject = NULL;
+
+    for (size_t i = 0; i < drawList.commands.size(); i++)
+    {
+        const DRAW_COMMAND& command = drawList.commands[i];
+
+        if ((NULL != m_pGpuProfiler) && (command.pObjectName != pProfiledObject))
+        {
+            if (NULL != pProfiledObject)
+            {
+                m_pGpuProfiler->EndScope();
+            }
+            pProfiledObject = command.pObjectName;
+            if (NULL != pProfiledObject)
+            {
+                m_pGpuProfiler->BeginScope(pProfiledObject);
+            }
+        }
+
+        // the scene draws in the same order every frame, so the draw
+        // index identifies the object across frames
+        if (bKeepModels && (i >= m_previousModels.size()))
+        {
+            m_previousModels.push_back(command.model);
+        }
+        m_pShaderManager->setMat4Value(g_ModelName, command.model);
+        m_pShaderManager->setMat4Value(g_PreviousModelName,
+            (i < m_previousModels.size()) ? m_previousModels[i] : command.model);
+        if (bKeepModels)
+        {
+            m_previousModels[i] = command.model;
+        }
+        stats.uniformWrites += 2;
+        stats.bytesUploaded += 2 * sizeof(glm::mat4);
+
+        if (loadedUseTexture != (int)command.bUseTexture)
+        {
+            m_pShaderManager->setIntValue(g_UseTextureName, command.bUseTexture);
+            loadedUseTexture = (int)command.bUseTexture;
+            stats.uniformWrites++;
+            stats.bytesUploaded += sizeof(int);
+        }
+        if (command.bUseTexture)
+        {
+            int textureSlot = m_textureSlots[command.textureIndex];
+            if (textureSlot < 0) textureSlot = 0;
+            if (textureSlot != loadedTextureSlot)
+            {
+                m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+                loadedTextureSlot = textureSlot;
+                // every texture stays bound to its own unit, so moving the
+                // sampler to another unit is the texture switch
+                stats.textureBinds++;
+                stats.uniformWrites++;
+                stats.bytesUploaded += sizeof(int);
+            }
+        }
+        else if (!bColorLoaded || (command.color != loadedColor))
+        {
+            m_pShaderManager->setVec4Value(g_ColorValueName, command.color);
+            loadedColor = command.color;
+            bColorLoaded = true;
+            stats.uniformWrites++;
+            stats.bytesUploaded += sizeof(glm::vec4);
+        }
+        if (!bUVScaleLoaded || (command.uvScale != loadedUVScale))
+        {
+            m_pShaderManager->setVec2Value("UVscale", command.uvScale);
+            loadedUVScale = command.uvScale;
+            bUVScaleLoaded = true;
+            stats.uniformWrites++;
+            stats.bytesUploaded += sizeof(glm::vec2);
+        }
+        if (!bMaterialLoaded ||
+            (command.material.diffuseColor != loadedMaterial.diffuseColor) ||
+            (command.material.specularColor != loadedMaterial.specularColor) ||
+            (command.material.shininess != loadedMaterial.shininess))
+        {
+            m_pShaderManager->setVec3Value("material.diffuseColor", command.material.diffuseColor);
+            m_pShaderManager->setVec3Value("material.specularColor", command.material.specularColor);
+            m_pShaderManager->setFloatValue("material.shininess", command.material.shininess);
+            loadedMaterial = command.material;
+            bMaterialLoaded = true;
+            stats.uniformWrites += 3;
+            stats.bytesUploaded += 2 * sizeof(glm::vec3) + sizeof(float);
+        }
+
+        if (command.bBlend != bBlending)
+        {
+            if (command.bBlend)
+            {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+                stats.stateChanges += 3;
+            }
+            else
+            {
+                glDepthMask(GL_TRUE);
+                glDisable(GL_BLEND);
+                stats.stateChanges += 2;
+            }
+            bBlending = command.bBlend;
+        }
+
+        switch (command.mesh)
+        {
+        case DRAW_MESH_BOX: m_basicMeshes->DrawBoxMesh(); break;
+        case DRAW_MESH_PLANE: m_basicMeshes->DrawPlaneMesh(); break;
+        case DRAW_MESH_CYLINDER: m_basicMeshes->DrawCylinderMesh(); break;
+        case DRAW_MESH_CONE: m_basicMeshes->DrawConeMesh(); break;
+        case DRAW_MESH_SPHERE: m_basicMeshes->DrawSphereMesh(); break;
+        case DRAW_MESH_TAPERED_CYLINDER: m_basicMeshes->DrawTaperedCylinderMesh(); break;
+        default: continue;
+        }
+        stats.drawCalls++;
+        stats.triangles += m_meshTriangles[command.mesh];
+    }
+
+    if (NULL != pProfiledObject)
+    {
+        m_pGpuProfiler->EndScope();
+    }
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    stats.stateChanges += 2;
 }
 
+/***********************************************************
+ *  SetPageLayerTransformations()
+ *
+ *  Stack the page layers a little apart, with a slight wave,
+ *  and arch and fan them out more towards the middle of the
+ *  book.
+ ***********************************************************/
+void SceneManager::SetPageLayerTransformations(
+    int layer,
+    int layerCount,
+    const glm::vec3& bookPosition,
+    float bookScaleFactor,
+    float baseRotationY,
+    const glm::vec3& pageScale)
+{
+    float baseY = -0.02f * bookScaleFactor;
+    float yOffset = baseY + layer * (pageScale.y * 0.8f);
+    float subtleWave = 0.002f * sinf(layer * 0.5f);
+
+    float normalized = (layer - layerCount / 2.0f) / (layerCount / 2.0f);
+    float smoothCurve = powf(fabs(normalized), 1.5f);
+    float archAmplitude = 0.10f * bookScaleFactor * (1.0f - smoothCurve);
+
+    float xOffset = -0.01f * normalized;
+    float pageYaw = normalized * 0.12f;
+
+    float rotationAngleX = -archAmplitude * 0.5f;
+    float rotationAngleY = baseRotationY + pageYaw;
+
+    glm::vec3 positionXYZ = bookPosition + glm::vec3(xOffset, yOffset + subtleWave, 0.0f);
+
+    SetTransformations(pageScale, rotationAngleX, rotationAngleY, 0.0f, positionXYZ);
+}
 
 /***********************************************************
  *  DrawBookSetup()  My scene setup with book, pen, paper, and inkpot
  ***********************************************************/
 void SceneManager::DrawBookSetup()
 {
+    PROFILE_SCOPE("DrawBookSetup");
+
     glm::vec3 scaleXYZ, positionXYZ;
 
     // Tablecloth covering the whole table
     {
+        SetObjectName("tablecloth");
+
         glm::vec3 tableCenter = glm::vec3(0.0f, 0.0f, 0.0f);
 
         float clothWidth = 16.0f;
@@ -577,7 +1068,7 @@ void SceneManager::DrawBookSetup()
 
         SetShaderTexture("cloth"); // using the tablecloth texture
         SetTextureUVScale(4.0f, 4.0f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
     }
 
     // Main open book setup
@@ -592,42 +1083,30 @@ void SceneManager::DrawBookSetup()
     const float baseRotationY = 4.5f; // small rotation to make it more natural
 
     // Bottom book cover
+    SetObjectName("book cover");
     scaleXYZ = glm::vec3(coverWidth, coverThickness * 0.95f, coverDepth);
     positionXYZ = bookPosition;
     SetTransformations(scaleXYZ, 0.0f, baseRotationY, 0.0f, positionXYZ);
     SetShaderTexture("book");
     SetTextureUVScale(2.0f, 1.5f);
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(DRAW_MESH_BOX);
 
     // Book pages layered to look real
+    SetObjectName("book pages");
     const int numPageLayers = 25;
-    float baseY = -0.02f * bookScaleFactor;
+    const glm::vec3 pageScale = glm::vec3(pageWidth, pageThickness, coverDepth - 0.08f);
     for (int i = 0; i < numPageLayers; ++i)
     {
-        float yOffset = baseY + i * (pageThickness * 0.8f);
-        float subtleWave = 0.002f * sinf(i * 0.5f);
-
-        float normalized = (i - numPageLayers / 2.0f) / (numPageLayers / 2.0f);
-        float smoothCurve = powf(fabs(normalized), 1.5f);
-        float archAmplitude = 0.10f * bookScaleFactor * (1.0f - smoothCurve);
-
-        float xOffset = -0.01f * normalized;
-        float pageYaw = normalized * 0.12f;
-
-        float rotationAngleX = -archAmplitude * 0.5f;
-        float rotationAngleY = baseRotationY + pageYaw;
-
-        scaleXYZ = glm::vec3(pageWidth, pageThickness, coverDepth - 0.08f);
-        positionXYZ = bookPosition + glm::vec3(xOffset, yOffset + subtleWave, 0.0f);
-
-        SetTransformations(scaleXYZ, rotationAngleX, rotationAngleY, 0.0f, positionXYZ);
+        SetPageLayerTransformations(i, numPageLayers, bookPosition, bookScaleFactor, baseRotationY, pageScale);
         SetShaderTexture("page");
         SetTextureUVScale(1.0f, 1.0f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
     }
 
     // Center divider in the middle of the book
     {
+        SetObjectName("book divider");
+
         float totalHeight = numPageLayers * (pageThickness * 0.8f);
         float dividerCenterY = (-0.02f * bookScaleFactor) + (totalHeight * 0.5f);
         float dividerHeight = totalHeight * 1.05f;
@@ -638,18 +1117,20 @@ void SceneManager::DrawBookSetup()
         positionXYZ = bookPosition + glm::vec3(0.0f, dividerCenterY, 0.0f);
         SetTransformations(scaleXYZ, 0.0f, baseRotationY, 0.0f, positionXYZ);
         SetShaderColor(0.11f, 0.09f, 0.08f, 1.0f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
 
         // darker strip inside for detail
         scaleXYZ = glm::vec3(dividerThickness * 0.9f, dividerHeight * 0.95f, dividerDepth - 0.01f);
         positionXYZ = bookPosition + glm::vec3(0.0f, dividerCenterY - (pageThickness * 0.02f), 0.0f);
         SetTransformations(scaleXYZ, 0.0f, baseRotationY, 0.0f, positionXYZ);
         SetShaderColor(0.07f, 0.06f, 0.055f, 1.0f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
     }
 
     // Pen next to the book
     {
+        SetObjectName("pen");
+
         const float penScale = 1.7f;
 
         float length = 0.45f * bookScaleFactor * penScale;
@@ -669,59 +1150,63 @@ void SceneManager::DrawBookSetup()
         );
 
         // pen body with texture
-        if (m_pShaderManager) m_pShaderManager->setIntValue(g_UseTextureName, true);
+        m_drawState.bUseTexture = true;
         SetShaderTexture("pen");
         SetTextureUVScale(1.0f, 1.0f);
         SetTransformations(glm::vec3(rRear, rFront, length), 0.0f, rotY, 0.0f, center);
-        m_basicMeshes->DrawTaperedCylinderMesh();
+        DrawMesh(DRAW_MESH_TAPERED_CYLINDER);
 
         // white pen tip
         glm::vec3 front = center + dir * (length * 0.5f + 0.003f);
         glm::vec3 tipPos = front + dir * (tipLen * 0.5f + 0.003f);
         glm::vec3 tipScale = glm::vec3(tipRadius, tipRadius, tipLen);
 
-        if (m_pShaderManager) m_pShaderManager->setIntValue(g_UseTextureName, false);
+        m_drawState.bUseTexture = false;
         SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
         SetTransformations(tipScale, 0.0f, rotY, 0.0f, tipPos);
-        m_basicMeshes->DrawConeMesh();
+        DrawMesh(DRAW_MESH_CONE);
     }
 
     // Inkpot next to the book
     const float inkPotScale = 1.5f;
 
     {
+        SetObjectName("inkpot");
+
         glm::vec3 inkPotPos = bookPosition + glm::vec3(
             (coverWidth * 0.5f) + 0.95f,
             -0.30f,
             -2.8f * bookScaleFactor
         );
 
-        if (m_pShaderManager) m_pShaderManager->setIntValue(g_UseTextureName, true);
+        m_drawState.bUseTexture = true;
         SetShaderTexture("inkpot");
 
         // inkpot base
         SetTransformations(glm::vec3(0.4f, 0.45f, 0.4f) * bookScaleFactor * inkPotScale,
             0, 0, 0,
             inkPotPos + glm::vec3(0.0f, 0.25f * bookScaleFactor * inkPotScale, 0.0f));
-        m_basicMeshes->DrawSphereMesh();
+        DrawMesh(DRAW_MESH_SPHERE);
 
         // inkpot neck
         SetTransformations(glm::vec3(0.18f, 0.2f, 0.18f) * bookScaleFactor * inkPotScale,
             0, 0, 0,
             inkPotPos + glm::vec3(0.0f, 0.5f * bookScaleFactor * inkPotScale, 0.0f));
-        m_basicMeshes->DrawCylinderMesh();
+        DrawMesh(DRAW_MESH_CYLINDER);
 
         // lid on top
-        if (m_pShaderManager) m_pShaderManager->setIntValue(g_UseTextureName, false);
+        m_drawState.bUseTexture = false;
         SetShaderColor(0.08f, 0.08f, 0.08f, 1.0f);
         SetTransformations(glm::vec3(0.22f, 0.08f, 0.22f) * bookScaleFactor * inkPotScale,
             0, 0, 0,
             inkPotPos + glm::vec3(0.0f, 0.6f * bookScaleFactor * inkPotScale, 0.0f));
-        m_basicMeshes->DrawCylinderMesh();
+        DrawMesh(DRAW_MESH_CYLINDER);
     }
 
     // Paper under the book
     {
+        SetObjectName("paper");
+
         glm::vec3 paperPos = bookPosition + glm::vec3(
             -0.04f,
             -0.27f,
@@ -733,15 +1218,17 @@ void SceneManager::DrawBookSetup()
 
         glm::vec3 paperScale = glm::vec3(4.75f, 0.01f, 3.15f) * paperScaleFactor;
 
-        if (m_pShaderManager) m_pShaderManager->setIntValue(g_UseTextureName, true);
+        m_drawState.bUseTexture = true;
         SetShaderTexture("page");
         SetTextureUVScale(1.5f, 1.5f);
         SetTransformations(paperScale, 0.0f, paperRotationY, 0.0f, paperPos);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
     }
 
     // Closed book near the corner of the table
     {
+        SetObjectName("closed book");
+
         glm::vec3 tableCenter = glm::vec3(0.0f, 0.0f, 0.0f);
 
         const float closedBookScale = 1.25f;
@@ -760,7 +1247,7 @@ void SceneManager::DrawBookSetup()
             closedBookPos);
         SetShaderTexture("book");
         SetTextureUVScale(2.2f, 1.8f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
 
         // pages
         glm::vec3 pagePos = closedBookPos + glm::vec3(0.0f, coverThickness * 0.5f + pagesHeight * 0.5f, 0.0f);
@@ -769,7 +1256,7 @@ void SceneManager::DrawBookSetup()
             pagePos);
         SetShaderTexture("page");
         SetTextureUVScale(2.5f, 2.5f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
 
         // spine on the left side
         {
@@ -794,7 +1281,7 @@ void SceneManager::DrawBookSetup()
 
             SetShaderTexture("book");
             SetTextureUVScale(1.0f, 1.0f);
-            m_basicMeshes->DrawBoxMesh();
+            DrawMesh(DRAW_MESH_BOX);
         }
 
         // top cover
@@ -804,6 +1291,6 @@ void SceneManager::DrawBookSetup()
             topCoverPos);
         SetShaderTexture("book");
         SetTextureUVScale(2.2f, 1.8f);
-        m_basicMeshes->DrawBoxMesh();
+        DrawMesh(DRAW_MESH_BOX);
     }
 }
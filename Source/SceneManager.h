@@ -11,6 +11,8 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "FrameState.h"
+#include "DrawList.h"
 
 #include <string>
 #include <vector>
@@ -18,6 +20,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 
+class GpuProfiler;
+class PerfCounters;
+
 /***********************************************************
  *  SceneManager
  *
@@ -26,6 +31,9 @@
  ***********************************************************/
 class SceneManager
 {
+	// times the private drawing helpers in isolation
+	friend class SceneMicroBenchmarks;
+
 public:
 	// constructor
 	SceneManager(ShaderManager* pShaderManager);
@@ -50,6 +58,44 @@ public:
 		std::string tag;
 	};
 
+	// an image file the scene textures are loaded from
+	struct TEXTURE_FILE
+	{
+		const char* filename;
+		const char* tag;
+	};
+
+	// the scene's texture files, in the order the draw list indexes them
+	static int GetSceneTextureCount();
+	static const TEXTURE_FILE& GetSceneTextureFile(int index);
+
+	// an image decoded from a texture file, waiting to be uploaded
+	struct DECODED_TEXTURE
+	{
+		std::vector<unsigned char> pixels;
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+	};
+
+	// what PrepareScene() works out without a context - the decoded
+	// scene textures, in file order, and the triangles in each basic
+	// mesh - so it can be done on other threads ahead of time
+	struct SCENE_ASSETS
+	{
+		DECODED_TEXTURE textures[16];
+		uint32_t meshTriangles[DRAW_MESH_COUNT];
+	};
+
+	// set up the image decoder - called once before any textures are
+	// decoded, since its settings are shared by every thread
+	static void PrepareTextureDecoding();
+	// decode an image file, bottom row first. Safe to call on any
+	// thread. Returns false if it failed to load.
+	static bool DecodeTexture(const char* filename, DECODED_TEXTURE& texture);
+	// count the triangles in one draw of each basic mesh
+	static void CountMeshTriangles(uint32_t meshTriangles[DRAW_MESH_COUNT]);
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
@@ -59,11 +105,35 @@ private:
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
+	// texture unit of each scene texture file, -1 if it failed to load
+	int m_textureSlots[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// model matrix of every draw in the previous frame, indexed by
+	// draw order, for the motion vectors
+	std::vector<glm::mat4> m_previousModels;
+
+	// shader state the next mesh draw is recorded with
+	DRAW_COMMAND m_drawState;
+	// the list being built by BuildDrawList()
+	DRAW_LIST* m_pDrawList;
+	// the list RenderScene() builds and submits each frame
+	DRAW_LIST m_drawList;
+	// scene lights, and the values last loaded into the shader
+	DRAW_LIGHTS m_lights;
+	DRAW_LIGHTS m_shaderLights;
+	// false until the lights have been loaded into the current program
+	bool m_bShaderLightsLoaded;
+	// times each object's draws on the GPU when set
+	GpuProfiler* m_pGpuProfiler;
+	// counts the CPU work of building and submitting the draws when set
+	PerfCounters* m_pPerfCounters;
+	// triangles in one draw of each basic mesh, for the render statistics
+	uint32_t m_meshTriangles[DRAW_MESH_COUNT];
 
 	// methods for managing OpenGL textures
 	bool CreateGLTexture(const char* filename, std::string tag);
+	bool UploadGLTexture(const DECODED_TEXTURE& texture, std::string tag);
 	void BindGLTextures();
 	void DestroyGLTextures();
 	int FindTextureID(std::string tag);
@@ -96,12 +166,65 @@ private:
 	void SetupSceneLights();
 	void SetShaderMaterial(const std::string& materialTag);
 
-public:
+	// place one of the stacked page layers of the open book
+	void SetPageLayerTransformations(
+		int layer,
+		int layerCount,
+		const glm::vec3& bookPosition,
+		float bookScaleFactor,
+		float baseRotationY,
+		const glm::vec3& pageScale);
+
+	// name the object the following draws belong to
+	void SetObjectName(const char* pObjectName);
+	// record a draw of one of the basic meshes with the current state
+	void DrawMesh(DRAW_MESH mesh);
+
+	// draw the list with OpenGL, only sending the shader state that
+	// changed since the previous draw, and keep its model matrices for
+	// the next frame's motion vectors unless told not to
+	void SubmitDrawList(const DRAW_LIST& drawList, bool bKeepModels);
+	void LoadLightIntoShader(const char* name, const DRAW_LIGHT& light, bool bDirectional);
 
-	void PrepareScene();
-	void RenderScene();
+public:
 
-	void LoadSceneTextures();
+	// load the textures and meshes, from assets prepared ahead of time
+	// when given
+	void PrepareScene(const SCENE_ASSETS* pAssets = NULL);
+	void RenderScene(const FRAME_STATE& frameState);
+	// draw an extra view of the frame, such as a capture, without
+	// disturbing the motion vectors of the next interactive frame
+	void RenderAuxiliaryScene(const FRAME_STATE& frameState);
+
+	// set up the materials and lights without any OpenGL resources, for
+	// renderers that only consume the draw list
+	void PrepareSceneDescription();
+
+	// record what RenderScene() draws for the frame, without any
+	// OpenGL calls
+	void BuildDrawList(const FRAME_STATE& frameState, DRAW_LIST& drawList);
+
+	// advance the scene animation and record it into the frame
+	// snapshot - called from the simulation thread, no GL calls
+	void UpdateSceneAnimation(FRAME_STATE& frameState);
+	// the same at a given animation time, in seconds
+	void UpdateSceneAnimation(FRAME_STATE& frameState, float elapsedSeconds);
+	// the animation clock UpdateSceneAnimation() follows by default, in
+	// seconds since startup
+	static float GetAnimationSeconds();
+
+	void LoadSceneTextures(const DECODED_TEXTURE* pDecodedTextures = NULL);
+
+	// time the draws of each scene object in RenderScene(), or pass
+	// NULL to stop
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+	// count the render thread's CPU work in RenderScene() with hardware
+	// counters, or pass NULL to stop
+	void SetPerfCounters(PerfCounters* pPerfCounters) { m_pPerfCounters = pPerfCounters; }
+	// draw with another shader program built from the same shaders, such
+	// as one that adds a multi-view stage - the lights are loaded into it
+	// again with the next draw list
+	void SetShaderManager(ShaderManager* pShaderManager) { m_pShaderManager = pShaderManager; m_bShaderLightsLoaded = false; }
 
 	void DrawBookSetup();
 };
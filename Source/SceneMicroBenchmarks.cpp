@@ -0,0 +1,244 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenemicrobenchmarks.cpp
+// ============
+// the scene microbenchmarks
+//
+// NOTE: the setters are called the way the scene calls them, with string
+// literals for the tags, so the string each call builds is part of the
+// time. The tags cycle through the whole table, which mixes early and late
+// matches. The scene is given its texture table without loading any
+// images, so the texture lookups search what a loaded scene would.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneMicroBenchmarks.h"
+#include "SceneManager.h"
+#include "CpuMeshes.h"
+
+namespace
+{
+	// the materials the scene draws with
+	const char* const MATERIAL_TAGS[] = { "metal", "wood", "candle", "flame", "cement" };
+	const int MATERIAL_TAG_COUNT = (int)(sizeof(MATERIAL_TAGS) / sizeof(MATERIAL_TAGS[0]));
+
+	// the book layout DrawBookSetup() places its pages with
+	const glm::vec3 BOOK_POSITION = glm::vec3(-2.0f, 0.20f, 2.1f);
+	const float BOOK_SCALE_FACTOR = 1.4f;
+	const float BOOK_ROTATION_Y = 4.5f;
+	const glm::vec3 PAGE_SCALE = glm::vec3(4.3f * BOOK_SCALE_FACTOR, 0.025f * BOOK_SCALE_FACTOR, 3.0f * BOOK_SCALE_FACTOR - 0.08f);
+	const int PAGE_LAYER_COUNT = 25;
+
+	// a mesh generator, called with the arguments PrepareScene() uses
+	struct MESH_GENERATOR
+	{
+		const char* pName;
+		void (*pLoad)(ShapeMeshes& meshes);
+	};
+
+	const MESH_GENERATOR MESH_GENERATORS[] =
+	{
+		{ "LoadBoxMesh", [](ShapeMeshes& meshes) { meshes.LoadBoxMesh(); } },
+		{ "LoadPlaneMesh", [](ShapeMeshes& meshes) { meshes.LoadPlaneMesh(); } },
+		{ "LoadCylinderMesh", [](ShapeMeshes& meshes) { meshes.LoadCylinderMesh(1.0f, 1.0f, 72); } },
+		{ "LoadConeMesh", [](ShapeMeshes& meshes) { meshes.LoadConeMesh(); } },
+		{ "LoadPrismMesh", [](ShapeMeshes& meshes) { meshes.LoadPrismMesh(); } },
+		{ "LoadPyramid4Mesh", [](ShapeMeshes& meshes) { meshes.LoadPyramid4Mesh(); } },
+		{ "LoadSphereMesh", [](ShapeMeshes& meshes) { meshes.LoadSphereMesh(); } },
+		{ "LoadTaperedCylinderMesh", [](ShapeMeshes& meshes) { meshes.LoadTaperedCylinderMesh(); } },
+		{ "LoadTorusMesh", [](ShapeMeshes& meshes) { meshes.LoadTorusMesh(); } },
+	};
+}
+
+/***********************************************************
+ *  SceneMicroBenchmarks()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneMicroBenchmarks::SceneMicroBenchmarks()
+{
+	m_pSceneManager = new SceneManager(NULL);
+	m_pSceneManager->PrepareSceneDescription();
+
+	// the table LoadSceneTextures() would fill, without the textures
+	int textureCount = SceneManager::GetSceneTextureCount();
+	for (int i = 0; i < textureCount; i++)
+	{
+		m_pSceneManager->m_textureIDs[i].tag = SceneManager::GetSceneTextureFile(i).tag;
+		m_pSceneManager->m_textureIDs[i].ID = 0;
+		m_pSceneManager->m_textureSlots[i] = i;
+	}
+	m_pSceneManager->m_loadedTextures = textureCount;
+}
+
+/***********************************************************
+ *  ~SceneMicroBenchmarks()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneMicroBenchmarks::~SceneMicroBenchmarks()
+{
+	// there are no textures behind the table to delete
+	m_pSceneManager->m_loadedTextures = 0;
+	delete m_pSceneManager;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  Register()
+ ***********************************************************/
+void SceneMicroBenchmarks::Register(MicroBenchmark& microBenchmark, bool bOpenGL)
+{
+	RegisterSetters(microBenchmark);
+	RegisterDrawLists(microBenchmark);
+	RegisterMeshGenerators(microBenchmark, bOpenGL);
+}
+
+/***********************************************************
+ *  RegisterSetters()
+ *
+ *  This method adds the calls made for every draw.
+ ***********************************************************/
+void SceneMicroBenchmarks::RegisterSetters(MicroBenchmark& microBenchmark)
+{
+	SceneManager* pScene = m_pSceneManager;
+
+	microBenchmark.Add("SetTransformations", [pScene](MicroBenchmarkState& state)
+	{
+		float angle = 0.0f;
+		while (state.KeepRunning())
+		{
+			pScene->SetTransformations(glm::vec3(1.5f, 0.25f, 1.5f), angle, 4.5f, -angle, glm::vec3(-2.0f, angle * 0.01f, 2.1f));
+			DoNotOptimize(pScene->m_drawState.model);
+			angle += 1.0f;
+		}
+		state.SetItemsPerIteration(1);
+	});
+
+	microBenchmark.Add("FindTextureSlot", [pScene](MicroBenchmarkState& state)
+	{
+		int textureCount = SceneManager::GetSceneTextureCount();
+		int textureIndex = 0;
+		while (state.KeepRunning())
+		{
+			int slot = pScene->FindTextureSlot(SceneManager::GetSceneTextureFile(textureIndex).tag);
+			DoNotOptimize(slot);
+			textureIndex = (textureIndex + 1) % textureCount;
+		}
+		state.SetItemsPerIteration(1);
+	});
+
+	microBenchmark.Add("SetShaderTexture", [pScene](MicroBenchmarkState& state)
+	{
+		int textureCount = SceneManager::GetSceneTextureCount();
+		int textureIndex = 0;
+		while (state.KeepRunning())
+		{
+			pScene->SetShaderTexture(SceneManager::GetSceneTextureFile(textureIndex).tag);
+			DoNotOptimize(pScene->m_drawState.textureIndex);
+			textureIndex = (textureIndex + 1) % textureCount;
+		}
+		state.SetItemsPerIteration(1);
+	});
+
+	microBenchmark.Add("SetShaderMaterial", [pScene](MicroBenchmarkState& state)
+	{
+		int materialIndex = 0;
+		while (state.KeepRunning())
+		{
+			pScene->SetShaderMaterial(MATERIAL_TAGS[materialIndex]);
+			DoNotOptimize(pScene->m_drawState.material);
+			materialIndex = (materialIndex + 1) % MATERIAL_TAG_COUNT;
+		}
+		state.SetItemsPerIteration(1);
+	});
+
+	// every layer of the book, as one pass of DrawBookSetup() places them
+	microBenchmark.Add("PageLayerTransformations", [pScene](MicroBenchmarkState& state)
+	{
+		while (state.KeepRunning())
+		{
+			for (int layer = 0; layer < PAGE_LAYER_COUNT; layer++)
+			{
+				pScene->SetPageLayerTransformations(layer, PAGE_LAYER_COUNT, BOOK_POSITION, BOOK_SCALE_FACTOR, BOOK_ROTATION_Y, PAGE_SCALE);
+				DoNotOptimize(pScene->m_drawState.model);
+			}
+		}
+		state.SetItemsPerIteration(PAGE_LAYER_COUNT);
+	});
+}
+
+/***********************************************************
+ *  RegisterDrawLists()
+ *
+ *  This method adds the recording of the book and of the
+ *  whole frame, for the setters in context.
+ ***********************************************************/
+void SceneMicroBenchmarks::RegisterDrawLists(MicroBenchmark& microBenchmark)
+{
+	SceneManager* pScene = m_pSceneManager;
+
+	microBenchmark.Add("DrawBookSetup", [pScene](MicroBenchmarkState& state)
+	{
+		DRAW_LIST drawList;
+		pScene->m_pDrawList = &drawList;
+		while (state.KeepRunning())
+		{
+			drawList.commands.clear();
+			pScene->DrawBookSetup();
+			DoNotOptimize(drawList.commands.data());
+		}
+		pScene->m_pDrawList = NULL;
+		state.SetItemsPerIteration(drawList.commands.size());
+	});
+
+	microBenchmark.Add("BuildDrawList", [pScene](MicroBenchmarkState& state)
+	{
+		FRAME_STATE frameState;
+		pScene->UpdateSceneAnimation(frameState, 1.0f);
+		DRAW_LIST drawList;
+		while (state.KeepRunning())
+		{
+			pScene->BuildDrawList(frameState, drawList);
+			DoNotOptimize(drawList.commands.data());
+		}
+		state.SetItemsPerIteration(drawList.commands.size());
+	});
+}
+
+/***********************************************************
+ *  RegisterMeshGenerators()
+ *
+ *  This method adds the basic mesh generators, each on its
+ *  own with a fresh ShapeMeshes object per run, or the CPU
+ *  meshes when there is no OpenGL context.
+ ***********************************************************/
+void SceneMicroBenchmarks::RegisterMeshGenerators(MicroBenchmark& microBenchmark, bool bOpenGL)
+{
+	if (!bOpenGL)
+	{
+		microBenchmark.Add("CpuMeshes", [](MicroBenchmarkState& state)
+		{
+			while (state.KeepRunning())
+			{
+				CpuMeshes cpuMeshes;
+				DoNotOptimize(cpuMeshes.GetMesh(DRAW_MESH_BOX).vertices.data());
+			}
+			state.SetItemsPerIteration(DRAW_MESH_COUNT);
+		});
+		return;
+	}
+
+	for (const MESH_GENERATOR& generator : MESH_GENERATORS)
+	{
+		void (*pLoad)(ShapeMeshes& meshes) = generator.pLoad;
+		microBenchmark.Add(std::string("ShapeMeshes::") + generator.pName, [pLoad](MicroBenchmarkState& state)
+		{
+			ShapeMeshes* pMeshes = new ShapeMeshes();
+			while (state.KeepRunning())
+			{
+				pLoad(*pMeshes);
+			}
+			delete pMeshes;
+			state.SetItemsPerIteration(1);
+		}, MESH_GENERATOR_ITERATIONS);
+	}
+}
@@ -0,0 +1,38 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenemicrobenchmarks.h
+// ============
+// microbenchmarks of the scene's per-draw hot paths - the transform, texture
+// and material setters, the page layers of the book, whole draw lists and the
+// basic mesh generators
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MicroBenchmark.h"
+
+class SceneManager;
+
+class SceneMicroBenchmarks
+{
+public:
+	// constructor - sets up a scene with its materials, lights and texture
+	// table but no OpenGL resources
+	SceneMicroBenchmarks();
+	// destructor
+	~SceneMicroBenchmarks();
+
+	// add the benchmarks to the suite. The OpenGL mesh generators need a
+	// current context, and without one the CPU meshes are timed instead.
+	void Register(MicroBenchmark& microBenchmark, bool bOpenGL);
+
+	// calls to the mesh generators in one run - each call creates new
+	// buffers, so the count is kept low
+	static const uint64_t MESH_GENERATOR_ITERATIONS = 200;
+
+private:
+	SceneManager* m_pSceneManager;
+
+	void RegisterSetters(MicroBenchmark& microBenchmark);
+	void RegisterDrawLists(MicroBenchmark& microBenchmark);
+	void RegisterMeshGenerators(MicroBenchmark& microBenchmark, bool bOpenGL);
+};
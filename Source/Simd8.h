@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+// simd8.h
+// ============
+// eight-lane float and integer vectors for the CPU renderers - AVX2 when the
+// compiler targets it (-mavx2 -mfma, /arch:AVX2), plain loops otherwise
+//
+// each build lives in its own namespace, SIMD8_NAMESPACE, so files built
+// with and without AVX2 can be linked together without the linker merging
+// the two versions of an inline function. Defining SIMD8_FORCE_SCALAR
+// before the include picks the plain loops whatever the compiler targets.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__) && !defined(SIMD8_FORCE_SCALAR)
+#include <immintrin.h>
+#define SIMD8_AVX2 1
+#define SIMD8_NAMESPACE Simd8Avx2
+#else
+#define SIMD8_AVX2 0
+#define SIMD8_NAMESPACE Simd8Scalar
+#endif
+
+namespace SIMD8_NAMESPACE
+{
+
+struct Mask8;
+struct Int8;
+
+/***********************************************************
+ *  Float8
+ *
+ *  Eight floats processed together.
+ ***********************************************************/
+struct Float8
+{
+#if SIMD8_AVX2
+	__m256 v;
+
+	Float8() {}
+	Float8(__m256 value) : v(value) {}
+	Float8(float value) : v(_mm256_set1_ps(value)) {}
+
+	static Float8 Load(const float* p) { return(_mm256_loadu_ps(p)); }
+	void Store(float* p) const { _mm256_storeu_ps(p, v); }
+	// start, start + 1, ... start + 7
+	static Float8 Ramp(float start) { return(_mm256_add_ps(_mm256_set1_ps(start), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7))); }
+	float Lane(int i) const { alignas(32) float lanes[8]; _mm256_store_ps(lanes, v); return(lanes[i]); }
+#else
+	float v[8];
+
+	Float8() {}
+	Float8(float value) { for (int i = 0; i < 8; i++) v[i] = value; }
+
+	static Float8 Load(const float* p) { Float8 r; for (int i = 0; i < 8; i++) r.v[i] = p[i]; return(r); }
+	void Store(float* p) const { for (int i = 0; i < 8; i++) p[i] = v[i]; }
+	static Float8 Ramp(float start) { Float8 r; for (int i = 0; i < 8; i++) r.v[i] = start + (float)i; return(r); }
+	float Lane(int i) const { return(v[i]); }
+#endif
+};
+
+/***********************************************************
+ *  Int8
+ *
+ *  Eight 32-bit integers processed together.
+ ***********************************************************/
+struct Int8
+{
+#if SIMD8_AVX2
+	__m256i v;
+
+	Int8() {}
+	Int8(__m256i value) : v(value) {}
+	Int8(int32_t value) : v(_mm256_set1_epi32(value)) {}
+
+	static Int8 Load(const int32_t* p) { return(_mm256_loadu_si256((const __m256i*)p)); }
+	void Store(int32_t* p) const { _mm256_storeu_si256((__m256i*)p, v); }
+	static Int8 Ramp(int32_t start) { return(_mm256_add_epi32(_mm256_set1_epi32(start), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))); }
+	int32_t Lane(int i) const { alignas(32) int32_t lanes[8]; _mm256_store_si256((__m256i*)lanes, v); return(lanes[i]); }
+#else
+	int32_t v[8];
+
+	Int8() {}
+	Int8(int32_t value) { for (int i = 0; i < 8; i++) v[i] = value; }
+
+	static Int8 Load(const int32_t* p) { Int8 r; for (int i = 0; i < 8; i++) r.v[i] = p[i]; return(r); }
+	void Store(int32_t* p) const { for (int i = 0; i < 8; i++) p[i] = v[i]; }
+	static Int8 Ramp(int32_t start) { Int8 r; for (int i = 0; i < 8; i++) r.v[i] = start + i; return(r); }
+	int32_t Lane(int i) const { return(v[i]); }
+#endif
+};
+
+/***********************************************************
+ *  Mask8
+ *
+ *  Eight lane flags, the result of a comparison.
+ ***********************************************************/
+struct Mask8
+{
+#if SIMD8_AVX2
+	__m256 v;
+
+	Mask8() {}
+	Mask8(__m256 value) : v(value) {}
+	Mask8(bool value) : v(_mm256_castsi256_ps(_mm256_set1_epi32(value ? -1 : 0))) {}
+
+	// one bit per lane, lane 0 in bit 0
+	int Bits() const { return(_mm256_movemask_ps(v)); }
+#else
+	int32_t v[8];
+
+	Mask8() {}
+	Mask8(bool value) { for (int i = 0; i < 8; i++) v[i] = value ? -1 : 0; }
+
+	int Bits() const { int bits = 0; for (int i = 0; i < 8; i++) bits |= (v[i] ? 1 : 0) << i; return(bits); }
+#endif
+
+	bool Any() const { return(Bits() != 0); }
+	bool All() const { return(Bits() == 0xFF); }
+};
+
+#if SIMD8_AVX2
+
+inline Float8 operator+(Float8 a, Float8 b) { return(_mm256_add_ps(a.v, b.v)); }
+inline Float8 operator-(Float8 a, Float8 b) { return(_mm256_sub_ps(a.v, b.v)); }
+inline Float8 operator*(Float8 a, Float8 b) { return(_mm256_mul_ps(a.v, b.v)); }
+inline Float8 operator/(Float8 a, Float8 b) { return(_mm256_div_ps(a.v, b.v)); }
+inline Float8 operator-(Float8 a) { return(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+inline Float8 Min(Float8 a, Float8 b) { return(_mm256_min_ps(a.v, b.v)); }
+inline Float8 Max(Float8 a, Float8 b) { return(_mm256_max_ps(a.v, b.v)); }
+inline Float8 Sqrt(Float8 a) { return(_mm256_sqrt_ps(a.v)); }
+inline Float8 Floor(Float8 a) { return(_mm256_floor_ps(a.v)); }
+#if defined(__FMA__)
+inline Float8 MultiplyAdd(Float8 a, Float8 b, Float8 c) { return(_mm256_fmadd_ps(a.v, b.v, c.v)); }
+#else
+inline Float8 MultiplyAdd(Float8 a, Float8 b, Float8 c) { return(_mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v)); }
+#endif
+
+inline Mask8 operator<(Float8 a, Float8 b) { return(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline Mask8 operator<=(Float8 a, Float8 b) { return(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline Mask8 operator>(Float8 a, Float8 b) { return(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+inline Mask8 operator>=(Float8 a, Float8 b) { return(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+inline Mask8 operator==(Float8 a, Float8 b) { return(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)); }
+
+inline Mask8 operator&(Mask8 a, Mask8 b) { return(_mm256_and_ps(a.v, b.v)); }
+inline Mask8 operator|(Mask8 a, Mask8 b) { return(_mm256_or_ps(a.v, b.v)); }
+inline Mask8 operator~(Mask8 a) { return(_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))); }
+
+// mask ? a : b, lane by lane
+inline Float8 Select(Mask8 mask, Float8 a, Float8 b) { return(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+inline Int8 Select(Mask8 mask, Int8 a, Int8 b) { return(_mm256_blendv_epi8(b.v, a.v, _mm256_castps_si256(mask.v))); }
+
+inline Int8 operator+(Int8 a, Int8 b) { return(_mm256_add_epi32(a.v, b.v)); }
+inline Int8 operator-(Int8 a, Int8 b) { return(_mm256_sub_epi32(a.v, b.v)); }
+inline Int8 operator*(Int8 a, Int8 b) { return(_mm256_mullo_epi32(a.v, b.v)); }
+inline Int8 operator&(Int8 a, Int8 b) { return(_mm256_and_si256(a.v, b.v)); }
+inline Int8 operator|(Int8 a, Int8 b) { return(_mm256_or_si256(a.v, b.v)); }
+inline Int8 operator<<(Int8 a, int bits) { return(_mm256_slli_epi32(a.v, bits)); }
+inline Int8 operator>>(Int8 a, int bits) { return(_mm256_srli_epi32(a.v, bits)); }
+inline Mask8 operator<(Int8 a, Int8 b) { return(_mm256_castsi256_ps(_mm256_cmpgt_epi32(b.v, a.v))); }
+inline Mask8 operator>(Int8 a, Int8 b) { return(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a.v, b.v))); }
+inline Mask8 operator==(Int8 a, Int8 b) { return(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v))); }
+
+// conversions, truncating toward zero, and bit casts
+inline Int8 ToInt(Float8 a) { return(_mm256_cvttps_epi32(a.v)); }
+inline Float8 ToFloat(Int8 a) { return(_mm256_cvtepi32_ps(a.v)); }
+inline Int8 AsInt(Float8 a) { return(_mm256_castps_si256(a.v)); }
+inline Float8 AsFloat(Int8 a) { return(_mm256_castsi256_ps(a.v)); }
+
+// load base[index] for the lanes in the mask, zero for the others
+inline Int8 Gather(const int32_t* base, Int8 index, Mask8 mask)
+{
+	return(_mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)base, index.v, _mm256_castps_si256(mask.v), 4));
+}
+
+#else
+
+#define SIMD8_LANES(expression) for (int i = 0; i < 8; i++) { expression; }
+
+inline Float8 operator+(Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = a.v[i] + b.v[i]); return(r); }
+inline Float8 operator-(Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = a.v[i] - b.v[i]); return(r); }
+inline Float8 operator*(Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = a.v[i] * b.v[i]); return(r); }
+inline Float8 operator/(Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = a.v[i] / b.v[i]); return(r); }
+inline Float8 operator-(Float8 a) { Float8 r; SIMD8_LANES(r.v[i] = -a.v[i]); return(r); }
+inline Float8 Min(Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = (a.v[i] < b.v[i]) ? a.v[i] : b.v[i]); return(r); }
+inline Float8 Max(Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = (a.v[i] > b.v[i]) ? a.v[i] : b.v[i]); return(r); }
+inline Float8 Sqrt(Float8 a) { Float8 r; SIMD8_LANES(r.v[i] = std::sqrt(a.v[i])); return(r); }
+inline Float8 Floor(Float8 a) { Float8 r; SIMD8_LANES(r.v[i] = std::floor(a.v[i])); return(r); }
+inline Float8 MultiplyAdd(Float8 a, Float8 b, Float8 c) { Float8 r; SIMD8_LANES(r.v[i] = a.v[i] * b.v[i] + c.v[i]); return(r); }
+
+inline Mask8 operator<(Float8 a, Float8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] < b.v[i]) ? -1 : 0); return(r); }
+inline Mask8 operator<=(Float8 a, Float8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] <= b.v[i]) ? -1 : 0); return(r); }
+inline Mask8 operator>(Float8 a, Float8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] > b.v[i]) ? -1 : 0); return(r); }
+inline Mask8 operator>=(Float8 a, Float8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] >= b.v[i]) ? -1 : 0); return(r); }
+inline Mask8 operator==(Float8 a, Float8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] == b.v[i]) ? -1 : 0); return(r); }
+
+inline Mask8 operator&(Mask8 a, Mask8 b) { Mask8 r; SIMD8_LANES(r.v[i] = a.v[i] & b.v[i]); return(r); }
+inline Mask8 operator|(Mask8 a, Mask8 b) { Mask8 r; SIMD8_LANES(r.v[i] = a.v[i] | b.v[i]); return(r); }
+inline Mask8 operator~(Mask8 a) { Mask8 r; SIMD8_LANES(r.v[i] = ~a.v[i]); return(r); }
+
+inline Float8 Select(Mask8 mask, Float8 a, Float8 b) { Float8 r; SIMD8_LANES(r.v[i] = mask.v[i] ? a.v[i] : b.v[i]); return(r); }
+inline Int8 Select(Mask8 mask, Int8 a, Int8 b) { Int8 r; SIMD8_LANES(r.v[i] = mask.v[i] ? a.v[i] : b.v[i]); return(r); }
+
+inline Int8 operator+(Int8 a, Int8 b) { Int8 r; SIMD8_LANES(r.v[i] = a.v[i] + b.v[i]); return(r); }
+inline Int8 operator-(Int8 a, Int8 b) { Int8 r; SIMD8_LANES(r.v[i] = a.v[i] - b.v[i]); return(r); }
+inline Int8 operator*(Int8 a, Int8 b) { Int8 r; SIMD8_LANES(r.v[i] = a.v[i] * b.v[i]); return(r); }
+inline Int8 operator&(Int8 a, Int8 b) { Int8 r; SIMD8_LANES(r.v[i] = a.v[i] & b.v[i]); return(r); }
+inline Int8 operator|(Int8 a, Int8 b) { Int8 r; SIMD8_LANES(r.v[i] = a.v[i] | b.v[i]); return(r); }
+inline Int8 operator<<(Int8 a, int bits) { Int8 r; SIMD8_LANES(r.v[i] = (int32_t)((uint32_t)a.v[i] << bits)); return(r); }
+inline Int8 operator>>(Int8 a, int bits) { Int8 r; SIMD8_LANES(r.v[i] = (int32_t)((uint32_t)a.v[i] >> bits)); return(r); }
+inline Mask8 operator<(Int8 a, Int8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] < b.v[i]) ? -1 : 0); return(r); }
+inline Mask8 operator>(Int8 a, Int8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] > b.v[i]) ? -1 : 0); return(r); }
+inline Mask8 operator==(Int8 a, Int8 b) { Mask8 r; SIMD8_LANES(r.v[i] = (a.v[i] == b.v[i]) ? -1 : 0); return(r); }
+
+inline Int8 ToInt(Float8 a) { Int8 r; SIMD8_LANES(r.v[i] = (int32_t)a.v[i]); return(r); }
+inline Float8 ToFloat(Int8 a) { Float8 r; SIMD8_LANES(r.v[i] = (float)a.v[i]); return(r); }
+inline Int8 AsInt(Float8 a) { Int8 r; SIMD8_LANES(memcpy(&r.v[i], &a.v[i], 4)); return(r); }
+inline Float8 AsFloat(Int8 a) { Float8 r; SIMD8_LANES(memcpy(&r.v[i], &a.v[i], 4)); return(r); }
+
+inline Int8 Gather(const int32_t* base, Int8 index, Mask8 mask) { Int8 r; SIMD8_LANES(r.v[i] = mask.v[i] ? base[index.v[i]] : 0); return(r); }
+
+#undef SIMD8_LANES
+
+#endif
+
+inline Float8& operator+=(Float8& a, Float8 b) { a = a + b; return(a); }
+inline Float8& operator*=(Float8& a, Float8 b) { a = a * b; return(a); }
+inline Mask8& operator&=(Mask8& a, Mask8 b) { a = a & b; return(a); }
+
+/***********************************************************
+ *  Exp2()
+ *
+ *  2^x to about six digits, for x above -126.
+ ***********************************************************/
+inline Float8 Exp2(Float8 x)
+{
+	x = Max(Min(x, Float8(126.0f)), Float8(-126.0f));
+	Float8 whole = Floor(x);
+	Float8 f = x - whole;
+
+	// 2^f on [0, 1)
+	Float8 p = Float8(0.0013333558f);
+	p = MultiplyAdd(p, f, Float8(0.0096181291f));
+	p = MultiplyAdd(p, f, Float8(0.0555041087f));
+	p = MultiplyAdd(p, f, Float8(0.2402264923f));
+	p = MultiplyAdd(p, f, Float8(0.6931471806f));
+	p = MultiplyAdd(p, f, Float8(1.0f));
+
+	// scale by 2^whole through the exponent bits
+	return(p * AsFloat((ToInt(whole) + Int8(127)) << 23));
+}
+
+/***********************************************************
+ *  Log2()
+ *
+ *  log2(x) to about five digits, for positive normal x.
+ ***********************************************************/
+inline Float8 Log2(Float8 x)
+{
+	Int8 bits = AsInt(x);
+	Float8 exponent = ToFloat((bits >> 23) - Int8(127));
+	Float8 mantissa = AsFloat((bits & Int8(0x007FFFFF)) | Int8(0x3F800000));
+
+	// log2(m) = 2/ln2 * atanh((m - 1) / (m + 1)) for m in [1, 2)
+	Float8 t = (mantissa - Float8(1.0f)) / (mantissa + Float8(1.0f));
+	Float8 t2 = t * t;
+	Float8 series = Float8(1.0f / 7.0f);
+	series = MultiplyAdd(series, t2, Float8(1.0f / 5.0f));
+	series = MultiplyAdd(series, t2, Float8(1.0f / 3.0f));
+	series = MultiplyAdd(series, t2, Float8(1.0f));
+
+	return(MultiplyAdd(t * series, Float8(2.8853900818f), exponent));
+}
+
+/***********************************************************
+ *  Pow()
+ *
+ *  x^y for x >= 0, with 0^y = 0.
+ ***********************************************************/
+inline Float8 Pow(Float8 x, Float8 y)
+{
+	Mask8 bPositive = x > Float8(1.0e-30f);
+	return(Select(bPositive, Exp2(y * Log2(Max(x, Float8(1.0e-30f)))), Float8(0.0f)));
+}
+
+}
@@ -0,0 +1,529 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// CPU rasterization of the draw list
+//
+// NOTE: a frame runs in two parallel passes. First every draw command is
+// transformed, clipped against the near plane and set up as edge functions
+// and attribute planes, and its triangles are binned into 64x64 pixel tiles.
+// Then each tile is cleared and rasterized by one core, walking the bins in
+// draw order so blending matches OpenGL, with no locks on the buffers. The
+// pixels of each triangle are filled by the kernels of
+// SoftwareRasterizerKernels.inl, eight at a time - the AVX2 build when
+// CpuFeatures::HasAvx2() says the CPU runs it, the plain one otherwise. This
+// file is built for any x86 CPU.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+	// size of the square screen tiles the triangles are binned into
+	const int TILE_SIZE = 64;
+
+	/***********************************************************
+	 *  PackColor()
+	 *
+	 *  Pack red, green and blue in [0, 1] into opaque RGBA8,
+	 *  rounded as the kernels do.
+	 ***********************************************************/
+	int32_t PackColor(const glm::vec3& color)
+	{
+		int32_t packed = (int32_t)0xFF000000;
+		for (int channel = 0; channel < 3; channel++)
+		{
+			float value = std::min(std::max(color[channel], 0.0f), 1.0f);
+			packed |= (int32_t)(value * 255.0f + 0.5f) << (channel * 8);
+		}
+		return(packed);
+	}
+
+	/***********************************************************
+	 *  CopyVector()
+	 ***********************************************************/
+	void CopyVector(const glm::vec3& source, float destination[3])
+	{
+		destination[0] = source.x;
+		destination[1] = source.y;
+		destination[2] = source.z;
+	}
+
+	/***********************************************************
+	 *  ClipAgainstNearPlane()
+	 *
+	 *  Clip the polygon against z >= -w in clip space, writing
+	 *  the result and returning its vertex count.
+	 ***********************************************************/
+	template <class VERTEX>
+	int ClipAgainstNearPlane(const VERTEX* pInput, int inputCount, VERTEX* pOutput, int attributeCount)
+	{
+		int outputCount = 0;
+		for (int i = 0; i < inputCount; i++)
+		{
+			const VERTEX& a = pInput[i];
+			const VERTEX& b = pInput[(i + 1) % inputCount];
+			float distanceA = a.clipPosition.z + a.clipPosition.w;
+			float distanceB = b.clipPosition.z + b.clipPosition.w;
+
+			if (distanceA >= 0.0f)
+			{
+				pOutput[outputCount++] = a;
+			}
+			if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+			{
+				float t = distanceA / (distanceA - distanceB);
+				VERTEX& clipped = pOutput[outputCount++];
+				clipped.clipPosition = a.clipPosition + (b.clipPosition - a.clipPosition) * t;
+				for (int k = 0; k < attributeCount; k++)
+				{
+					clipped.attributes[k] = a.attributes[k] + (b.attributes[k] - a.attributes[k]) * t;
+				}
+			}
+		}
+		return(outputCount);
+	}
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer(int threadCount)
+{
+	// the calling thread works alongside the pool
+	if (threadCount <= 0)
+	{
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	m_threadCount = threadCount;
+	m_pThreadPool = new ThreadPool(std::max(1, threadCount - 1));
+
+	m_width = 0;
+	m_height = 0;
+	m_stride = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_frame = RASTER_FRAME();
+
+	m_bAvx2 = CpuFeatures::HasAvx2();
+	m_pRasterizeTriangle = m_bAvx2 ?
+		SoftwareRasterizerAvx2::RasterizeTriangle :
+		SoftwareRasterizerScalar::RasterizeTriangle;
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	if (NULL != m_pThreadPool)
+	{
+		delete m_pThreadPool;
+		m_pThreadPool = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadTextures()
+ ***********************************************************/
+bool SoftwareRasterizer::LoadTextures()
+{
+	return(m_textures.Load());
+}
+
+/***********************************************************
+ *  Resize()
+ ***********************************************************/
+void SoftwareRasterizer::Resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_stride = (width + 7) & ~7;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_colorBuffer.assign((size_t)m_stride * height, 0);
+	m_depthBuffer.assign((size_t)m_stride * height, 1.0f);
+
+	for (DRAW_BATCH& batch : m_batches)
+	{
+		batch.tileBins.clear();
+	}
+}
+
+/***********************************************************
+ *  Render()
+ ***********************************************************/
+void SoftwareRasterizer::Render(
+	const DRAW_LIST& drawList,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	if ((m_width <= 0) || (m_height <= 0))
+	{
+		return;
+	}
+
+	// the lights the shader would skip are dropped here
+	m_lights.clear();
+	if (drawList.lights.directional.bActive)
+	{
+		RASTER_LIGHT light;
+		light.bDirectional = true;
+		CopyVector(glm::normalize(-drawList.lights.directional.position), light.vector);
+		CopyVector(drawList.lights.directional.ambient, light.ambient);
+		CopyVector(drawList.lights.directional.diffuse, light.diffuse);
+		CopyVector(drawList.lights.directional.specular, light.specular);
+		m_lights.push_back(light);
+	}
+	for (int i = 0; i < DRAW_POINT_LIGHTS; i++)
+	{
+		const DRAW_LIGHT& pointLight = drawList.lights.pointLights[i];
+		if (pointLight.bActive)
+		{
+			RASTER_LIGHT light;
+			light.bDirectional = false;
+			CopyVector(pointLight.position, light.vector);
+			CopyVector(pointLight.ambient, light.ambient);
+			CopyVector(pointLight.diffuse, light.diffuse);
+			CopyVector(pointLight.specular, light.specular);
+			m_lights.push_back(light);
+		}
+	}
+
+	m_frame.pColorBuffer = m_colorBuffer.data();
+	m_frame.pDepthBuffer = m_depthBuffer.data();
+	m_frame.stride = m_stride;
+	m_frame.bUseLighting = drawList.bUseLighting;
+	m_frame.pLights = m_lights.data();
+	m_frame.lightCount = (int)m_lights.size();
+	CopyVector(viewPosition, m_frame.viewPosition);
+
+	// the shading inputs of each draw command
+	m_materials.resize(drawList.commands.size());
+	for (size_t i = 0; i < drawList.commands.size(); i++)
+	{
+		const DRAW_COMMAND& command = drawList.commands[i];
+		RASTER_MATERIAL& material = m_materials[i];
+		const CPU_TEXTURE* pTexture = command.bUseTexture ? m_textures.Get(command.textureIndex) : NULL;
+		material.pTexels = (NULL != pTexture) ? pTexture->texels.data() : NULL;
+		material.levelCount = (NULL != pTexture) ? pTexture->levelCount : 0;
+		material.pLevelOffsets = (NULL != pTexture) ? pTexture->levelOffsets : NULL;
+		material.pLevelWidths = (NULL != pTexture) ? pTexture->levelWidths : NULL;
+		material.pLevelHeights = (NULL != pTexture) ? pTexture->levelHeights : NULL;
+		material.bUseTexture = command.bUseTexture;
+		material.bBlend = command.bBlend;
+		for (int channel = 0; channel < 4; channel++)
+		{
+			material.color[channel] = command.color[channel];
+		}
+		CopyVector(command.material.diffuseColor, material.diffuseColor);
+		CopyVector(command.material.specularColor, material.specularColor);
+		material.shininess = command.material.shininess;
+	}
+
+	// vertex stage and binning, one draw command per task
+	if (m_batches.size() < drawList.commands.size())
+	{
+		m_batches.resize(drawList.commands.size());
+	}
+	glm::mat4 viewProjection = projection * view;
+	RunParallel((int)drawList.commands.size(), [&](int commandIndex)
+		{
+			ProcessDraw(drawList.commands[commandIndex], viewProjection, m_batches[commandIndex]);
+		});
+
+	// raster stage, one tile per task
+	RunParallel(m_tilesX * m_tilesY, [&](int tileIndex)
+		{
+			RasterizeTile(tileIndex, drawList);
+		});
+}
+
+/***********************************************************
+ *  ReadPixels()
+ ***********************************************************/
+void SoftwareRasterizer::ReadPixels(std::vector<unsigned char>& pixels) const
+{
+	pixels.resize((size_t)m_width * m_height * 3);
+	for (int y = 0; y < m_height; y++)
+	{
+		const int32_t* pRow = &m_colorBuffer[(size_t)y * m_stride];
+		unsigned char* pOut = &pixels[(size_t)y * m_width * 3];
+		for (int x = 0; x < m_width; x++)
+		{
+			uint32_t color = (uint32_t)pRow[x];
+			pOut[x * 3 + 0] = (unsigned char)(color & 0xFF);
+			pOut[x * 3 + 1] = (unsigned char)((color >> 8) & 0xFF);
+			pOut[x * 3 + 2] = (unsigned char)((color >> 16) & 0xFF);
+		}
+	}
+}
+
+/***********************************************************
+ *  ProcessDraw()
+ *
+ *  This method runs the vertex shader over the mesh of the
+ *  draw command, clips and sets up its triangles, and bins
+ *  them into the tiles their bounding boxes touch.
+ ***********************************************************/
+void SoftwareRasterizer::ProcessDraw(const DRAW_COMMAND& command, const glm::mat4& viewProjection, DRAW_BATCH& batch)
+{
+	const CPU_MESH& mesh = m_meshes.GetMesh(command.mesh);
+	glm::mat4 modelViewProjection = viewProjection * command.model;
+
+	// the scene vertex shader passes the normal through untransformed
+	batch.vertices.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		const CPU_VERTEX& vertex = mesh.vertices[i];
+		CLIP_VERTEX& output = batch.vertices[i];
+		glm::vec4 position(vertex.position, 1.0f);
+		glm::vec4 worldPosition = command.model * position;
+
+		output.clipPosition = modelViewProjection * position;
+		output.attributes[RASTER_ATTRIBUTE_POSITION + 0] = worldPosition.x;
+		output.attributes[RASTER_ATTRIBUTE_POSITION + 1] = worldPosition.y;
+		output.attributes[RASTER_ATTRIBUTE_POSITION + 2] = worldPosition.z;
+		output.attributes[RASTER_ATTRIBUTE_NORMAL + 0] = vertex.normal.x;
+		output.attributes[RASTER_ATTRIBUTE_NORMAL + 1] = vertex.normal.y;
+		output.attributes[RASTER_ATTRIBUTE_NORMAL + 2] = vertex.normal.z;
+		output.attributes[RASTER_ATTRIBUTE_TEXTURE + 0] = vertex.textureCoordinate.x * command.uvScale.x;
+		output.attributes[RASTER_ATTRIBUTE_TEXTURE + 1] = vertex.textureCoordinate.y * command.uvScale.y;
+	}
+
+	batch.triangles.clear();
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const CLIP_VERTEX& v0 = batch.vertices[mesh.indices[i]];
+		const CLIP_VERTEX& v1 = batch.vertices[mesh.indices[i + 1]];
+		const CLIP_VERTEX& v2 = batch.vertices[mesh.indices[i + 2]];
+		const glm::vec4& p0 = v0.clipPosition;
+		const glm::vec4& p1 = v1.clipPosition;
+		const glm::vec4& p2 = v2.clipPosition;
+
+		// skip triangles entirely outside one plane of the frustum
+		if (((p0.x > p0.w) && (p1.x > p1.w) && (p2.x > p2.w)) ||
+			((p0.x < -p0.w) && (p1.x < -p1.w) && (p2.x < -p2.w)) ||
+			((p0.y > p0.w) && (p1.y > p1.w) && (p2.y > p2.w)) ||
+			((p0.y < -p0.w) && (p1.y < -p1.w) && (p2.y < -p2.w)) ||
+			((p0.z > p0.w) && (p1.z > p1.w) && (p2.z > p2.w)) ||
+			((p0.z < -p0.w) && (p1.z < -p1.w) && (p2.z < -p2.w)))
+		{
+			continue;
+		}
+
+		if ((p0.z >= -p0.w) && (p1.z >= -p1.w) && (p2.z >= -p2.w))
+		{
+			AddTriangle(v0, v1, v2, batch);
+		}
+		else
+		{
+			// clipping a triangle against one plane gives up to four
+			// vertices, drawn as a fan
+			CLIP_VERTEX input[3] = { v0, v1, v2 };
+			CLIP_VERTEX clipped[4];
+			int clippedCount = ClipAgainstNearPlane(input, 3, clipped, ATTRIBUTE_COUNT);
+			for (int k = 1; k + 1 < clippedCount; k++)
+			{
+				AddTriangle(clipped[0], clipped[k], clipped[k + 1], batch);
+			}
+		}
+	}
+
+	// bin by bounding box
+	size_t tileCount = (size_t)m_tilesX * m_tilesY;
+	if (batch.tileBins.size() != tileCount)
+	{
+		batch.tileBins.assign(tileCount, std::vector<uint32_t>());
+	}
+	for (std::vector<uint32_t>& tileBin : batch.tileBins)
+	{
+		tileBin.clear();
+	}
+	for (size_t i = 0; i < batch.triangles.size(); i++)
+	{
+		const TRIANGLE& triangle = batch.triangles[i];
+		for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+		{
+			for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+			{
+				batch.tileBins[tileY * m_tilesX + tileX].push_back((uint32_t)i);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method projects a clipped triangle to the window and
+ *  sets up its edge functions and attribute planes.
+ ***********************************************************/
+void SoftwareRasterizer::AddTriangle(const CLIP_VERTEX& v0, const CLIP_VERTEX& v1, const CLIP_VERTEX& v2, DRAW_BATCH& batch)
+{
+	const CLIP_VERTEX* vertices[3] = { &v0, &v1, &v2 };
+	float x[3];
+	float y[3];
+	float inverseW[3];
+	float values[3][ATTRIBUTE_COUNT + 2];
+
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& clip = vertices[i]->clipPosition;
+		if (clip.w <= 0.0f)
+		{
+			return;
+		}
+		inverseW[i] = 1.0f / clip.w;
+		x[i] = (clip.x * inverseW[i] * 0.5f + 0.5f) * (float)m_width;
+		y[i] = (clip.y * inverseW[i] * 0.5f + 0.5f) * (float)m_height;
+
+		values[i][RASTER_PLANE_DEPTH] = clip.z * inverseW[i] * 0.5f + 0.5f;
+		values[i][RASTER_PLANE_INVERSE_W] = inverseW[i];
+		for (int k = 0; k < ATTRIBUTE_COUNT; k++)
+		{
+			values[i][RASTER_PLANE_ATTRIBUTES + k] = vertices[i]->attributes[k] * inverseW[i];
+		}
+	}
+
+	TRIANGLE triangle;
+
+	// edge i is opposite vertex i, so its function is twice the area
+	// of the triangle it makes with the pixel
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		int k = (i + 2) % 3;
+		triangle.edgeA[i] = y[j] - y[k];
+		triangle.edgeB[i] = x[k] - x[j];
+		triangle.edgeC[i] = x[j] * y[k] - x[k] * y[j];
+	}
+	float doubleArea = triangle.edgeA[0] * x[0] + triangle.edgeB[0] * y[0] + triangle.edgeC[0];
+	if (std::fabs(doubleArea) < 1.0e-8f)
+	{
+		return;
+	}
+
+	// both windings are drawn - flip clockwise ones so inside is positive
+	if (doubleArea < 0.0f)
+	{
+		doubleArea = -doubleArea;
+		for (int i = 0; i < 3; i++)
+		{
+			triangle.edgeA[i] = -triangle.edgeA[i];
+			triangle.edgeB[i] = -triangle.edgeB[i];
+			triangle.edgeC[i] = -triangle.edgeC[i];
+		}
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		// left edges face right, top edges face down
+		triangle.bTopLeft[i] = (triangle.edgeA[i] > 0.0f) ||
+			((triangle.edgeA[i] == 0.0f) && (triangle.edgeB[i] < 0.0f));
+	}
+
+	// value = sum of vertex values weighted by edge / area
+	float inverseArea = 1.0f / doubleArea;
+	for (int k = 0; k < ATTRIBUTE_COUNT + 2; k++)
+	{
+		triangle.planeA[k] = 0.0f;
+		triangle.planeB[k] = 0.0f;
+		triangle.planeC[k] = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			triangle.planeA[k] += triangle.edgeA[i] * values[i][k];
+			triangle.planeB[k] += triangle.edgeB[i] * values[i][k];
+			triangle.planeC[k] += triangle.edgeC[i] * values[i][k];
+		}
+		triangle.planeA[k] *= inverseArea;
+		triangle.planeB[k] *= inverseArea;
+		triangle.planeC[k] *= inverseArea;
+	}
+
+	// pixel centers inside the box, clamped to the window
+	float minX = std::min(x[0], std::min(x[1], x[2]));
+	float maxX = std::max(x[0], std::max(x[1], x[2]));
+	float minY = std::min(y[0], std::min(y[1], y[2]));
+	float maxY = std::max(y[0], std::max(y[1], y[2]));
+	triangle.minX = std::max(0, (int)std::floor(minX - 0.5f));
+	triangle.maxX = std::min(m_width - 1, (int)std::ceil(maxX - 0.5f));
+	triangle.minY = std::max(0, (int)std::floor(minY - 0.5f));
+	triangle.maxY = std::min(m_height - 1, (int)std::ceil(maxY - 0.5f));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+
+	batch.triangles.push_back(triangle);
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTile(int tileIndex, const DRAW_LIST& drawList)
+{
+	int tileMinX = (tileIndex % m_tilesX) * TILE_SIZE;
+	int tileMinY = (tileIndex / m_tilesX) * TILE_SIZE;
+	int tileMaxX = std::min(tileMinX + TILE_SIZE, m_width) - 1;
+	int tileMaxY = std::min(tileMinY + TILE_SIZE, m_height) - 1;
+
+	// clear the tile, including the row padding beyond the width
+	int clearMaxX = std::min(tileMinX + TILE_SIZE, m_stride) - 1;
+	int32_t clearColor = PackColor(glm::vec3(drawList.clearColor));
+	for (int y = tileMinY; y <= tileMaxY; y++)
+	{
+		size_t rowStart = (size_t)y * m_stride;
+		std::fill(&m_colorBuffer[rowStart + tileMinX], &m_colorBuffer[rowStart + clearMaxX] + 1, clearColor);
+		std::fill(&m_depthBuffer[rowStart + tileMinX], &m_depthBuffer[rowStart + clearMaxX] + 1, 1.0f);
+	}
+
+	for (size_t commandIndex = 0; commandIndex < drawList.commands.size(); commandIndex++)
+	{
+		const DRAW_BATCH& batch = m_batches[commandIndex];
+		for (uint32_t triangleIndex : batch.tileBins[tileIndex])
+		{
+			const TRIANGLE& triangle = batch.triangles[triangleIndex];
+			m_pRasterizeTriangle(
+				triangle,
+				m_materials[commandIndex],
+				m_frame,
+				std::max(triangle.minX, tileMinX),
+				std::min(triangle.maxX, tileMaxX),
+				std::max(triangle.minY, tileMinY),
+				std::min(triangle.maxY, tileMaxY));
+		}
+	}
+}
+
+/***********************************************************
+ *  RunParallel()
+ ***********************************************************/
+void SoftwareRasterizer::RunParallel(int taskCount, const std::function<void(int)>& task)
+{
+	std::atomic<int> nextTask(0);
+	auto worker = [&]()
+		{
+			int taskIndex;
+			while ((taskIndex = nextTask++) < taskCount)
+			{
+				task(taskIndex);
+			}
+		};
+
+	int workerCount = std::min(taskCount, m_threadCount) - 1;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_pThreadPool->Submit(worker);
+	}
+	worker();
+	m_pThreadPool->WaitIdle();
+}
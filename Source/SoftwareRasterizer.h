@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// draw the scene's draw list on the CPU, for machines without any OpenGL
+// driver - tile binning across cores, eight pixels at a time per core
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "DrawList.h"
+#include "CpuMeshes.h"
+#include "CpuTextures.h"
+#include "ThreadPool.h"
+#include "SoftwareRasterizerKernels.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class SoftwareRasterizer
+{
+public:
+	// constructor - a thread count of zero uses every hardware thread
+	SoftwareRasterizer(int threadCount);
+	// destructor
+	~SoftwareRasterizer();
+
+	// load the scene textures and build their mipmaps
+	bool LoadTextures();
+
+	// (re)allocate the color and depth buffers
+	void Resize(int width, int height);
+
+	// draw the list as the scene shaders would with the given camera
+	void Render(
+		const DRAW_LIST& drawList,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+
+	// copy the color buffer into 8-bit RGB pixels, bottom row first
+	void ReadPixels(std::vector<unsigned char>& pixels) const;
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	int GetThreadCount() const { return(m_threadCount); }
+	// whether the pixels are drawn with the AVX2 kernels
+	bool UsesAvx2() const { return(m_bAvx2); }
+
+	// number of interpolated values per vertex - world position,
+	// normal, and texture coordinate
+	static const int ATTRIBUTE_COUNT = RASTER_ATTRIBUTE_COUNT;
+
+private:
+	// a vertex after the vertex stage
+	struct CLIP_VERTEX
+	{
+		glm::vec4 clipPosition;
+		float attributes[ATTRIBUTE_COUNT];
+	};
+
+	// a triangle set up for rasterization, as the kernels take it
+	typedef RASTER_TRIANGLE TRIANGLE;
+
+	// the triangles of one draw command and the tiles they touch
+	struct DRAW_BATCH
+	{
+		std::vector<CLIP_VERTEX> vertices;
+		std::vector<TRIANGLE> triangles;
+		// triangle indices for each tile, in draw order
+		std::vector<std::vector<uint32_t>> tileBins;
+	};
+
+	ThreadPool* m_pThreadPool;
+	// pool threads used, plus the calling thread
+	int m_threadCount;
+	CpuMeshes m_meshes;
+	CpuTextures m_textures;
+	// the per-pixel stage, AVX2 when the CPU has it
+	bool m_bAvx2;
+	RASTERIZE_TRIANGLE m_pRasterizeTriangle;
+
+	int m_width;
+	int m_height;
+	// row length of the buffers, rounded up to whole groups of 8
+	int m_stride;
+	int m_tilesX;
+	int m_tilesY;
+	std::vector<int32_t> m_colorBuffer;
+	std::vector<float> m_depthBuffer;
+
+	// state of the frame being drawn
+	std::vector<DRAW_BATCH> m_batches;
+	std::vector<RASTER_LIGHT> m_lights;
+	std::vector<RASTER_MATERIAL> m_materials;
+	RASTER_FRAME m_frame;
+
+	void ProcessDraw(const DRAW_COMMAND& command, const glm::mat4& viewProjection, DRAW_BATCH& batch);
+	void AddTriangle(const CLIP_VERTEX& v0, const CLIP_VERTEX& v1, const CLIP_VERTEX& v2, DRAW_BATCH& batch);
+	void RasterizeTile(int tileIndex, const DRAW_LIST& drawList);
+
+	// run task(0) .. task(taskCount - 1) across the pool and this thread
+	void RunParallel(int taskCount, const std::function<void(int)>& task);
+};
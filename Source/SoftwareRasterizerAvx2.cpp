@@ -0,0 +1,12 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizeravx2.cpp
+// ============
+// the software rasterizer kernels built for AVX2 and FMA
+//
+// NOTE: this is the only rasterizer file built with AVX2 enabled
+// (/arch:AVX2, -mavx2 -mfma). The rasterizer calls into it only after
+// CpuFeatures::HasAvx2() has confirmed the CPU and OS support it.
+///////////////////////////////////////////////////////////////////////////////
+
+#define RASTER_KERNEL_NAMESPACE SoftwareRasterizerAvx2
+#include "SoftwareRasterizerKernels.inl"
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizerkernels.h
+// ============
+// the per-pixel stage of the software rasterizer, built once for AVX2 and
+// once for any x86 CPU
+//
+// the kernels only see the plain structures below, so nothing from glm or
+// the standard library is compiled with AVX2 enabled and shared with the
+// rest of the program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+// number of interpolated values per vertex - world position, normal,
+// and texture coordinate
+const int RASTER_ATTRIBUTE_COUNT = 8;
+
+// attribute slots within the interpolated values
+const int RASTER_ATTRIBUTE_POSITION = 0;
+const int RASTER_ATTRIBUTE_NORMAL = 3;
+const int RASTER_ATTRIBUTE_TEXTURE = 6;
+
+// plane slots within RASTER_TRIANGLE - depth and 1/w come first
+const int RASTER_PLANE_DEPTH = 0;
+const int RASTER_PLANE_INVERSE_W = 1;
+const int RASTER_PLANE_ATTRIBUTES = 2;
+
+// a triangle set up for rasterization. Values are planes over the
+// window - a * x + b * y + c at the pixel center (x, y)
+struct RASTER_TRIANGLE
+{
+	// edge functions, positive inside, and whether pixel centers
+	// exactly on the edge belong to this triangle
+	float edgeA[3];
+	float edgeB[3];
+	float edgeC[3];
+	bool bTopLeft[3];
+	// window depth, 1/w, then each attribute divided by w
+	float planeA[RASTER_ATTRIBUTE_COUNT + 2];
+	float planeB[RASTER_ATTRIBUTE_COUNT + 2];
+	float planeC[RASTER_ATTRIBUTE_COUNT + 2];
+	// bounding box in pixels, inclusive
+	int minX;
+	int maxX;
+	int minY;
+	int maxY;
+};
+
+// an active light, ready for shading
+struct RASTER_LIGHT
+{
+	bool bDirectional;
+	// position, or the direction toward a directional light
+	float vector[3];
+	float ambient[3];
+	float diffuse[3];
+	float specular[3];
+};
+
+// how the pixels of one draw command are shaded
+struct RASTER_MATERIAL
+{
+	// the RGBA8 mip chain, NULL for a flat color or a texture that
+	// failed to load
+	const int32_t* pTexels;
+	int levelCount;
+	const int* pLevelOffsets;
+	const int* pLevelWidths;
+	const int* pLevelHeights;
+	// a texture was asked for - one that failed to load samples as white
+	bool bUseTexture;
+	bool bBlend;
+	float color[4];
+	float diffuseColor[3];
+	float specularColor[3];
+	float shininess;
+};
+
+// the buffers being drawn into and the lighting of the frame
+struct RASTER_FRAME
+{
+	// rows of stride pixels, bottom row first
+	int32_t* pColorBuffer;
+	float* pDepthBuffer;
+	int stride;
+	bool bUseLighting;
+	const RASTER_LIGHT* pLights;
+	int lightCount;
+	float viewPosition[3];
+};
+
+// fill the pixels of the triangle within minX..maxX, minY..maxY, eight
+// pixels of a row at a time
+typedef void (*RASTERIZE_TRIANGLE)(
+	const RASTER_TRIANGLE& triangle,
+	const RASTER_MATERIAL& material,
+	const RASTER_FRAME& frame,
+	int minX,
+	int maxX,
+	int minY,
+	int maxY);
+
+namespace SoftwareRasterizerAvx2
+{
+	// only call when CpuFeatures::HasAvx2() is true
+	void RasterizeTriangle(
+		const RASTER_TRIANGLE& triangle,
+		const RASTER_MATERIAL& material,
+		const RASTER_FRAME& frame,
+		int minX,
+		int maxX,
+		int minY,
+		int maxY);
+}
+
+namespace SoftwareRasterizerScalar
+{
+	void RasterizeTriangle(
+		const RASTER_TRIANGLE& triangle,
+		const RASTER_MATERIAL& material,
+		const RASTER_FRAME& frame,
+		int minX,
+		int maxX,
+		int minY,
+		int maxY);
+}
@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizerkernels.inl
+// ============
+// body of the software rasterizer kernels, included by
+// SoftwareRasterizerAvx2.cpp and SoftwareRasterizerScalar.cpp
+//
+// NOTE: the including file names the namespace of the entry points in
+// RASTER_KERNEL_NAMESPACE. Everything else here has internal linkage, and
+// only Simd8.h and the C library are used, so no inline function built for
+// one instruction set can be picked by the linker for a caller built for
+// the other. The edge functions, depth test, perspective-correct
+// interpolation, texture sampling and the Phong model of fragmentShader.glsl
+// all run on eight pixels of a row at once. Texture level is picked per
+// group of eight from the analytic UV derivatives, then sampled bilinearly
+// with wrapping.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizerKernels.h"
+#include "Simd8.h"
+
+#include <cstddef>
+#include <math.h>
+
+using namespace SIMD8_NAMESPACE;
+
+namespace
+{
+	// three Float8 lanes of vectors
+	struct VEC3X8
+	{
+		Float8 x;
+		Float8 y;
+		Float8 z;
+	};
+
+	inline Float8 Dot(const VEC3X8& a, const VEC3X8& b)
+	{
+		return(MultiplyAdd(a.x, b.x, MultiplyAdd(a.y, b.y, a.z * b.z)));
+	}
+
+	inline VEC3X8 Normalize(const VEC3X8& a)
+	{
+		Float8 scale = Float8(1.0f) / Sqrt(Max(Dot(a, a), Float8(1.0e-20f)));
+		return(VEC3X8{ a.x * scale, a.y * scale, a.z * scale });
+	}
+
+	/***********************************************************
+	 *  PackColor()
+	 *
+	 *  Pack red, green and blue in [0, 1] into opaque RGBA8.
+	 ***********************************************************/
+	inline Int8 PackColor(Float8 r, Float8 g, Float8 b)
+	{
+		Float8 zero(0.0f);
+		Float8 one(1.0f);
+		Float8 scale(255.0f);
+		Float8 half(0.5f);
+		Int8 red = ToInt(MultiplyAdd(Min(Max(r, zero), one), scale, half));
+		Int8 green = ToInt(MultiplyAdd(Min(Max(g, zero), one), scale, half));
+		Int8 blue = ToInt(MultiplyAdd(Min(Max(b, zero), one), scale, half));
+		return(red | (green << 8) | (blue << 16) | Int8((int32_t)0xFF000000));
+	}
+
+	/***********************************************************
+	 *  UnpackChannel()
+	 *
+	 *  Return one 8-bit channel of RGBA8 texels as 0..255.
+	 ***********************************************************/
+	inline Float8 UnpackChannel(Int8 texels, int shift)
+	{
+		return(ToFloat((texels >> shift) & Int8(0xFF)));
+	}
+
+	/***********************************************************
+	 *  BilinearChannel()
+	 ***********************************************************/
+	inline Float8 BilinearChannel(Int8 t00, Int8 t10, Int8 t01, Int8 t11, int shift, Float8 fx, Float8 fy)
+	{
+		Float8 bottom = UnpackChannel(t00, shift);
+		Float8 top = UnpackChannel(t01, shift);
+		bottom = MultiplyAdd(UnpackChannel(t10, shift) - bottom, fx, bottom);
+		top = MultiplyAdd(UnpackChannel(t11, shift) - top, fx, top);
+		return(MultiplyAdd(top - bottom, fy, bottom) * Float8(1.0f / 255.0f));
+	}
+}
+
+namespace RASTER_KERNEL_NAMESPACE
+{
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This function fills the part of the triangle inside the
+ *  given pixels, eight pixels of a row at a time, running the
+ *  depth test and the fragment shader on the covered pixels.
+ ***********************************************************/
+void RasterizeTriangle(
+	const RASTER_TRIANGLE& triangle,
+	const RASTER_MATERIAL& material,
+	const RASTER_FRAME& frame,
+	int minX,
+	int maxX,
+	int minY,
+	int maxY)
+{
+	// whole groups of eight, so the loads stay within the row padding
+	minX &= ~7;
+
+	Mask8 topLeft[3] = { Mask8(triangle.bTopLeft[0]), Mask8(triangle.bTopLeft[1]), Mask8(triangle.bTopLeft[2]) };
+	Float8 zero(0.0f);
+	Float8 one(1.0f);
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		Float8 pixelY((float)y + 0.5f);
+		size_t rowStart = (size_t)y * frame.stride;
+
+		for (int x = minX; x <= maxX; x += 8)
+		{
+			Float8 pixelX = Float8::Ramp((float)x + 0.5f);
+
+			// coverage, with ties going to top and left edges
+			Mask8 covered = Int8::Ramp(x) < Int8(maxX + 1);
+			for (int i = 0; i < 3; i++)
+			{
+				Float8 edge = MultiplyAdd(Float8(triangle.edgeA[i]), pixelX,
+					MultiplyAdd(Float8(triangle.edgeB[i]), pixelY, Float8(triangle.edgeC[i])));
+				covered &= (edge > zero) | ((edge == zero) & topLeft[i]);
+			}
+			if (!covered.Any())
+			{
+				continue;
+			}
+
+			// depth test, GL_LESS
+			float* pDepth = frame.pDepthBuffer + rowStart + x;
+			Float8 depth = MultiplyAdd(Float8(triangle.planeA[RASTER_PLANE_DEPTH]), pixelX,
+				MultiplyAdd(Float8(triangle.planeB[RASTER_PLANE_DEPTH]), pixelY, Float8(triangle.planeC[RASTER_PLANE_DEPTH])));
+			Float8 storedDepth = Float8::Load(pDepth);
+			Mask8 visible = covered & (depth < storedDepth);
+			if (!visible.Any())
+			{
+				continue;
+			}
+
+			// perspective-correct attributes
+			Float8 inverseW = MultiplyAdd(Float8(triangle.planeA[RASTER_PLANE_INVERSE_W]), pixelX,
+				MultiplyAdd(Float8(triangle.planeB[RASTER_PLANE_INVERSE_W]), pixelY, Float8(triangle.planeC[RASTER_PLANE_INVERSE_W])));
+			Float8 w = one / inverseW;
+			Float8 attributes[RASTER_ATTRIBUTE_COUNT];
+			for (int k = 0; k < RASTER_ATTRIBUTE_COUNT; k++)
+			{
+				int plane = RASTER_PLANE_ATTRIBUTES + k;
+				attributes[k] = w * MultiplyAdd(Float8(triangle.planeA[plane]), pixelX,
+					MultiplyAdd(Float8(triangle.planeB[plane]), pixelY, Float8(triangle.planeC[plane])));
+			}
+
+			// base color and alpha - the texture or the flat color
+			VEC3X8 base;
+			Float8 alpha;
+			if (NULL != material.pTexels)
+			{
+				Float8 u = attributes[RASTER_ATTRIBUTE_TEXTURE];
+				Float8 v = attributes[RASTER_ATTRIBUTE_TEXTURE + 1];
+
+				// d(U/W)/dx = (dU/dx - u dW/dx) / W, and likewise for y
+				int uPlane = RASTER_PLANE_ATTRIBUTES + RASTER_ATTRIBUTE_TEXTURE;
+				int vPlane = uPlane + 1;
+				Float8 inverseWA(triangle.planeA[RASTER_PLANE_INVERSE_W]);
+				Float8 inverseWB(triangle.planeB[RASTER_PLANE_INVERSE_W]);
+				Float8 dudx = (Float8(triangle.planeA[uPlane]) - u * inverseWA) * w;
+				Float8 dvdx = (Float8(triangle.planeA[vPlane]) - v * inverseWA) * w;
+				Float8 dudy = (Float8(triangle.planeB[uPlane]) - u * inverseWB) * w;
+				Float8 dvdy = (Float8(triangle.planeB[vPlane]) - v * inverseWB) * w;
+
+				// the level for the sharpest covered pixel of the group
+				Float8 textureWidth((float)material.pLevelWidths[0]);
+				Float8 textureHeight((float)material.pLevelHeights[0]);
+				Float8 footprintX = dudx * textureWidth * dudx * textureWidth + dvdx * textureHeight * dvdx * textureHeight;
+				Float8 footprintY = dudy * textureWidth * dudy * textureWidth + dvdy * textureHeight * dvdy * textureHeight;
+				Float8 footprint = Select(visible, Max(footprintX, footprintY), Float8(1.0e30f));
+				float smallest = footprint.Lane(0);
+				for (int lane = 1; lane < 8; lane++)
+				{
+					float laneFootprint = footprint.Lane(lane);
+					smallest = (laneFootprint < smallest) ? laneFootprint : smallest;
+				}
+				// log2 of the squared footprint is twice the level
+				int level = (smallest > 1.0f) ? (int)(0.5f * log2f(smallest) + 0.5f) : 0;
+				level = (level < material.levelCount - 1) ? level : material.levelCount - 1;
+
+				int levelWidth = material.pLevelWidths[level];
+				int levelHeight = material.pLevelHeights[level];
+				const int32_t* pTexels = material.pTexels + material.pLevelOffsets[level];
+
+				// wrap, then find the four texels around the sample
+				Float8 texelX = (u - Floor(u)) * Float8((float)levelWidth) - Float8(0.5f);
+				Float8 texelY = (v - Floor(v)) * Float8((float)levelHeight) - Float8(0.5f);
+				Float8 floorX = Floor(texelX);
+				Float8 floorY = Floor(texelY);
+				Float8 fractionX = texelX - floorX;
+				Float8 fractionY = texelY - floorY;
+				Int8 x0 = ToInt(floorX);
+				Int8 y0 = ToInt(floorY);
+				x0 = Select(x0 < Int8(0), x0 + Int8(levelWidth), x0);
+				y0 = Select(y0 < Int8(0), y0 + Int8(levelHeight), y0);
+				Int8 x1 = x0 + Int8(1);
+				Int8 y1 = y0 + Int8(1);
+				x1 = Select(x1 == Int8(levelWidth), Int8(0), x1);
+				y1 = Select(y1 == Int8(levelHeight), Int8(0), y1);
+				// the wrapped coordinates can still be out of range
+				// when the interpolated UV is not finite
+				x0 = Select((x0 < Int8(0)) | (x0 > Int8(levelWidth - 1)), Int8(0), x0);
+				y0 = Select((y0 < Int8(0)) | (y0 > Int8(levelHeight - 1)), Int8(0), y0);
+				x1 = Select((x1 < Int8(0)) | (x1 > Int8(levelWidth - 1)), Int8(0), x1);
+				y1 = Select((y1 < Int8(0)) | (y1 > Int8(levelHeight - 1)), Int8(0), y1);
+
+				Int8 row0 = y0 * Int8(levelWidth);
+				Int8 row1 = y1 * Int8(levelWidth);
+				Int8 t00 = Gather(pTexels, row0 + x0, visible);
+				Int8 t10 = Gather(pTexels, row0 + x1, visible);
+				Int8 t01 = Gather(pTexels, row1 + x0, visible);
+				Int8 t11 = Gather(pTexels, row1 + x1, visible);
+
+				base.x = BilinearChannel(t00, t10, t01, t11, 0, fractionX, fractionY);
+				base.y = BilinearChannel(t00, t10, t01, t11, 8, fractionX, fractionY);
+				base.z = BilinearChannel(t00, t10, t01, t11, 16, fractionX, fractionY);
+				alpha = BilinearChannel(t00, t10, t01, t11, 24, fractionX, fractionY);
+			}
+			else if (material.bUseTexture)
+			{
+				// a texture that failed to load samples as white
+				base = VEC3X8{ one, one, one };
+				alpha = one;
+			}
+			else
+			{
+				base = VEC3X8{ Float8(material.color[0]), Float8(material.color[1]), Float8(material.color[2]) };
+				alpha = Float8(material.color[3]);
+			}
+
+			VEC3X8 color = base;
+			if (frame.bUseLighting)
+			{
+				VEC3X8 position = { attributes[RASTER_ATTRIBUTE_POSITION], attributes[RASTER_ATTRIBUTE_POSITION + 1], attributes[RASTER_ATTRIBUTE_POSITION + 2] };
+				VEC3X8 normal = Normalize(VEC3X8{ attributes[RASTER_ATTRIBUTE_NORMAL], attributes[RASTER_ATTRIBUTE_NORMAL + 1], attributes[RASTER_ATTRIBUTE_NORMAL + 2] });
+				VEC3X8 viewDirection = Normalize(VEC3X8{
+					Float8(frame.viewPosition[0]) - position.x,
+					Float8(frame.viewPosition[1]) - position.y,
+					Float8(frame.viewPosition[2]) - position.z });
+				Float8 shininess(material.shininess);
+
+				color = VEC3X8{ zero, zero, zero };
+				for (int lightIndex = 0; lightIndex < frame.lightCount; lightIndex++)
+				{
+					const RASTER_LIGHT& light = frame.pLights[lightIndex];
+					VEC3X8 lightDirection;
+					if (light.bDirectional)
+					{
+						lightDirection = VEC3X8{ Float8(light.vector[0]), Float8(light.vector[1]), Float8(light.vector[2]) };
+					}
+					else
+					{
+						lightDirection = Normalize(VEC3X8{
+							Float8(light.vector[0]) - position.x,
+							Float8(light.vector[1]) - position.y,
+							Float8(light.vector[2]) - position.z });
+					}
+
+					// reflect(-L, N) = 2 (N.L) N - L
+					Float8 normalDotLight = Dot(normal, lightDirection);
+					Float8 diffuse = Max(normalDotLight, zero);
+					Float8 twiceDot = normalDotLight + normalDotLight;
+					VEC3X8 reflection = {
+						MultiplyAdd(twiceDot, normal.x, -lightDirection.x),
+						MultiplyAdd(twiceDot, normal.y, -lightDirection.y),
+						MultiplyAdd(twiceDot, normal.z, -lightDirection.z) };
+					Float8 specular = Pow(Max(Dot(viewDirection, reflection), zero), shininess);
+
+					// point lights leave the base color out of the
+					// specular term, as the shader does
+					Float8 specularBase = light.bDirectional ? one : zero;
+					for (int channel = 0; channel < 3; channel++)
+					{
+						Float8& out = (channel == 0) ? color.x : ((channel == 1) ? color.y : color.z);
+						Float8 baseChannel = (channel == 0) ? base.x : ((channel == 1) ? base.y : base.z);
+						float diffuseScale = light.diffuse[channel] * material.diffuseColor[channel];
+						float specularScale = light.specular[channel] * material.specularColor[channel];
+						Float8 lit = MultiplyAdd(Float8(diffuseScale), diffuse, Float8(light.ambient[channel]));
+						Float8 specularTerm = Float8(specularScale) * specular;
+						out += lit * baseChannel + Select(specularBase > zero, specularTerm * baseChannel, specularTerm);
+					}
+				}
+			}
+
+			int32_t* pColor = frame.pColorBuffer + rowStart + x;
+			Int8 storedColor = Int8::Load(pColor);
+			if (material.bBlend)
+			{
+				// GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA without depth writes
+				Float8 sourceAlpha = Min(Max(alpha, zero), one);
+				Float8 scale(1.0f / 255.0f);
+				color.x = MultiplyAdd(Min(Max(color.x, zero), one) - UnpackChannel(storedColor, 0) * scale, sourceAlpha, UnpackChannel(storedColor, 0) * scale);
+				color.y = MultiplyAdd(Min(Max(color.y, zero), one) - UnpackChannel(storedColor, 8) * scale, sourceAlpha, UnpackChannel(storedColor, 8) * scale);
+				color.z = MultiplyAdd(Min(Max(color.z, zero), one) - UnpackChannel(storedColor, 16) * scale, sourceAlpha, UnpackChannel(storedColor, 16) * scale);
+			}
+			else
+			{
+				Select(visible, depth, storedDepth).Store(pDepth);
+			}
+			Select(visible, PackColor(color.x, color.y, color.z), storedColor).Store(pColor);
+		}
+	}
+}
+
+}
@@ -0,0 +1,10 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizerscalar.cpp
+// ============
+// the software rasterizer kernels built for any x86 CPU, used when AVX2
+// is missing
+///////////////////////////////////////////////////////////////////////////////
+
+#define SIMD8_FORCE_SCALAR
+#define RASTER_KERNEL_NAMESPACE SoftwareRasterizerScalar
+#include "SoftwareRasterizerKernels.inl"
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// spscqueue.h
+// ============
+// bounded lock-free single producer / single consumer ring buffer
+//
+//  One thread may call Push() and one other thread may call Pop(). Neither
+//  call ever blocks - Push() fails when the ring is full and Pop() fails
+//  when it is empty. The capacity must be a power of two.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+		"SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue()
+	{
+		m_head.store(0);
+		m_tail.store(0);
+	}
+
+	// producer side - returns false if the ring is full
+	bool Push(const T& item)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) >= CAPACITY)
+		{
+			return(false);
+		}
+		m_items[tail & (CAPACITY - 1)] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return(true);
+	}
+
+	// consumer side - returns false if the ring is empty
+	bool Pop(T& item)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+		{
+			return(false);
+		}
+		item = m_items[head & (CAPACITY - 1)];
+		m_head.store(head + 1, std::memory_order_release);
+		return(true);
+	}
+
+private:
+	T m_items[CAPACITY];
+	// next slot to read, written only by the consumer
+	alignas(64) std::atomic<size_t> m_head;
+	// next slot to write, written only by the producer
+	alignas(64) std::atomic<size_t> m_tail;
+};
@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+// startuploader.cpp
+// ============
+// the startup work queued ahead of the OpenGL context
+//
+// NOTE: the shader manager opens its vertex and fragment shader files itself,
+// so reading them here only brings them into the file cache - the multi-view
+// geometry shader is compiled from the source read here. The basic meshes
+// are generated straight into OpenGL buffers and stay on the context thread,
+// so only their CPU tessellation, which sizes them for the statistics, runs
+// ahead.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StartupLoader.h"
+#include "StartupProfiler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	// returned for a shader file that was never asked for
+	const std::string g_EmptyFile;
+}
+
+/***********************************************************
+ *  StartupLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StartupLoader::StartupLoader(bool bParallel)
+{
+	m_bParallel = bParallel;
+	m_pThreadPool = NULL;
+}
+
+/***********************************************************
+ *  ~StartupLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StartupLoader::~StartupLoader()
+{
+	Finish();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method queues the shader files first, since they
+ *  are the quickest to read, then a task per scene texture
+ *  and the mesh tessellation.
+ ***********************************************************/
+void StartupLoader::Start(const std::vector<std::string>& shaderFilenames)
+{
+	for (const std::string& filename : shaderFilenames)
+	{
+		// every file gets its entry now, so the tasks never change
+		// the map itself
+		std::string* pContents = &m_shaderFiles[filename];
+		m_shaderTasks.tasks.push_back(STARTUP_TASK{ "ReadShaderFile " + filename, [filename, pContents]()
+		{
+			std::ifstream shaderFile(filename);
+			std::stringstream shaderStream;
+			shaderStream << shaderFile.rdbuf();
+			*pContents = shaderStream.str();
+		} });
+	}
+
+	SceneManager::PrepareTextureDecoding();
+	int textureCount = SceneManager::GetSceneTextureCount();
+	for (int i = 0; i < textureCount; i++)
+	{
+		const SceneManager::TEXTURE_FILE& textureFile = SceneManager::GetSceneTextureFile(i);
+		SceneManager::DECODED_TEXTURE* pTexture = &m_sceneAssets.textures[i];
+		m_sceneTasks.tasks.push_back(STARTUP_TASK{ std::string("DecodeTexture ") + textureFile.tag, [textureFile, pTexture]()
+		{
+			SceneManager::DecodeTexture(textureFile.filename, *pTexture);
+		} });
+	}
+	uint32_t* pMeshTriangles = m_sceneAssets.meshTriangles;
+	m_sceneTasks.tasks.push_back(STARTUP_TASK{ "CountMeshTriangles", [pMeshTriangles]()
+	{
+		SceneManager::CountMeshTriangles(pMeshTriangles);
+	} });
+
+	if (!m_bParallel)
+	{
+		return;
+	}
+
+	// the calling thread is busy bringing up the window meanwhile
+	int taskCount = (int)(m_shaderTasks.tasks.size() + m_sceneTasks.tasks.size());
+	int threadCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	m_pThreadPool = new ThreadPool(std::min(taskCount, threadCount));
+	Submit(m_shaderTasks);
+	Submit(m_sceneTasks);
+}
+
+/***********************************************************
+ *  Submit()
+ ***********************************************************/
+void StartupLoader::Submit(TASK_GROUP& group)
+{
+	group.pendingCount = (int)group.tasks.size();
+	for (const STARTUP_TASK& task : group.tasks)
+	{
+		const STARTUP_TASK* pTask = &task;
+		TASK_GROUP* pGroup = &group;
+		m_pThreadPool->Submit([this, pTask, pGroup]()
+		{
+			{
+				StartupPhase startupPhase(pTask->name);
+				pTask->work();
+			}
+			std::lock_guard<std::mutex> lock(m_mutex);
+			pGroup->pendingCount--;
+			m_taskDone.notify_all();
+		});
+	}
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method waits for the group's tasks on the worker
+ *  threads, timed as a phase that depends on all of them,
+ *  or does them here when loading serially.
+ ***********************************************************/
+void StartupLoader::Wait(TASK_GROUP& group, const char* pWaitName)
+{
+	if (!m_bParallel)
+	{
+		for (const STARTUP_TASK& task : group.tasks)
+		{
+			StartupPhase startupPhase(task.name);
+			task.work();
+		}
+		group.tasks.clear();
+		return;
+	}
+
+	std::vector<std::string> taskNames;
+	for (const STARTUP_TASK& task : group.tasks)
+	{
+		taskNames.push_back(task.name);
+	}
+	StartupPhase startupPhase(pWaitName, taskNames);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_taskDone.wait(lock, [&group]() { return(group.pendingCount == 0); });
+}
+
+/***********************************************************
+ *  WaitForShaderFiles()
+ ***********************************************************/
+void StartupLoader::WaitForShaderFiles()
+{
+	Wait(m_shaderTasks, "WaitForShaderFiles");
+}
+
+/***********************************************************
+ *  GetShaderFile()
+ ***********************************************************/
+const std::string& StartupLoader::GetShaderFile(const std::string& filename) const
+{
+	std::map<std::string, std::string>::const_iterator found = m_shaderFiles.find(filename);
+	if (found == m_shaderFiles.end())
+	{
+		return(g_EmptyFile);
+	}
+	return(found->second);
+}
+
+/***********************************************************
+ *  WaitForSceneAssets()
+ ***********************************************************/
+const SceneManager::SCENE_ASSETS* StartupLoader::WaitForSceneAssets()
+{
+	Wait(m_sceneTasks, "WaitForSceneAssets");
+	return(&m_sceneAssets);
+}
+
+/***********************************************************
+ *  Finish()
+ ***********************************************************/
+void StartupLoader::Finish()
+{
+	if (NULL != m_pThreadPool)
+	{
+		m_pThreadPool->WaitIdle();
+		delete m_pThreadPool;
+		m_pThreadPool = NULL;
+	}
+
+	// the textures were uploaded by now
+	int textureCount = SceneManager::GetSceneTextureCount();
+	for (int i = 0; i < textureCount; i++)
+	{
+		std::vector<unsigned char>().swap(m_sceneAssets.textures[i].pixels);
+	}
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// startuploader.h
+// ============
+// the startup work that needs no OpenGL context - decoding the scene
+// textures, tessellating the meshes to size them and reading the shader
+// files - run on worker threads while the window and context come up
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+class StartupLoader
+{
+public:
+	// constructor - unless parallel, each piece of work is done on the
+	// calling thread when it is first waited for, in the order startup
+	// used to do it
+	StartupLoader(bool bParallel);
+	// destructor - waits for the work
+	~StartupLoader();
+
+	// queue the work
+	void Start(const std::vector<std::string>& shaderFilenames);
+
+	// wait for the shader files to be read
+	void WaitForShaderFiles();
+	// the contents of a shader file, empty if it could not be read -
+	// valid once WaitForShaderFiles() returned
+	const std::string& GetShaderFile(const std::string& filename) const;
+
+	// wait for the decoded textures and mesh sizes, to hand to
+	// SceneManager::PrepareScene()
+	const SceneManager::SCENE_ASSETS* WaitForSceneAssets();
+
+	// wait for any work left, stop the worker threads and release the
+	// decoded textures - once the scene is prepared
+	void Finish();
+
+private:
+	// work done once, timed as a startup phase under its name
+	struct STARTUP_TASK
+	{
+		std::string name;
+		std::function<void()> work;
+	};
+
+	// tasks that are waited for together
+	struct TASK_GROUP
+	{
+		std::vector<STARTUP_TASK> tasks;
+		int pendingCount = 0;
+	};
+
+	bool m_bParallel;
+	ThreadPool* m_pThreadPool;
+	std::mutex m_mutex;
+	// signalled when a task finishes
+	std::condition_variable m_taskDone;
+
+	TASK_GROUP m_shaderTasks;
+	TASK_GROUP m_sceneTasks;
+
+	// the results, each written by one task only
+	std::map<std::string, std::string> m_shaderFiles;
+	SceneManager::SCENE_ASSETS m_sceneAssets;
+
+	void Submit(TASK_GROUP& group);
+	void Wait(TASK_GROUP& group, const char* pWaitName);
+};
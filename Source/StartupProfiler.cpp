@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+// startupprofiler.cpp
+// ============
+// the startup phase records and the critical path report
+//
+// NOTE: phases are few and recorded once each, so they go into one list
+// under a lock. The time between two phases on the critical path is shown
+// as waiting - work that was not timed as a phase, or a thread that had
+// not been given its next phase yet.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StartupProfiler.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+	// one finished phase
+	struct STARTUP_PHASE_RECORD
+	{
+		std::string name;
+		int threadIndex;
+		int64_t startTime;
+		int64_t endTime;
+		std::vector<std::string> dependencies;
+	};
+
+	std::atomic<bool> g_bTiming(false);
+	std::chrono::steady_clock::time_point g_StartTime;
+	std::mutex g_Mutex;
+	std::vector<STARTUP_PHASE_RECORD> g_Phases;
+	// threads are numbered in the order they record their first phase,
+	// after the one that started timing - a thread of its own rather
+	// than its id, which a later thread may be given again
+	int g_ThreadCount = 0;
+	thread_local int t_ThreadIndex = -1;
+
+	/***********************************************************
+	 *  ToMilliseconds()
+	 ***********************************************************/
+	double ToMilliseconds(int64_t nanoseconds)
+	{
+		return(nanoseconds / 1000000.0);
+	}
+
+	/***********************************************************
+	 *  FindPredecessor()
+	 *
+	 *  Returns the phase that finished last of those the given
+	 *  one depends on - the one before it on its thread and the
+	 *  ones it names - or -1 if there are none.
+	 ***********************************************************/
+	int FindPredecessor(const std::vector<STARTUP_PHASE_RECORD>& phases, int index)
+	{
+		const STARTUP_PHASE_RECORD& phase = phases[index];
+		int predecessor = -1;
+		for (int i = 0; i < (int)phases.size(); i++)
+		{
+			const STARTUP_PHASE_RECORD& candidate = phases[i];
+			if ((i == index) || (candidate.endTime > phase.endTime))
+			{
+				continue;
+			}
+
+			bool bDependency = (candidate.threadIndex == phase.threadIndex) && (candidate.endTime <= phase.startTime);
+			for (const std::string& dependency : phase.dependencies)
+			{
+				bDependency = bDependency || (candidate.name == dependency);
+			}
+			if (bDependency && ((predecessor < 0) || (candidate.endTime > phases[predecessor].endTime)))
+			{
+				predecessor = i;
+			}
+		}
+		return(predecessor);
+	}
+}
+
+/***********************************************************
+ *  Start()
+ ***********************************************************/
+void StartupProfiler::Start(std::chrono::steady_clock::time_point startTime)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+	g_StartTime = startTime;
+	g_Phases.clear();
+	g_ThreadCount = 1;
+	t_ThreadIndex = 0;
+	g_bTiming = true;
+}
+
+/***********************************************************
+ *  IsTiming()
+ ***********************************************************/
+bool StartupProfiler::IsTiming()
+{
+	return(g_bTiming.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  GetTimestamp()
+ ***********************************************************/
+int64_t StartupProfiler::GetTimestamp()
+{
+	return(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - g_StartTime).count());
+}
+
+/***********************************************************
+ *  RecordPhase()
+ ***********************************************************/
+void StartupProfiler::RecordPhase(
+	const std::string& name,
+	int64_t startTime,
+	int64_t endTime,
+	const std::vector<std::string>& dependencies)
+{
+	std::lock_guard<std::mutex> lock(g_Mutex);
+	if (!g_bTiming)
+	{
+		return;
+	}
+
+	if (t_ThreadIndex < 0)
+	{
+		t_ThreadIndex = g_ThreadCount++;
+	}
+
+	STARTUP_PHASE_RECORD phase;
+	phase.name = name;
+	phase.threadIndex = t_ThreadIndex;
+	phase.startTime = startTime;
+	phase.endTime = endTime;
+	phase.dependencies = dependencies;
+	g_Phases.push_back(phase);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method lists every phase in the order they started,
+ *  then the chain of phases the last one waited on, and how
+ *  much of the phases' work overlapped.
+ ***********************************************************/
+void StartupProfiler::Finish()
+{
+	std::vector<STARTUP_PHASE_RECORD> phases;
+	int threadCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(g_Mutex);
+		if (!g_bTiming)
+		{
+			return;
+		}
+		g_bTiming = false;
+		phases.swap(g_Phases);
+		threadCount = g_ThreadCount;
+	}
+	if (phases.empty())
+	{
+		return;
+	}
+
+	std::sort(phases.begin(), phases.end(),
+		[](const STARTUP_PHASE_RECORD& a, const STARTUP_PHASE_RECORD& b) { return(a.startTime < b.startTime); });
+
+	int lastPhase = 0;
+	int64_t workTime = 0;
+	LOG_INFO("Startup phases:");
+	for (int i = 0; i < (int)phases.size(); i++)
+	{
+		const STARTUP_PHASE_RECORD& phase = phases[i];
+		LOG_INFO("  %-32s thread %d  at %8.2f ms  for %8.2f ms",
+			phase.name.c_str(),
+			phase.threadIndex,
+			ToMilliseconds(phase.startTime),
+			ToMilliseconds(phase.endTime - phase.startTime));
+		workTime += phase.endTime - phase.startTime;
+		if (phase.endTime > phases[lastPhase].endTime)
+		{
+			lastPhase = i;
+		}
+	}
+
+	// follow the latest finishing dependency back from the last phase
+	std::vector<int> criticalPath;
+	for (int i = lastPhase; (i >= 0) && (criticalPath.size() < phases.size()); i = FindPredecessor(phases, i))
+	{
+		criticalPath.push_back(i);
+	}
+	std::reverse(criticalPath.begin(), criticalPath.end());
+
+	// a phase that began before its predecessor ended - one waiting
+	// on another thread - only adds the time after that
+	int64_t criticalTime = 0;
+	int64_t gapTime = 0;
+	int64_t previousEndTime = 0;
+	LOG_INFO("Startup critical path:");
+	for (int index : criticalPath)
+	{
+		const STARTUP_PHASE_RECORD& phase = phases[index];
+		int64_t gap = std::max((int64_t)0, phase.startTime - previousEndTime);
+		int64_t added = phase.endTime - std::max(phase.startTime, previousEndTime);
+		LOG_INFO("  %-32s thread %d  adds %8.2f ms after a %.2f ms gap",
+			phase.name.c_str(),
+			phase.threadIndex,
+			ToMilliseconds(added),
+			ToMilliseconds(gap));
+		criticalTime += added;
+		gapTime += gap;
+		previousEndTime = phase.endTime;
+	}
+
+	LOG_INFO("Startup took %.2f ms to the end of %s - %.2f ms on the critical path and %.2f ms between its phases, out of %.2f ms in all phases on %d threads",
+		ToMilliseconds(phases[lastPhase].endTime),
+		phases[lastPhase].name.c_str(),
+		ToMilliseconds(criticalTime),
+		ToMilliseconds(gapTime),
+		ToMilliseconds(workTime),
+		threadCount);
+}
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// startupprofiler.h
+// ============
+// time the phases of startup on every thread, from main() to the first frame
+// on screen, and report which chain of them decided when that frame appeared
+//
+//  A phase depends on the phase its thread ran before it, and on any phases
+//  named when it is recorded - the work it waited for on other threads. The
+//  critical path is followed back from the last phase to finish, always
+//  through the dependency that finished last.
+//
+//  Usage:
+//      StartupPhase startupPhase("LoadShaders");
+//      StartupPhase waitPhase("WaitForTextures", { "DecodeTextures" });
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+class StartupProfiler
+{
+public:
+	// start timing phases, measured from the given moment
+	static void Start(std::chrono::steady_clock::time_point startTime);
+	// log the phases and the critical path, and stop timing - once the
+	// first frame is on screen
+	static void Finish();
+
+	// true between Start() and Finish()
+	static bool IsTiming();
+
+	// nanoseconds since the start time
+	static int64_t GetTimestamp();
+	// add a finished phase of the calling thread
+	static void RecordPhase(
+		const std::string& name,
+		int64_t startTime,
+		int64_t endTime,
+		const std::vector<std::string>& dependencies);
+};
+
+/***********************************************************
+ *  StartupPhase
+ *
+ *  Records the time between its construction and its end
+ *  as a startup phase of the calling thread.
+ ***********************************************************/
+class StartupPhase
+{
+public:
+	StartupPhase(const std::string& name, std::initializer_list<std::string> dependencies = {})
+	{
+		m_name = name;
+		m_dependencies = dependencies;
+		m_startTime = StartupProfiler::IsTiming() ? StartupProfiler::GetTimestamp() : -1;
+	}
+
+	StartupPhase(const std::string& name, const std::vector<std::string>& dependencies)
+	{
+		m_name = name;
+		m_dependencies = dependencies;
+		m_startTime = StartupProfiler::IsTiming() ? StartupProfiler::GetTimestamp() : -1;
+	}
+
+	~StartupPhase()
+	{
+		if (m_startTime >= 0)
+		{
+			StartupProfiler::RecordPhase(m_name, m_startTime, StartupProfiler::GetTimestamp(), m_dependencies);
+		}
+	}
+
+private:
+	std::string m_name;
+	std::vector<std::string> m_dependencies;
+	int64_t m_startTime;
+};
@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// statsoverlay.cpp
+// ============
+// text overlay of the render statistics
+//
+// NOTE: the text is drawn by one fragment shader pass over the overlay
+// rectangle. The characters of the grid are uploaded as a small integer
+// texture each frame, and the shader looks each pixel's glyph row up in a
+// second texture holding a 5x7 bitmap font, so the overlay costs a single
+// draw and a few hundred bytes of upload however much text it shows.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StatsOverlay.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <string>
+
+namespace
+{
+	// printable ASCII from the space to the underscore, upper case only
+	const int FIRST_GLYPH = 32;
+	const int GLYPH_COUNT = 64;
+	const int GLYPH_ROWS = 7;
+
+	// rows of each glyph from the top, bit 4 being the leftmost pixel
+	const unsigned char FONT_GLYPHS[GLYPH_COUNT][GLYPH_ROWS] =
+	{
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, { 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A },
+		{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, { 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 },
+		{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 },
+		{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },
+		{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E },
+		{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }
+	};
+
+	// window pixels per font pixel, and font pixels per character cell
+	// including the spacing
+	const int PIXEL_SCALE = 2;
+	const int CELL_WIDTH = 6;
+	const int CELL_HEIGHT = 9;
+	// font pixels of background around the text
+	const int MARGIN = 2;
+	// texture units used by the overlay - kept clear of the units the
+	// scene textures are bound to once at startup
+	const int OVERLAY_TEXTURE_UNIT = 12;
+
+	/***********************************************************
+	 *  FormatBytes()
+	 ***********************************************************/
+	std::string FormatBytes(uint64_t bytes)
+	{
+		char text[32];
+		if (bytes >= 1024 * 1024)
+		{
+			snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+		}
+		else if (bytes >= 1024)
+		{
+			snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+		}
+		else
+		{
+			snprintf(text, sizeof(text), "%llu B", (unsigned long long)bytes);
+		}
+		return(text);
+	}
+
+	/***********************************************************
+	 *  FormatLines()
+	 *
+	 *  Lay the statistics out as one line of text per counter.
+	 ***********************************************************/
+	void FormatLines(const RENDER_STATS& stats, std::string lines[StatsOverlay::TEXT_ROWS])
+	{
+		char text[64];
+		double framesPerSecond = (stats.frameMilliseconds > 0.0) ? 1000.0 / stats.frameMilliseconds : 0.0;
+
+		snprintf(text, sizeof(text), "FRAME %6.2f MS %5.0f FPS", stats.frameMilliseconds, framesPerSecond);
+		lines[0] = text;
+		snprintf(text, sizeof(text), "CPU   %6.2f MS", stats.cpuMilliseconds);
+		lines[1] = text;
+		snprintf(text, sizeof(text), "GPU   %6.2f MS", stats.gpuMilliseconds);
+		lines[2] = text;
+		// the counters below only cover the scene manager
+		lines[3] = "SCENE MANAGER ONLY";
+		snprintf(text, sizeof(text), "DRAWS     %llu", (unsigned long long)stats.drawCalls);
+		lines[4] = text;
+		snprintf(text, sizeof(text), "TRIANGLES %llu", (unsigned long long)stats.triangles);
+		lines[5] = text;
+		snprintf(text, sizeof(text), "UNIFORMS  %llu", (unsigned long long)stats.uniformWrites);
+		lines[6] = text;
+		snprintf(text, sizeof(text), "TEXTURES  %llu", (unsigned long long)stats.textureBinds);
+		lines[7] = text;
+		snprintf(text, sizeof(text), "STATES    %llu", (unsigned long long)stats.stateChanges);
+		lines[8] = text;
+		lines[9] = "UPLOADED  " + FormatBytes(stats.bytesUploaded);
+	}
+}
+
+/***********************************************************
+ *  StatsOverlay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StatsOverlay::StatsOverlay()
+{
+	m_pOverlayShader = new ShaderManager();
+	m_pOverlayShader->LoadShaders(
+		"shaders/statsOverlayVertexShader.glsl",
+		"shaders/statsOverlayFragmentShader.glsl");
+
+	glGenVertexArrays(1, &m_vertexArray);
+
+	// one texel per glyph row, the glyphs side by side
+	unsigned char fontRows[GLYPH_ROWS][GLYPH_COUNT];
+	for (int glyph = 0; glyph < GLYPH_COUNT; glyph++)
+	{
+		for (int row = 0; row < GLYPH_ROWS; row++)
+		{
+			fontRows[row][glyph] = FONT_GLYPHS[glyph][row];
+		}
+	}
+
+	glGenTextures(1, &m_fontTexture);
+	glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, GLYPH_COUNT, GLYPH_ROWS, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, fontRows);
+
+	m_text.assign(TEXT_COLUMNS * TEXT_ROWS, ' ');
+	glGenTextures(1, &m_textTexture);
+	glBindTexture(GL_TEXTURE_2D, m_textTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, TEXT_COLUMNS, TEXT_ROWS, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, m_text.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  ~StatsOverlay()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StatsOverlay::~StatsOverlay()
+{
+	glDeleteTextures(1, &m_fontTexture);
+	glDeleteTextures(1, &m_textTexture);
+	glDeleteVertexArrays(1, &m_vertexArray);
+
+	if (NULL != m_pOverlayShader)
+	{
+		delete m_pOverlayShader;
+		m_pOverlayShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Draw()
+ ***********************************************************/
+void StatsOverlay::Draw(const RENDER_STATS& stats, int framebufferWidth, int framebufferHeight)
+{
+	std::string lines[TEXT_ROWS];
+	FormatLines(stats, lines);
+
+	// the grid is stored top row first, and the font only has capitals
+	std::fill(m_text.begin(), m_text.end(), ' ');
+	for (int row = 0; row < TEXT_ROWS; row++)
+	{
+		int length = std::min((int)lines[row].size(), TEXT_COLUMNS);
+		for (int column = 0; column < length; column++)
+		{
+			m_text[row * TEXT_COLUMNS + column] = (unsigned char)toupper((unsigned char)lines[row][column]);
+		}
+	}
+
+	int overlayWidth = std::min((TEXT_COLUMNS * CELL_WIDTH + 2 * MARGIN) * PIXEL_SCALE, framebufferWidth);
+	int overlayHeight = std::min((TEXT_ROWS * CELL_HEIGHT + 2 * MARGIN) * PIXEL_SCALE, framebufferHeight);
+	int overlayBottom = framebufferHeight - overlayHeight;
+
+	// the scene shader stays bound between frames, so put it back after
+	GLint sceneProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &sceneProgram);
+
+	// the full-screen triangle only covers the overlay with the viewport
+	// set to it
+	glViewport(0, overlayBottom, overlayWidth, overlayHeight);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glActiveTexture(GL_TEXTURE0 + OVERLAY_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_textTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXT_COLUMNS, TEXT_ROWS, GL_RED_INTEGER, GL_UNSIGNED_BYTE, m_text.data());
+	glActiveTexture(GL_TEXTURE0 + OVERLAY_TEXTURE_UNIT + 1);
+	glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pOverlayShader->use();
+	m_pOverlayShader->setSampler2DValue("textCodes", OVERLAY_TEXTURE_UNIT);
+	m_pOverlayShader->setSampler2DValue("fontRows", OVERLAY_TEXTURE_UNIT + 1);
+	m_pOverlayShader->setVec2Value("overlayTopLeft", glm::vec2(0.0f, (float)framebufferHeight));
+	m_pOverlayShader->setIntValue("pixelScale", PIXEL_SCALE);
+	m_pOverlayShader->setIntValue("margin", MARGIN);
+
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glViewport(0, 0, framebufferWidth, framebufferHeight);
+	glDisable(GL_BLEND);
+	glUseProgram(sceneProgram);
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// statsoverlay.h
+// ============
+// draw the render statistics of the last frame as text in the corner of
+// the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderStats.h"
+#include "ShaderManager.h"
+
+#include <vector>
+
+class StatsOverlay
+{
+public:
+	// constructor - an OpenGL context must be current
+	StatsOverlay();
+	// destructor
+	~StatsOverlay();
+
+	// draw the statistics into the top left corner of the bound
+	// framebuffer, over what is already there
+	void Draw(const RENDER_STATS& stats, int framebufferWidth, int framebufferHeight);
+
+	// the characters of the text grid - the columns are kept a multiple
+	// of four so the rows upload without unpack padding
+	static const int TEXT_COLUMNS = 28;
+	static const int TEXT_ROWS = 10;
+
+private:
+	// shader program that draws the text
+	ShaderManager* m_pOverlayShader;
+	// empty vertex array for the full-screen triangle
+	GLuint m_vertexArray;
+	// bit rows of each glyph, and the character codes of the text grid
+	GLuint m_fontTexture;
+	GLuint m_textTexture;
+	std::vector<unsigned char> m_text;
+};
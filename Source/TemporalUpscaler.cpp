@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////////////////
+// temporalupscaler.cpp
+// ============
+// temporal upsampling resolve pass
+//
+// NOTE: the projection is jittered along a Halton(2,3) sequence so that, over
+// a few frames, every output pixel receives samples from different sub-pixel
+// positions. Each frame the previous result is reprojected with the motion
+// vectors, clamped to the colors around the new sample to reject stale
+// history, and blended with the new sample.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TemporalUpscaler.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+namespace
+{
+	// number of distinct jitter positions before the sequence repeats
+	const unsigned int JITTER_SEQUENCE_LENGTH = 8;
+	// weight of the reprojected history in the blended result
+	const float HISTORY_WEIGHT = 0.9f;
+	// texture units used by the resolve pass - kept clear of the units
+	// the scene textures are bound to once at startup
+	const int RESOLVE_TEXTURE_UNIT = 12;
+
+	/***********************************************************
+	 *  Halton()
+	 *
+	 *  Return the index-th value of the Halton sequence for the
+	 *  given base, in the range [0, 1).
+	 ***********************************************************/
+	float Halton(unsigned int index, unsigned int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / (float)base;
+		while (index > 0)
+		{
+			result += fraction * (float)(index % base);
+			index /= base;
+			fraction /= (float)base;
+		}
+		return(result);
+	}
+}
+
+/***********************************************************
+ *  TemporalUpscaler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TemporalUpscaler::TemporalUpscaler()
+{
+	m_pResolveShader = new ShaderManager();
+	m_pResolveShader->LoadShaders(
+		"shaders/temporalResolveVertexShader.glsl",
+		"shaders/temporalResolveFragmentShader.glsl");
+
+	glGenVertexArrays(1, &m_vertexArray);
+
+	for (int i = 0; i < 2; i++)
+	{
+		m_historyTextures[i] = 0;
+		m_historyFramebuffers[i] = 0;
+	}
+	m_historyWidth = 0;
+	m_historyHeight = 0;
+	m_currentHistory = 0;
+	m_bHistoryValid = false;
+
+	m_jitterIndex = 0;
+	m_jitter = glm::vec2(0.0f, 0.0f);
+	m_currentViewProjection = glm::mat4(1.0f);
+	m_previousViewProjection = glm::mat4(1.0f);
+}
+
+/***********************************************************
+ *  ~TemporalUpscaler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TemporalUpscaler::~TemporalUpscaler()
+{
+	DestroyHistory();
+	glDeleteVertexArrays(1, &m_vertexArray);
+
+	if (NULL != m_pResolveShader)
+	{
+		delete m_pResolveShader;
+		m_pResolveShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  NextJitter()
+ *
+ *  This method returns the next sub-pixel offset, centered
+ *  on the pixel, in render pixels.
+ ***********************************************************/
+glm::vec2 TemporalUpscaler::NextJitter()
+{
+	// the Halton sequence starts at 1 - index 0 is always zero
+	m_jitterIndex = (m_jitterIndex % JITTER_SEQUENCE_LENGTH) + 1;
+	m_jitter = glm::vec2(
+		Halton(m_jitterIndex, 2) - 0.5f,
+		Halton(m_jitterIndex, 3) - 0.5f);
+	return(m_jitter);
+}
+
+/***********************************************************
+ *  SetCameraMatrices()
+ ***********************************************************/
+void TemporalUpscaler::SetCameraMatrices(
+	const glm::mat4& currentViewProjection,
+	const glm::mat4& previousViewProjection)
+{
+	m_currentViewProjection = currentViewProjection;
+	m_previousViewProjection = previousViewProjection;
+}
+
+/***********************************************************
+ *  ResetHistory()
+ ***********************************************************/
+void TemporalUpscaler::ResetHistory()
+{
+	m_bHistoryValid = false;
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method runs the resolve pass into the next history
+ *  image and copies the result into the window framebuffer.
+ ***********************************************************/
+void TemporalUpscaler::Resolve(
+	GLuint colorTexture,
+	GLuint motionTexture,
+	GLuint depthTexture,
+	int renderWidth,
+	int renderHeight,
+	int textureWidth,
+	int textureHeight,
+	int outputWidth,
+	int outputHeight)
+{
+	if ((outputWidth != m_historyWidth) || (outputHeight != m_historyHeight))
+	{
+		DestroyHistory();
+		CreateHistory(outputWidth, outputHeight);
+	}
+
+	int previousHistory = m_currentHistory;
+	m_currentHistory = 1 - m_currentHistory;
+
+	// the scene shader stays bound between frames, so put it back after
+	GLint sceneProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &sceneProgram);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_historyFramebuffers[m_currentHistory]);
+	glViewport(0, 0, outputWidth, outputHeight);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glActiveTexture(GL_TEXTURE0 + RESOLVE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, colorTexture);
+	glActiveTexture(GL_TEXTURE0 + RESOLVE_TEXTURE_UNIT + 1);
+	glBindTexture(GL_TEXTURE_2D, motionTexture);
+	glActiveTexture(GL_TEXTURE0 + RESOLVE_TEXTURE_UNIT + 2);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glActiveTexture(GL_TEXTURE0 + RESOLVE_TEXTURE_UNIT + 3);
+	glBindTexture(GL_TEXTURE_2D, m_historyTextures[previousHistory]);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pResolveShader->use();
+	m_pResolveShader->setSampler2DValue("currentColor", RESOLVE_TEXTURE_UNIT);
+	m_pResolveShader->setSampler2DValue("motionVectors", RESOLVE_TEXTURE_UNIT + 1);
+	m_pResolveShader->setSampler2DValue("sceneDepth", RESOLVE_TEXTURE_UNIT + 2);
+	m_pResolveShader->setSampler2DValue("historyColor", RESOLVE_TEXTURE_UNIT + 3);
+	m_pResolveShader->setVec2Value("renderSize", glm::vec2((float)renderWidth, (float)renderHeight));
+	m_pResolveShader->setVec2Value("inputTextureSize", glm::vec2((float)textureWidth, (float)textureHeight));
+	m_pResolveShader->setVec2Value("jitter", m_jitter);
+	m_pResolveShader->setMat4Value("currentInverseViewProjection", glm::inverse(m_currentViewProjection));
+	m_pResolveShader->setMat4Value("previousViewProjection", m_previousViewProjection);
+	m_pResolveShader->setFloatValue("historyWeight", HISTORY_WEIGHT);
+	m_pResolveShader->setBoolValue("bHistoryValid", m_bHistoryValid);
+
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	m_bHistoryValid = true;
+
+	// show the resolved image
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_historyFramebuffers[m_currentHistory]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, outputWidth, outputHeight,
+		0, 0, outputWidth, outputHeight,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glUseProgram(sceneProgram);
+	glEnable(GL_DEPTH_TEST);
+}
+
+/***********************************************************
+ *  CreateHistory()
+ ***********************************************************/
+void TemporalUpscaler::CreateHistory(int width, int height)
+{
+	glGenTextures(2, m_historyTextures);
+	glGenFramebuffers(2, m_historyFramebuffers);
+
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_historyTextures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_historyFramebuffers[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_historyTextures[i], 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_historyWidth = width;
+	m_historyHeight = height;
+	m_bHistoryValid = false;
+}
+
+/***********************************************************
+ *  DestroyHistory()
+ ***********************************************************/
+void TemporalUpscaler::DestroyHistory()
+{
+	if (m_historyTextures[0] != 0)
+	{
+		glDeleteFramebuffers(2, m_historyFramebuffers);
+		glDeleteTextures(2, m_historyTextures);
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		m_historyTextures[i] = 0;
+		m_historyFramebuffers[i] = 0;
+	}
+	m_historyWidth = 0;
+	m_historyHeight = 0;
+}
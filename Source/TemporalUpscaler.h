@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// temporalupscaler.h
+// ============
+// reconstruct a full-resolution image from jittered reduced-resolution
+// frames, reprojecting the previous result with per-object motion vectors
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+class TemporalUpscaler
+{
+public:
+	// constructor
+	TemporalUpscaler();
+	// destructor
+	~TemporalUpscaler();
+
+	// advance to the next sub-pixel jitter offset, in render pixels
+	glm::vec2 NextJitter();
+
+	// set the unjittered camera matrices of this frame and the last one
+	void SetCameraMatrices(
+		const glm::mat4& currentViewProjection,
+		const glm::mat4& previousViewProjection);
+
+	// forget the accumulated history, e.g. after a camera cut
+	void ResetHistory();
+
+	// combine this frame with the history into the output resolution and
+	// draw the result into the window framebuffer
+	void Resolve(
+		GLuint colorTexture,
+		GLuint motionTexture,
+		GLuint depthTexture,
+		int renderWidth,
+		int renderHeight,
+		int textureWidth,
+		int textureHeight,
+		int outputWidth,
+		int outputHeight);
+
+private:
+	// shader program for the resolve pass
+	ShaderManager* m_pResolveShader;
+	// empty vertex array for the full-screen triangle
+	GLuint m_vertexArray;
+
+	// ping-pong history images at the output resolution
+	GLuint m_historyTextures[2];
+	GLuint m_historyFramebuffers[2];
+	int m_historyWidth;
+	int m_historyHeight;
+	int m_currentHistory;
+	bool m_bHistoryValid;
+
+	// position in the jitter sequence and the current offset
+	unsigned int m_jitterIndex;
+	glm::vec2 m_jitter;
+
+	// camera matrices for reprojecting the background
+	glm::mat4 m_currentViewProjection;
+	glm::mat4 m_previousViewProjection;
+
+	void CreateHistory(int width, int height);
+	void DestroyHistory();
+};
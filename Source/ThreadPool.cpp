@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ============
+// worker threads for background tasks
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadPool::ThreadPool(int threadCount)
+{
+	m_pendingCount = 0;
+	m_bStopping = false;
+
+	if (threadCount <= 0)
+	{
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_taskReady.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+/***********************************************************
+ *  Submit()
+ ***********************************************************/
+void ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+		m_pendingCount++;
+	}
+	m_taskReady.notify_one();
+}
+
+/***********************************************************
+ *  WaitIdle()
+ ***********************************************************/
+void ThreadPool::WaitIdle()
+{
+	WaitForPendingBelow(1);
+}
+
+/***********************************************************
+ *  WaitForPendingBelow()
+ ***********************************************************/
+void ThreadPool::WaitForPendingBelow(size_t pendingCount)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_taskDone.wait(lock, [this, pendingCount]() { return(m_pendingCount < pendingCount); });
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ ***********************************************************/
+size_t ThreadPool::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_pendingCount);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method runs on each worker thread, taking tasks off
+ *  the queue until the pool is destroyed. Queued tasks are
+ *  still run when the pool is stopping.
+ ***********************************************************/
+void ThreadPool::WorkerLoop()
+{
+	PROFILE_THREAD_NAME("pool worker");
+
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskReady.wait(lock, [this]() { return(m_bStopping || !m_tasks.empty()); });
+			if (m_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		{
+			PROFILE_SCOPE("pool task");
+			task();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pendingCount--;
+		}
+		m_taskDone.notify_all();
+	}
+}
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// a fixed set of worker threads running queued tasks
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// constructor - a thread count of zero uses one thread per
+	// hardware thread, less one for the caller
+	ThreadPool(int threadCount);
+	// destructor - finishes the queued tasks first
+	~ThreadPool();
+
+	// queue a task to run on one of the workers
+	void Submit(std::function<void()> task);
+
+	// wait until every queued task has finished
+	void WaitIdle();
+	// wait until fewer than the given number of tasks are queued or running
+	void WaitForPendingBelow(size_t pendingCount);
+
+	// number of tasks queued or running
+	size_t GetPendingCount();
+	int GetThreadCount() const { return((int)m_threads.size()); }
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	// signalled when a task is queued or the pool is stopping
+	std::condition_variable m_taskReady;
+	// signalled when a task finishes
+	std::condition_variable m_taskDone;
+	// tasks queued or running
+	size_t m_pendingCount;
+	bool m_bStopping;
+
+	void WorkerLoop();
+};
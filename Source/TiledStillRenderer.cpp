@@ -0,0 +1,292 @@
+///////////////////////////////////////////////////////////////////////////////
+// tiledstillrenderer.cpp
+// ============
+// tiled rendering of very large stills
+//
+// NOTE: each tile is drawn with the camera projection narrowed to the tile's
+// part of normalized device space - an off-center sub-frustum for the
+// perspective camera - so the tiles line up exactly. The image is built one
+// band of tiles at a time, top band first, and each finished band is
+// appended to the file straight from the band buffer. The pixels held in
+// memory are that one band - image width by tile size - however tall the
+// image is. On top of it each tile context keeps a tile sized framebuffer,
+// and each worker context its own copy of the shaders and the scene, so
+// memory still grows with the image width and the tile threads.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TiledStillRenderer.h"
+#include "CpuProfiler.h"
+#include "ViewManager.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/***********************************************************
+ *  TiledStillRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TiledStillRenderer::TiledStillRenderer(int tileSize)
+{
+	GLint maxTextureSize = 0;
+	GLint maxRenderbufferSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+
+	m_tileSize = std::max(16, std::min(tileSize, std::min(maxTextureSize, maxRenderbufferSize)));
+	m_pCallerContext = NULL;
+}
+
+/***********************************************************
+ *  ~TiledStillRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TiledStillRenderer::~TiledStillRenderer()
+{
+	DestroyContexts();
+}
+
+/***********************************************************
+ *  UseCurrentContext()
+ ***********************************************************/
+void TiledStillRenderer::UseCurrentContext(ShaderManager* pShaderManager, SceneManager* pSceneManager)
+{
+	TILE_CONTEXT tileContext;
+	tileContext.pHeadlessContext = NULL;
+	tileContext.pShaderManager = pShaderManager;
+	tileContext.pSceneManager = pSceneManager;
+	tileContext.pTarget = new OffscreenTarget();
+	tileContext.pTarget->Resize(m_tileSize, m_tileSize);
+	m_contexts.push_back(tileContext);
+}
+
+/***********************************************************
+ *  CreateWorkerContexts()
+ *
+ *  This method creates headless contexts for worker threads.
+ *  OpenGL objects are not shared between them, so each one
+ *  loads its own shaders and prepares its own scene.
+ ***********************************************************/
+int TiledStillRenderer::CreateWorkerContexts(int workerCount, HeadlessContext* pCallerContext)
+{
+	m_pCallerContext = pCallerContext;
+
+	int created = 0;
+	for (int i = 0; i < workerCount; i++)
+	{
+		HeadlessContext* pHeadlessContext = new HeadlessContext();
+		if (!pHeadlessContext->Create())
+		{
+			delete pHeadlessContext;
+			break;
+		}
+
+		TILE_CONTEXT tileContext;
+		tileContext.pHeadlessContext = pHeadlessContext;
+		tileContext.pShaderManager = new ShaderManager();
+		tileContext.pShaderManager->LoadShaders(
+			"shaders/vertexShader.glsl",
+			"shaders/fragmentShader.glsl");
+		tileContext.pShaderManager->use();
+		tileContext.pSceneManager = new SceneManager(tileContext.pShaderManager);
+		tileContext.pSceneManager->PrepareScene();
+		tileContext.pTarget = new OffscreenTarget();
+		tileContext.pTarget->Resize(m_tileSize, m_tileSize);
+
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		pHeadlessContext->ReleaseCurrent();
+		m_contexts.push_back(tileContext);
+		created++;
+	}
+
+	if (NULL != m_pCallerContext)
+	{
+		m_pCallerContext->MakeCurrent();
+	}
+
+	return(created);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method renders the still band by band. Within a band
+ *  the tiles are shared out between the contexts, each on
+ *  its own thread when there are worker contexts.
+ ***********************************************************/
+bool TiledStillRenderer::Render(
+	const FRAME_STATE& frameState,
+	int width,
+	int height,
+	const std::string& filename)
+{
+	if (m_contexts.empty())
+	{
+		LOG_ERROR("Tiled rendering has no context to render with");
+		return(false);
+	}
+
+	ImageWriter::StreamWriter streamWriter;
+	if (!streamWriter.Begin(filename, width, height))
+	{
+		return(false);
+	}
+
+	auto renderStart = std::chrono::steady_clock::now();
+	bool bWorkers = (NULL != m_contexts[0].pHeadlessContext);
+	std::vector<unsigned char> band((size_t)width * m_tileSize * 3);
+	int tileCount = 0;
+
+	for (int bandTop = height; bandTop > 0; bandTop -= m_tileSize)
+	{
+		int bandBottom = std::max(0, bandTop - m_tileSize);
+
+		std::vector<TILE> tiles;
+		for (int x = 0; x < width; x += m_tileSize)
+		{
+			TILE tile;
+			tile.x = x;
+			tile.y = bandBottom;
+			tile.width = std::min(m_tileSize, width - x);
+			tile.height = bandTop - bandBottom;
+			tiles.push_back(tile);
+		}
+		tileCount += (int)tiles.size();
+
+		if (!bWorkers)
+		{
+			for (const TILE& tile : tiles)
+			{
+				RenderTile(m_contexts[0], frameState, tile, width, height, bandBottom, band.data());
+			}
+		}
+		else
+		{
+			// the workers take the next tile until the band is done
+			std::atomic<size_t> nextTile(0);
+			std::vector<std::thread> threads;
+			for (TILE_CONTEXT& tileContext : m_contexts)
+			{
+				threads.emplace_back([&, pTileContext = &tileContext]()
+					{
+						PROFILE_THREAD_NAME("tile worker");
+						pTileContext->pHeadlessContext->MakeCurrent();
+						size_t index;
+						while ((index = nextTile++) < tiles.size())
+						{
+							PROFILE_SCOPE("tile");
+							RenderTile(*pTileContext, frameState, tiles[index], width, height, bandBottom, band.data());
+						}
+						pTileContext->pHeadlessContext->ReleaseCurrent();
+					});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		if (!streamWriter.WriteRows(band.data(), bandTop - bandBottom))
+		{
+			LOG_ERROR("Failed writing %s", filename.c_str());
+			return(false);
+		}
+	}
+
+	bool bWritten = streamWriter.End();
+
+	double renderSeconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - renderStart).count();
+	LOG_INFO("Rendered %s (%dx%d) as %d tiles of %d on %d context(s) in %.2f s",
+		filename.c_str(), width, height, tileCount, m_tileSize, (int)m_contexts.size(), renderSeconds);
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  RenderTile()
+ *
+ *  This method draws the scene through the part of the
+ *  projection covered by the tile, then reads the tile into
+ *  the band with the band width as the row length.
+ ***********************************************************/
+void TiledStillRenderer::RenderTile(
+	TILE_CONTEXT& tileContext,
+	const FRAME_STATE& frameState,
+	const TILE& tile,
+	int imageWidth,
+	int imageHeight,
+	int bandBottom,
+	unsigned char* pBand)
+{
+	// the tile's corners in normalized device coordinates
+	float left = 2.0f * tile.x / imageWidth - 1.0f;
+	float right = 2.0f * (tile.x + tile.width) / imageWidth - 1.0f;
+	float bottom = 2.0f * tile.y / imageHeight - 1.0f;
+	float top = 2.0f * (tile.y + tile.height) / imageHeight - 1.0f;
+
+	// stretch that region over the whole viewport
+	glm::mat4 tileCrop =
+		glm::scale(glm::vec3(2.0f / (right - left), 2.0f / (top - bottom), 1.0f)) *
+		glm::translate(glm::vec3(-0.5f * (left + right), -0.5f * (bottom + top), 0.0f));
+
+	tileContext.pTarget->Bind();
+	glViewport(0, 0, tile.width, tile.height);
+	glEnable(GL_DEPTH_TEST);
+
+	tileContext.pShaderManager->use();
+	ViewManager::LoadViewIntoShader(
+		tileContext.pShaderManager,
+		frameState.view,
+		tileCrop * frameState.projection,
+		frameState.viewPosition);
+	tileContext.pSceneManager->RenderScene(frameState);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, tileContext.pTarget->GetFramebuffer());
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ROW_LENGTH, imageWidth);
+	glReadPixels(0, 0, tile.width, tile.height, GL_RGB, GL_UNSIGNED_BYTE,
+		pBand + ((size_t)(tile.y - bandBottom) * imageWidth + tile.x) * 3);
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  DestroyContexts()
+ ***********************************************************/
+void TiledStillRenderer::DestroyContexts()
+{
+	for (TILE_CONTEXT& tileContext : m_contexts)
+	{
+		if (NULL != tileContext.pHeadlessContext)
+		{
+			// the worker's objects belong to its own context
+			tileContext.pHeadlessContext->MakeCurrent();
+			delete tileContext.pTarget;
+			delete tileContext.pSceneManager;
+			delete tileContext.pShaderManager;
+			tileContext.pHeadlessContext->ReleaseCurrent();
+			delete tileContext.pHeadlessContext;
+		}
+		else
+		{
+			delete tileContext.pTarget;
+		}
+	}
+	m_contexts.clear();
+
+	if (NULL != m_pCallerContext)
+	{
+		m_pCallerContext->MakeCurrent();
+	}
+}
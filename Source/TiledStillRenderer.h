@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// tiledstillrenderer.h
+// ============
+// render stills far larger than any framebuffer the driver allows, one tile
+// at a time, streaming the finished rows to disk
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "SceneManager.h"
+#include "HeadlessContext.h"
+#include "OffscreenTarget.h"
+#include "FrameState.h"
+
+#include <string>
+#include <vector>
+
+class TiledStillRenderer
+{
+public:
+	// constructor - the tile size is clamped to what the driver supports
+	TiledStillRenderer(int tileSize);
+	// destructor
+	~TiledStillRenderer();
+
+	// render tiles with the scene objects of the calling thread's context
+	void UseCurrentContext(ShaderManager* pShaderManager, SceneManager* pSceneManager);
+
+	// render tiles in parallel on extra headless contexts, each with its
+	// own copy of the scene - the calling thread's context is made
+	// current again afterwards. Returns the number created.
+	int CreateWorkerContexts(int workerCount, HeadlessContext* pCallerContext);
+
+	// render the still from the camera of the frame snapshot and write
+	// it as a streamed PNG or PPM
+	bool Render(
+		const FRAME_STATE& frameState,
+		int width,
+		int height,
+		const std::string& filename);
+
+private:
+	// a context that tiles are rendered on
+	struct TILE_CONTEXT
+	{
+		// NULL for the calling thread's own context
+		HeadlessContext* pHeadlessContext;
+		ShaderManager* pShaderManager;
+		SceneManager* pSceneManager;
+		OffscreenTarget* pTarget;
+	};
+
+	// one tile of a band, in image pixels from the bottom left
+	struct TILE
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	int m_tileSize;
+	std::vector<TILE_CONTEXT> m_contexts;
+	HeadlessContext* m_pCallerContext;
+
+	// draw one tile and read it back into its place in the band
+	void RenderTile(
+		TILE_CONTEXT& tileContext,
+		const FRAME_STATE& frameState,
+		const TILE& tile,
+		int imageWidth,
+		int imageHeight,
+		int bandBottom,
+		unsigned char* pBand);
+
+	void DestroyContexts();
+};
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// lock-free single producer / single consumer triple buffer
+//
+//  The producer always owns one slot to write into, the consumer always owns
+//  one slot to read from, and the third slot is exchanged between them with
+//  a single atomic operation. Neither side ever waits on the other - the
+//  producer simply overwrites a snapshot the consumer never picked up, and
+//  the consumer keeps re-reading its slot until a newer one is published.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+	{
+		m_writeIndex = 0;
+		m_middleIndex.store(1);
+		m_readIndex = 2;
+	}
+
+	// slot owned by the producer - fill it in, then call Publish()
+	T& GetWriteBuffer()
+	{
+		return(m_buffers[m_writeIndex]);
+	}
+
+	// hand the write slot over to the consumer and take back the spare slot
+	void Publish()
+	{
+		m_writeIndex = m_middleIndex.exchange(
+			(uint8_t)(m_writeIndex | DIRTY_BIT),
+			std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// pick up the most recently published slot, if there is a new one;
+	// returns false when the read slot is already the latest
+	bool Consume()
+	{
+		if ((m_middleIndex.load(std::memory_order_relaxed) & DIRTY_BIT) == 0)
+		{
+			return(false);
+		}
+		m_readIndex = m_middleIndex.exchange(
+			(uint8_t)m_readIndex,
+			std::memory_order_acq_rel) & INDEX_MASK;
+		return(true);
+	}
+
+	// slot owned by the consumer - valid until the next Consume()
+	const T& GetReadBuffer() const
+	{
+		return(m_buffers[m_readIndex]);
+	}
+
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t DIRTY_BIT = 0x4;
+
+	T m_buffers[3];
+	// only touched by the producer
+	uint8_t m_writeIndex;
+	// only touched by the consumer
+	uint8_t m_readIndex;
+	// the exchanged slot, with a flag set when it holds unread data
+	std::atomic<uint8_t> m_middleIndex;
+};
@@ -18,12 +18,19 @@
 // - Set up the main display window using GLFW.
 // - Configure projection settings for both perspective and orthographic views.
 // - Update the view and projection matrices for rendering.
+// - Record the camera into frame snapshots on the simulation thread and
+//   load published snapshots into the shader on the render thread.
 //
 // NOTE: This implementation uses GLFW for window management and input, and 
 // GLM for mathematical operations like matrix transformations.
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "CpuProfiler.h"
+#include "InputRecording.h"
+#include "Logger.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
 
 // GLM Math Header inclusions
 #define GLM_ENABLE_EXPERIMENTAL
@@ -31,12 +38,22 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <atomic>
+#include <deque>
+
 // declarations for global variables and defines
 namespace
 {
-	// Variables for window width and height
+	// Variables for the initial window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
+
+	// current size of the window framebuffer, updated by the input
+	// thread whenever the window is resized
+	std::atomic<int> gFramebufferWidth(WINDOW_WIDTH);
+	std::atomic<int> gFramebufferHeight(WINDOW_HEIGHT);
+	// aspect ratio of the last non-empty framebuffer
+	float gAspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
 
@@ -56,6 +73,143 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// true when the frame is upscaled temporally, toggled with T
+	bool gbTemporalUpscaling = true;
+	// true when the review views are shown side by side, toggled with M
+	bool gbMultiView = false;
+	// true when the scene is drawn for a stereo display, toggled with V
+	bool gbStereo = false;
+	// counts the panorama captures requested with C
+	uint32_t gPanoramaRequest = 0;
+	// counts the GPU profile dumps requested with G
+	uint32_t gGpuProfileRequest = 0;
+	// true while recording, toggled with R
+	bool gbRecording = false;
+	// true when the render statistics are drawn over the frame, toggled
+	// with I
+	bool gbStatsOverlay = false;
+
+	// distance between the eyes and to the plane that appears at screen
+	// depth, in scene units
+	const float STEREO_EYE_SEPARATION = 0.35f;
+	const float STEREO_CONVERGENCE_DISTANCE = 18.0f;
+
+	// running total of mouse motion, published for late latching
+	struct MOUSE_TOTALS
+	{
+		double totalX = 0.0;
+		double totalY = 0.0;
+		uint64_t mouseSequence = 0;
+		uint64_t inputSequence = 0;
+		double timestamp = 0.0;
+	};
+
+	// events from the input thread to the simulation thread
+	SpscQueue<INPUT_EVENT, 4096> g_InputQueue;
+	// latest mouse totals from the input thread to the render thread
+	TripleBuffer<MOUSE_TOTALS> g_MouseTotals;
+
+	// mouse totals of the motion queued by the input thread
+	MOUSE_TOTALS gInputMouseTotals;
+	// events the queue had no room for, oldest first - kept on the
+	// input thread and sent ahead of any newer event (input thread)
+	std::deque<INPUT_EVENT> gPendingInputEvents;
+	// mouse totals already applied to the camera by the simulation thread
+	MOUSE_TOTALS gAppliedMouseTotals;
+	// sequence number of the last event queued (input thread)
+	uint64_t gInputSequence = 0;
+	// sequence number and time of the newest input applied by the
+	// simulation thread
+	uint64_t gLastInputSequence = 0;
+	double gLastInputTimestamp = 0.0;
+
+	// key up/down state, rebuilt from key events on the simulation thread
+	bool gKeyDown[GLFW_KEY_LAST + 1] = { false };
+
+	/***********************************************************
+	 *  FlushInputEvents()
+	 *
+	 *  Send the pending events to the simulation thread in
+	 *  order, stopping at the first one the queue has no room
+	 *  for. The mouse totals only advance, and are only
+	 *  published for late latching, with motion that was
+	 *  queued, so they always match what the simulation will
+	 *  apply. Returns true when events are still pending.
+	 ***********************************************************/
+	bool FlushInputEvents()
+	{
+		while (!gPendingInputEvents.empty())
+		{
+			INPUT_EVENT& inputEvent = gPendingInputEvents.front();
+			bool bMouseMove = (inputEvent.type == INPUT_MOUSE_MOVE);
+			inputEvent.mouseSequence = gInputMouseTotals.mouseSequence + (bMouseMove ? 1 : 0);
+			inputEvent.inputSequence = gInputSequence + 1;
+			if (!g_InputQueue.Push(inputEvent))
+			{
+				return(true);
+			}
+			gInputSequence = inputEvent.inputSequence;
+
+			if (bMouseMove)
+			{
+				gInputMouseTotals.totalX += inputEvent.xOffset;
+				gInputMouseTotals.totalY += inputEvent.yOffset;
+				gInputMouseTotals.mouseSequence = inputEvent.mouseSequence;
+				gInputMouseTotals.inputSequence = inputEvent.inputSequence;
+				gInputMouseTotals.timestamp = inputEvent.timestamp;
+				g_MouseTotals.GetWriteBuffer() = gInputMouseTotals;
+				g_MouseTotals.Publish();
+			}
+			gPendingInputEvents.pop_front();
+		}
+		return(false);
+	}
+
+	/***********************************************************
+	 *  PushInputEvent()
+	 *
+	 *  Forward an input event to the simulation thread without
+	 *  ever blocking the input thread. While the simulation is
+	 *  too far behind for the queue to take it, the event waits
+	 *  with the others that did not fit - consecutive mouse
+	 *  motion is folded into one event, and key changes are all
+	 *  kept, so no motion or key release is ever lost.
+	 ***********************************************************/
+	void PushInputEvent(INPUT_EVENT_TYPE type, int key, int action, float xOffset, float yOffset)
+	{
+		double timestamp = glfwGetTime();
+		if ((type == INPUT_MOUSE_MOVE) && !gPendingInputEvents.empty() &&
+			(gPendingInputEvents.back().type == INPUT_MOUSE_MOVE))
+		{
+			INPUT_EVENT& pendingEvent = gPendingInputEvents.back();
+			pendingEvent.xOffset += xOffset;
+			pendingEvent.yOffset += yOffset;
+			pendingEvent.timestamp = timestamp;
+		}
+		else
+		{
+			INPUT_EVENT inputEvent = INPUT_EVENT();
+			inputEvent.type = type;
+			inputEvent.key = key;
+			inputEvent.action = action;
+			inputEvent.xOffset = xOffset;
+			inputEvent.yOffset = yOffset;
+			inputEvent.timestamp = timestamp;
+			gPendingInputEvents.push_back(inputEvent);
+		}
+		FlushInputEvents();
+	}
+
+	/***********************************************************
+	 *  IsKeyDown()
+	 *
+	 *  Check the key state tracked from the key events.
+	 ***********************************************************/
+	bool IsKeyDown(int key)
+	{
+		return((key >= 0) && (key <= GLFW_KEY_LAST) && gKeyDown[key]);
+	}
 }
 
 /***********************************************************
@@ -77,6 +231,17 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+
+	m_bLateLatching = true;
+	m_latchedInputSequence = 0;
+	m_latchedInputTimestamp = 0.0;
+	m_projectionJitter = glm::vec2(0.0f);
+	m_currentViewProjection = glm::mat4(1.0f);
+	m_previousViewProjection = glm::mat4(1.0f);
+	m_bViewProjectionValid = false;
+	m_latchedView = glm::mat4(1.0f);
+	m_latchedProjection = glm::mat4(1.0f);
+	m_latchedViewPosition = glm::vec3(0.0f);
 }
 
 /***********************************************************
@@ -113,34 +278,51 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 		NULL, NULL);
 	if (window == NULL)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
+		LOG_ERROR("Failed to create GLFW window");
 		glfwTerminate();
 		return NULL;
 	}
 	glfwMakeContextCurrent(window);
 
+	// track the real framebuffer size, which differs from the window
+	// size on high-DPI displays and changes when the window is resized
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	gFramebufferWidth = framebufferWidth;
+	gFramebufferHeight = framebufferHeight;
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int width, int height)
+		{
+			gFramebufferWidth = width;
+			gFramebufferHeight = height;
+		});
+
 	// tell GLFW to capture all mouse events
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+	// use unaccelerated mouse motion when the platform provides it
+	if (glfwRawMouseMotionSupported())
+	{
+		glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+	}
+
 	// Connect my mouse callback
 	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
 
+	// the input thread only records scrolling and key changes, the
+	// simulation thread applies them
 	glfwSetScrollCallback(window, [](GLFWwindow*, double xoffset, double yoffset)
 		{
-			std::cout << "Scroll detected! yoffset = " << yoffset << "\n";
-			if (g_pCamera)
+			PushInputEvent(INPUT_SCROLL, 0, 0, (float)xoffset, (float)yoffset);
+		});
+	glfwSetKeyCallback(window, [](GLFWwindow*, int key, int, int action, int)
+		{
+			if (action != GLFW_REPEAT)
 			{
-				// Adjust movement speed with mouse scroll
-				g_pCamera->MovementSpeed += (float)yoffset;
-				if (g_pCamera->MovementSpeed < 1.0f) g_pCamera->MovementSpeed = 1.0f;
-				if (g_pCamera->MovementSpeed > 100.0f) g_pCamera->MovementSpeed = 100.0f;
-
-				std::cout << "MovementSpeed = " << g_pCamera->MovementSpeed << "\n";
+				PushInputEvent(INPUT_KEY, key, action, 0.0f, 0.0f);
 			}
 		});
 
-
-
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -150,6 +332,35 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	return(window);
 }
 
+/***********************************************************
+ *  LoadViewIntoShader()
+ ***********************************************************/
+void ViewManager::LoadViewIntoShader(
+	ShaderManager* pShaderManager,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	// set the view matrix into the shader for proper rendering
+	pShaderManager->setMat4Value(g_ViewName, view);
+	// set the projection matrix into the shader for proper rendering
+	pShaderManager->setMat4Value(g_ProjectionName, projection);
+	// set the view position of the camera into the shader for proper rendering
+	pShaderManager->setVec3Value("viewPosition", viewPosition);
+}
+
+/***********************************************************
+ *  SetFramebufferSize()
+ *
+ *  This method sets the render size when there is no display
+ *  window to report it.
+ ***********************************************************/
+void ViewManager::SetFramebufferSize(int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -176,40 +387,169 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// queue the offsets for the simulation thread to move the camera -
+	// the running totals for late latching on the render thread are
+	// published as the motion is queued
+	PushInputEvent(INPUT_MOUSE_MOVE, 0, 0, xOffset, yOffset);
+}
+
+/***********************************************************
+ *  FlushPendingInput()
+ ***********************************************************/
+bool ViewManager::FlushPendingInput()
+{
+	return(FlushInputEvents());
+}
+
+/***********************************************************
+ *  CaptureInputStep()
+ *
+ *  This method is called on the simulation thread to read
+ *  the clock and framebuffer size, and take all input events
+ *  forwarded by the input thread since the last simulation
+ *  step.
+ ***********************************************************/
+void ViewManager::CaptureInputStep(INPUT_STEP& inputStep)
+{
+	inputStep.time = glfwGetTime();
+	inputStep.framebufferWidth = gFramebufferWidth;
+	inputStep.framebufferHeight = gFramebufferHeight;
+
+	inputStep.events.clear();
+	INPUT_EVENT inputEvent;
+	while (g_InputQueue.Pop(inputEvent))
+	{
+		inputStep.events.push_back(inputEvent);
+	}
+}
+
+/***********************************************************
+ *  DiscardLiveInput()
+ ***********************************************************/
+void ViewManager::DiscardLiveInput()
+{
+	INPUT_EVENT inputEvent;
+	while (g_InputQueue.Pop(inputEvent))
+	{
+		if ((inputEvent.type == INPUT_KEY) && (inputEvent.key == GLFW_KEY_ESCAPE) &&
+			(inputEvent.action == GLFW_PRESS) && (NULL != m_pWindow))
+		{
+			glfwSetWindowShouldClose(m_pWindow, true);
+			glfwPostEmptyEvent();
+		}
+	}
+}
+
+/***********************************************************
+ *  ProcessInputEvents()
+ *
+ *  This method is called on the simulation thread to apply
+ *  the input events of a step, whether they were captured
+ *  live or read from a recording.
+ ***********************************************************/
+void ViewManager::ProcessInputEvents(const INPUT_STEP& inputStep)
+{
+	for (const INPUT_EVENT& inputEvent : inputStep.events)
+	{
+		switch (inputEvent.type)
+		{
+		case INPUT_MOUSE_MOVE:
+			// move the 3D camera according to the calculated offsets
+			g_pCamera->ProcessMouseMovement(inputEvent.xOffset, inputEvent.yOffset);
+			gAppliedMouseTotals.totalX += inputEvent.xOffset;
+			gAppliedMouseTotals.totalY += inputEvent.yOffset;
+			gAppliedMouseTotals.mouseSequence = inputEvent.mouseSequence;
+			break;
+
+		case INPUT_SCROLL:
+			// Adjust movement speed with mouse scroll
+			g_pCamera->MovementSpeed += inputEvent.yOffset;
+			if (g_pCamera->MovementSpeed < 1.0f) g_pCamera->MovementSpeed = 1.0f;
+			if (g_pCamera->MovementSpeed > 100.0f) g_pCamera->MovementSpeed = 100.0f;
+
+			LOG_INFO_THROTTLED(0.25, "Scroll detected, MovementSpeed = %.1f", g_pCamera->MovementSpeed);
+			break;
+
+		case INPUT_KEY:
+			if ((inputEvent.key >= 0) && (inputEvent.key <= GLFW_KEY_LAST))
+			{
+				gKeyDown[inputEvent.key] = (inputEvent.action == GLFW_PRESS);
+			}
+
+			// toggles act on the press rather than while the key is held
+			if ((inputEvent.key == GLFW_KEY_T) && (inputEvent.action == GLFW_PRESS))
+			{
+				gbTemporalUpscaling = !gbTemporalUpscaling;
+				LOG_INFO("Temporal upscaling %s", gbTemporalUpscaling ? "ON" : "OFF");
+			}
+			if ((inputEvent.key == GLFW_KEY_M) && (inputEvent.action == GLFW_PRESS))
+			{
+				gbMultiView = !gbMultiView;
+				gbStereo = false;
+				LOG_INFO("Multi-view %s", gbMultiView ? "ON" : "OFF");
+			}
+			if ((inputEvent.key == GLFW_KEY_V) && (inputEvent.action == GLFW_PRESS))
+			{
+				gbStereo = !gbStereo;
+				gbMultiView = false;
+				LOG_INFO("Stereo %s", gbStereo ? "ON" : "OFF");
+			}
+			if ((inputEvent.key == GLFW_KEY_C) && (inputEvent.action == GLFW_PRESS))
+			{
+				gPanoramaRequest++;
+			}
+			if ((inputEvent.key == GLFW_KEY_R) && (inputEvent.action == GLFW_PRESS))
+			{
+				gbRecording = !gbRecording;
+			}
+			if ((inputEvent.key == GLFW_KEY_G) && (inputEvent.action == GLFW_PRESS))
+			{
+				gGpuProfileRequest++;
+			}
+			if ((inputEvent.key == GLFW_KEY_I) && (inputEvent.action == GLFW_PRESS))
+			{
+				gbStatsOverlay = !gbStatsOverlay;
+			}
+			break;
+		}
+
+		gLastInputSequence = inputEvent.inputSequence;
+		gLastInputTimestamp = inputEvent.timestamp;
+	}
 }
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is called to process the keys that are
+ *  currently held down.
  ***********************************************************/
 void ViewManager::ProcessKeyboardEvents()
 {
 	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_ESCAPE))
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
+		// wake the input thread so it notices the close request
+		glfwPostEmptyEvent();
 	}
 
 	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_W))
 	{
 		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_S))
 	{
 		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
 	}
 
 	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_A))
 	{
 		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_D))
 	{
 		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
 	}
@@ -218,19 +558,23 @@ void ViewManager::ProcessKeyboardEvents()
 	// This makes it easier to view the objects from higher or lower angles.
 
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_Q))
 	{
 		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_E))
 	{
 		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
 	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_P))
 	{
+		// only report the switch once, not for every step the key is held
+		if (bOrthographicProjection)
+		{
+			LOG_INFO("Switched to PERSPECTIVE projection");
+		}
 		bOrthographicProjection = false;
-		std::cout << "Switched to PERSPECTIVE projection\n";
 
 		// Reset camera back to the normal perspective view
 		// so that it looks like the default scene angle again
@@ -239,10 +583,13 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	if (IsKeyDown(GLFW_KEY_O))
 	{
+		if (!bOrthographicProjection)
+		{
+			LOG_INFO("Switched to ORTHOGRAPHIC projection");
+		}
 		bOrthographicProjection = true;
-		std::cout << "Switched to ORTHOGRAPHIC projection\n";
 
 		// moving the camera closer and slightly above the scene for a flat view
 		g_pCamera->Position = glm::vec3(0.0f, 5.0f, 10.0f);
@@ -257,33 +604,43 @@ void ViewManager::ProcessKeyboardEvents()
 }
 
 /***********************************************************
- *  PrepareSceneView()
+ *  UpdateSceneView()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is called from the simulation thread to
+ *  process input, move the camera, and record the resulting
+ *  view and projection into the frame snapshot
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::UpdateSceneView(FRAME_STATE& frameState, const INPUT_STEP& inputStep)
 {
 	glm::mat4 view;
 	glm::mat4 projection;
 
 	// per-frame timing
-	float currentFrame = glfwGetTime();
+	float currentFrame = (float)inputStep.time;
 	gDeltaTime = currentFrame - gLastFrame;
 	gLastFrame = currentFrame;
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
+	// apply the step's input events, then process the keys that are
+	// held down
+	ProcessInputEvents(inputStep);
 	ProcessKeyboardEvents();
 
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix();
 
+	// the aspect ratio follows the window as it is resized - a
+	// minimized window reports a zero size and keeps the last one
+	int framebufferWidth = inputStep.framebufferWidth;
+	int framebufferHeight = inputStep.framebufferHeight;
+	if ((framebufferWidth > 0) && (framebufferHeight > 0))
+	{
+		gAspectRatio = (float)framebufferWidth / (float)framebufferHeight;
+	}
+	float aspect = gAspectRatio;
+
 	if (bOrthographicProjection)
 	{
 		float orthoSize = 5.0f; // smaller number zooms in more
-		float aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
 
 		// I switch to orthographic here so there's no perspective distortion.
 		// This gives me a nice flat view to see the table and candle straight on.
@@ -298,19 +655,228 @@ void ViewManager::PrepareSceneView()
 		// Otherwise I stay in perspective mode so everything looks 3D.
 		projection = glm::perspective(
 			glm::radians(g_pCamera->Zoom),
-			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
+			aspect,
 			0.1f, 100.0f);
 	}
 
+	frameState.deltaTime = gDeltaTime;
+	frameState.framebufferWidth = framebufferWidth;
+	frameState.framebufferHeight = framebufferHeight;
+	frameState.view = view;
+	frameState.projection = projection;
+	frameState.viewPosition = g_pCamera->Position;
+	frameState.bOrthographicProjection = bOrthographicProjection;
+	frameState.bTemporalUpscaling = gbTemporalUpscaling;
+	frameState.bMultiView = gbMultiView;
+	frameState.bStereo = gbStereo;
+	frameState.panoramaRequest = gPanoramaRequest;
+	frameState.gpuProfileRequest = gGpuProfileRequest;
+	frameState.bRecording = gbRecording;
+	frameState.bStatsOverlay = gbStatsOverlay;
+	frameState.fieldOfView = g_pCamera->Zoom;
+	frameState.cameraYaw = g_pCamera->Yaw;
+	frameState.cameraPitch = g_pCamera->Pitch;
+	frameState.mouseSensitivity = g_pCamera->MouseSensitivity;
+	frameState.cameraWorldUp = g_pCamera->WorldUp;
+	frameState.mouseTotalX = gAppliedMouseTotals.totalX;
+	frameState.mouseTotalY = gAppliedMouseTotals.totalY;
+	frameState.mouseSequence = gAppliedMouseTotals.mouseSequence;
+	frameState.inputSequence = gLastInputSequence;
+	frameState.inputTimestamp = gLastInputTimestamp;
+}
+
+/***********************************************************
+ *  PrepareSceneView()
+ *
+ *  This method is called from the render thread to load the
+ *  view and projection recorded in the frame snapshot into
+ *  the shader for rendering
+ ***********************************************************/
+void ViewManager::PrepareSceneView(const FRAME_STATE& frameState)
+{
+	PROFILE_SCOPE("PrepareSceneView");
+
+	glm::mat4 view = frameState.view;
+	m_latchedInputSequence = frameState.inputSequence;
+	m_latchedInputTimestamp = frameState.inputTimestamp;
+
+	// apply any mouse motion that arrived after the simulation built
+	// this snapshot, the same way the camera would have applied it
+	if (m_bLateLatching)
+	{
+		g_MouseTotals.Consume();
+		const MOUSE_TOTALS& mouseTotals = g_MouseTotals.GetReadBuffer();
+
+		if (mouseTotals.mouseSequence > frameState.mouseSequence)
+		{
+			float yaw = frameState.cameraYaw + frameState.mouseSensitivity *
+				(float)(mouseTotals.totalX - frameState.mouseTotalX);
+			float pitch = frameState.cameraPitch + frameState.mouseSensitivity *
+				(float)(mouseTotals.totalY - frameState.mouseTotalY);
+			pitch = glm::clamp(pitch, -89.0f, 89.0f);
+
+			glm::vec3 front = glm::normalize(glm::vec3(
+				cos(glm::radians(yaw)) * cos(glm::radians(pitch)),
+				sin(glm::radians(pitch)),
+				sin(glm::radians(yaw)) * cos(glm::radians(pitch))));
+			glm::vec3 right = glm::normalize(glm::cross(front, frameState.cameraWorldUp));
+			glm::vec3 up = glm::normalize(glm::cross(right, front));
+
+			view = glm::lookAt(frameState.viewPosition, frameState.viewPosition + front, up);
+			m_latchedInputSequence = mouseTotals.inputSequence;
+			m_latchedInputTimestamp = mouseTotals.timestamp;
+		}
+	}
+
+	m_latchedView = view;
+
+	// keep the unjittered view-projection of this frame and the last
+	// one for the motion vectors - the first frame has no motion
+	m_previousViewProjection = m_currentViewProjection;
+	m_currentViewProjection = frameState.projection * view;
+	if (!m_bViewProjectionValid)
+	{
+		m_previousViewProjection = m_currentViewProjection;
+		m_bViewProjectionValid = true;
+	}
+
+	// the jitter shifts the whole image in NDC after projection
+	m_latchedProjection = glm::translate(
+		glm::mat4(1.0f),
+		glm::vec3(m_projectionJitter.x, m_projectionJitter.y, 0.0f)) * frameState.projection;
+	m_latchedViewPosition = frameState.viewPosition;
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		LoadPreparedView(m_pShaderManager);
+	}
+}
+
+/***********************************************************
+ *  LoadPreparedView()
+ ***********************************************************/
+void ViewManager::LoadPreparedView(ShaderManager* pShaderManager) const
+{
+	LoadViewIntoShader(pShaderManager, m_latchedView, m_latchedProjection, m_latchedViewPosition);
+
+	// set the view-projections used for the motion vectors
+	pShaderManager->setMat4Value("currentViewProjection", m_currentViewProjection);
+	pShaderManager->setMat4Value("previousViewProjection", m_previousViewProjection);
+}
+
+/***********************************************************
+ *  GetMultiViews()
+ *
+ *  This method builds the views for the multi-view mode,
+ *  laid out in three columns across the render target. The
+ *  first follows the camera, with the latest mouse motion
+ *  latched in by PrepareSceneView().
+ ***********************************************************/
+int ViewManager::GetMultiViews(const FRAME_STATE& frameState, MultiViewRenderer::VIEW* pViews) const
+{
+	if (frameState.bStereo)
+	{
+		return(GetStereoViews(frameState, pViews));
+	}
+
+	const int viewCount = 3;
+	const float columnWidth = 1.0f / (float)viewCount;
+
+	// each view only gets a column of the window
+	float aspect = 1.0f;
+	if (frameState.framebufferHeight > 0)
+	{
+		aspect = columnWidth * (float)frameState.framebufferWidth / (float)frameState.framebufferHeight;
 	}
-}
\ No newline at end of file
+
+	// live perspective camera
+	glm::mat4 perspective = glm::perspective(
+		glm::radians(frameState.fieldOfView),
+		aspect,
+		0.1f, 100.0f);
+	pViews[0].viewProjection = perspective * m_latchedView;
+
+	// the flat front view the O key switches to
+	float orthoSize = 5.0f;
+	glm::mat4 frontView = glm::lookAt(
+		glm::vec3(0.0f, 5.0f, 10.0f),
+		glm::vec3(0.0f, 5.0f, 10.0f) + glm::normalize(glm::vec3(0.0f, -0.3f, -1.0f)),
+		glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 frontProjection = glm::ortho(
+		-orthoSize * aspect, orthoSize * aspect,
+		-orthoSize, orthoSize,
+		0.1f, 500.0f);
+	pViews[1].viewProjection = frontProjection * frontView;
+
+	// straight down onto the table, far side at the top
+	float topSize = 8.0f;
+	glm::mat4 topView = glm::lookAt(
+		glm::vec3(0.0f, 30.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f));
+	glm::mat4 topProjection = glm::ortho(
+		-topSize * aspect, topSize * aspect,
+		-topSize, topSize,
+		0.1f, 100.0f);
+	pViews[2].viewProjection = topProjection * topView;
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		pViews[i].x = i * columnWidth;
+		pViews[i].y = 0.0f;
+		pViews[i].width = columnWidth;
+		pViews[i].height = 1.0f;
+	}
+
+	return(viewCount);
+}
+
+/***********************************************************
+ *  GetStereoViews()
+ *
+ *  This method builds the left and right eye views of the
+ *  live camera, side by side. Each eye is offset along the
+ *  camera right axis and uses an asymmetric frustum, so that
+ *  both frusta meet at the convergence distance and objects
+ *  there show no parallax.
+ ***********************************************************/
+int ViewManager::GetStereoViews(const FRAME_STATE& frameState, MultiViewRenderer::VIEW* pViews) const
+{
+	const int viewCount = 2;
+	const float nearPlane = 0.1f;
+	const float farPlane = 100.0f;
+
+	float aspect = 1.0f;
+	if (frameState.framebufferHeight > 0)
+	{
+		aspect = 0.5f * (float)frameState.framebufferWidth / (float)frameState.framebufferHeight;
+	}
+
+	float top = nearPlane * tan(glm::radians(frameState.fieldOfView) * 0.5f);
+	float right = top * aspect;
+	float frustumShift = 0.5f * STEREO_EYE_SEPARATION * nearPlane / STEREO_CONVERGENCE_DISTANCE;
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		// -1 for the left eye, +1 for the right eye
+		float eye = (i == 0) ? -1.0f : 1.0f;
+
+		glm::mat4 eyeView = glm::translate(
+			glm::mat4(1.0f),
+			glm::vec3(-eye * 0.5f * STEREO_EYE_SEPARATION, 0.0f, 0.0f)) * m_latchedView;
+		glm::mat4 eyeProjection = glm::frustum(
+			-right - eye * frustumShift,
+			right - eye * frustumShift,
+			-top, top,
+			nearPlane, farPlane);
+
+		pViews[i].viewProjection = eyeProjection * eyeView;
+		pViews[i].x = 0.5f * i;
+		pViews[i].y = 0.0f;
+		pViews[i].width = 0.5f;
+		pViews[i].height = 1.0f;
+	}
+
+	return(viewCount);
+}
@@ -10,6 +10,9 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "FrameState.h"
+#include "InputRecording.h"
+#include "MultiViewRenderer.h"
 #include "camera.h"
 
 // GLFW library
@@ -26,20 +29,98 @@ public:
 
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
+	// retry sending the input events the simulation had no room for -
+	// returns true while some are still waiting (input thread)
+	static bool FlushPendingInput();
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// true when newer mouse motion is latched into the view at render time
+	bool m_bLateLatching;
+	// sequence number and time of the newest input latched into the
+	// last prepared view
+	uint64_t m_latchedInputSequence;
+	double m_latchedInputTimestamp;
+	// sub-pixel offset added to the projection, in NDC units
+	glm::vec2 m_projectionJitter;
+	// unjittered view-projection of this frame and the one before it
+	glm::mat4 m_currentViewProjection;
+	glm::mat4 m_previousViewProjection;
+	// false until the first view has been prepared
+	bool m_bViewProjectionValid;
+	// camera view matrix used by the last prepared view, after late
+	// latching, with the jittered projection and camera position
+	glm::mat4 m_latchedView;
+	glm::mat4 m_latchedProjection;
+	glm::vec3 m_latchedViewPosition;
 
+	// apply the input events of a simulation step
+	void ProcessInputEvents(const INPUT_STEP& inputStep);
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+
+	// set the size of the framebuffer the views are rendered into, for
+	// rendering without a display window
+	void SetFramebufferSize(int width, int height);
+
+	// load a view and projection into the given scene shader, for
+	// renderers that draw with their own shader and scene objects
+	static void LoadViewIntoShader(
+		ShaderManager* pShaderManager,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
 	
+	// collect what the next simulation step reads from the window - the
+	// clock, the framebuffer size and the input events forwarded since
+	// the last step (simulation thread)
+	void CaptureInputStep(INPUT_STEP& inputStep);
+	// drop the forwarded input while a recording is replayed in its
+	// place - Escape still closes the window (simulation thread)
+	void DiscardLiveInput();
+
+	// advance the camera with a step's input and record the resulting
+	// view into the frame snapshot (simulation thread)
+	void UpdateSceneView(FRAME_STATE& frameState, const INPUT_STEP& inputStep);
+
 	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+	// using a published frame snapshot (render thread)
+	void PrepareSceneView(const FRAME_STATE& frameState);
+	// load the last prepared view into another shader program built
+	// from the scene shaders
+	void LoadPreparedView(ShaderManager* pShaderManager) const;
+
+	// apply mouse motion that arrives after a snapshot was built when
+	// preparing its view - on by default, off for scripted cameras
+	void SetLateLatching(bool bEnabled) { m_bLateLatching = bEnabled; }
+
+	// sequence number and time (glfwGetTime) of the newest input shown
+	// by the last prepared view
+	uint64_t GetLatchedInputSequence() const { return(m_latchedInputSequence); }
+	double GetLatchedInputTimestamp() const { return(m_latchedInputTimestamp); }
+
+	// offset the projection of the following prepared views by a
+	// sub-pixel amount, given in NDC units
+	void SetProjectionJitter(glm::vec2 ndcOffset) { m_projectionJitter = ndcOffset; }
+
+	// unjittered view-projection of the last prepared view and the one before it
+	const glm::mat4& GetCurrentViewProjection() const { return(m_currentViewProjection); }
+	const glm::mat4& GetPreviousViewProjection() const { return(m_previousViewProjection); }
+
+	// fill in the views shown side by side in multi-view mode - the live
+	// perspective camera, a fixed orthographic front view and a top-down
+	// view - or the two eyes in stereo mode, and return how many there
+	// are (render thread)
+	int GetMultiViews(const FRAME_STATE& frameState, MultiViewRenderer::VIEW* pViews) const;
+
+private:
+	// fill in the left and right eye views of the live camera
+	int GetStereoViews(const FRAME_STATE& frameState, MultiViewRenderer::VIEW* pViews) const;
 };
\ No newline at end of file
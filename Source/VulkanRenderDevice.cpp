@@ -0,0 +1,2015 @@
+///////////////////////////////////////////////////////////////////////////////
+// vulkanrenderdevice.cpp
+// ============
+// Vulkan implementation of the render device
+//
+// NOTE: the loader is opened at run time (libvulkan.so.1 or vulkan-1.dll)
+// and every entry point is fetched through vkGetInstanceProcAddr, so the
+// program starts and falls back cleanly on machines without Vulkan, and
+// only the Vulkan headers are needed to build. Without them, Create()
+// reports the backend as unavailable.
+//
+// Frames are drawn into an RGBA8 color image and a depth image, copied into
+// a host visible buffer and waited on, so ReadPixels() is a plain copy.
+// The scene shaders are the SPIR-V files compiled from
+// shaders/vulkanSceneVertexShader.glsl and vulkanSceneFragmentShader.glsl
+// (glslangValidator -V), and compiled pipelines are kept in a pipeline
+// cache file between runs.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VulkanRenderDevice.h"
+#include "CpuMeshes.h"
+#include "Logger.h"
+
+#if defined(__has_include)
+#if __has_include(<vulkan/vulkan.h>)
+#define VULKAN_HEADERS_AVAILABLE
+#endif
+#endif
+
+#ifdef VULKAN_HEADERS_AVAILABLE
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// entry points fetched from the instance
+#define VULKAN_INSTANCE_FUNCTIONS(FUNCTION) \
+	FUNCTION(vkDestroyInstance) \
+	FUNCTION(vkEnumeratePhysicalDevices) \
+	FUNCTION(vkGetPhysicalDeviceProperties) \
+	FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties) \
+	FUNCTION(vkGetPhysicalDeviceMemoryProperties) \
+	FUNCTION(vkGetPhysicalDeviceFormatProperties) \
+	FUNCTION(vkCreateDevice) \
+	FUNCTION(vkGetDeviceProcAddr)
+
+// entry points fetched from the device
+#define VULKAN_DEVICE_FUNCTIONS(FUNCTION) \
+	FUNCTION(vkDestroyDevice) \
+	FUNCTION(vkGetDeviceQueue) \
+	FUNCTION(vkQueueSubmit) \
+	FUNCTION(vkDeviceWaitIdle) \
+	FUNCTION(vkAllocateMemory) \
+	FUNCTION(vkFreeMemory) \
+	FUNCTION(vkMapMemory) \
+	FUNCTION(vkUnmapMemory) \
+	FUNCTION(vkCreateBuffer) \
+	FUNCTION(vkDestroyBuffer) \
+	FUNCTION(vkGetBufferMemoryRequirements) \
+	FUNCTION(vkBindBufferMemory) \
+	FUNCTION(vkCreateImage) \
+	FUNCTION(vkDestroyImage) \
+	FUNCTION(vkGetImageMemoryRequirements) \
+	FUNCTION(vkBindImageMemory) \
+	FUNCTION(vkCreateImageView) \
+	FUNCTION(vkDestroyImageView) \
+	FUNCTION(vkCreateSampler) \
+	FUNCTION(vkDestroySampler) \
+	FUNCTION(vkCreateShaderModule) \
+	FUNCTION(vkDestroyShaderModule) \
+	FUNCTION(vkCreatePipelineCache) \
+	FUNCTION(vkDestroyPipelineCache) \
+	FUNCTION(vkGetPipelineCacheData) \
+	FUNCTION(vkCreateGraphicsPipelines) \
+	FUNCTION(vkDestroyPipeline) \
+	FUNCTION(vkCreatePipelineLayout) \
+	FUNCTION(vkDestroyPipelineLayout) \
+	FUNCTION(vkCreateDescriptorSetLayout) \
+	FUNCTION(vkDestroyDescriptorSetLayout) \
+	FUNCTION(vkCreateDescriptorPool) \
+	FUNCTION(vkDestroyDescriptorPool) \
+	FUNCTION(vkAllocateDescriptorSets) \
+	FUNCTION(vkUpdateDescriptorSets) \
+	FUNCTION(vkCreateRenderPass) \
+	FUNCTION(vkDestroyRenderPass) \
+	FUNCTION(vkCreateFramebuffer) \
+	FUNCTION(vkDestroyFramebuffer) \
+	FUNCTION(vkCreateCommandPool) \
+	FUNCTION(vkDestroyCommandPool) \
+	FUNCTION(vkResetCommandPool) \
+	FUNCTION(vkAllocateCommandBuffers) \
+	FUNCTION(vkBeginCommandBuffer) \
+	FUNCTION(vkEndCommandBuffer) \
+	FUNCTION(vkCreateFence) \
+	FUNCTION(vkDestroyFence) \
+	FUNCTION(vkWaitForFences) \
+	FUNCTION(vkResetFences) \
+	FUNCTION(vkCmdBeginRenderPass) \
+	FUNCTION(vkCmdEndRenderPass) \
+	FUNCTION(vkCmdExecuteCommands) \
+	FUNCTION(vkCmdBindPipeline) \
+	FUNCTION(vkCmdBindDescriptorSets) \
+	FUNCTION(vkCmdBindVertexBuffers) \
+	FUNCTION(vkCmdBindIndexBuffer) \
+	FUNCTION(vkCmdPushConstants) \
+	FUNCTION(vkCmdDrawIndexed) \
+	FUNCTION(vkCmdSetViewport) \
+	FUNCTION(vkCmdSetScissor) \
+	FUNCTION(vkCmdPipelineBarrier) \
+	FUNCTION(vkCmdCopyBuffer) \
+	FUNCTION(vkCmdCopyBufferToImage) \
+	FUNCTION(vkCmdCopyImageToBuffer) \
+	FUNCTION(vkCmdBlitImage)
+
+#define VULKAN_DECLARE_FUNCTION(name) PFN_##name name = NULL;
+
+namespace
+{
+	// compiled scene shaders
+	const char* VERTEX_SHADER_FILE = "shaders/vulkanSceneVertexShader.spv";
+	const char* FRAGMENT_SHADER_FILE = "shaders/vulkanSceneFragmentShader.spv";
+	// compiled pipelines kept between runs
+	const char* PIPELINE_CACHE_FILE = "vulkanPipelineCache.bin";
+
+	const VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+	// the frame constants in the std140 layout of the shaders' uniform
+	// block - lights are a direction or position, then the ambient,
+	// diffuse and specular colors, with the first w holding bActive
+	struct FRAME_UNIFORMS
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		// w holds bUseLighting
+		glm::vec4 viewPosition;
+		glm::vec4 directionalLight[4];
+		glm::vec4 pointLights[DRAW_POINT_LIGHTS * 4];
+	};
+
+	struct VULKAN_BUFFER
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+	};
+
+	struct VULKAN_TEXTURE
+	{
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+}
+
+class VulkanCommandList;
+
+struct VULKAN_STATE
+{
+#ifdef _WIN32
+	HMODULE library = NULL;
+#else
+	void* library = NULL;
+#endif
+	PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = NULL;
+	PFN_vkCreateInstance vkCreateInstance = NULL;
+	VULKAN_INSTANCE_FUNCTIONS(VULKAN_DECLARE_FUNCTION)
+	VULKAN_DEVICE_FUNCTIONS(VULKAN_DECLARE_FUNCTION)
+
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	uint32_t queueFamily = 0;
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkDescriptorSetLayout frameSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout textureSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkShaderModule vertexShader = VK_NULL_HANDLE;
+	VkShaderModule fragmentShader = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+	// the frame constants, mapped for the life of the device
+	VULKAN_BUFFER frameUniforms;
+	void* pFrameUniforms = NULL;
+	VkDescriptorSet frameDescriptorSet = VK_NULL_HANDLE;
+
+	// submission of frames and uploads
+	VkCommandPool primaryPool = VK_NULL_HANDLE;
+	VkCommandBuffer primaryCommands = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	VulkanCommandList* pCommandLists[VulkanRenderDevice::MAX_COMMAND_LISTS] = {};
+
+	// the render target, sized by BeginFrame()
+	int width = 0;
+	int height = 0;
+	VkImage colorImage = VK_NULL_HANDLE;
+	VkDeviceMemory colorMemory = VK_NULL_HANDLE;
+	VkImageView colorView = VK_NULL_HANDLE;
+	VkImage depthImage = VK_NULL_HANDLE;
+	VkDeviceMemory depthMemory = VK_NULL_HANDLE;
+	VkImageView depthView = VK_NULL_HANDLE;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	VULKAN_BUFFER readback;
+	const unsigned char* pReadback = NULL;
+	VkClearColorValue clearColor;
+
+	std::vector<VULKAN_BUFFER> buffers;
+	std::vector<VULKAN_TEXTURE> textures;
+	std::vector<VkPipeline> pipelines;
+	// white texture bound at the start of each list
+	TEXTURE_HANDLE defaultTexture = INVALID_DEVICE_HANDLE;
+};
+
+/***********************************************************
+ *  VulkanCommandList
+ *
+ *  A secondary command buffer recorded inside the render
+ *  pass. Each list has its own pool, so lists can be
+ *  recorded on different threads at once.
+ ***********************************************************/
+class VulkanCommandList : public RenderCommandList
+{
+public:
+	VulkanCommandList(VULKAN_STATE* pState)
+	{
+		m_pState = pState;
+		m_commandPool = VK_NULL_HANDLE;
+		m_commandBuffer = VK_NULL_HANDLE;
+	}
+
+	bool Create()
+	{
+		VULKAN_STATE& s = *m_pState;
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = s.queueFamily;
+		if (s.vkCreateCommandPool(s.device, &poolInfo, NULL, &m_commandPool) != VK_SUCCESS)
+		{
+			return(false);
+		}
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = m_commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocateInfo.commandBufferCount = 1;
+		return(s.vkAllocateCommandBuffers(s.device, &allocateInfo, &m_commandBuffer) == VK_SUCCESS);
+	}
+
+	void Destroy()
+	{
+		if (VK_NULL_HANDLE != m_commandPool)
+		{
+			m_pState->vkDestroyCommandPool(m_pState->device, m_commandPool, NULL);
+			m_commandPool = VK_NULL_HANDLE;
+			m_commandBuffer = VK_NULL_HANDLE;
+		}
+	}
+
+	// start recording into the current framebuffer with the frame
+	// constants and the default texture bound
+	void Begin()
+	{
+		VULKAN_STATE& s = *m_pState;
+		s.vkResetCommandPool(s.device, m_commandPool, 0);
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = s.renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = s.framebuffer;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+			VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		s.vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+
+		VkViewport viewport = {};
+		viewport.width = (float)s.width;
+		viewport.height = (float)s.height;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		s.vkCmdSetViewport(m_commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = {};
+		scissor.extent.width = (uint32_t)s.width;
+		scissor.extent.height = (uint32_t)s.height;
+		s.vkCmdSetScissor(m_commandBuffer, 0, 1, &scissor);
+
+		VkDescriptorSet descriptorSets[2] = {
+			s.frameDescriptorSet,
+			s.textures[s.defaultTexture].descriptorSet };
+		s.vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			s.pipelineLayout, 0, 2, descriptorSets, 0, NULL);
+	}
+
+	void End()
+	{
+		m_pState->vkEndCommandBuffer(m_commandBuffer);
+	}
+
+	virtual void BindPipeline(PIPELINE_HANDLE pipeline)
+	{
+		m_pState->vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_pState->pipelines[pipeline]);
+	}
+
+	virtual void BindTexture(TEXTURE_HANDLE texture)
+	{
+		m_pState->vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_pState->pipelineLayout, 1, 1, &m_pState->textures[texture].descriptorSet, 0, NULL);
+	}
+
+	virtual void BindMesh(BUFFER_HANDLE vertexBuffer, BUFFER_HANDLE indexBuffer)
+	{
+		VkDeviceSize offset = 0;
+		m_pState->vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &m_pState->buffers[vertexBuffer].buffer, &offset);
+		m_pState->vkCmdBindIndexBuffer(m_commandBuffer, m_pState->buffers[indexBuffer].buffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	virtual void SetDrawConstants(const DRAW_CONSTANTS& constants)
+	{
+		m_pState->vkCmdPushConstants(m_commandBuffer, m_pState->pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0, sizeof(DRAW_CONSTANTS), &constants);
+	}
+
+	virtual void DrawIndexed(uint32_t indexCount)
+	{
+		m_pState->vkCmdDrawIndexed(m_commandBuffer, indexCount, 1, 0, 0, 0);
+	}
+
+	VkCommandBuffer GetCommandBuffer() const { return(m_commandBuffer); }
+
+private:
+	VULKAN_STATE* m_pState;
+	VkCommandPool m_commandPool;
+	VkCommandBuffer m_commandBuffer;
+};
+
+namespace
+{
+	/***********************************************************
+	 *  FindMemoryType()
+	 *
+	 *  Return the first memory type allowed by the type bits
+	 *  with all the wanted properties, or -1 if there is none.
+	 ***********************************************************/
+	int FindMemoryType(const VULKAN_STATE& s, uint32_t typeBits, VkMemoryPropertyFlags properties)
+	{
+		for (uint32_t i = 0; i < s.memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeBits & (1u << i)) &&
+				((s.memoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
+			{
+				return((int)i);
+			}
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  AllocateMemory()
+	 *
+	 *  Allocate memory for the requirements, with the preferred
+	 *  properties if possible and the required ones otherwise.
+	 ***********************************************************/
+	VkDeviceMemory AllocateMemory(
+		const VULKAN_STATE& s,
+		const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags preferred,
+		VkMemoryPropertyFlags required)
+	{
+		int memoryType = FindMemoryType(s, requirements.memoryTypeBits, preferred);
+		if (memoryType < 0)
+		{
+			memoryType = FindMemoryType(s, requirements.memoryTypeBits, required);
+		}
+		if (memoryType < 0)
+		{
+			return(VK_NULL_HANDLE);
+		}
+
+		VkMemoryAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = requirements.size;
+		allocateInfo.memoryTypeIndex = (uint32_t)memoryType;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		if (s.vkAllocateMemory(s.device, &allocateInfo, NULL, &memory) != VK_SUCCESS)
+		{
+			return(VK_NULL_HANDLE);
+		}
+		return(memory);
+	}
+
+	/***********************************************************
+	 *  CreateBufferWithMemory()
+	 ***********************************************************/
+	bool CreateBufferWithMemory(
+		const VULKAN_STATE& s,
+		VkDeviceSize size,
+		VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags preferred,
+		VkMemoryPropertyFlags required,
+		VULKAN_BUFFER& buffer)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = std::max<VkDeviceSize>(size, 4);
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (s.vkCreateBuffer(s.device, &bufferInfo, NULL, &buffer.buffer) != VK_SUCCESS)
+		{
+			return(false);
+		}
+
+		VkMemoryRequirements requirements;
+		s.vkGetBufferMemoryRequirements(s.device, buffer.buffer, &requirements);
+		buffer.memory = AllocateMemory(s, requirements, preferred, required);
+		if (VK_NULL_HANDLE == buffer.memory)
+		{
+			return(false);
+		}
+		return(s.vkBindBufferMemory(s.device, buffer.buffer, buffer.memory, 0) == VK_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  DestroyBuffer()
+	 ***********************************************************/
+	void DestroyBuffer(const VULKAN_STATE& s, VULKAN_BUFFER& buffer)
+	{
+		if (VK_NULL_HANDLE != buffer.buffer)
+		{
+			s.vkDestroyBuffer(s.device, buffer.buffer, NULL);
+			buffer.buffer = VK_NULL_HANDLE;
+		}
+		if (VK_NULL_HANDLE != buffer.memory)
+		{
+			s.vkFreeMemory(s.device, buffer.memory, NULL);
+			buffer.memory = VK_NULL_HANDLE;
+		}
+	}
+
+	/***********************************************************
+	 *  CreateStagingBuffer()
+	 *
+	 *  Create a host visible buffer holding a copy of the data,
+	 *  to upload from.
+	 ***********************************************************/
+	bool CreateStagingBuffer(const VULKAN_STATE& s, const void* pData, size_t size, VULKAN_BUFFER& staging)
+	{
+		if (!CreateBufferWithMemory(s, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			staging))
+		{
+			DestroyBuffer(s, staging);
+			return(false);
+		}
+
+		void* pMapped = NULL;
+		if (s.vkMapMemory(s.device, staging.memory, 0, VK_WHOLE_SIZE, 0, &pMapped) != VK_SUCCESS)
+		{
+			DestroyBuffer(s, staging);
+			return(false);
+		}
+		memcpy(pMapped, pData, size);
+		s.vkUnmapMemory(s.device, staging.memory);
+		return(true);
+	}
+
+	/***********************************************************
+	 *  BeginCommands()
+	 *
+	 *  Start recording the primary command buffer.
+	 ***********************************************************/
+	VkCommandBuffer BeginCommands(const VULKAN_STATE& s)
+	{
+		s.vkResetCommandPool(s.device, s.primaryPool, 0);
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		s.vkBeginCommandBuffer(s.primaryCommands, &beginInfo);
+		return(s.primaryCommands);
+	}
+
+	/***********************************************************
+	 *  SubmitCommands()
+	 *
+	 *  Submit the primary command buffer and wait for it to
+	 *  finish.
+	 ***********************************************************/
+	bool SubmitCommands(const VULKAN_STATE& s)
+	{
+		s.vkEndCommandBuffer(s.primaryCommands);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &s.primaryCommands;
+		if (s.vkQueueSubmit(s.queue, 1, &submitInfo, s.fence) != VK_SUCCESS)
+		{
+			LOG_ERROR("Vulkan queue submission failed");
+			return(false);
+		}
+		s.vkWaitForFences(s.device, 1, &s.fence, VK_TRUE, UINT64_MAX);
+		s.vkResetFences(s.device, 1, &s.fence);
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ImageBarrier()
+	 *
+	 *  Record a layout transition of some mip levels of a
+	 *  color image.
+	 ***********************************************************/
+	void ImageBarrier(
+		const VULKAN_STATE& s,
+		VkCommandBuffer commandBuffer,
+		VkImage image,
+		uint32_t firstLevel,
+		uint32_t levelCount,
+		VkImageLayout oldLayout,
+		VkImageLayout newLayout,
+		VkAccessFlags sourceAccess,
+		VkAccessFlags destinationAccess,
+		VkPipelineStageFlags sourceStage,
+		VkPipelineStageFlags destinationStage)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = sourceAccess;
+		barrier.dstAccessMask = destinationAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = firstLevel;
+		barrier.subresourceRange.levelCount = levelCount;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		s.vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0,
+			0, NULL, 0, NULL, 1, &barrier);
+	}
+
+	/***********************************************************
+	 *  CreateImageWithMemory()
+	 ***********************************************************/
+	bool CreateImageWithMemory(
+		const VULKAN_STATE& s,
+		VkFormat format,
+		uint32_t width,
+		uint32_t height,
+		uint32_t levelCount,
+		VkImageUsageFlags usage,
+		VkImage& image,
+		VkDeviceMemory& memory)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent.width = width;
+		imageInfo.extent.height = height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = levelCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (s.vkCreateImage(s.device, &imageInfo, NULL, &image) != VK_SUCCESS)
+		{
+			return(false);
+		}
+
+		VkMemoryRequirements requirements;
+		s.vkGetImageMemoryRequirements(s.device, image, &requirements);
+		memory = AllocateMemory(s, requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+		if (VK_NULL_HANDLE == memory)
+		{
+			return(false);
+		}
+		return(s.vkBindImageMemory(s.device, image, memory, 0) == VK_SUCCESS);
+	}
+
+	/***********************************************************
+	 *  CreateImageView()
+	 ***********************************************************/
+	VkImageView CreateImageView(
+		const VULKAN_STATE& s,
+		VkImage image,
+		VkFormat format,
+		VkImageAspectFlags aspect,
+		uint32_t levelCount)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		viewInfo.subresourceRange.aspectMask = aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = levelCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		VkImageView view = VK_NULL_HANDLE;
+		if (s.vkCreateImageView(s.device, &viewInfo, NULL, &view) != VK_SUCCESS)
+		{
+			return(VK_NULL_HANDLE);
+		}
+		return(view);
+	}
+
+	/***********************************************************
+	 *  ReadFile()
+	 ***********************************************************/
+	bool ReadFile(const char* filename, std::vector<char>& data)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+		{
+			return(false);
+		}
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  VulkanRenderDevice()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VulkanRenderDevice::VulkanRenderDevice()
+{
+	m_pState = new VULKAN_STATE();
+	m_name = "Vulkan";
+}
+
+/***********************************************************
+ *  ~VulkanRenderDevice()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VulkanRenderDevice::~VulkanRenderDevice()
+{
+	Destroy();
+	delete m_pState;
+	m_pState = NULL;
+}
+
+/***********************************************************
+ *  Create()
+ ***********************************************************/
+bool VulkanRenderDevice::Create()
+{
+	if (!CreateInstance() ||
+		!SelectPhysicalDevice() ||
+		!CreateLogicalDevice() ||
+		!CreateRenderPass() ||
+		!CreateLayouts() ||
+		!CreateCommandObjects() ||
+		!LoadShaderModules())
+	{
+		Destroy();
+		return(false);
+	}
+	LoadPipelineCache();
+
+	// bound where a list has no texture of its own
+	const uint32_t whitePixel = 0xFFFFFFFF;
+	TEXTURE_DESC whiteDesc;
+	whiteDesc.width = 1;
+	whiteDesc.height = 1;
+	whiteDesc.pPixels = &whitePixel;
+	whiteDesc.bMipmaps = false;
+	m_pState->defaultTexture = CreateTexture(whiteDesc);
+	if (INVALID_DEVICE_HANDLE == m_pState->defaultTexture)
+	{
+		Destroy();
+		return(false);
+	}
+
+	LOG_INFO("Created the %s render device", m_name.c_str());
+	return(true);
+}
+
+/***********************************************************
+ *  CreateInstance()
+ *
+ *  This method opens the Vulkan loader and creates an
+ *  instance with no extensions - nothing is presented.
+ ***********************************************************/
+bool VulkanRenderDevice::CreateInstance()
+{
+	VULKAN_STATE& s = *m_pState;
+
+#ifdef _WIN32
+	s.library = LoadLibraryA("vulkan-1.dll");
+	if (NULL != s.library)
+	{
+		s.vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)(void*)GetProcAddress(s.library, "vkGetInstanceProcAddr");
+	}
+#else
+	s.library = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+	if (NULL == s.library)
+	{
+		s.library = dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+	}
+	if (NULL != s.library)
+	{
+		s.vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)dlsym(s.library, "vkGetInstanceProcAddr");
+	}
+#endif
+	if (NULL == s.vkGetInstanceProcAddr)
+	{
+		LOG_ERROR("The Vulkan loader could not be found");
+		return(false);
+	}
+
+	s.vkCreateInstance = (PFN_vkCreateInstance)s.vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance");
+	if (NULL == s.vkCreateInstance)
+	{
+		LOG_ERROR("The Vulkan loader has no vkCreateInstance");
+		return(false);
+	}
+
+	VkApplicationInfo applicationInfo = {};
+	applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	applicationInfo.pApplicationName = "7-1 Final Project";
+	applicationInfo.applicationVersion = 1;
+	applicationInfo.pEngineName = "7-1 Final Project";
+	applicationInfo.engineVersion = 1;
+	applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+
+	VkInstanceCreateInfo instanceInfo = {};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &applicationInfo;
+	VkResult result = s.vkCreateInstance(&instanceInfo, NULL, &s.instance);
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR("vkCreateInstance failed (%d) - no Vulkan driver is installed", (int)result);
+		return(false);
+	}
+
+#define VULKAN_LOAD_INSTANCE_FUNCTION(name) \
+	s.name = (PFN_##name)s.vkGetInstanceProcAddr(s.instance, #name); \
+	if (NULL == s.name) \
+	{ \
+		LOG_ERROR("The Vulkan instance has no %s", #name); \
+		return(false); \
+	}
+	VULKAN_INSTANCE_FUNCTIONS(VULKAN_LOAD_INSTANCE_FUNCTION)
+#undef VULKAN_LOAD_INSTANCE_FUNCTION
+
+	return(true);
+}
+
+/***********************************************************
+ *  SelectPhysicalDevice()
+ *
+ *  This method picks the device to render on - a discrete
+ *  GPU, then an integrated one, then anything else with a
+ *  graphics queue, such as lavapipe on the CPU.
+ ***********************************************************/
+bool VulkanRenderDevice::SelectPhysicalDevice()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	uint32_t deviceCount = 0;
+	s.vkEnumeratePhysicalDevices(s.instance, &deviceCount, NULL);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	if (deviceCount > 0)
+	{
+		s.vkEnumeratePhysicalDevices(s.instance, &deviceCount, devices.data());
+	}
+
+	int bestScore = -1;
+	for (VkPhysicalDevice physicalDevice : devices)
+	{
+		uint32_t familyCount = 0;
+		s.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, NULL);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		s.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+		int graphicsFamily = -1;
+		for (uint32_t i = 0; i < familyCount; i++)
+		{
+			if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (families[i].queueCount > 0))
+			{
+				graphicsFamily = (int)i;
+				break;
+			}
+		}
+		if (graphicsFamily < 0)
+		{
+			continue;
+		}
+
+		VkPhysicalDeviceProperties properties;
+		s.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		int score = 0;
+		switch (properties.deviceType)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score = 3; break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score = 2; break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score = 1; break;
+		default: score = 0; break;
+		}
+		if (score > bestScore)
+		{
+			bestScore = score;
+			s.physicalDevice = physicalDevice;
+			s.queueFamily = (uint32_t)graphicsFamily;
+			m_name = std::string("Vulkan on ") + properties.deviceName;
+		}
+	}
+
+	if (VK_NULL_HANDLE == s.physicalDevice)
+	{
+		LOG_ERROR("No Vulkan device with a graphics queue was found");
+		return(false);
+	}
+	s.vkGetPhysicalDeviceMemoryProperties(s.physicalDevice, &s.memoryProperties);
+
+	// the first depth format that can be rendered to
+	const VkFormat depthFormats[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
+		VK_FORMAT_D16_UNORM };
+	for (VkFormat format : depthFormats)
+	{
+		VkFormatProperties formatProperties;
+		s.vkGetPhysicalDeviceFormatProperties(s.physicalDevice, format, &formatProperties);
+		if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			s.depthFormat = format;
+			break;
+		}
+	}
+	if (VK_FORMAT_UNDEFINED == s.depthFormat)
+	{
+		LOG_ERROR("%s has no depth format to render to", m_name.c_str());
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  CreateLogicalDevice()
+ ***********************************************************/
+bool VulkanRenderDevice::CreateLogicalDevice()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo = {};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = s.queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &queuePriority;
+
+	VkDeviceCreateInfo deviceInfo = {};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	VkResult result = s.vkCreateDevice(s.physicalDevice, &deviceInfo, NULL, &s.device);
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR("vkCreateDevice failed (%d)", (int)result);
+		return(false);
+	}
+
+#define VULKAN_LOAD_DEVICE_FUNCTION(name) \
+	s.name = (PFN_##name)s.vkGetDeviceProcAddr(s.device, #name); \
+	if (NULL == s.name) \
+	{ \
+		LOG_ERROR("The Vulkan device has no %s", #name); \
+		return(false); \
+	}
+	VULKAN_DEVICE_FUNCTIONS(VULKAN_LOAD_DEVICE_FUNCTION)
+#undef VULKAN_LOAD_DEVICE_FUNCTION
+
+	s.vkGetDeviceQueue(s.device, s.queueFamily, 0, &s.queue);
+	return(true);
+}
+
+/***********************************************************
+ *  CreateRenderPass()
+ *
+ *  This method creates the single pass frames are drawn in.
+ *  Both attachments are cleared, and the color image is left
+ *  ready to be copied out.
+ ***********************************************************/
+bool VulkanRenderDevice::CreateRenderPass()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	VkAttachmentDescription attachments[2] = {};
+	attachments[0].format = COLOR_FORMAT;
+	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	attachments[1].format = s.depthFormat;
+	attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+	subpass.pDepthStencilAttachment = &depthReference;
+
+	// the previous frame's copy reads the color image before it is
+	// cleared, and this frame's drawing finishes before the copy
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies;
+	return(s.vkCreateRenderPass(s.device, &renderPassInfo, NULL, &s.renderPass) == VK_SUCCESS);
+}
+
+/***********************************************************
+ *  CreateLayouts()
+ *
+ *  This method creates the resource layout of the scene
+ *  shaders - the frame constants in set 0, a texture in set
+ *  1 and the draw constants as push constants - and the
+ *  uniform buffer the frame constants are written to.
+ ***********************************************************/
+bool VulkanRenderDevice::CreateLayouts()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	VkDescriptorSetLayoutBinding frameBinding = {};
+	frameBinding.binding = 0;
+	frameBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	frameBinding.descriptorCount = 1;
+	frameBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &frameBinding;
+	if (s.vkCreateDescriptorSetLayout(s.device, &layoutInfo, NULL, &s.frameSetLayout) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkDescriptorSetLayoutBinding textureBinding = {};
+	textureBinding.binding = 0;
+	textureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureBinding.descriptorCount = 1;
+	textureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	layoutInfo.pBindings = &textureBinding;
+	if (s.vkCreateDescriptorSetLayout(s.device, &layoutInfo, NULL, &s.textureSetLayout) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DRAW_CONSTANTS);
+
+	VkDescriptorSetLayout setLayouts[2] = { s.frameSetLayout, s.textureSetLayout };
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (s.vkCreatePipelineLayout(s.device, &pipelineLayoutInfo, NULL, &s.pipelineLayout) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = MAX_TEXTURES;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = MAX_TEXTURES + 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (s.vkCreateDescriptorPool(s.device, &poolInfo, NULL, &s.descriptorPool) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (s.vkCreateSampler(s.device, &samplerInfo, NULL, &s.sampler) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	if (!CreateBufferWithMemory(s, sizeof(FRAME_UNIFORMS), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		s.frameUniforms))
+	{
+		return(false);
+	}
+	if (s.vkMapMemory(s.device, s.frameUniforms.memory, 0, VK_WHOLE_SIZE, 0, &s.pFrameUniforms) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = s.descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &s.frameSetLayout;
+	if (s.vkAllocateDescriptorSets(s.device, &allocateInfo, &s.frameDescriptorSet) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = s.frameUniforms.buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = sizeof(FRAME_UNIFORMS);
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = s.frameDescriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	s.vkUpdateDescriptorSets(s.device, 1, &write, 0, NULL);
+	return(true);
+}
+
+/***********************************************************
+ *  CreateCommandObjects()
+ *
+ *  This method creates the primary command buffer frames
+ *  and uploads are submitted with, and a secondary command
+ *  buffer with its own pool for every list index.
+ ***********************************************************/
+bool VulkanRenderDevice::CreateCommandObjects()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = s.queueFamily;
+	if (s.vkCreateCommandPool(s.device, &poolInfo, NULL, &s.primaryPool) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = s.primaryPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+	if (s.vkAllocateCommandBuffers(s.device, &allocateInfo, &s.primaryCommands) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (s.vkCreateFence(s.device, &fenceInfo, NULL, &s.fence) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < MAX_COMMAND_LISTS; i++)
+	{
+		s.pCommandLists[i] = new VulkanCommandList(m_pState);
+		if (!s.pCommandLists[i]->Create())
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  LoadShaderModules()
+ ***********************************************************/
+bool VulkanRenderDevice::LoadShaderModules()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	const char* filenames[2] = { VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE };
+	VkShaderModule* pModules[2] = { &s.vertexShader, &s.fragmentShader };
+	for (int i = 0; i < 2; i++)
+	{
+		std::vector<char> code;
+		if (!ReadFile(filenames[i], code) || code.empty() || (code.size() % 4 != 0))
+		{
+			LOG_ERROR("Could not load %s - compile it with glslangValidator -V", filenames[i]);
+			return(false);
+		}
+
+		// the words are copied so they are aligned
+		std::vector<uint32_t> words(code.size() / 4);
+		memcpy(words.data(), code.data(), code.size());
+
+		VkShaderModuleCreateInfo moduleInfo = {};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = code.size();
+		moduleInfo.pCode = words.data();
+		if (s.vkCreateShaderModule(s.device, &moduleInfo, NULL, pModules[i]) != VK_SUCCESS)
+		{
+			LOG_ERROR("%s is not valid SPIR-V", filenames[i]);
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  LoadPipelineCache()
+ *
+ *  This method creates the pipeline cache from the file the
+ *  last run saved. The driver checks the header and ignores
+ *  data from another device or driver version.
+ ***********************************************************/
+void VulkanRenderDevice::LoadPipelineCache()
+{
+	VULKAN_STATE& s = *m_pState;
+
+	std::vector<char> data;
+	ReadFile(PIPELINE_CACHE_FILE, data);
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? NULL : data.data();
+	if (s.vkCreatePipelineCache(s.device, &cacheInfo, NULL, &s.pipelineCache) != VK_SUCCESS)
+	{
+		// start empty if the driver rejects the data
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = NULL;
+		if (s.vkCreatePipelineCache(s.device, &cacheInfo, NULL, &s.pipelineCache) != VK_SUCCESS)
+		{
+			s.pipelineCache = VK_NULL_HANDLE;
+		}
+	}
+	else if (!data.empty())
+	{
+		LOG_INFO("Loaded %zu bytes of Vulkan pipeline cache from %s", data.size(), PIPELINE_CACHE_FILE);
+	}
+}
+
+/***********************************************************
+ *  SavePipelineCache()
+ ***********************************************************/
+void VulkanRenderDevice::SavePipelineCache()
+{
+	VULKAN_STATE& s = *m_pState;
+	if ((VK_NULL_HANDLE == s.pipelineCache) || s.pipelines.empty())
+	{
+		return;
+	}
+
+	size_t size = 0;
+	if ((s.vkGetPipelineCacheData(s.device, s.pipelineCache, &size, NULL) != VK_SUCCESS) || (0 == size))
+	{
+		return;
+	}
+	std::vector<char> data(size);
+	if (s.vkGetPipelineCacheData(s.device, s.pipelineCache, &size, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	std::ofstream file(PIPELINE_CACHE_FILE, std::ios::binary);
+	file.write(data.data(), (std::streamsize)size);
+	if (!file)
+	{
+		LOG_WARNING("Could not save the Vulkan pipeline cache to %s", PIPELINE_CACHE_FILE);
+	}
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method creates a device local buffer and uploads
+ *  the data through a staging buffer.
+ ***********************************************************/
+BUFFER_HANDLE VulkanRenderDevice::CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size)
+{
+	VULKAN_STATE& s = *m_pState;
+	if (VK_NULL_HANDLE == s.device)
+	{
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	VkBufferUsageFlags usageFlags = (BUFFER_USAGE_INDEX == usage) ?
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT : VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	VULKAN_BUFFER buffer;
+	VULKAN_BUFFER staging;
+	if (!CreateBufferWithMemory(s, size, usageFlags | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, buffer) ||
+		!CreateStagingBuffer(s, pData, size, staging))
+	{
+		LOG_ERROR("Could not create a Vulkan buffer of %zu bytes", size);
+		DestroyBuffer(s, buffer);
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	VkCommandBuffer commandBuffer = BeginCommands(s);
+	VkBufferCopy region = {};
+	region.size = size;
+	s.vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer.buffer, 1, &region);
+	bool bSubmitted = SubmitCommands(s);
+	DestroyBuffer(s, staging);
+	if (!bSubmitted)
+	{
+		DestroyBuffer(s, buffer);
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	s.buffers.push_back(buffer);
+	return((BUFFER_HANDLE)s.buffers.size() - 1);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method uploads the top level of a texture and blits
+ *  each mip level down from the one above, as
+ *  glGenerateMipmap does.
+ ***********************************************************/
+TEXTURE_HANDLE VulkanRenderDevice::CreateTexture(const TEXTURE_DESC& desc)
+{
+	VULKAN_STATE& s = *m_pState;
+	if ((VK_NULL_HANDLE == s.device) || ((int)s.textures.size() >= MAX_TEXTURES) ||
+		(desc.width <= 0) || (desc.height <= 0))
+	{
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	uint32_t levelCount = 1;
+	if (desc.bMipmaps)
+	{
+		levelCount = (uint32_t)std::floor(std::log2((double)std::max(desc.width, desc.height))) + 1;
+	}
+
+	VULKAN_TEXTURE texture;
+	VULKAN_BUFFER staging;
+	size_t size = (size_t)desc.width * desc.height * 4;
+	if (!CreateImageWithMemory(s, COLOR_FORMAT, (uint32_t)desc.width, (uint32_t)desc.height, levelCount,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		texture.image, texture.memory) ||
+		!CreateStagingBuffer(s, desc.pPixels, size, staging))
+	{
+		LOG_ERROR("Could not create a %dx%d Vulkan texture", desc.width, desc.height);
+		if (VK_NULL_HANDLE != texture.image)
+		{
+			s.vkDestroyImage(s.device, texture.image, NULL);
+		}
+		if (VK_NULL_HANDLE != texture.memory)
+		{
+			s.vkFreeMemory(s.device, texture.memory, NULL);
+		}
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	VkCommandBuffer commandBuffer = BeginCommands(s);
+	ImageBarrier(s, commandBuffer, texture.image, 0, levelCount,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		0, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	// the rows go in as they are - Vulkan and OpenGL both put texture
+	// coordinate 0 at the first row in memory
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent.width = (uint32_t)desc.width;
+	region.imageExtent.height = (uint32_t)desc.height;
+	region.imageExtent.depth = 1;
+	s.vkCmdCopyBufferToImage(commandBuffer, staging.buffer, texture.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	int32_t levelWidth = desc.width;
+	int32_t levelHeight = desc.height;
+	for (uint32_t level = 1; level < levelCount; level++)
+	{
+		ImageBarrier(s, commandBuffer, texture.image, level - 1, 1,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		VkImageBlit blit = {};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1].x = levelWidth;
+		blit.srcOffsets[1].y = levelHeight;
+		blit.srcOffsets[1].z = 1;
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1].x = levelWidth;
+		blit.dstOffsets[1].y = levelHeight;
+		blit.dstOffsets[1].z = 1;
+		s.vkCmdBlitImage(commandBuffer,
+			texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+
+		ImageBarrier(s, commandBuffer, texture.image, level - 1, 1,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	}
+	ImageBarrier(s, commandBuffer, texture.image, levelCount - 1, 1,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	bool bSubmitted = SubmitCommands(s);
+	DestroyBuffer(s, staging);
+
+	texture.view = CreateImageView(s, texture.image, COLOR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = s.descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &s.textureSetLayout;
+	bool bAllocated = (VK_NULL_HANDLE != texture.view) &&
+		(s.vkAllocateDescriptorSets(s.device, &allocateInfo, &texture.descriptorSet) == VK_SUCCESS);
+
+	// kept even on failure, so the destructor releases it
+	s.textures.push_back(texture);
+	if (!bSubmitted || !bAllocated)
+	{
+		LOG_ERROR("Could not upload a %dx%d Vulkan texture", desc.width, desc.height);
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = s.sampler;
+	imageInfo.imageView = texture.view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = texture.descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	s.vkUpdateDescriptorSets(s.device, 1, &write, 0, NULL);
+
+	return((TEXTURE_HANDLE)s.textures.size() - 1);
+}
+
+/***********************************************************
+ *  CreatePipeline()
+ *
+ *  This method compiles the scene shaders with the given
+ *  fixed function state, through the pipeline cache.
+ ***********************************************************/
+PIPELINE_HANDLE VulkanRenderDevice::CreatePipeline(const PIPELINE_DESC& desc)
+{
+	VULKAN_STATE& s = *m_pState;
+	if (VK_NULL_HANDLE == s.device)
+	{
+		return(INVALID_DEVICE_HANDLE);
+	}
+
+	VkPipelineShaderStageCreateInfo stages[2] = {};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = s.vertexShader;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = s.fragmentShader;
+	stages[1].pName = "main";
+
+	VkVertexInputBindingDescription vertexBinding = {};
+	vertexBinding.binding = 0;
+	vertexBinding.stride = sizeof(CPU_VERTEX);
+	vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription vertexAttributes[3] = {};
+	vertexAttributes[0].location = 0;
+	vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	vertexAttributes[0].offset = offsetof(CPU_VERTEX, position);
+	vertexAttributes[1].location = 1;
+	vertexAttributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	vertexAttributes[1].offset = offsetof(CPU_VERTEX, normal);
+	vertexAttributes[2].location = 2;
+	vertexAttributes[2].format = VK_FORMAT_R32G32_SFLOAT;
+	vertexAttributes[2].offset = offsetof(CPU_VERTEX, textureCoordinate);
+
+	VkPipelineVertexInputStateCreateInfo vertexInput = {};
+	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInput.vertexBindingDescriptionCount = 1;
+	vertexInput.pVertexBindingDescriptions = &vertexBinding;
+	vertexInput.vertexAttributeDescriptionCount = 3;
+	vertexInput.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// the viewport and scissor are set by each list
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// nothing is culled, as in the OpenGL renderer
+	VkPipelineRasterizationStateCreateInfo rasterization = {};
+	rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterization.cullMode = VK_CULL_MODE_NONE;
+	rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterization.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisample = {};
+	multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = desc.bDepthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) for color and alpha
+	VkPipelineColorBlendAttachmentState blendAttachment = {};
+	blendAttachment.blendEnable = desc.bBlend ? VK_TRUE : VK_FALSE;
+	blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlend = {};
+	colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlend.attachmentCount = 1;
+	colorBlend.pAttachments = &blendAttachment;
+
+	VkDynamicState dynamicStates[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = stages;
+	pipelineInfo.pVertexInputState = &vertexInput;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterization;
+	pipelineInfo.pMultisampleState = &multisample;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlend;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = s.pipelineLayout;
+	pipelineInfo.renderPass = s.renderPass;
+	pipelineInfo.subpass = 0;
+
+	auto createStart = std::chrono::steady_clock::now();
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkResult result = s.vkCreateGraphicsPipelines(s.device, s.pipelineCache, 1, &pipelineInfo, NULL, &pipeline);
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR("vkCreateGraphicsPipelines failed (%d)", (int)result);
+		return(INVALID_DEVICE_HANDLE);
+	}
+	LOG_DEBUG("Created a Vulkan pipeline in %.3f ms", std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - createStart).count());
+
+	s.pipelines.push_back(pipeline);
+	return((PIPELINE_HANDLE)s.pipelines.size() - 1);
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method creates the color and depth images frames
+ *  are drawn into, and the host visible buffer the color
+ *  image is copied into.
+ ***********************************************************/
+bool VulkanRenderDevice::CreateTarget(int width, int height)
+{
+	VULKAN_STATE& s = *m_pState;
+	s.width = width;
+	s.height = height;
+
+	bool bDepthHasStencil = (VK_FORMAT_D24_UNORM_S8_UINT == s.depthFormat) ||
+		(VK_FORMAT_D32_SFLOAT_S8_UINT == s.depthFormat);
+	VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT |
+		(bDepthHasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+
+	if (!CreateImageWithMemory(s, COLOR_FORMAT, (uint32_t)width, (uint32_t)height, 1,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		s.colorImage, s.colorMemory) ||
+		!CreateImageWithMemory(s, s.depthFormat, (uint32_t)width, (uint32_t)height, 1,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		s.depthImage, s.depthMemory))
+	{
+		LOG_ERROR("Could not create a %dx%d Vulkan render target", width, height);
+		return(false);
+	}
+	s.colorView = CreateImageView(s, s.colorImage, COLOR_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	s.depthView = CreateImageView(s, s.depthImage, s.depthFormat, depthAspect, 1);
+	if ((VK_NULL_HANDLE == s.colorView) || (VK_NULL_HANDLE == s.depthView))
+	{
+		return(false);
+	}
+
+	VkImageView attachments[2] = { s.colorView, s.depthView };
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = s.renderPass;
+	framebufferInfo.attachmentCount = 2;
+	framebufferInfo.pAttachments = attachments;
+	framebufferInfo.width = (uint32_t)width;
+	framebufferInfo.height = (uint32_t)height;
+	framebufferInfo.layers = 1;
+	if (s.vkCreateFramebuffer(s.device, &framebufferInfo, NULL, &s.framebuffer) != VK_SUCCESS)
+	{
+		return(false);
+	}
+
+	// cached memory makes reading the pixels back much faster
+	if (!CreateBufferWithMemory(s, (VkDeviceSize)width * height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		s.readback))
+	{
+		return(false);
+	}
+	void* pMapped = NULL;
+	if (s.vkMapMemory(s.device, s.readback.memory, 0, VK_WHOLE_SIZE, 0, &pMapped) != VK_SUCCESS)
+	{
+		return(false);
+	}
+	s.pReadback = (const unsigned char*)pMapped;
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ ***********************************************************/
+void VulkanRenderDevice::DestroyTarget()
+{
+	VULKAN_STATE& s = *m_pState;
+	if (NULL != s.pReadback)
+	{
+		s.vkUnmapMemory(s.device, s.readback.memory);
+		s.pReadback = NULL;
+	}
+	DestroyBuffer(s, s.readback);
+	if (VK_NULL_HANDLE != s.framebuffer)
+	{
+		s.vkDestroyFramebuffer(s.device, s.framebuffer, NULL);
+		s.framebuffer = VK_NULL_HANDLE;
+	}
+	VkImageView* pViews[2] = { &s.colorView, &s.depthView };
+	VkImage* pImages[2] = { &s.colorImage, &s.depthImage };
+	VkDeviceMemory* pMemories[2] = { &s.colorMemory, &s.depthMemory };
+	for (int i = 0; i < 2; i++)
+	{
+		if (VK_NULL_HANDLE != *pViews[i])
+		{
+			s.vkDestroyImageView(s.device, *pViews[i], NULL);
+			*pViews[i] = VK_NULL_HANDLE;
+		}
+		if (VK_NULL_HANDLE != *pImages[i])
+		{
+			s.vkDestroyImage(s.device, *pImages[i], NULL);
+			*pImages[i] = VK_NULL_HANDLE;
+		}
+		if (VK_NULL_HANDLE != *pMemories[i])
+		{
+			s.vkFreeMemory(s.device, *pMemories[i], NULL);
+			*pMemories[i] = VK_NULL_HANDLE;
+		}
+	}
+	s.width = 0;
+	s.height = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method resizes the target when needed and writes the
+ *  frame constants. The previous frame has already finished,
+ *  so the uniform buffer is free to overwrite.
+ ***********************************************************/
+bool VulkanRenderDevice::BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants)
+{
+	VULKAN_STATE& s = *m_pState;
+	if ((VK_NULL_HANDLE == s.device) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if ((width != s.width) || (height != s.height))
+	{
+		s.vkDeviceWaitIdle(s.device);
+		DestroyTarget();
+		if (!CreateTarget(width, height))
+		{
+			DestroyTarget();
+			return(false);
+		}
+	}
+
+	FRAME_UNIFORMS uniforms;
+	uniforms.view = frameConstants.view;
+	uniforms.projection = frameConstants.projection;
+	uniforms.viewPosition = glm::vec4(frameConstants.viewPosition, frameConstants.bUseLighting ? 1.0f : 0.0f);
+
+	const DRAW_LIGHT& directional = frameConstants.lights.directional;
+	uniforms.directionalLight[0] = glm::vec4(directional.position, directional.bActive ? 1.0f : 0.0f);
+	uniforms.directionalLight[1] = glm::vec4(directional.ambient, 0.0f);
+	uniforms.directionalLight[2] = glm::vec4(directional.diffuse, 0.0f);
+	uniforms.directionalLight[3] = glm::vec4(directional.specular, 0.0f);
+	for (int i = 0; i < DRAW_POINT_LIGHTS; i++)
+	{
+		const DRAW_LIGHT& pointLight = frameConstants.lights.pointLights[i];
+		uniforms.pointLights[i * 4 + 0] = glm::vec4(pointLight.position, pointLight.bActive ? 1.0f : 0.0f);
+		uniforms.pointLights[i * 4 + 1] = glm::vec4(pointLight.ambient, 0.0f);
+		uniforms.pointLights[i * 4 + 2] = glm::vec4(pointLight.diffuse, 0.0f);
+		uniforms.pointLights[i * 4 + 3] = glm::vec4(pointLight.specular, 0.0f);
+	}
+	memcpy(s.pFrameUniforms, &uniforms, sizeof(uniforms));
+
+	const glm::vec4& clearColor = frameConstants.clearColor;
+	s.clearColor.float32[0] = clearColor.r;
+	s.clearColor.float32[1] = clearColor.g;
+	s.clearColor.float32[2] = clearColor.b;
+	s.clearColor.float32[3] = clearColor.a;
+	return(true);
+}
+
+/***********************************************************
+ *  BeginCommandList()
+ ***********************************************************/
+RenderCommandList* VulkanRenderDevice::BeginCommandList(int listIndex)
+{
+	VulkanCommandList* pCommandList = m_pState->pCommandLists[listIndex];
+	pCommandList->Begin();
+	return(pCommandList);
+}
+
+/***********************************************************
+ *  EndCommandList()
+ ***********************************************************/
+void VulkanRenderDevice::EndCommandList(int listIndex)
+{
+	m_pState->pCommandLists[listIndex]->End();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method runs the recorded lists inside the render
+ *  pass, copies the color image out and waits for the
+ *  frame to finish.
+ ***********************************************************/
+void VulkanRenderDevice::EndFrame(int listCount)
+{
+	VULKAN_STATE& s = *m_pState;
+	VkCommandBuffer commandBuffer = BeginCommands(s);
+
+	VkClearValue clearValues[2] = {};
+	clearValues[0].color = s.clearColor;
+	clearValues[1].depthStencil.depth = 1.0f;
+	clearValues[1].depthStencil.stencil = 0;
+
+	VkRenderPassBeginInfo renderPassBegin = {};
+	renderPassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBegin.renderPass = s.renderPass;
+	renderPassBegin.framebuffer = s.framebuffer;
+	renderPassBegin.renderArea.extent.width = (uint32_t)s.width;
+	renderPassBegin.renderArea.extent.height = (uint32_t)s.height;
+	renderPassBegin.clearValueCount = 2;
+	renderPassBegin.pClearValues = clearValues;
+	s.vkCmdBeginRenderPass(commandBuffer, &renderPassBegin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+	if (listCount > 0)
+	{
+		VkCommandBuffer secondaryCommands[MAX_COMMAND_LISTS];
+		for (int i = 0; i < listCount; i++)
+		{
+			secondaryCommands[i] = s.pCommandLists[i]->GetCommandBuffer();
+		}
+		s.vkCmdExecuteCommands(commandBuffer, (uint32_t)listCount, secondaryCommands);
+	}
+	s.vkCmdEndRenderPass(commandBuffer);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent.width = (uint32_t)s.width;
+	region.imageExtent.height = (uint32_t)s.height;
+	region.imageExtent.depth = 1;
+	s.vkCmdCopyImageToBuffer(commandBuffer, s.colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		s.readback.buffer, 1, &region);
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = s.readback.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	s.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, NULL, 1, &barrier, 0, NULL);
+
+	SubmitCommands(s);
+}
+
+/***********************************************************
+ *  ReadPixels()
+ *
+ *  This method converts the copied RGBA rows, top row first,
+ *  into RGB rows with the bottom row first.
+ ***********************************************************/
+void VulkanRenderDevice::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	VULKAN_STATE& s = *m_pState;
+	pixels.resize((size_t)s.width * s.height * 3);
+	if (NULL == s.pReadback)
+	{
+		return;
+	}
+
+	for (int y = 0; y < s.height; y++)
+	{
+		const unsigned char* pSource = s.pReadback + (size_t)(s.height - 1 - y) * s.width * 4;
+		unsigned char* pDestination = &pixels[(size_t)y * s.width * 3];
+		for (int x = 0; x < s.width; x++)
+		{
+			pDestination[x * 3 + 0] = pSource[x * 4 + 0];
+			pDestination[x * 3 + 1] = pSource[x * 4 + 1];
+			pDestination[x * 3 + 2] = pSource[x * 4 + 2];
+		}
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method releases everything that was created, in
+ *  reverse order, after the device has gone idle.
+ ***********************************************************/
+void VulkanRenderDevice::Destroy()
+{
+	VULKAN_STATE& s = *m_pState;
+	if (VK_NULL_HANDLE != s.device)
+	{
+		s.vkDeviceWaitIdle(s.device);
+		SavePipelineCache();
+		DestroyTarget();
+
+		for (VkPipeline pipeline : s.pipelines)
+		{
+			s.vkDestroyPipeline(s.device, pipeline, NULL);
+		}
+		s.pipelines.clear();
+		for (VULKAN_TEXTURE& texture : s.textures)
+		{
+			if (VK_NULL_HANDLE != texture.view)
+			{
+				s.vkDestroyImageView(s.device, texture.view, NULL);
+			}
+			s.vkDestroyImage(s.device, texture.image, NULL);
+			s.vkFreeMemory(s.device, texture.memory, NULL);
+		}
+		s.textures.clear();
+		s.defaultTexture = INVALID_DEVICE_HANDLE;
+		for (VULKAN_BUFFER& buffer : s.buffers)
+		{
+			DestroyBuffer(s, buffer);
+		}
+		s.buffers.clear();
+
+		for (int i = 0; i < MAX_COMMAND_LISTS; i++)
+		{
+			if (NULL != s.pCommandLists[i])
+			{
+				s.pCommandLists[i]->Destroy();
+				delete s.pCommandLists[i];
+				s.pCommandLists[i] = NULL;
+			}
+		}
+		if (VK_NULL_HANDLE != s.fence)
+		{
+			s.vkDestroyFence(s.device, s.fence, NULL);
+		}
+		if (VK_NULL_HANDLE != s.primaryPool)
+		{
+			s.vkDestroyCommandPool(s.device, s.primaryPool, NULL);
+		}
+		if (VK_NULL_HANDLE != s.pipelineCache)
+		{
+			s.vkDestroyPipelineCache(s.device, s.pipelineCache, NULL);
+		}
+		if (VK_NULL_HANDLE != s.vertexShader)
+		{
+			s.vkDestroyShaderModule(s.device, s.vertexShader, NULL);
+		}
+		if (VK_NULL_HANDLE != s.fragmentShader)
+		{
+			s.vkDestroyShaderModule(s.device, s.fragmentShader, NULL);
+		}
+		if (NULL != s.pFrameUniforms)
+		{
+			s.vkUnmapMemory(s.device, s.frameUniforms.memory);
+		}
+		DestroyBuffer(s, s.frameUniforms);
+		if (VK_NULL_HANDLE != s.sampler)
+		{
+			s.vkDestroySampler(s.device, s.sampler, NULL);
+		}
+		// the descriptor sets go with their pool
+		if (VK_NULL_HANDLE != s.descriptorPool)
+		{
+			s.vkDestroyDescriptorPool(s.device, s.descriptorPool, NULL);
+		}
+		if (VK_NULL_HANDLE != s.pipelineLayout)
+		{
+			s.vkDestroyPipelineLayout(s.device, s.pipelineLayout, NULL);
+		}
+		if (VK_NULL_HANDLE != s.textureSetLayout)
+		{
+			s.vkDestroyDescriptorSetLayout(s.device, s.textureSetLayout, NULL);
+		}
+		if (VK_NULL_HANDLE != s.frameSetLayout)
+		{
+			s.vkDestroyDescriptorSetLayout(s.device, s.frameSetLayout, NULL);
+		}
+		if (VK_NULL_HANDLE != s.renderPass)
+		{
+			s.vkDestroyRenderPass(s.device, s.renderPass, NULL);
+		}
+		s.vkDestroyDevice(s.device, NULL);
+	}
+	if (VK_NULL_HANDLE != s.instance)
+	{
+		s.vkDestroyInstance(s.instance, NULL);
+	}
+	if (NULL != s.library)
+	{
+#ifdef _WIN32
+		FreeLibrary(s.library);
+#else
+		dlclose(s.library);
+#endif
+	}
+
+	// start over from nothing, so a second Destroy() does no harm
+	*m_pState = VULKAN_STATE();
+}
+
+#else
+
+/***********************************************************
+ *  Built without the Vulkan headers - the backend exists so
+ *  callers need no conditional code, but cannot be created.
+ ***********************************************************/
+struct VULKAN_STATE
+{
+};
+
+VulkanRenderDevice::VulkanRenderDevice()
+{
+	m_pState = NULL;
+	m_name = "Vulkan";
+}
+
+VulkanRenderDevice::~VulkanRenderDevice()
+{
+}
+
+bool VulkanRenderDevice::Create()
+{
+	LOG_ERROR("This build has no Vulkan support - it was compiled without the Vulkan headers");
+	return(false);
+}
+
+BUFFER_HANDLE VulkanRenderDevice::CreateBuffer(BUFFER_USAGE, const void*, size_t)
+{
+	return(INVALID_DEVICE_HANDLE);
+}
+
+TEXTURE_HANDLE VulkanRenderDevice::CreateTexture(const TEXTURE_DESC&)
+{
+	return(INVALID_DEVICE_HANDLE);
+}
+
+PIPELINE_HANDLE VulkanRenderDevice::CreatePipeline(const PIPELINE_DESC&)
+{
+	return(INVALID_DEVICE_HANDLE);
+}
+
+bool VulkanRenderDevice::BeginFrame(int, int, const FRAME_CONSTANTS&)
+{
+	return(false);
+}
+
+RenderCommandList* VulkanRenderDevice::BeginCommandList(int)
+{
+	return(NULL);
+}
+
+void VulkanRenderDevice::EndCommandList(int)
+{
+}
+
+void VulkanRenderDevice::EndFrame(int)
+{
+}
+
+void VulkanRenderDevice::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	pixels.clear();
+}
+
+#endif
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// vulkanrenderdevice.h
+// ============
+// the render device on Vulkan - renders offscreen with no window or surface,
+// so it runs on Mesa's lavapipe on machines without a GPU. Each command list
+// is a secondary command buffer from its own pool, recorded on any thread.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderDevice.h"
+
+#include <string>
+#include <vector>
+
+// the Vulkan objects, kept out of the header so that only the
+// implementation needs the Vulkan headers
+struct VULKAN_STATE;
+
+class VulkanRenderDevice : public RenderDevice
+{
+public:
+	// constructor
+	VulkanRenderDevice();
+	// destructor - saves the pipeline cache for the next run
+	virtual ~VulkanRenderDevice();
+
+	// load the Vulkan loader, pick a device - a GPU when there is one,
+	// otherwise a CPU implementation - and create the objects every
+	// frame uses. Returns false when Vulkan is not available.
+	bool Create();
+
+	virtual const char* GetName() const { return(m_name.c_str()); }
+
+	virtual BUFFER_HANDLE CreateBuffer(BUFFER_USAGE usage, const void* pData, size_t size);
+	virtual TEXTURE_HANDLE CreateTexture(const TEXTURE_DESC& desc);
+	virtual PIPELINE_HANDLE CreatePipeline(const PIPELINE_DESC& desc);
+
+	virtual int GetMaxCommandLists() const { return(MAX_COMMAND_LISTS); }
+
+	virtual bool BeginFrame(int width, int height, const FRAME_CONSTANTS& frameConstants);
+	virtual RenderCommandList* BeginCommandList(int listIndex);
+	virtual void EndCommandList(int listIndex);
+	virtual void EndFrame(int listCount);
+
+	virtual void ReadPixels(std::vector<unsigned char>& pixels);
+
+	static const int MAX_COMMAND_LISTS = 64;
+	// most textures that can be created, each with its own descriptor set
+	static const int MAX_TEXTURES = 256;
+
+private:
+	VULKAN_STATE* m_pState;
+	std::string m_name;
+
+	bool CreateInstance();
+	bool SelectPhysicalDevice();
+	bool CreateLogicalDevice();
+	bool CreateRenderPass();
+	bool CreateLayouts();
+	bool CreateCommandObjects();
+	bool LoadShaderModules();
+	void LoadPipelineCache();
+	void SavePipelineCache();
+	bool CreateTarget(int width, int height);
+	void DestroyTarget();
+	void Destroy();
+};
@@ -1,9 +1,16 @@
 #version 330 core
-out vec4 fragmentColor;
-
-in vec3 fragmentPosition;
-in vec3 fragmentVertexNormal;
-in vec2 fragmentTextureCoordinate;
+layout (location = 0) out vec4 fragmentColor;
+// screen-space motion since the previous frame, in texture coordinates -
+// only stored when the render target has a second color attachment
+layout (location = 1) out vec4 fragmentMotion;
+
+in VertexData {
+    vec3 fragmentPosition;
+    vec3 fragmentVertexNormal;
+    vec2 fragmentTextureCoordinate;
+    vec4 currentClipPosition;
+    vec4 previousClipPosition;
+};
 
 struct Material {
     vec3 diffuseColor;
@@ -123,6 +130,11 @@ void main()
             fragmentColor = objectColor;
         }
     }
+
+    // alpha is 1 so that blended objects replace the motion underneath
+    vec2 currentPosition = currentClipPosition.xy / currentClipPosition.w;
+    vec2 previousPosition = previousClipPosition.xy / previousClipPosition.w;
+    fragmentMotion = vec4((currentPosition - previousPosition) * 0.5f, 0.0f, 1.0f);
 }
 
 // calculates the color when using a directional light.
@@ -0,0 +1,81 @@
+#version 410 core
+// draws every triangle into up to VIEW_COUNT viewports, or layers of a layered
+// render target when LAYERED is defined, from a single submission - one
+// invocation per view, each with its own view-projection. MultiViewRenderer
+// defines both when it compiles each variant.
+layout (triangles, invocations = VIEW_COUNT) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in VertexData {
+    vec3 fragmentPosition;
+    vec3 fragmentVertexNormal;
+    vec2 fragmentTextureCoordinate;
+    vec4 currentClipPosition;
+    vec4 previousClipPosition;
+} geometryIn[];
+
+out VertexData {
+    vec3 fragmentPosition;
+    vec3 fragmentVertexNormal;
+    vec2 fragmentTextureCoordinate;
+    vec4 currentClipPosition;
+    vec4 previousClipPosition;
+};
+
+uniform int viewCount;
+uniform mat4 viewProjections[VIEW_COUNT];
+
+void main()
+{
+    // invocations past the views in use pass nothing on
+    if (gl_InvocationID >= viewCount)
+    {
+        return;
+    }
+
+    vec4 clipPositions[3];
+    for (int i = 0; i < 3; i++)
+    {
+        clipPositions[i] = viewProjections[gl_InvocationID] * vec4(geometryIn[i].fragmentPosition, 1.0);
+    }
+
+    // skip the triangle for this view when all of it lies outside one
+    // of the frustum planes
+    bvec3 outside[6];
+    for (int i = 0; i < 3; i++)
+    {
+        vec4 p = clipPositions[i];
+        outside[0][i] = p.x < -p.w;
+        outside[1][i] = p.x > p.w;
+        outside[2][i] = p.y < -p.w;
+        outside[3][i] = p.y > p.w;
+        outside[4][i] = p.z < -p.w;
+        outside[5][i] = p.z > p.w;
+    }
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (all(outside[plane]))
+        {
+            return;
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        gl_Position = clipPositions[i];
+        // a layered target takes every view at the same viewport
+#ifdef LAYERED
+        gl_Layer = gl_InvocationID;
+#else
+        gl_ViewportIndex = gl_InvocationID;
+#endif
+
+        fragmentPosition = geometryIn[i].fragmentPosition;
+        fragmentVertexNormal = geometryIn[i].fragmentVertexNormal;
+        fragmentTextureCoordinate = geometryIn[i].fragmentTextureCoordinate;
+        currentClipPosition = geometryIn[i].currentClipPosition;
+        previousClipPosition = geometryIn[i].previousClipPosition;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
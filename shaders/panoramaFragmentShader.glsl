@@ -0,0 +1,23 @@
+#version 330 core
+// unwraps a cube map capture into an equirectangular panorama - longitude
+// runs across the image with -Z at the centre, latitude runs up it
+out vec4 fragmentColor;
+
+in vec2 panoramaCoordinate;
+
+uniform samplerCube sceneCube;
+
+const float PI = 3.14159265358979;
+
+void main()
+{
+    float longitude = (panoramaCoordinate.x * 2.0 - 1.0) * PI;
+    float latitude = (panoramaCoordinate.y - 0.5) * PI;
+
+    vec3 direction = vec3(
+        cos(latitude) * sin(longitude),
+        sin(latitude),
+        -cos(latitude) * cos(longitude));
+
+    fragmentColor = vec4(texture(sceneCube, direction).rgb, 1.0);
+}
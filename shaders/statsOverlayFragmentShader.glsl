@@ -0,0 +1,41 @@
+#version 330 core
+out vec4 overlayColor;
+
+// character code of each cell of the text grid, top row first
+uniform usampler2D textCodes;
+// bit rows of the glyphs from the space up, one glyph per column and the
+// top row first, bit 4 being the leftmost pixel
+uniform usampler2D fontRows;
+
+uniform vec2 overlayTopLeft;   // window pixels
+uniform int pixelScale;        // window pixels per font pixel
+uniform int margin;            // font pixels around the text
+
+const ivec2 CELL_SIZE = ivec2(6, 9);
+const ivec2 GLYPH_SIZE = ivec2(5, 7);
+const uint FIRST_GLYPH = 32u;
+
+void main()
+{
+    // font pixel from the top left corner of the text
+    ivec2 windowPixel = ivec2(gl_FragCoord.x - overlayTopLeft.x, overlayTopLeft.y - gl_FragCoord.y);
+    ivec2 fontPixel = windowPixel / pixelScale - ivec2(margin);
+
+    bool bLit = false;
+    ivec2 cell = fontPixel / CELL_SIZE;
+    ivec2 glyphPixel = fontPixel - cell * CELL_SIZE;
+    if (all(greaterThanEqual(fontPixel, ivec2(0))) &&
+        all(lessThan(cell, textureSize(textCodes, 0))) &&
+        all(lessThan(glyphPixel, GLYPH_SIZE)))
+    {
+        uint code = texelFetch(textCodes, cell, 0).r;
+        if ((code >= FIRST_GLYPH) && (code < FIRST_GLYPH + uint(textureSize(fontRows, 0).x)))
+        {
+            uint bits = texelFetch(fontRows, ivec2(int(code - FIRST_GLYPH), glyphPixel.y), 0).r;
+            bLit = ((bits >> uint(GLYPH_SIZE.x - 1 - glyphPixel.x)) & 1u) != 0u;
+        }
+    }
+
+    // white text on a darkened panel
+    overlayColor = bLit ? vec4(1.0f, 1.0f, 1.0f, 1.0f) : vec4(0.0f, 0.0f, 0.0f, 0.6f);
+}
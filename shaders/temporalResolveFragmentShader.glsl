@@ -0,0 +1,88 @@
+#version 330 core
+out vec4 resolvedColor;
+
+in vec2 outputTextureCoordinate;
+
+// this frame, rendered at the reduced resolution with sub-pixel jitter
+uniform sampler2D currentColor;
+uniform sampler2D motionVectors;
+uniform sampler2D sceneDepth;
+// the resolved full-resolution image from the previous frame
+uniform sampler2D historyColor;
+
+uniform vec2 renderSize;        // pixels rendered this frame
+uniform vec2 inputTextureSize;  // allocated size of the input textures
+uniform vec2 jitter;            // projection jitter in render pixels
+uniform mat4 currentInverseViewProjection;
+uniform mat4 previousViewProjection;
+uniform float historyWeight;
+uniform bool bHistoryValid;
+
+void main()
+{
+    // the scene point at this output pixel landed here in the jittered image
+    vec2 renderPosition = outputTextureCoordinate * renderSize + jitter;
+    ivec2 centerTexel = ivec2(clamp(floor(renderPosition), vec2(0.0f), renderSize - 1.0f));
+
+    // gather the neighborhood for history clamping, and the motion of the
+    // closest surface so that edges move with the object in front
+    vec3 neighborhoodMin = vec3(1.0e9f);
+    vec3 neighborhoodMax = vec3(-1.0e9f);
+    float closestDepth = 1.0f;
+    ivec2 closestTexel = centerTexel;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            ivec2 texel = clamp(centerTexel + ivec2(x, y), ivec2(0), ivec2(renderSize) - 1);
+            vec3 neighbor = texelFetch(currentColor, texel, 0).rgb;
+            neighborhoodMin = min(neighborhoodMin, neighbor);
+            neighborhoodMax = max(neighborhoodMax, neighbor);
+
+            float depth = texelFetch(sceneDepth, texel, 0).r;
+            if (depth < closestDepth)
+            {
+                closestDepth = depth;
+                closestTexel = texel;
+            }
+        }
+    }
+
+    // bilinear sample of this frame, kept inside the rendered area
+    vec2 samplePosition = clamp(renderPosition, vec2(0.5f), renderSize - 0.5f);
+    vec3 current = texture(currentColor, samplePosition / inputTextureSize).rgb;
+
+    // where this pixel was in the previous frame - the background has no
+    // motion vectors, so it is reprojected with the camera alone
+    vec2 previousTextureCoordinate;
+    if (closestDepth < 1.0f)
+    {
+        previousTextureCoordinate = outputTextureCoordinate - texelFetch(motionVectors, closestTexel, 0).xy;
+    }
+    else
+    {
+        vec4 farPoint = currentInverseViewProjection * vec4(outputTextureCoordinate * 2.0f - 1.0f, 1.0f, 1.0f);
+        vec4 previousClip = previousViewProjection * vec4(farPoint.xyz / farPoint.w, 1.0f);
+        previousTextureCoordinate = (previousClip.xy / previousClip.w) * 0.5f + 0.5f;
+    }
+
+    if (!bHistoryValid ||
+        any(lessThan(previousTextureCoordinate, vec2(0.0f))) ||
+        any(greaterThan(previousTextureCoordinate, vec2(1.0f))))
+    {
+        resolvedColor = vec4(current, 1.0f);
+        return;
+    }
+
+    // reject history that no longer matches what is visible now
+    vec3 history = texture(historyColor, previousTextureCoordinate).rgb;
+    history = clamp(history, neighborhoodMin, neighborhoodMax);
+
+    // trust this frame more where a rendered sample sits close to the
+    // output pixel, since that is where it carries new detail
+    vec2 sampleOffset = renderPosition - (floor(renderPosition) + 0.5f);
+    float sampleConfidence = exp(-2.0f * dot(sampleOffset, sampleOffset));
+    float currentWeight = (1.0f - historyWeight) * mix(0.5f, 1.5f, sampleConfidence);
+
+    resolvedColor = vec4(mix(history, current, clamp(currentWeight, 0.0f, 1.0f)), 1.0f);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec2 outputTextureCoordinate;
+
+void main()
+{
+   // one triangle that covers the whole viewport, built from the vertex index
+   vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+   outputTextureCoordinate = position;
+   gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -3,18 +3,32 @@ layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
 
-out vec3 fragmentPosition;
-out vec3 fragmentVertexNormal;
-out vec2 fragmentTextureCoordinate;
+// a block so the multi-view geometry shader can pass it through
+out VertexData {
+    vec3 fragmentPosition;
+    vec3 fragmentVertexNormal;
+    vec2 fragmentTextureCoordinate;
+    vec4 currentClipPosition;
+    vec4 previousClipPosition;
+};
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// unjittered matrices of this frame and the previous one, used to write
+// per-object motion vectors for temporal upsampling
+uniform mat4 previousModel;
+uniform mat4 currentViewProjection;
+uniform mat4 previousViewProjection;
+
 void main()
 {
    fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
    gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
    fragmentVertexNormal = inVertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
+
+   currentClipPosition = currentViewProjection * model * vec4(inVertexPosition, 1.0f);
+   previousClipPosition = previousViewProjection * previousModel * vec4(inVertexPosition, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#version 450
+// the scene fragment shader for the Vulkan render device - the lighting of
+// fragmentShader.glsl, without the spot light and motion vectors the device
+// path never uses. Compile with:
+//     glslangValidator -V vulkanSceneFragmentShader.glsl -o vulkanSceneFragmentShader.spv
+layout (location = 0) in vec3 fragmentPosition;
+layout (location = 1) in vec3 fragmentVertexNormal;
+layout (location = 2) in vec2 fragmentTextureCoordinate;
+
+layout (location = 0) out vec4 fragmentColor;
+
+#define TOTAL_POINT_LIGHTS 5
+
+layout (std140, set = 0, binding = 0) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+    vec4 directionalLight[4];
+    vec4 pointLights[TOTAL_POINT_LIGHTS * 4];
+} frame;
+
+layout (push_constant) uniform DrawConstants {
+    mat4 model;
+    vec4 objectColor;
+    vec2 UVscale;
+    int bUseTexture;
+    float shininess;
+    vec4 diffuseColor;
+    vec4 specularColor;
+} draw;
+
+layout (set = 1, binding = 0) uniform sampler2D objectTexture;
+
+// function prototypes
+vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir, vec3 surfaceColor);
+vec3 CalcPointLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 surfaceColor);
+
+void main()
+{
+    vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * draw.UVscale);
+    vec4 surfaceColor = (draw.bUseTexture != 0) ? textureColor : draw.objectColor;
+
+    if(frame.viewPosition.w != 0.0f)
+    {
+        vec3 phongResult = vec3(0.0f);
+        vec3 norm = normalize(fragmentVertexNormal);
+        vec3 viewDir = normalize(frame.viewPosition.xyz - fragmentPosition);
+
+        if(frame.directionalLight[0].w != 0.0f)
+        {
+            phongResult += CalcDirectionalLight(norm, viewDir, surfaceColor.rgb);
+        }
+        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+        {
+            if(frame.pointLights[i * 4].w != 0.0f)
+            {
+                phongResult += CalcPointLight(i, norm, fragmentPosition, viewDir, surfaceColor.rgb);
+            }
+        }
+        fragmentColor = vec4(phongResult, surfaceColor.a);
+    }
+    else
+    {
+        fragmentColor = surfaceColor;
+    }
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir, vec3 surfaceColor)
+{
+    vec3 lightDirection = normalize(-frame.directionalLight[0].xyz);
+    // diffuse shading
+    float diff = max(dot(normal, lightDirection), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), draw.shininess);
+    // combine results
+    vec3 ambient = frame.directionalLight[1].rgb * surfaceColor;
+    vec3 diffuse = frame.directionalLight[2].rgb * diff * draw.diffuseColor.rgb * surfaceColor;
+    vec3 specular = frame.directionalLight[3].rgb * spec * draw.specularColor.rgb * surfaceColor;
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a point light - the specular
+// highlight is not tinted by the surface, as in fragmentShader.glsl
+vec3 CalcPointLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 surfaceColor)
+{
+    vec3 lightDir = normalize(frame.pointLights[index * 4].xyz - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), draw.shininess);
+    // combine results
+    vec3 ambient = frame.pointLights[index * 4 + 1].rgb * surfaceColor;
+    vec3 diffuse = frame.pointLights[index * 4 + 2].rgb * diff * draw.diffuseColor.rgb * surfaceColor;
+    vec3 specular = frame.pointLights[index * 4 + 3].rgb * specularComponent * draw.specularColor.rgb;
+    return (ambient + diffuse + specular);
+}
@@ -0,0 +1,50 @@
+#version 450
+// the scene vertex shader for the Vulkan render device - the transform of
+// vertexShader.glsl with the frame values in a uniform block and the draw
+// values in push constants. Compile with:
+//     glslangValidator -V vulkanSceneVertexShader.glsl -o vulkanSceneVertexShader.spv
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+layout (location = 0) out vec3 fragmentPosition;
+layout (location = 1) out vec3 fragmentVertexNormal;
+layout (location = 2) out vec2 fragmentTextureCoordinate;
+
+#define TOTAL_POINT_LIGHTS 5
+
+// FRAME_UNIFORMS in VulkanRenderDevice.cpp
+layout (std140, set = 0, binding = 0) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    // w is bUseLighting
+    vec4 viewPosition;
+    // direction, ambient, diffuse, specular - the direction's w is bActive
+    vec4 directionalLight[4];
+    // position, ambient, diffuse, specular per light - the position's w is bActive
+    vec4 pointLights[TOTAL_POINT_LIGHTS * 4];
+} frame;
+
+// DRAW_CONSTANTS in RenderDevice.h
+layout (push_constant) uniform DrawConstants {
+    mat4 model;
+    vec4 objectColor;
+    vec2 UVscale;
+    int bUseTexture;
+    float shininess;
+    vec4 diffuseColor;
+    vec4 specularColor;
+} draw;
+
+void main()
+{
+   fragmentPosition = vec3(draw.model * vec4(inVertexPosition, 1.0));
+   gl_Position = frame.projection * frame.view * draw.model * vec4(inVertexPosition, 1.0f);
+   fragmentVertexNormal = inVertexNormal;
+   fragmentTextureCoordinate = inTextureCoordinate;
+
+   // OpenGL clip space to Vulkan's - y points down and depth runs
+   // from 0 to 1 instead of -1 to 1
+   gl_Position.y = -gl_Position.y;
+   gl_Position.z = (gl_Position.z + gl_Position.w) * 0.5f;
+}